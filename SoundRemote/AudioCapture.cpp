@@ -266,6 +266,9 @@ CaptureCoroutine AudioCapture::capture() {
             BufferReleaser bufferReleaser (captureClient_, numFramesAvailable);
 
             //if (flags & AUDCLNT_BUFFERFLAGS_SILENT) {}
+            if (flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY) {
+                ++glitchCount_;
+            }
             const auto size = numFramesAvailable * supportedWaveFormat_->Format.nBlockAlign;
             co_yield{ reinterpret_cast<char*>(pData), size };
             //throw Audio::Error("AudioCapture::capture loop");
@@ -279,6 +282,10 @@ CaptureCoroutine AudioCapture::capture() {
     }
 }
 
+uint64_t AudioCapture::glitchCount() const {
+    return glitchCount_;
+}
+
 bool AudioCapture::resampleRequired() const {
     return resampleRequired_;
 }
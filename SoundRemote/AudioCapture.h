@@ -5,6 +5,7 @@
 
 #include <chrono>
 #include <coroutine>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <span>
@@ -61,6 +62,11 @@ public:
     /// </summary>
     /// <returns>Peak value as a number in range from 0.0 to 1.0. Returns -1 on fail.</returns>
     float getPeakValue() const;
+
+    /// <summary>
+    /// Gets the number of the gaps in the captured audio reported by the device, e.g. on a capture overrun.
+    /// </summary>
+    uint64_t glitchCount() const;
 private:
     using WaveFormat = std::unique_ptr<WAVEFORMATEXTENSIBLE, Audio::CoDeleter<WAVEFORMATEXTENSIBLE>>;
     using BufferDuration = std::chrono::duration<long, std::ratio_multiply<std::hecto, std::nano>>;    //hundreds nanoseconds
@@ -68,6 +74,7 @@ private:
     boost::asio::io_context& ioContext_;
     bool resampleRequired_ = false;
     BufferDuration bufferDuration_ = BufferDuration::zero();
+    uint64_t glitchCount_ = 0;
     std::unique_ptr<Audio::CoUninitializer> coUninitializer_;
 
     WaveFormat requestedWaveFormat_;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+// Audio types and constants without the platform dependencies of AudioUtil.h
+namespace Audio {
+	enum class Compression { none = 0, kbps_64 = 64'000, kbps_128 = 128'000, kbps_192 = 192'000, kbps_256 = 256'000, kbps_320 = 320'000 };
+	// Number of the Compression values
+	constexpr size_t compressionCount = 6;
+	// Gets a zero-based index of the compression, less than compressionCount. Useful for the per compression arrays.
+	constexpr size_t compressionIndex(Compression compression) {
+		switch (compression) {
+		case Compression::kbps_64:
+			return 1;
+		case Compression::kbps_128:
+			return 2;
+		case Compression::kbps_192:
+			return 3;
+		case Compression::kbps_256:
+			return 4;
+		case Compression::kbps_320:
+			return 5;
+		default:
+			return 0;
+		}
+	}
+	// All the Compression values, in the compressionIndex order
+	constexpr std::array<Compression, compressionCount> compressions{ Compression::none, Compression::kbps_64,
+		Compression::kbps_128, Compression::kbps_192, Compression::kbps_256, Compression::kbps_320 };
+
+	namespace Opus {
+		// Supported sample rates
+		enum class SampleRate { khz_8 = 8'000, khz_12 = 12'000, khz_16 = 16'000, khz_24 = 24'000, khz_48 = 48'000 };
+		// Supported channels
+		enum class Channels { mono = 1, stereo = 2 };
+		// Longest Opus frame in ms. Opus can encode frames of 2.5, 5, 10, 20, 40, or 60 ms, see Audio::Opus::FrameLength.
+		// At 48 kHz the permitted values of Opus frame size are 120(2.5ms), 240(5ms), 480(10ms), 960(20ms), 1920(40ms), and 2880(60ms).
+		constexpr int maxFrameLength = 60;
+		// Maximum Opus packet size in bytes, enough for the longest frames.
+		constexpr int maxPacketSize = 2 * static_cast<int>(Compression::kbps_320) * maxFrameLength / (1000 * 8);
+	}
+
+	enum class SampleType {
+		Unknown = 0,
+		SignedInt = 1,
+		UnSignedInt = 2,
+		Float = 3
+	};
+
+	class Error : public std::runtime_error {
+	public:
+		Error(const std::string& what) : std::runtime_error(what) {};
+	};
+}
@@ -7,9 +7,10 @@
 #include <wmcodecdsp.h>
 
 #include "AudioUtil.h"
+#include "FrameRing.h"
 
 AudioResampler::AudioResampler(_In_ const WAVEFORMATEXTENSIBLE* inputFormat, _In_ const WAVEFORMATEXTENSIBLE* outputFormat,
-    _In_ boost::asio::streambuf& outBuffer): outBuffer_(outBuffer) {
+    _In_ FrameRing& outBuffer): outBuffer_(outBuffer) {
     HRESULT hr;
     CComPtr<IUnknown> transformUnk;
     hr = transformUnk.CoCreateInstance(__uuidof(CResamplerMediaObject));
@@ -57,7 +58,7 @@ AudioResampler::~AudioResampler() {
     }
 }
 
-void AudioResampler::resample(_In_ const std::span<char>& pcmAudio) {
+size_t AudioResampler::resample(_In_ const std::span<char>& pcmAudio) {
     HRESULT hr;
 // Create MediaBuffer with incoming data
     CComPtr<IMFMediaBuffer> inSampleBuffer;
@@ -102,6 +103,7 @@ void AudioResampler::resample(_In_ const std::span<char>& pcmAudio) {
         outputDataBuffer.pSample = outSample;
     }
     DWORD totalBytesResampled = 0;
+    size_t droppedBytes = 0;
     for (;;) {
         DWORD dwStatus = 0;
         hr = transform_->ProcessOutput(0, 1, &outputDataBuffer, &dwStatus);
@@ -125,9 +127,11 @@ void AudioResampler::resample(_In_ const std::span<char>& pcmAudio) {
         BYTE* outBytes = nullptr;
         hr = processedDataBuffer->Lock(&outBytes, nullptr, nullptr);
         throwOnError(hr, Audio::Location::RESAMPLER_PROCESSED_BUFFER_LOCK);
-        outBuffer_.sputn(reinterpret_cast<char*>(outBytes), cbBytes);
+        // The frames are drained after every capture, so the ring fills up only with a capture longer than it
+        droppedBytes += cbBytes - outBuffer_.write({ reinterpret_cast<const char*>(outBytes), cbBytes });
         totalBytesResampled += cbBytes;
         hr = processedDataBuffer->Unlock();
         throwOnError(hr, Audio::Location::RESAMPLER_PROCESSED_BUFFER_UNLOCK);
     };
+    return droppedBytes;
 }
@@ -6,18 +6,21 @@
 
 #include <span>
 
-#include <boost/asio/streambuf.hpp>
-
+class FrameRing;
 struct IMFTransform;
 
 class AudioResampler {
 public:
 	AudioResampler(_In_ const WAVEFORMATEXTENSIBLE* inputFormat, _In_ const WAVEFORMATEXTENSIBLE* outputFormat,
-		_In_ boost::asio::streambuf& outBuffer);
+		_In_ FrameRing& outBuffer);
 	~AudioResampler();
-    void resample(_In_ const std::span<char>& pcmAudio);
+	/// <summary>
+	/// Resamples the audio into the frame buffer.
+	/// </summary>
+	/// <returns>Bytes of the resampled audio dropped as the frame buffer was full.</returns>
+	size_t resample(_In_ const std::span<char>& pcmAudio);
 private:
 	CComPtr<IMFTransform> transform_;
-	boost::asio::streambuf& outBuffer_;
+	FrameRing& outBuffer_;
 	double outBufferSizeMultiplier_ = 0.0;
 };
@@ -2,10 +2,10 @@
 
 #include <mmdeviceapi.h>
 
-#include <stdexcept>
 #include <string>
 #include <unordered_map>
 
+#include "AudioDefines.h"
 #include "Util.h"
 
 #define EXIT_ON_ERROR(hres)  \
@@ -27,27 +27,6 @@ namespace Audio {
 	constexpr auto defaultRenderDeviceId = -1;
 	constexpr auto defaultCaptureDeviceId = -2;
 
-	enum class Compression { none = 0, kbps_64 = 64'000, kbps_128 = 128'000, kbps_192 = 192'000, kbps_256 = 256'000, kbps_320 = 320'000 };
-
-	namespace Opus {
-		// Supported sample rates
-		enum class SampleRate { khz_8 = 8'000, khz_12 = 12'000, khz_16 = 16'000, khz_24 = 24'000, khz_48 = 48'000 };
-		// Supported channels
-		enum class Channels { mono = 1, stereo = 2 };
-		// Opus frame length in ms. Opus can encode frames of 2.5, 5, 10, 20, 40, or 60 ms. This value determines Opus frame size.
-		// At 48 kHz the permitted values of Opus frame size are 120(2.5ms), 240(5ms), 480(10ms), 960(20ms), 1920(40ms), and 2880(60ms).
-		constexpr int frameLength = 10;
-		// Maximum Opus packet size in bytes.
-		constexpr int maxPacketSize = 2 * static_cast<int>(Compression::kbps_320) * frameLength / (1000 * 8);
-	}
-
-	enum class SampleType {
-		Unknown = 0,
-		SignedInt = 1,
-		UnSignedInt = 2,
-		Float = 3
-	};
-
 	enum class Location {
 		NOWHERE = 0,
 		CAPTURE_COINITIALIZE = 1,
@@ -103,6 +82,15 @@ namespace Audio {
 		ENCODER_CREATE = 202,
 		ENCODER_SET_BITRATE= 203,
 		ENCODER_ENCODE = 204,
+		ENCODER_SET_DTX = 205,
+		ENCODER_SET_COMPLEXITY = 206,
+		ENCODER_SET_MAX_BANDWIDTH = 207,
+		ENCODER_SET_VBR = 208,
+		ENCODER_SET_LSB_DEPTH = 209,
+		ENCODER_SET_PACKET_LOSS = 210,
+		ENCODER_SET_INBAND_FEC = 211,
+		ENCODER_REPACKETIZER_CREATE = 212,
+		ENCODER_REPACKETIZER_OUT = 213,
 
 		UTIL_GETDEVICES_COINITIALIZE = 301,
 		UTIL_GETDEVICES_CREATE_ENUMERATOR = 302,
@@ -130,11 +118,6 @@ namespace Audio {
 
 // Utility classes and structs
 
-	class Error : public std::runtime_error {
-	public:
-		Error(const std::string& what) : std::runtime_error(what) {};
-	};
-
 	// Function object to be used as a deleter with std::unique_ptr to the objects requiring CoTaskMemFree.
 	// std::unique_ptr<tWAVEFORMATEX, Audio::CoDeleter<tWAVEFORMATEX>> waveFormat;
 	template<typename T>
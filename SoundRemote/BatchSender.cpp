@@ -0,0 +1,86 @@
+#include "BatchSender.h"
+
+#include <algorithm>
+#include <cerrno>
+
+using boost::asio::ip::udp;
+
+BatchSender::BatchSender(udp::socket& socket) : socket_(socket) {}
+
+size_t BatchSender::send(
+    std::span<const boost::asio::const_buffer> datagram,
+    std::span<const udp::endpoint> destinations,
+    boost::system::error_code& ec
+) {
+    ec.clear();
+    if (destinations.empty()) { return 0; }
+    ++stats_.batches;
+#if defined(__linux__)
+    const size_t sent = sendMultiple(datagram, destinations, ec);
+#else
+    const size_t sent = sendEach(datagram, destinations, ec);
+#endif
+    stats_.datagrams += sent;
+    return sent;
+}
+
+const BatchSender::Stats& BatchSender::stats() const {
+    return stats_;
+}
+
+size_t BatchSender::sendEach(
+    std::span<const boost::asio::const_buffer> datagram,
+    std::span<const udp::endpoint> destinations,
+    boost::system::error_code& ec
+) {
+    size_t sent = 0;
+    for (; sent < destinations.size(); ++sent) {
+        ++stats_.syscalls;
+        socket_.send_to(datagram, destinations[sent], 0, ec);
+        if (ec) { break; }
+    }
+    return sent;
+}
+
+#if defined(__linux__)
+size_t BatchSender::sendMultiple(
+    std::span<const boost::asio::const_buffer> datagram,
+    std::span<const udp::endpoint> destinations,
+    boost::system::error_code& ec
+) {
+    // All the messages share the same iovec array, only the destination differs.
+    if (iovecs_.size() < datagram.size()) {
+        iovecs_.resize(datagram.size());
+    }
+    for (size_t i = 0; i < datagram.size(); ++i) {
+        iovecs_[i].iov_base = const_cast<void*>(datagram[i].data());
+        iovecs_[i].iov_len = datagram[i].size();
+    }
+    size_t sent = 0;
+    while (sent < destinations.size()) {
+        const size_t count = std::min(destinations.size() - sent, maxBatchSize_);
+        if (messages_.size() < count) {
+            messages_.resize(count);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            const auto& destination = destinations[sent + i];
+            msghdr& header = messages_[i].msg_hdr;
+            header = {};
+            header.msg_name = const_cast<void*>(static_cast<const void*>(destination.data()));
+            header.msg_namelen = static_cast<socklen_t>(destination.size());
+            header.msg_iov = iovecs_.data();
+            header.msg_iovlen = datagram.size();
+        }
+        ++stats_.syscalls;
+        const int result = ::sendmmsg(socket_.native_handle(), messages_.data(), static_cast<unsigned int>(count),
+            MSG_DONTWAIT);
+        if (result < 0) {
+            ec = boost::system::error_code(errno, boost::asio::error::get_system_category());
+            break;
+        }
+        // A short count means the next message failed, the following call reports why.
+        sent += result;
+    }
+    return sent;
+}
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/ip/udp.hpp>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#endif
+
+/// <summary>
+/// Sends one datagram to many destinations using as few system calls as the platform allows.
+/// On Linux all the destinations go out in <c>sendmmsg</c> calls, elsewhere it falls back to a loop of
+/// non-blocking <c>send_to</c> calls.
+/// </summary>
+class BatchSender {
+public:
+	struct Stats {
+		size_t batches = 0;
+		size_t datagrams = 0;
+		size_t syscalls = 0;
+	};
+
+	/// <summary>
+	/// Creates BatchSender.
+	/// </summary>
+	/// <param name="socket">Socket to send with. Must be open and in non-blocking mode.</param>
+	explicit BatchSender(boost::asio::ip::udp::socket& socket);
+
+	/// <summary>
+	/// Sends a datagram to the destinations without blocking. Stops at the first destination that fails.
+	/// </summary>
+	/// <param name="datagram">- buffers gathered into a single datagram</param>
+	/// <param name="destinations">- endpoints to send the datagram to</param>
+	/// <param name="ec">- set to the error that stopped the batch. <c>boost::asio::error::would_block</c> means
+	/// the socket send buffer is full and the rest of the destinations can be retried when it's writable.</param>
+	/// <returns>Number of the destinations the datagram was sent to.</returns>
+	size_t send(
+		std::span<const boost::asio::const_buffer> datagram,
+		std::span<const boost::asio::ip::udp::endpoint> destinations,
+		boost::system::error_code& ec
+	);
+	const Stats& stats() const;
+private:
+	size_t sendEach(
+		std::span<const boost::asio::const_buffer> datagram,
+		std::span<const boost::asio::ip::udp::endpoint> destinations,
+		boost::system::error_code& ec
+	);
+
+	boost::asio::ip::udp::socket& socket_;
+	Stats stats_;
+#if defined(__linux__)
+	// Max messages passed to a single sendmmsg call
+	static constexpr size_t maxBatchSize_ = 64;
+
+	size_t sendMultiple(
+		std::span<const boost::asio::const_buffer> datagram,
+		std::span<const boost::asio::ip::udp::endpoint> destinations,
+		boost::system::error_code& ec
+	);
+
+	// Kept between calls so sending doesn't allocate once they have grown to the batch size
+	std::vector<iovec> iovecs_;
+	std::vector<mmsghdr> messages_;
+#endif
+};
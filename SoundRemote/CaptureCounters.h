@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// Plain copy of <c>CaptureCounters</c>.
+/// </summary>
+struct CaptureStats {
+	uint64_t bufferedBytes = 0;
+	uint64_t captureGlitches = 0;
+	uint64_t encodeFailures = 0;
+	uint64_t encodeQueueDepth = 0;
+	uint64_t sendQueueDepth = 0;
+	uint64_t captureStalls = 0;
+	uint64_t encodeStalls = 0;
+	uint64_t silentFrames = 0;
+	uint64_t ringDroppedBytes = 0;
+	friend bool operator==(const CaptureStats& lhs, const CaptureStats& rhs) = default;
+};
+
+/// <summary>
+/// Counters of the capture pipeline, updated by the pipe and read from any thread without locking.
+/// </summary>
+struct CaptureCounters {
+	// Audio waiting in the frame buffer for a complete frame
+	std::atomic<uint64_t> bufferedBytes = 0;
+	// Gaps in the captured audio the device reported, the audio in them is lost
+	std::atomic<uint64_t> captureGlitches = 0;
+	// Frames not sent to the clients of a compression as the encoding failed
+	std::atomic<uint64_t> encodeFailures = 0;
+	// Frames the capture thread queued for the encoder thread and the ones the encoder thread took.
+	// Each side counts its own end of the queue, the difference is the depth.
+	std::atomic<uint64_t> encodeQueued = 0;
+	std::atomic<uint64_t> encodeDequeued = 0;
+	// Encoded frames the encoder thread queued for the network thread and the ones the network thread took
+	std::atomic<uint64_t> sendQueued = 0;
+	std::atomic<uint64_t> sendDequeued = 0;
+	// Frames the capture thread dropped as the encode queue was full
+	std::atomic<uint64_t> captureStalls = 0;
+	// Encoded frames the encoder thread dropped as the send queue was full
+	std::atomic<uint64_t> encodeStalls = 0;
+	// Frames not encoded nor sent as they were silence
+	std::atomic<uint64_t> silentFrames = 0;
+	// Captured audio dropped as the frame buffer was full, in bytes
+	std::atomic<uint64_t> ringDroppedBytes = 0;
+
+	void setBuffered(size_t bytes) {
+		bufferedBytes.store(bytes, std::memory_order_relaxed);
+	}
+	void countGlitches(uint64_t glitches) {
+		captureGlitches.fetch_add(glitches, std::memory_order_relaxed);
+	}
+	void countEncodeFailure() {
+		encodeFailures.fetch_add(1, std::memory_order_relaxed);
+	}
+	void countEncodeQueued() {
+		encodeQueued.fetch_add(1, std::memory_order_relaxed);
+	}
+	void countEncodeDequeued() {
+		encodeDequeued.fetch_add(1, std::memory_order_relaxed);
+	}
+	void countSendQueued() {
+		sendQueued.fetch_add(1, std::memory_order_relaxed);
+	}
+	void countSendDequeued() {
+		sendDequeued.fetch_add(1, std::memory_order_relaxed);
+	}
+	void countCaptureStall() {
+		captureStalls.fetch_add(1, std::memory_order_relaxed);
+	}
+	void countEncodeStall() {
+		encodeStalls.fetch_add(1, std::memory_order_relaxed);
+	}
+	void countSilentFrame() {
+		silentFrames.fetch_add(1, std::memory_order_relaxed);
+	}
+	void countRingDropped(size_t bytes) {
+		ringDroppedBytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+	CaptureStats load() const {
+		return {
+			bufferedBytes.load(std::memory_order_relaxed),
+			captureGlitches.load(std::memory_order_relaxed),
+			encodeFailures.load(std::memory_order_relaxed),
+			depthOf(encodeQueued, encodeDequeued),
+			depthOf(sendQueued, sendDequeued),
+			captureStalls.load(std::memory_order_relaxed),
+			encodeStalls.load(std::memory_order_relaxed),
+			silentFrames.load(std::memory_order_relaxed),
+			ringDroppedBytes.load(std::memory_order_relaxed)
+		};
+	}
+private:
+	static uint64_t depthOf(const std::atomic<uint64_t>& queued, const std::atomic<uint64_t>& dequeued) {
+		// A frame may be taken before the other side counts it queued
+		const auto taken = dequeued.load(std::memory_order_relaxed);
+		const auto added = queued.load(std::memory_order_relaxed);
+		return added > taken ? added - taken : 0;
+	}
+};
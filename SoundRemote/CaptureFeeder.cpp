@@ -0,0 +1,114 @@
+#include "CaptureFeeder.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include <boost/asio/post.hpp>
+
+#include "CaptureSource.h"
+#include "EncoderStage.h"
+#include "FrameRing.h"
+
+CaptureFeeder::CaptureFeeder(CaptureSource& source, FrameRing& frameRing, std::shared_ptr<EncoderStage> encoder,
+    boost::asio::io_context& ioContext, std::shared_ptr<CaptureCounters> counters,
+    std::shared_ptr<PipelineLatency> latency, bool muted) :
+    source_(source),
+    frameRing_(frameRing),
+    encoder_(std::move(encoder)),
+    ioContext_(ioContext),
+    counters_(std::move(counters)),
+    latency_(std::move(latency)),
+    muted_(muted) {}
+
+CaptureFeeder::~CaptureFeeder() {
+    stop();
+}
+
+void CaptureFeeder::start() {
+    thread_ = std::thread(&CaptureFeeder::run, this);
+}
+
+void CaptureFeeder::stop() {
+    source_.stopCapture();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void CaptureFeeder::setMuted(bool muted) {
+    muted_ = muted;
+}
+
+void CaptureFeeder::run() {
+    try {
+        source_.capture([this](std::span<char> audio) { onCaptured(audio); });
+    }
+    catch (...) {
+        // Handled on the network thread along with the errors of its own tasks
+        boost::asio::post(ioContext_, [error = std::current_exception()] { std::rethrow_exception(error); });
+    }
+}
+
+void CaptureFeeder::onCaptured(std::span<char> audio) {
+    const auto captured = PipelineLatency::now();
+    if (const auto glitches = source_.glitchCount(); glitches != glitchesCounted_) {
+        counters_->countGlitches(glitches - glitchesCounted_);
+        glitchesCounted_ = glitches;
+    }
+    if (!muted_ && encoder_->haveClients()) {
+        process(audio, captured);
+    }
+}
+
+void CaptureFeeder::process(std::span<char> audio, PipelineLatency::TimePoint captured) {
+    using Stage = PipelineLatency::Stage;
+    // Checked before the source may convert into the ring
+    const bool hadPartial = frameRing_.partialSize() > 0;
+    const auto converted = source_.convert(audio);
+    // Completes the frame left from the previous capture first, the rest is framed in place without copying
+    const auto partial = frameRing_.partialSize();
+    const auto topUp = partial == 0 ? 0 : std::min(converted.size(), frameRing_.frameSize() - partial);
+    writeToRing(converted.first(topUp));
+    auto direct = std::span<const char>(converted).subspan(topUp);
+    const auto resampled = PipelineLatency::now();
+    latency_->record(Stage::resample, captured, resampled);
+    // Only the frame left from the previous capture started before this one
+    auto frameStarted = hadPartial ? partialStarted_ : resampled;
+    bool completed = false;
+    // The ring frames are handed over in the buffers they were gathered in
+    while (auto frame = frameRing_.take()) {
+        pushFrame(std::move(frame), captured, frameStarted);
+        frameStarted = resampled;
+        completed = true;
+    }
+    const auto frameSize = frameRing_.frameSize();
+    for (; direct.size() >= frameSize; direct = direct.subspan(frameSize)) {
+        pushFrame(direct.first(frameSize), captured, resampled);
+        completed = true;
+    }
+    // The rest waits in the ring for the next capture
+    writeToRing(direct);
+    if (!hadPartial || completed) {
+        partialStarted_ = resampled;
+    }
+    counters_->setBuffered(frameRing_.size());
+}
+
+void CaptureFeeder::writeToRing(std::span<const char> audio) {
+    const auto written = frameRing_.write(audio);
+    if (written < audio.size()) {
+        counters_->countRingDropped(audio.size() - written);
+    }
+}
+
+template <typename Frame>
+void CaptureFeeder::pushFrame(
+    Frame pcmFrame,
+    PipelineLatency::TimePoint captured,
+    PipelineLatency::TimePoint frameStarted
+) {
+    latency_->record(PipelineLatency::Stage::frame, frameStarted, PipelineLatency::now());
+    // A dropped frame is counted as a stall, the capture goes on
+    encoder_->push(std::move(pcmFrame), captured);
+}
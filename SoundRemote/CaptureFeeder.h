@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <span>
+#include <thread>
+
+#include <boost/asio/io_context.hpp>
+
+#include "CaptureCounters.h"
+#include "PipelineLatency.h"
+
+class CaptureSource;
+class EncoderStage;
+class FrameRing;
+
+/// <summary>
+/// Capture thread of the pipeline. Runs the capture source, frames its audio and pushes the frames to the
+/// encoder stage. Doesn't depend on the capture device, so it runs with a synthetic source in the tests.
+/// </summary>
+class CaptureFeeder {
+public:
+	/// <param name="source">Source of the audio, must outlive the feeder</param>
+	/// <param name="frameRing">Audio waiting for a complete frame, the source may convert its audio into it</param>
+	/// <param name="ioContext">Context of the network thread. The capture errors are rethrown on it.</param>
+	/// <param name="counters">Counters of the pipeline, may outlive the feeder</param>
+	/// <param name="latency">Latencies of the pipeline stages, may outlive the feeder</param>
+	CaptureFeeder(CaptureSource& source, FrameRing& frameRing, std::shared_ptr<EncoderStage> encoder,
+		boost::asio::io_context& ioContext, std::shared_ptr<CaptureCounters> counters,
+		std::shared_ptr<PipelineLatency> latency, bool muted = false);
+	~CaptureFeeder();
+	/// <summary>
+	/// Starts the capture thread.
+	/// </summary>
+	void start();
+	/// <summary>
+	/// Stops the source and waits for the capture thread to finish.
+	/// </summary>
+	void stop();
+	void setMuted(bool muted);
+private:
+	// Capture thread
+	void run();
+	// Handles a block of the source
+	void onCaptured(std::span<char> audio);
+	void process(std::span<char> audio, PipelineLatency::TimePoint captured);
+	// Writes the audio to the frame ring, counts the audio not fitting it as dropped
+	void writeToRing(std::span<const char> audio);
+	// Hands the frame, a span or a PacketPtr, over to the encoder stage.
+	// frameStarted is the time its first audio was resampled.
+	template <typename Frame>
+	void pushFrame(Frame pcmFrame, PipelineLatency::TimePoint captured,
+		PipelineLatency::TimePoint frameStarted);
+
+	CaptureSource& source_;
+	FrameRing& frameRing_;
+	std::shared_ptr<EncoderStage> encoder_;
+	boost::asio::io_context& ioContext_;
+	std::shared_ptr<CaptureCounters> counters_;
+	std::shared_ptr<PipelineLatency> latency_;
+	std::atomic_bool muted_ = false;
+	// Capture thread, time the first audio of the partial frame in frameRing_ was resampled
+	PipelineLatency::TimePoint partialStarted_{};
+	// Capture thread, glitches of the source already added to counters_
+	uint64_t glitchesCounted_ = 0;
+	std::thread thread_;
+};
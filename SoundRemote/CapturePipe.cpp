@@ -1,13 +1,20 @@
 #include "CapturePipe.h"
 
+#include <algorithm>
+#include <chrono>
 #include <coroutine>
-#include <unordered_set>
+#include <exception>
 
 #include "AudioCapture.h"
 #include "AudioResampler.h"
 #include "AudioUtil.h"
+#include "CaptureFeeder.h"
 #include "Clients.h"
+#include "DownMixer.h"
 #include "EncoderOpus.h"
+#include "EncoderStage.h"
+#include "PolyphaseResampler.h"
+#include "SampleConverter.h"
 #include "Server.h"
 #include "Util.h"
 
@@ -35,19 +42,135 @@ struct [[nodiscard]] PipeCoroutine {
     //PipeCoroutine(const PipeCoroutine&) = delete;
 };
 
-Net::Packet::SequenceNumberType CapturePipe::audioSequenceNumber_ = 1u;
+namespace {
+    // Audio the frame ring holds
+    constexpr std::chrono::milliseconds frameRingDuration{ 320 };
+    // Audio each queue of the encoder stage holds
+    constexpr std::chrono::milliseconds encoderQueueDuration{ 160 };
 
-CapturePipe::CapturePipe(const std::wstring& deviceId, std::shared_ptr<Server> server, boost::asio::io_context& ioContext, bool muted):
-    device_(deviceId), server_(server), io_context_(ioContext), muted_(muted) {
+    // Frames of the duration rounded up, at least the minimum
+    size_t framesOf(std::chrono::microseconds duration, Audio::Opus::FrameLength frameLength, size_t minFrames) {
+        const auto length = static_cast<int>(frameLength);
+        return std::max<size_t>(static_cast<size_t>((duration.count() + length - 1) / length), minFrames);
+    }
+
+    // Frames each queue of the encoder stage holds
+    size_t encoderQueueCapacity(Audio::Opus::FrameLength frameLength) {
+        return framesOf(encoderQueueDuration, frameLength, EncoderStage::defaultQueueCapacity);
+    }
+
+    size_t pcmFrameSize(Audio::Opus::FrameLength frameLength, Audio::SampleType sampleType) {
+        return EncoderOpus::getInputSize(EncoderOpus::getFrameSize(Audio::Opus::SampleRate::khz_48, frameLength),
+            Audio::Opus::Channels::stereo, sampleType);
+    }
+
+    SampleFormat sampleFormatOf(const WAVEFORMATEXTENSIBLE& waveFormat) {
+        bool isFloat = false;
+        bool isPcm = false;
+        if (waveFormat.Format.wFormatTag == WAVE_FORMAT_EXTENSIBLE) {
+            isFloat = IsEqualGUID(waveFormat.SubFormat, KSDATAFORMAT_SUBTYPE_IEEE_FLOAT);
+            isPcm = IsEqualGUID(waveFormat.SubFormat, KSDATAFORMAT_SUBTYPE_PCM);
+        } else {
+            isFloat = waveFormat.Format.wFormatTag == WAVE_FORMAT_IEEE_FLOAT;
+            isPcm = waveFormat.Format.wFormatTag == WAVE_FORMAT_PCM;
+        }
+        // The container size, the valid bits of a 32 bit container are the upper ones
+        const auto bits = waveFormat.Format.wBitsPerSample;
+        if (isFloat && bits == 32) {
+            return SampleFormat::float32;
+        }
+        if (isPcm) {
+            switch (bits) {
+            case 16:
+                return SampleFormat::int16;
+            case 24:
+                return SampleFormat::int24;
+            case 32:
+                return SampleFormat::int32;
+            }
+        }
+        return SampleFormat::unsupported;
+    }
+
+    // The captured audio needs only its samples converted to match the requested format
+    bool onlySampleFormatDiffers(const WAVEFORMATEXTENSIBLE& captured, const WAVEFORMATEXTENSIBLE& requested) {
+        return captured.Format.nSamplesPerSec == requested.Format.nSamplesPerSec &&
+            captured.Format.nChannels == requested.Format.nChannels &&
+            sampleFormatOf(captured) != SampleFormat::unsupported &&
+            sampleFormatOf(requested) == SampleFormat::int16;
+    }
+
+    // The float audio of the shared mode mix format can be mixed to stereo and resampled without Media Foundation
+    bool convertibleFloat(const WAVEFORMATEXTENSIBLE& captured, const WAVEFORMATEXTENSIBLE& requested) {
+        const auto capturedRate = captured.Format.nSamplesPerSec;
+        const auto requestedRate = requested.Format.nSamplesPerSec;
+        return sampleFormatOf(captured) == SampleFormat::float32 &&
+            sampleFormatOf(requested) == SampleFormat::int16 &&
+            requested.Format.nChannels == 2 &&
+            (capturedRate == requestedRate || PolyphaseResampler::supports(capturedRate, requestedRate));
+    }
+
+    uint32_t channelMaskOf(const WAVEFORMATEXTENSIBLE& waveFormat) {
+        return waveFormat.Format.wFormatTag == WAVE_FORMAT_EXTENSIBLE ? waveFormat.dwChannelMask : 0;
+    }
+
+    // Float frames skip the conversion to int16 and back in the encoders
+    Audio::SampleType frameSampleType(const AudioCapture& audioCapture) {
+        if (audioCapture.resampleRequired() &&
+            convertibleFloat(*audioCapture.capturedWaveFormat(), *audioCapture.requestedWaveFormat())) {
+            return Audio::SampleType::Float;
+        }
+        return Audio::SampleType::SignedInt;
+    }
+}
+
+CapturePipe::CapturePipe(const std::wstring& deviceId, std::shared_ptr<Server> server, boost::asio::io_context& ioContext,
+    std::shared_ptr<CaptureCounters> counters, std::shared_ptr<PipelineLatency> latency, size_t encoderThreads,
+    bool muted, const Audio::Opus::Profile& opusProfile):
+    device_(deviceId),
+    audioCapture_(std::make_unique<AudioCapture>(deviceId, Audio::Format{}, captureContext_)),
+    sampleType_(frameSampleType(*audioCapture_)), opusProfile_(opusProfile),
+    frameRing_(pcmFrameSize(opusProfile.frameLength, sampleType_),
+        framesOf(frameRingDuration, opusProfile.frameLength, 2),
+        // A frame taken out of the ring may wait in both queues of the encoder stage
+        2 * encoderQueueCapacity(opusProfile.frameLength)),
+    counters_(counters), latency_(latency) {
     //throw std::runtime_error("CapturePipe::ctr");
-    Audio::Format requestedFormat;
-    audioCapture_ = std::make_unique<AudioCapture>(deviceId, requestedFormat, ioContext);
     if (audioCapture_->resampleRequired()) {
         auto capturedWaveFormat = audioCapture_->capturedWaveFormat();
         auto requestedWaveFormat = audioCapture_->requestedWaveFormat();
-        audioResampler_ = std::make_unique<AudioResampler>(capturedWaveFormat, requestedWaveFormat, pcmAudioBuffer_);
+        const auto& captured = capturedWaveFormat->Format;
+        const auto& requested = requestedWaveFormat->Format;
+        if (sampleType_ == Audio::SampleType::Float) {
+            if (captured.nChannels != requested.nChannels) {
+                downMixer_ = std::make_unique<DownMixer>(channelMaskOf(*capturedWaveFormat), captured.nChannels, false);
+            }
+            if (captured.nSamplesPerSec != requested.nSamplesPerSec) {
+                polyphaseResampler_ = std::make_unique<PolyphaseResampler>(captured.nSamplesPerSec,
+                    requested.nSamplesPerSec, requested.nChannels);
+            }
+        } else if (onlySampleFormatDiffers(*capturedWaveFormat, *requestedWaveFormat)) {
+            sampleConverter_ = std::make_unique<SampleConverter>(sampleFormatOf(*capturedWaveFormat), true);
+        } else {
+            audioResampler_ = std::make_unique<AudioResampler>(capturedWaveFormat, requestedWaveFormat, frameRing_);
+        }
     }
-    opusInputSize_ = EncoderOpus::getInputSize(EncoderOpus::getFrameSize(Audio::Opus::SampleRate::khz_48), Audio::Opus::Channels::stereo);
+    auto sink = [weakServer = std::weak_ptr(server)](Audio::Compression compression,
+        Net::Packet::SequenceNumberType sequenceNumber, const PacketPtr& audioData) {
+        const auto server = weakServer.lock();
+        if (!server) {
+            return;
+        }
+        if (!audioData) {
+            server->sendSilence(compression, sequenceNumber);
+        } else {
+            server->sendAudio(compression, sequenceNumber, audioData);
+        }
+    };
+    encoder_ = EncoderStage::create(frameRing_.frameSize(), ioContext, std::move(sink), counters_, latency_,
+        encoderThreads, encoderQueueCapacity(opusProfile_.frameLength), sampleType_, opusProfile_);
+    feeder_ = std::make_unique<CaptureFeeder>(static_cast<CaptureSource&>(*this), frameRing_, encoder_, ioContext,
+        counters_, latency_, muted);
 }
 
 CapturePipe::~CapturePipe() {
@@ -55,7 +178,7 @@ CapturePipe::~CapturePipe() {
 }
 
 void CapturePipe::start() {
-    pipeCoro_ = std::make_unique<PipeCoroutine>(process());
+    feeder_->start();
 }
 
 float CapturePipe::getPeakValue() const {
@@ -63,93 +186,95 @@ float CapturePipe::getPeakValue() const {
 }
 
 void CapturePipe::setMuted(bool muted) {
-    muted_ = muted;
+    feeder_->setMuted(muted);
 }
 
-void CapturePipe::onClientsUpdate(std::forward_list<ClientInfo> clients) {
-    std::unordered_set<Audio::Compression> newCompressions;
-    std::unordered_set<Audio::Compression> existingCompressions;
+void CapturePipe::onClientsSnapshot(const std::forward_list<ClientInfo>& clients, uint64_t version) {
+    encoder_->clearClients();
     for (auto&& client : clients) {
-        if (encoders_.contains(client.compression)) {
-            existingCompressions.insert(client.compression);
-        } else {
-            newCompressions.insert(client.compression);
-        }
-    }
-
-    if (newCompressions.empty() && existingCompressions.size() == encoders_.size()) {
-        return;
+        encoder_->addClient(client.compression, client.lossPercent);
     }
+}
 
-    std::erase_if(encoders_, [&](const auto& item) {
-        return !existingCompressions.contains(item.first);
-    });
-    for (auto&& it: newCompressions) {
-        if (it == Audio::Compression::none) {
-            encoders_[it] = std::unique_ptr<EncoderOpus>();
-        } else {
-            encoders_[it] = std::make_unique<EncoderOpus>(it, Audio::Opus::SampleRate::khz_48,
-                Audio::Opus::Channels::stereo);
+void CapturePipe::onClientsDelta(const ClientsDelta& delta) {
+    switch (delta.type) {
+    case ClientsDelta::Type::added:
+        encoder_->addClient(delta.client.compression, delta.client.lossPercent);
+        break;
+    case ClientsDelta::Type::removed:
+        encoder_->removeClient(delta.client.compression, delta.client.lossPercent);
+        break;
+    case ClientsDelta::Type::formatChanged:
+        if (delta.previous && delta.previous->compression == delta.client.compression &&
+            delta.previous->lossPercent == delta.client.lossPercent) {
+            break;
+        }
+        if (delta.previous) {
+            encoder_->removeClient(delta.previous->compression, delta.previous->lossPercent);
         }
+        encoder_->addClient(delta.client.compression, delta.client.lossPercent);
+        break;
     }
 }
 
+void CapturePipe::capture(const Handler& handler) {
+    handler_ = &handler;
+    pipeCoro_ = std::make_unique<PipeCoroutine>(process());
+    captureContext_.run();
+}
+
+void CapturePipe::stopCapture() {
+    captureContext_.stop();
+}
+
+uint64_t CapturePipe::glitchCount() const {
+    return audioCapture_->glitchCount();
+}
+
 PipeCoroutine CapturePipe::process() {
     //throw std::runtime_error("CapturePipe::process start");
     auto audioCapture = audioCapture_->capture();
     for (;;) {
         auto capturedAudio = co_await audioCapture;
-        if (!muted_) {
-            auto server = server_.lock();
-            if (server && haveClients()) {
-                process(capturedAudio, server);
-            }
-        }
+        (*handler_)(capturedAudio);
         //throw std::runtime_error("CapturePipe::process loop");
         audioCapture.h_();
     }
 }
 
 void CapturePipe::stop() {
+    feeder_->stop();
     if (pipeCoro_) {
         pipeCoro_->h_.destroy();
         pipeCoro_.reset();
     }
 }
 
-bool CapturePipe::haveClients() const {
-    return !encoders_.empty();
-}
-
-void CapturePipe::process(std::span<char> pcmAudio, std::shared_ptr<Server> server) {
-    if (audioCapture_->resampleRequired()) {
-        audioResampler_->resample(pcmAudio);
-    } else {
-        pcmAudioBuffer_.sputn(pcmAudio.data(), pcmAudio.size());
-    }
-    while (pcmAudioBuffer_.data().size() >= opusInputSize_) {
-        for (auto&& [compression, encoder] : encoders_) {
-            if (compression == Audio::Compression::none) {
-                std::vector<char> uncompressed(opusInputSize_);
-                std::copy_n(
-                    reinterpret_cast<const char *>(pcmAudioBuffer_.data().data()),
-                    opusInputSize_,
-                    uncompressed.data()
-                );
-                server->sendAudio(compression, audioSequenceNumber_,  uncompressed);
-            } else {
-                std::vector<char> encodedPacket(Audio::Opus::maxPacketSize);
-                const auto packetSize = encoder->encode(
-                    static_cast<const char*>(pcmAudioBuffer_.data().data()),
-                    encodedPacket.data()
-                );
-                encodedPacket.resize(packetSize);
-                if (packetSize > 0) {
-                    server->sendAudio(compression, audioSequenceNumber_, encodedPacket);
-                }
-            }
-        }
-        ++audioSequenceNumber_;
-        pcmAudioBuffer_.consume(opusInputSize_);
+std::span<char> CapturePipe::convert(std::span<char> pcmAudio) {
+    // The buffers grow only until they fit the largest capture
+    if (downMixer_) {
+        const std::span<const float> samples{ reinterpret_cast<const float*>(pcmAudio.data()),
+            pcmAudio.size() / sizeof(float) };
+        mixed_.resize(2 * (samples.size() / downMixer_->channels()));
+        const auto mixedFrames = downMixer_->mix(samples, mixed_);
+        pcmAudio = { reinterpret_cast<char*>(mixed_.data()), 2 * mixedFrames * sizeof(float) };
+    }
+    if (polyphaseResampler_) {
+        const auto channels = polyphaseResampler_->channels();
+        const auto frames = pcmAudio.size() / sizeof(float) / channels;
+        resampled_.resize(polyphaseResampler_->maxOutputFrames(frames) * channels);
+        const std::span<const float> samples{ reinterpret_cast<const float*>(pcmAudio.data()), frames * channels };
+        const auto resampledFrames = polyphaseResampler_->process(samples, resampled_);
+        pcmAudio = { reinterpret_cast<char*>(resampled_.data()), resampledFrames * channels * sizeof(float) };
+    }
+    if (sampleConverter_) {
+        converted_.resize(sampleConverter_->sampleCount(pcmAudio.size()));
+        const auto samples = sampleConverter_->convert(pcmAudio, converted_);
+        pcmAudio = { reinterpret_cast<char*>(converted_.data()), samples * sizeof(int16_t) };
+    }
+    if (audioResampler_) {
+        counters_->countRingDropped(audioResampler_->resample(pcmAudio));
+        return {};
     }
+    return pcmAudio;
 }
@@ -1,51 +1,93 @@
 #pragma once
 
-#include <atomic>
 #include <forward_list>
 #include <memory>
 #include <span>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 #include <boost/asio/io_context.hpp>
-#include <boost/asio/streambuf.hpp>
-
 #include "AudioUtil.h"
-#include "NetDefines.h"
+#include "CaptureCounters.h"
+#include "CaptureSource.h"
+#include "FrameRing.h"
+#include "OpusProfile.h"
+#include "PipelineLatency.h"
 
 class AudioCapture;
 class AudioResampler;
-class EncoderOpus;
+class CaptureFeeder;
+class DownMixer;
+class PolyphaseResampler;
+class EncoderStage;
+class SampleConverter;
 class Server;
 struct PipeCoroutine;
 struct ClientInfo;
+struct ClientsDelta;
 
-class CapturePipe {
+/// <summary>
+/// Capture pipeline. The audio is captured and framed on the thread of the <c>CaptureFeeder</c>, encoded on
+/// the thread of the <c>EncoderStage</c> and sent on the thread running <c>io_context</c>.
+/// The pipe is the feeder's source, capturing from the device and converting the audio.
+/// </summary>
+class CapturePipe : private CaptureSource {
 public:
+	/// <param name="io_context">Context of the network thread. The pipeline errors are rethrown on it.</param>
+	/// <param name="counters">Counters of the pipeline, may outlive the pipe</param>
+	/// <param name="latency">Latencies of the pipeline stages, may outlive the pipe</param>
+	/// <param name="encoderThreads">Threads encoding each frame</param>
+	/// <param name="opusProfile">Settings of the Opus encoders, the frames are of its length</param>
 	CapturePipe(const std::wstring& deviceId, std::shared_ptr<Server> server, boost::asio::io_context& io_context,
-		bool muted = false);
-	~CapturePipe();
+		std::shared_ptr<CaptureCounters> counters, std::shared_ptr<PipelineLatency> latency, size_t encoderThreads = 1,
+		bool muted = false, const Audio::Opus::Profile& opusProfile = {});
+	~CapturePipe() override;
+	/// <summary>
+	/// Starts the capture thread.
+	/// </summary>
 	void start();
 	float getPeakValue() const;
 	void setMuted(bool muted);
-	void onClientsUpdate(std::forward_list<ClientInfo> clients);
+	void onClientsSnapshot(const std::forward_list<ClientInfo>& clients, uint64_t version);
+	void onClientsDelta(const ClientsDelta& delta);
 private:
-	// Capturing coroutine
+	// CaptureSource, called by the feeder on the capture thread
+	void capture(const Handler& handler) override;
+	void stopCapture() override;
+	uint64_t glitchCount() const override;
+	// Runs the conversion stages, the audio is in one of the buffers after them or in the frame ring
+	std::span<char> convert(std::span<char> pcmAudio) override;
+
+	// Capturing coroutine, passes the audio to handler_
 	PipeCoroutine process();
-	// Destroys the capturing coroutine
+	// Stops the capture thread and destroys the capturing coroutine
 	void stop();
-	void process(std::span<char> pcmAudio, std::shared_ptr<Server> server);
-	bool haveClients() const;
 
-	boost::asio::io_context& io_context_;
+	// Runs the capture timer on the capture thread
+	boost::asio::io_context captureContext_;
 	std::unique_ptr<PipeCoroutine> pipeCoro_;
 	std::unique_ptr<AudioCapture> audioCapture_;
+	// Converts the captured audio unless it's in the requested format. Float audio stays float: downMixer_ mixes
+	// it to stereo and polyphaseResampler_ changes its rate. Other formats are made int16, by sampleConverter_
+	// if only the sample format differs, by Media Foundation otherwise.
 	std::unique_ptr<AudioResampler> audioResampler_;
-	std::weak_ptr<Server> server_;
+	std::unique_ptr<DownMixer> downMixer_;
+	std::unique_ptr<PolyphaseResampler> polyphaseResampler_;
+	std::unique_ptr<SampleConverter> sampleConverter_;
+	// Outputs of the built-in stages, reused between the captures
+	std::vector<float> mixed_;
+	std::vector<float> resampled_;
+	std::vector<int16_t> converted_;
 	const std::wstring device_;
-	boost::asio::streambuf pcmAudioBuffer_;
-	std::atomic_bool muted_ = false;
-	std::unordered_map<Audio::Compression, std::unique_ptr<EncoderOpus>> encoders_;
-	int opusInputSize_;
-	static Net::Packet::SequenceNumberType audioSequenceNumber_;
+	// Type of the samples of the frames, float if the captured ones are
+	const Audio::SampleType sampleType_;
+	const Audio::Opus::Profile opusProfile_;
+	// Audio waiting for a complete frame, or all the audio if it's resampled
+	FrameRing frameRing_;
+	std::shared_ptr<CaptureCounters> counters_;
+	std::shared_ptr<PipelineLatency> latency_;
+	std::shared_ptr<EncoderStage> encoder_;
+	// Capture thread, handler of the capture in progress
+	const Handler* handler_ = nullptr;
+	std::unique_ptr<CaptureFeeder> feeder_;
 };
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+/// <summary>
+/// Source of the captured audio for <c>CaptureFeeder</c>: the capture device and the conversion of its audio
+/// to the format of the frames.
+/// </summary>
+class CaptureSource {
+public:
+	// Called on the capture thread with every captured block
+	using Handler = std::function<void(std::span<char> audio)>;
+
+	virtual ~CaptureSource() = default;
+	/// <summary>
+	/// Captures on the calling thread until <c>stopCapture</c> is called, passing every block to the handler.
+	/// Throws on a capture error.
+	/// </summary>
+	virtual void capture(const Handler& handler) = 0;
+	/// <summary>
+	/// Makes <c>capture</c> return. Called from another thread, may be called before the capture starts.
+	/// </summary>
+	virtual void stopCapture() = 0;
+	/// <summary>
+	/// Gets the gaps in the captured audio the device reported so far.
+	/// </summary>
+	virtual uint64_t glitchCount() const = 0;
+	/// <summary>
+	/// Converts a captured block to the format of the frames.
+	/// </summary>
+	/// <returns>Converted audio, valid until the next call. Empty if the audio was converted straight into
+	/// the frame ring.</returns>
+	virtual std::span<char> convert(std::span<char> audio) = 0;
+};
@@ -1,116 +1,441 @@
 #include "Clients.h"
 
-Clients::Clients(int timeoutSeconds) : timeoutSeconds_(timeoutSeconds) {}
+#include <algorithm>
+#include <vector>
 
-void Clients::add(const Net::Address& address, Audio::Compression compression) {
-	const std::unique_lock lock(clientsMutex_);
-	if (clients_.contains(address)) {
-		clients_[address]->updateLastContact();
-		if (clients_[address]->compression() == compression) {
+namespace {
+	constexpr auto expiryTick = std::chrono::seconds(1);
+	constexpr size_t expirySlots = 8;
+
+	// Runs the action on leaving the scope, also when a listener throws
+	template <typename Action>
+	class OnExit {
+	public:
+		explicit OnExit(Action action) : action_(std::move(action)) {}
+		~OnExit() { action_(); }
+		OnExit(const OnExit&) = delete;
+		OnExit& operator=(const OnExit&) = delete;
+	private:
+		Action action_;
+	};
+}
+
+Clients::Clients(int timeoutSeconds) :
+	timeoutSeconds_(timeoutSeconds),
+	snapshot_(std::make_shared<const Snapshot>()),
+	expiries_(expiryTick, expirySlots) {}
+
+void Clients::add(const Net::Address& address, Audio::Compression compression, Net::Packet::ProtocolVersionType protocol,
+	bool parity, int framesPerPacket) {
+	std::optional<ClientsDelta> delta;
+	{
+		const std::lock_guard lock(changeMutex_);
+		const auto snapshot = snapshot_.load();
+		const auto it = snapshot->clients.find(address);
+		if (it != snapshot->clients.end()) {
+			const auto& client = *it->second;
+			client.updateLastContact();
+			if (client.compression() == compression && client.protocol() == protocol && client.parity() == parity &&
+				client.framesPerPacket() == framesPerPacket) {
+				return;
+			}
+		}
+		auto clients = snapshot->clients;
+		if (it != snapshot->clients.end()) {
+			const auto& previous = *it->second;
+			// The scheduled expiry stays valid as the generation is the same
+			const auto& client = clients[address] = std::make_shared<const Client>(previous, compression, protocol, parity,
+				framesPerPacket);
+			client->counters()->countFormatChange();
+			compressionCounters(compression).countFormatChange();
+			delta = ClientsDelta{ ClientsDelta::Type::formatChanged, makeInfo(address, *client),
+				makeInfo(address, previous) };
+		} else {
+			auto client = std::make_shared<const Client>(compression, protocol, parity, framesPerPacket,
+				nextGeneration_++);
+			scheduleExpiry(address, *client);
+			delta = ClientsDelta{ ClientsDelta::Type::added, makeInfo(address, *client) };
+			clients.emplace(address, std::move(client));
+		}
+		publish(std::move(clients), { &*delta, 1 });
+	}
+	notifyListeners({ &*delta, 1 });
+}
+
+void Clients::setCompression(const Net::Address& address, Audio::Compression compression, int framesPerPacket) {
+	std::optional<ClientsDelta> delta;
+	{
+		const std::lock_guard lock(changeMutex_);
+		const auto snapshot = snapshot_.load();
+		const auto it = snapshot->clients.find(address);
+		if (it == snapshot->clients.end() ||
+			(it->second->compression() == compression && it->second->framesPerPacket() == framesPerPacket)) {
 			return;
 		}
-		clients_[address]->setCompression(compression);
-		updateAndNotify();
-	} else {
-		clients_[address] = std::make_unique<Client>(compression);		
-		updateAndNotify();
+		const auto& previous = *it->second;
+		auto clients = snapshot->clients;
+		const auto& client = clients[address] = std::make_shared<const Client>(previous, compression, previous.protocol(),
+			previous.parity(), framesPerPacket);
+		client->counters()->countFormatChange();
+		compressionCounters(compression).countFormatChange();
+		delta = ClientsDelta{ ClientsDelta::Type::formatChanged, makeInfo(address, *client),
+			makeInfo(address, previous) };
+		publish(std::move(clients), { &*delta, 1 });
 	}
+	notifyListeners({ &*delta, 1 });
 }
 
-void Clients::setCompression(const Net::Address& address, Audio::Compression compression) {
-	const std::unique_lock lock(clientsMutex_);
-	if (!clients_.contains(address) || clients_[address]->compression() == compression) {
+void Clients::keep(const Net::Address& address, std::optional<std::chrono::microseconds> roundTrip) {
+	const auto snapshot = snapshot_.load();
+	const auto it = snapshot->clients.find(address);
+	if (it == snapshot->clients.end()) {
 		return;
 	}
-	clients_[address]->setCompression(compression);
-	updateAndNotify();
+	it->second->updateLastContact();
+	it->second->counters()->countKeepalive();
+	compressionCounters(it->second->sent().compression).countKeepalive();
+	if (roundTrip) {
+		it->second->roundTrip().addSample(*roundTrip);
+	}
 }
 
-void Clients::keep(const Net::Address& address) {
-	const std::unique_lock lock(clientsMutex_);
-	if (!clients_.contains(address)) {
-		return;
+void Clients::reportLoss(const Net::Address& address, uint32_t received, uint32_t lost, Audio::Compression lowest) {
+	std::optional<ClientsDelta> delta;
+	{
+		const std::lock_guard lock(changeMutex_);
+		const auto snapshot = snapshot_.load();
+		const auto it = snapshot->clients.find(address);
+		if (it == snapshot->clients.end()) {
+			return;
+		}
+		const auto& previous = *it->second;
+		previous.updateLastContact();
+		if (previous.protocol() < Net::Protocol::lossReport) {
+			return;
+		}
+		const auto& sent = previous.adaptation().report(received, lost, lowest);
+		if (sent == previous.sent()) {
+			return;
+		}
+		// Not counted as a format change, the client hasn't asked for it
+		auto clients = snapshot->clients;
+		const auto& client = clients[address] = std::make_shared<const Client>(previous, sent);
+		delta = ClientsDelta{ ClientsDelta::Type::formatChanged, makeInfo(address, *client),
+			makeInfo(address, previous) };
+		publish(std::move(clients), { &*delta, 1 });
 	}
-	clients_[address]->updateLastContact();
+	notifyListeners({ &*delta, 1 });
 }
 
 void Clients::remove(const Net::Address& address) {
-	const std::unique_lock lock(clientsMutex_);
-	if (clients_.erase(address)) {
-		updateAndNotify();
+	std::optional<ClientsDelta> delta;
+	{
+		const std::lock_guard lock(changeMutex_);
+		const auto snapshot = snapshot_.load();
+		const auto it = snapshot->clients.find(address);
+		if (it == snapshot->clients.end()) {
+			return;
+		}
+		delta = ClientsDelta{ ClientsDelta::Type::removed, makeInfo(address, *it->second) };
+		auto clients = snapshot->clients;
+		clients.erase(address);
+		publish(std::move(clients), { &*delta, 1 });
 	}
+	notifyListeners({ &*delta, 1 });
 }
 
-void Clients::addClientsListener(ClientsUpdateCallback listener) {
-	clientsListeners_.push_front(listener);
-	listener(clientInfos_);
+Clients::ListenerId Clients::addClientsListener(ClientsListener listener) {
+	std::unique_lock lock(listenersMutex_);
+	// May be ahead of the notified version, then the listener skips the deltas it has already seen
+	const auto snapshot = snapshot_.load();
+	const auto id = nextListenerId_++;
+	const auto subscription = std::make_shared<Subscription>(id, std::move(listener), snapshot->version);
+	// Subscribed before the snapshot is sent so no delta is missed, the deltas wait for the caller
+	subscription->caller = std::this_thread::get_id();
+	clientsListeners_.insert(clientsListeners_.begin(), subscription);
+	lock.unlock();
+
+	bool subscribed = false;
+	const OnExit finish([&] {
+		lock.lock();
+		subscription->caller = {};
+		if (!subscribed) {
+			subscription->active = false;
+			std::erase(clientsListeners_, subscription);
+		}
+		versionNotified_.notify_all();
+	});
+	subscription->listener.onSnapshot(makeInfos(*snapshot), snapshot->version);
+	subscribed = true;
+	return id;
 }
 
-size_t Clients::removeClientsListener(ClientsUpdateCallback listener) {
-	return clientsListeners_.remove_if([&](ClientsUpdateCallback f) {
-		return f.target_type().name() == listener.target_type().name();
+size_t Clients::removeClientsListener(ListenerId id) {
+	std::unique_lock lock(listenersMutex_);
+	const auto it = std::ranges::find(clientsListeners_, id, &Subscription::id);
+	if (it == clientsListeners_.end()) {
+		return 0;
+	}
+	const auto subscription = *it;
+	clientsListeners_.erase(it);
+	subscription->active = false;
+	// The caller may free what the listener uses once this returns. A listener removing itself is not waited for.
+	versionNotified_.wait(lock, [&] {
+		return subscription->caller == std::thread::id() || subscription->caller == std::this_thread::get_id();
 	});
+	return 1;
 }
 
-void Clients::maintain() {
-	const std::unique_lock lock(clientsMutex_);
-	bool clientRemoved = false;
-	const auto now = std::chrono::steady_clock::now();
-	for (auto&& it = clients_.begin(); it != clients_.end();) {
-		std::chrono::duration<float> elapsedSeconds = now - it->second->lastContact();
-		if (elapsedSeconds.count() > timeoutSeconds_) {
-			it = clients_.erase(it);
-			clientRemoved = true;
-		} else {
-			++it;
+void Clients::maintain(TimePoint now) {
+	std::vector<ClientsDelta> deltas;
+	{
+		const std::lock_guard lock(changeMutex_);
+		const auto snapshot = snapshot_.load();
+		// Copied on the first removal only
+		std::optional<ClientMap> clients;
+		const std::chrono::seconds timeout(timeoutSeconds_);
+		expiries_.advance(now, [&](const Expiry& expiry) {
+			const auto it = snapshot->clients.find(expiry.address);
+			// Removed already, possibly added again with a newer expiry
+			if (it == snapshot->clients.end() || it->second->generation() != expiry.generation) {
+				return;
+			}
+			if (now - it->second->lastContact() >= timeout) {
+				if (!clients) {
+					clients = snapshot->clients;
+				}
+				clients->erase(expiry.address);
+				deltas.push_back({ ClientsDelta::Type::removed, makeInfo(expiry.address, *it->second) });
+			} else {
+				scheduleExpiry(expiry.address, *it->second);
+			}
+		});
+		if (!clients) {
+			return;
 		}
+		publish(std::move(*clients), deltas);
 	}
-	if (clientRemoved) {
-		updateAndNotify();
-	}
+	notifyListeners(deltas);
+}
+
+TrafficCounters& Clients::compressionCounters(Audio::Compression compression) {
+	return compressionCounters_[Audio::compressionIndex(compression)];
 }
 
-void Clients::updateInfos() {
-	clientInfos_.clear();
-	for (auto&& client : clients_) {
-		clientInfos_.push_front({ client.first, client.second->compression() });
+ClientsStats Clients::stats() const {
+	using Audio::Compression;
+	const auto snapshot = snapshot_.load();
+	ClientsStats result;
+	result.version = snapshot->version;
+	result.clients.reserve(snapshot->clients.size());
+	std::array<size_t, Audio::compressionCount> clientCounts{};
+	for (auto&& [address, client] : snapshot->clients) {
+		result.clients.push_back({
+			address,
+			client->sent().compression,
+			client->connected(),
+			client->lastContact(),
+			client->counters()->load(),
+			client->roundTrip().load()
+		});
+		++clientCounts[Audio::compressionIndex(client->sent().compression)];
+	}
+	for (auto compression : { Compression::none, Compression::kbps_64, Compression::kbps_128,
+		Compression::kbps_192, Compression::kbps_256, Compression::kbps_320 }) {
+		const auto index = Audio::compressionIndex(compression);
+		result.compressions.push_back({ compression, clientCounts[index], compressionCounters_[index].load() });
 	}
+	return result;
 }
 
-void Clients::notifyListeners() const {
-	for (auto&& listener : clientsListeners_) {
-		listener(clientInfos_);
+void Clients::scheduleExpiry(const Net::Address& address, const Client& client) {
+	expiries_.schedule({ address, client.generation() }, client.lastContact() + std::chrono::seconds(timeoutSeconds_));
+}
+
+void Clients::publish(ClientMap clients, std::span<ClientsDelta> deltas) {
+	auto version = snapshot_.load()->version;
+	for (auto&& delta : deltas) {
+		delta.version = ++version;
 	}
+	snapshot_.store(std::make_shared<const Snapshot>(std::move(clients), version));
 }
 
-void Clients::updateAndNotify() {
-	updateInfos();
-	notifyListeners();
+ClientInfo Clients::makeInfo(const Net::Address& address, const Client& client) {
+	const auto& sent = client.sent();
+	return { address, sent.compression, client.protocol(), client.counters(), sent.lossPercent, client.parity(),
+		client.framesPerPacket() };
 }
 
-// Client
+std::forward_list<ClientInfo> Clients::makeInfos(const Snapshot& snapshot) {
+	std::forward_list<ClientInfo> infos;
+	for (auto&& client : snapshot.clients) {
+		infos.push_front(makeInfo(client.first, *client.second));
+	}
+	return infos;
+}
 
-Clients::Client::Client(Audio::Compression compression): compression_(compression) {
-	updateLastContact();
+void Clients::notifyListeners(std::span<const ClientsDelta> deltas) {
+	std::unique_lock lock(listenersMutex_);
+	// The changes publish in the version order but may get here in any
+	for (auto&& delta : deltas) {
+		const auto position = std::ranges::upper_bound(pendingDeltas_, delta.version, {}, &ClientsDelta::version);
+		pendingDeltas_.insert(position, delta);
+	}
+	// Made from a listener, the notifying thread delivers it after the current delta
+	if (notifier_ == std::this_thread::get_id()) {
+		return;
+	}
+	const auto version = deltas.back().version;
+	while (notifiedVersion_ < version) {
+		const bool ready = notifier_ == std::thread::id() && !pendingDeltas_.empty() &&
+			pendingDeltas_.front().version == notifiedVersion_ + 1;
+		if (ready) {
+			dispatchDeltas(lock);
+		} else {
+			versionNotified_.wait(lock);
+		}
+	}
+}
+
+void Clients::dispatchDeltas(std::unique_lock<std::mutex>& lock) {
+	notifier_ = std::this_thread::get_id();
+	const OnExit finish([&] {
+		notifier_ = {};
+		versionNotified_.notify_all();
+	});
+	while (!pendingDeltas_.empty() && pendingDeltas_.front().version == notifiedVersion_ + 1) {
+		const auto delta = std::move(pendingDeltas_.front());
+		pendingDeltas_.pop_front();
+		// The listeners may subscribe and unsubscribe while being called
+		const auto subscriptions = clientsListeners_;
+		// A throwing listener doesn't hold the later deltas back
+		const OnExit notified([&] { notifiedVersion_ = delta.version; });
+		for (auto&& subscription : subscriptions) {
+			if (delta.version > subscription->version) {
+				notifyListener(lock, *subscription, delta);
+			}
+		}
+	}
 }
 
-void Clients::Client::updateLastContact() {
-	lastContact_ = std::chrono::steady_clock::now();
+void Clients::notifyListener(std::unique_lock<std::mutex>& lock, Subscription& subscription,
+	const ClientsDelta& delta) {
+	// Still getting its snapshot on another thread
+	versionNotified_.wait(lock, [&] { return subscription.caller == std::thread::id(); });
+	if (!subscription.active) {
+		return;
+	}
+	subscription.caller = std::this_thread::get_id();
+	lock.unlock();
+	const OnExit finish([&] {
+		lock.lock();
+		subscription.caller = {};
+		versionNotified_.notify_all();
+	});
+	subscription.listener.onDelta(delta);
 }
 
-void Clients::Client::setCompression(Audio::Compression compression) {
-	compression_ = compression;
+// Client
+
+Clients::Client::Client(Audio::Compression compression, Net::Packet::ProtocolVersionType protocol, bool parity,
+	int framesPerPacket, uint64_t generation) :
+	compression_(compression),
+	sent_{ compression, 0 },
+	protocol_(protocol),
+	parity_(parity),
+	framesPerPacket_(framesPerPacket),
+	lastContact_(std::chrono::steady_clock::now().time_since_epoch().count()),
+	connected_(lastContact()),
+	generation_(generation),
+	counters_(std::make_shared<TrafficCounters>()),
+	roundTrip_(std::make_shared<RoundTripTime>()),
+	adaptation_(std::make_shared<LossAdaptation>(compression)) {}
+
+Clients::Client::Client(
+	const Client& previous,
+	Audio::Compression compression,
+	Net::Packet::ProtocolVersionType protocol,
+	bool parity,
+	int framesPerPacket
+) :
+	compression_(compression),
+	sent_{ compression, 0 },
+	protocol_(protocol),
+	parity_(parity),
+	framesPerPacket_(framesPerPacket),
+	lastContact_(previous.lastContact_.load(std::memory_order_relaxed)),
+	connected_(previous.connected_),
+	generation_(previous.generation_),
+	counters_(previous.counters_),
+	roundTrip_(previous.roundTrip_),
+	adaptation_(std::make_shared<LossAdaptation>(compression)) {}
+
+Clients::Client::Client(const Client& previous, const LossAdaptation::State& sent) :
+	compression_(previous.compression_),
+	sent_(sent),
+	protocol_(previous.protocol_),
+	parity_(previous.parity_),
+	framesPerPacket_(previous.framesPerPacket_),
+	lastContact_(previous.lastContact_.load(std::memory_order_relaxed)),
+	connected_(previous.connected_),
+	generation_(previous.generation_),
+	counters_(previous.counters_),
+	roundTrip_(previous.roundTrip_),
+	adaptation_(previous.adaptation_) {}
+
+void Clients::Client::updateLastContact() const {
+	lastContact_.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
 }
 
 Clients::TimePoint Clients::Client::lastContact() const {
-	return lastContact_;
+	return TimePoint(TimePoint::duration(lastContact_.load(std::memory_order_relaxed)));
+}
+
+Clients::TimePoint Clients::Client::connected() const {
+	return connected_;
 }
 
 Audio::Compression Clients::Client::compression() const {
 	return compression_;
 }
 
+const LossAdaptation::State& Clients::Client::sent() const {
+	return sent_;
+}
+
+Net::Packet::ProtocolVersionType Clients::Client::protocol() const {
+	return protocol_;
+}
+
+bool Clients::Client::parity() const {
+	return parity_;
+}
+
+int Clients::Client::framesPerPacket() const {
+	return framesPerPacket_;
+}
+
+uint64_t Clients::Client::generation() const {
+	return generation_;
+}
+
+const std::shared_ptr<TrafficCounters>& Clients::Client::counters() const {
+	return counters_;
+}
+
+RoundTripTime& Clients::Client::roundTrip() const {
+	return *roundTrip_;
+}
+
+LossAdaptation& Clients::Client::adaptation() const {
+	return *adaptation_;
+}
+
 bool operator==(const ClientInfo& lhs, const ClientInfo& rhs) {
 	return lhs.address == rhs.address &&
-		lhs.compression == rhs.compression;
-}
\ No newline at end of file
+		lhs.compression == rhs.compression &&
+		lhs.protocol == rhs.protocol &&
+		lhs.lossPercent == rhs.lossPercent &&
+		lhs.parity == rhs.parity &&
+		lhs.framesPerPacket == rhs.framesPerPacket;
+}
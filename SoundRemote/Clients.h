@@ -1,58 +1,272 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <forward_list>
 #include <functional>
 #include <memory>
-#include <shared_mutex>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "AudioUtil.h"
+#include "LossAdaptation.h"
 #include "NetDefines.h"
+#include "RoundTripTime.h"
+#include "TimerWheel.h"
+#include "TrafficCounters.h"
 
 struct ClientInfo;
+struct ClientsDelta;
+struct ClientsStats;
 
+/// <summary>
+/// Subscriber to the changes of the clients.
+/// </summary>
+struct ClientsListener {
+	// Called once on subscribe with all the current clients and the version they are at, before any delta
+	std::function<void(const std::forward_list<ClientInfo>& clients, uint64_t version)> onSnapshot;
+	// Called on every change made after the snapshot, in the version order
+	std::function<void(const ClientsDelta& delta)> onDelta;
+};
+
+/// <summary>
+/// Registry of the connected clients.
+/// The registry is published as immutable snapshots, so the readers and <c>keep()</c> don't take any lock.
+/// The changes are serialized and the listeners are notified after the change has been published.
+/// The listeners are called without any lock held, one change at a time. A change made from a listener returns
+/// before it's notified, the listeners get it after the current one.
+/// </summary>
 class Clients {
-	using TimePoint = std::chrono::steady_clock::time_point;
-	using ClientsUpdateCallback = std::function<void(std::forward_list<ClientInfo>)>;
 public:
+	using TimePoint = std::chrono::steady_clock::time_point;
+	using ListenerId = uint64_t;
+
 	Clients(int timeoutSeconds = 5);
-	void add(const Net::Address& address, Audio::Compression compression);
-	void setCompression(const Net::Address& address, Audio::Compression compression);
-	void keep(const Net::Address& address);
+	/// <summary>
+	/// Adds a client or updates an existing one.
+	/// </summary>
+	/// <param name="address">Client address</param>
+	/// <param name="compression">Requested compression</param>
+	/// <param name="protocol">Protocol version negotiated with the client</param>
+	/// <param name="parity">The client opted in for the parity packets</param>
+	/// <param name="framesPerPacket">Audio frames per packet the client gets</param>
+	void add(const Net::Address& address, Audio::Compression compression,
+		Net::Packet::ProtocolVersionType protocol = Net::Protocol::initial, bool parity = false,
+		int framesPerPacket = 1);
+	/// <summary>
+	/// Changes the format of an existing client.
+	/// </summary>
+	/// <param name="address">Client address</param>
+	/// <param name="compression">Requested compression</param>
+	/// <param name="framesPerPacket">Audio frames per packet the client gets</param>
+	void setCompression(const Net::Address& address, Audio::Compression compression, int framesPerPacket = 1);
+	/// <summary>
+	/// Updates the last contact time of the client. Lock-free.
+	/// Must be called from one thread, as the round-trip samples are.
+	/// </summary>
+	/// <param name="address">Client address</param>
+	/// <param name="roundTrip">Round-trip time measured with the keepalive, if any</param>
+	void keep(const Net::Address& address, std::optional<std::chrono::microseconds> roundTrip = std::nullopt);
+	/// <summary>
+	/// Applies a loss report of the client, also keeping it alive. Only the clients supporting
+	/// <c>Net::Protocol::lossReport</c> are adapted. The client's format changes if its compression steps
+	/// or its loss changes by a step, see <c>LossAdaptation</c>.
+	/// </summary>
+	/// <param name="address">Client address</param>
+	/// <param name="received">Audio packets received since the previous report</param>
+	/// <param name="lost">Audio packets lost since the previous report</param>
+	/// <param name="lowest">Lowest compression the client allows, <c>Compression::none</c> to keep the requested one</param>
+	void reportLoss(const Net::Address& address, uint32_t received, uint32_t lost, Audio::Compression lowest);
 	void remove(const Net::Address& address);
-	void addClientsListener(ClientsUpdateCallback listener);
-	size_t removeClientsListener(ClientsUpdateCallback listener);
-	void maintain();
+	/// <summary>
+	/// Subscribes the listener. Its <c>onSnapshot</c> is called before returning, the deltas wait for it to finish.
+	/// </summary>
+	/// <returns>Id to unsubscribe the listener with.</returns>
+	ListenerId addClientsListener(ClientsListener listener);
+	/// <summary>
+	/// Unsubscribes the listener. If it's being called on another thread, waits for the call to finish,
+	/// so the listener must not wait for the thread removing it.
+	/// </summary>
+	/// <returns>Number of the listeners removed, 0 or 1.</returns>
+	size_t removeClientsListener(ListenerId id);
+	/// <summary>
+	/// Removes the clients that timed out. Only the clients due for a check are visited.
+	/// </summary>
+	/// <param name="now">Current time</param>
+	void maintain(TimePoint now = std::chrono::steady_clock::now());
+	/// <summary>
+	/// Gets the counters of all the clients that ever used the compression. Lock-free, the reference stays valid
+	/// for the lifetime of the Clients.
+	/// </summary>
+	TrafficCounters& compressionCounters(Audio::Compression compression);
+	/// <summary>
+	/// Gets the statistics of the current clients and the totals per compression.
+	/// The clients are taken from one version of the registry. Each client's and each compression's counters are
+	/// consistent in themselves, taken between their updates, but the sets are read one after another without
+	/// stopping the updates, so a packet sent meanwhile may show in the compression totals and not in the client's.
+	/// </summary>
+	ClientsStats stats() const;
 
 private:
+	// Shared between the snapshots, only the last contact time changes after creation
 	class Client {
 	public:
-		Client(Audio::Compression compression);
-		void updateLastContact();
-		void setCompression(Audio::Compression compression);
+		Client(Audio::Compression compression, Net::Packet::ProtocolVersionType protocol, bool parity,
+			int framesPerPacket, uint64_t generation);
+		// Makes the client with a new format, keeping the rest. The adaptation starts over.
+		Client(const Client& previous, Audio::Compression compression, Net::Packet::ProtocolVersionType protocol,
+			bool parity, int framesPerPacket);
+		// Makes the client with the encoding its adaptation has got to, keeping the rest
+		Client(const Client& previous, const LossAdaptation::State& sent);
+		void updateLastContact() const;
 		TimePoint lastContact() const;
+		TimePoint connected() const;
+		// Requested compression
 		Audio::Compression compression() const;
+		// Encoding the client gets, as of the creation
+		const LossAdaptation::State& sent() const;
+		Net::Packet::ProtocolVersionType protocol() const;
+		bool parity() const;
+		int framesPerPacket() const;
+		uint64_t generation() const;
+		const std::shared_ptr<TrafficCounters>& counters() const;
+		RoundTripTime& roundTrip() const;
+		// Must be used with changeMutex_ locked
+		LossAdaptation& adaptation() const;
 	private:
-		Audio::Compression compression_ = Audio::Compression::none;
-		TimePoint lastContact_{};
+		const Audio::Compression compression_ = Audio::Compression::none;
+		const LossAdaptation::State sent_;
+		const Net::Packet::ProtocolVersionType protocol_ = Net::Protocol::initial;
+		const bool parity_ = false;
+		const int framesPerPacket_ = 1;
+		// Ticks of steady_clock since its epoch
+		mutable std::atomic<TimePoint::rep> lastContact_;
+		const TimePoint connected_;
+		// Tells apart clients with the same address added at different times
+		const uint64_t generation_ = 0;
+		// Shared with the previous and the next formats of the client
+		const std::shared_ptr<TrafficCounters> counters_;
+		const std::shared_ptr<RoundTripTime> roundTrip_;
+		// Shared with the next snapshots of the same format
+		const std::shared_ptr<LossAdaptation> adaptation_;
+	};
+	using ClientMap = std::unordered_map<Net::Address, std::shared_ptr<const Client>>;
+	struct Snapshot {
+		ClientMap clients;
+		// Incremented on every change, a snapshot made by several changes is the version of the last one
+		uint64_t version = 0;
+	};
+	struct Subscription {
+		ListenerId id;
+		ClientsListener listener;
+		// Version of the snapshot the listener got, the changes up to it are not sent as deltas
+		uint64_t version;
+		// Guarded by listenersMutex_. Cleared on unsubscribe, as a notification may hold a copy of the subscription.
+		bool active = true;
+		// Guarded by listenersMutex_. Thread calling the listener, none if it's not being called.
+		std::thread::id caller;
+	};
+	// Scheduled timeout check of a client
+	struct Expiry {
+		Net::Address address;
+		uint64_t generation;
 	};
 	
-	void updateInfos();
-	void notifyListeners() const;
-	void updateAndNotify();
+	void scheduleExpiry(const Net::Address& address, const Client& client);
+	// Must be called with changeMutex_ locked. Sets the versions of the deltas.
+	void publish(ClientMap clients, std::span<ClientsDelta> deltas);
+	static ClientInfo makeInfo(const Net::Address& address, const Client& client);
+	static std::forward_list<ClientInfo> makeInfos(const Snapshot& snapshot);
+	// Must be called with changeMutex_ unlocked. Waits for the deltas to be notified, unless called from a listener.
+	void notifyListeners(std::span<const ClientsDelta> deltas);
+	// Notifies the pending deltas that follow the notified version. Must be called with listenersMutex_ locked.
+	void dispatchDeltas(std::unique_lock<std::mutex>& lock);
+	// Calls the listener with listenersMutex_ unlocked, after its snapshot. Returns with the mutex locked.
+	void notifyListener(std::unique_lock<std::mutex>& lock, Subscription& subscription, const ClientsDelta& delta);
 
 	const int timeoutSeconds_;
-	std::unordered_map<Net::Address, std::unique_ptr<Client>> clients_;
-	std::forward_list<ClientInfo> clientInfos_;
-	std::shared_mutex clientsMutex_;
-	// listeners are not synchronized, the list is modified on program start and on device change
-	std::forward_list<ClientsUpdateCallback> clientsListeners_;
+	std::atomic<std::shared_ptr<const Snapshot>> snapshot_;
+	// Serializes the changes
+	std::mutex changeMutex_;
+	// A client is checked when its timeout would pass since the last contact known at scheduling.
+	// Keeping a client alive doesn't touch the wheel, the check reschedules it instead.
+	TimerWheel<Expiry> expiries_;
+	uint64_t nextGeneration_ = 0;
+	std::array<TrafficCounters, Audio::compressionCount> compressionCounters_;
+	// Guards the subscriptions and the notification state, it's never held while calling a listener
+	std::mutex listenersMutex_;
+	// Signalled whenever the notification state or a listener call changes
+	std::condition_variable versionNotified_;
+	// Newest first
+	std::vector<std::shared_ptr<Subscription>> clientsListeners_;
+	// Published deltas waiting to be notified, in the version order
+	std::deque<ClientsDelta> pendingDeltas_;
+	// Thread notifying the listeners, one at a time so the deltas go in order
+	std::thread::id notifier_;
+	ListenerId nextListenerId_ = 0;
+	uint64_t notifiedVersion_ = 0;
 };
 
 struct ClientInfo {
 	Net::Address address;
+	// Compression the client gets the audio with, may be lower than the requested one on a loss
 	Audio::Compression compression;
-	ClientInfo(Net::Address addr, Audio::Compression br) : address(addr), compression(br) {}
+	Net::Packet::ProtocolVersionType protocol;
+	// Counters of the client for the hot paths, not compared
+	std::shared_ptr<TrafficCounters> counters;
+	// Packet loss the encoder of the client protects the audio against, in percent
+	int lossPercent = 0;
+	// Gets the parity packets
+	bool parity = false;
+	// Audio frames the client gets in a packet
+	int framesPerPacket = 1;
+	ClientInfo(Net::Address addr, Audio::Compression br, Net::Packet::ProtocolVersionType prot = Net::Protocol::initial,
+		std::shared_ptr<TrafficCounters> cnt = nullptr, int loss = 0, bool par = false, int fpp = 1) :
+		address(addr), compression(br), protocol(prot), counters(std::move(cnt)), lossPercent(loss), parity(par),
+		framesPerPacket(fpp) {}
 	friend bool operator==(const ClientInfo& lhs, const ClientInfo& rhs);
 };
+
+struct ClientsDelta {
+	// formatChanged is also made by the loss adaptation, with the same requested compression
+	enum class Type { added, removed, formatChanged };
+	Type type;
+	// The client after the change, or the removed one
+	ClientInfo client;
+	// The client before the change, set for formatChanged only
+	std::optional<ClientInfo> previous;
+	// Version of the clients after the change, increases by one with every change
+	uint64_t version = 0;
+	friend bool operator==(const ClientsDelta& lhs, const ClientsDelta& rhs) = default;
+};
+
+struct ClientStats {
+	Net::Address address;
+	Audio::Compression compression;
+	Clients::TimePoint connected;
+	Clients::TimePoint lastContact;
+	TrafficStats traffic;
+	// Empty for the clients not supporting Net::Protocol::roundTrip
+	RoundTripStats roundTrip;
+};
+
+struct CompressionStats {
+	Audio::Compression compression;
+	size_t clientCount = 0;
+	// Includes the clients that are gone or use another compression now
+	TrafficStats traffic;
+};
+
+struct ClientsStats {
+	// Version of the clients the stats were taken at
+	uint64_t version = 0;
+	std::vector<ClientStats> clients;
+	std::vector<CompressionStats> compressions;
+};
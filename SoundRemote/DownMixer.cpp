@@ -0,0 +1,291 @@
+#include "DownMixer.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "Quantize.h"
+
+namespace {
+    using Isa = DownMixer::Isa;
+    using Matrix = DownMixer::Matrix;
+    using Coefficients = DownMixer::Coefficients;
+    using DitherState = DownMixer::DitherState;
+    using Speaker = DownMixer::Speaker;
+
+    constexpr float floatScale = 32768.0f;
+    // -3 dB
+    constexpr float attenuated = 0.70710678f;
+
+    DownMixer::Gains gainsOf(Speaker speaker) {
+        switch (speaker) {
+        case Speaker::frontLeft:
+        case Speaker::frontLeftOfCenter:
+            return { 1.0f, 0.0f };
+        case Speaker::frontRight:
+        case Speaker::frontRightOfCenter:
+            return { 0.0f, 1.0f };
+        case Speaker::frontCenter:
+            return { attenuated, attenuated };
+        case Speaker::backLeft:
+        case Speaker::sideLeft:
+        case Speaker::topFrontLeft:
+        case Speaker::topBackLeft:
+            return { attenuated, 0.0f };
+        case Speaker::backRight:
+        case Speaker::sideRight:
+        case Speaker::topFrontRight:
+        case Speaker::topBackRight:
+            return { 0.0f, attenuated };
+        case Speaker::backCenter:
+        case Speaker::topCenter:
+        case Speaker::topFrontCenter:
+        case Speaker::topBackCenter:
+            return { 0.5f, 0.5f };
+        default:
+            // The LFE and the unknown speakers
+            return {};
+        }
+    }
+
+    template <bool Dither>
+    void mixScalar(const float* input, int16_t* output, size_t frames, const Matrix& matrix, const Coefficients&,
+        DitherState& dither) {
+        const auto channels = matrix.size();
+        for (size_t f = 0; f < frames; ++f, input += channels) {
+            float left = 0.0f;
+            float right = 0.0f;
+            for (size_t c = 0; c < channels; ++c) {
+                left += input[c] * matrix[c].left;
+                right += input[c] * matrix[c].right;
+            }
+            left *= floatScale;
+            right *= floatScale;
+            if constexpr (Dither) {
+                left += Quantize::tpdf(dither[0]);
+                right += Quantize::tpdf(dither[0]);
+            }
+            *output++ = Quantize::toInt16(left);
+            *output++ = Quantize::toInt16(right);
+        }
+    }
+
+    void mixScalarFloat(const float* input, float* output, size_t frames, const Matrix& matrix, const Coefficients&) {
+        const auto channels = matrix.size();
+        for (size_t f = 0; f < frames; ++f, input += channels) {
+            float left = 0.0f;
+            float right = 0.0f;
+            for (size_t c = 0; c < channels; ++c) {
+                left += input[c] * matrix[c].left;
+                right += input[c] * matrix[c].right;
+            }
+            *output++ = left;
+            *output++ = right;
+        }
+    }
+
+#ifdef SOUNDREMOTE_X86
+    // AVX2: a frame of up to 8 channels per vector, masked so the next frame isn't read
+
+    struct Avx2Gains {
+        __m256i mask;
+        __m256 left;
+        __m256 right;
+    };
+
+    SOUNDREMOTE_TARGET_AVX2 Avx2Gains loadGains(const Coefficients& coefficients, size_t channels) {
+        const auto lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        return {
+            _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(channels)), lanes),
+            _mm256_loadu_ps(coefficients.data()),
+            _mm256_loadu_ps(coefficients.data() + DownMixer::maxVectorChannels)
+        };
+    }
+
+    // Left and right of the frame at the input followed by the ones of the next frame
+    SOUNDREMOTE_TARGET_AVX2 __m128 mixTwo(const float* input, size_t channels, const Avx2Gains& gains) {
+        const auto first = _mm256_maskload_ps(input, gains.mask);
+        const auto second = _mm256_maskload_ps(input + channels, gains.mask);
+        // Pairwise sums of the products, the halves hold the sums of the lower and the upper 4 channels
+        const auto firstSums = _mm256_hadd_ps(_mm256_mul_ps(first, gains.left), _mm256_mul_ps(first, gains.right));
+        const auto secondSums = _mm256_hadd_ps(_mm256_mul_ps(second, gains.left), _mm256_mul_ps(second, gains.right));
+        const auto sums = _mm256_hadd_ps(firstSums, secondSums);
+        return _mm_add_ps(_mm256_castps256_ps128(sums), _mm256_extractf128_ps(sums, 1));
+    }
+
+    SOUNDREMOTE_TARGET_AVX2 __m256 mixFour(const float* input, size_t channels, const Avx2Gains& gains) {
+        const auto low = mixTwo(input, channels, gains);
+        const auto high = mixTwo(input + 2 * channels, channels, gains);
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+    }
+
+    // 8 frames per iteration
+    template <bool Dither>
+    SOUNDREMOTE_TARGET_AVX2 void mixAvx2(const float* input, int16_t* output, size_t frames, const Matrix& matrix,
+        const Coefficients& coefficients, DitherState& dither) {
+        constexpr size_t step = 8;
+        const auto channels = matrix.size();
+        const auto gains = loadGains(coefficients, channels);
+        const auto scale = _mm256_set1_ps(floatScale);
+        auto state = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dither.data()));
+        size_t f = 0;
+        for (; f + step <= frames; f += step) {
+            auto low = _mm256_mul_ps(mixFour(input + f * channels, channels, gains), scale);
+            auto high = _mm256_mul_ps(mixFour(input + (f + 4) * channels, channels, gains), scale);
+            if constexpr (Dither) {
+                low = _mm256_add_ps(low, Quantize::tpdf(state));
+                high = _mm256_add_ps(high, Quantize::tpdf(state));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 2 * f), Quantize::toInt16(low, high));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dither.data()), state);
+        mixScalar<Dither>(input + f * channels, output + 2 * f, frames - f, matrix, coefficients, dither);
+    }
+
+    // 2 frames per iteration
+    SOUNDREMOTE_TARGET_AVX2 void mixAvx2Float(const float* input, float* output, size_t frames, const Matrix& matrix,
+        const Coefficients& coefficients) {
+        const auto channels = matrix.size();
+        const auto gains = loadGains(coefficients, channels);
+        size_t f = 0;
+        for (; f + 2 <= frames; f += 2) {
+            _mm_storeu_ps(output + 2 * f, mixTwo(input + f * channels, channels, gains));
+        }
+        mixScalarFloat(input + f * channels, output + 2 * f, frames - f, matrix, coefficients);
+    }
+#endif
+
+    // Scalar unless specialized for the instruction set
+    template <Isa KernelIsa, bool Dither>
+    struct MixKernel {
+        static void mix(const float* input, int16_t* output, size_t frames, const Matrix& matrix,
+            const Coefficients& coefficients, DitherState& dither) {
+            mixScalar<Dither>(input, output, frames, matrix, coefficients, dither);
+        }
+        static void mixFloat(const float* input, float* output, size_t frames, const Matrix& matrix,
+            const Coefficients& coefficients) {
+            mixScalarFloat(input, output, frames, matrix, coefficients);
+        }
+    };
+
+#ifdef SOUNDREMOTE_X86
+    template <bool Dither>
+    struct MixKernel<Isa::avx2, Dither> {
+        static void mix(const float* input, int16_t* output, size_t frames, const Matrix& matrix,
+            const Coefficients& coefficients, DitherState& dither) {
+            mixAvx2<Dither>(input, output, frames, matrix, coefficients, dither);
+        }
+        static void mixFloat(const float* input, float* output, size_t frames, const Matrix& matrix,
+            const Coefficients& coefficients) {
+            mixAvx2Float(input, output, frames, matrix, coefficients);
+        }
+    };
+#endif
+
+    // The vector kernel takes a frame per register. There's no SSE2 one, it lacks the masked loads
+    // and the horizontal adds.
+    Isa kernelIsa(Isa isa, const Matrix& matrix) {
+        return isa == Isa::avx2 && matrix.size() <= DownMixer::maxVectorChannels ? Isa::avx2 : Isa::scalar;
+    }
+
+    template <bool Dither>
+    DownMixer::Int16Kernel int16KernelFor(Isa isa) {
+        return isa == Isa::avx2 ? &MixKernel<Isa::avx2, Dither>::mix : &MixKernel<Isa::scalar, Dither>::mix;
+    }
+
+    DownMixer::FloatKernel floatKernelFor(Isa isa) {
+        return isa == Isa::avx2 ? &MixKernel<Isa::avx2, false>::mixFloat : &MixKernel<Isa::scalar, false>::mixFloat;
+    }
+
+    Matrix checked(Matrix matrix) {
+        if (matrix.empty()) {
+            throw std::invalid_argument("DownMixer: empty matrix");
+        }
+        return matrix;
+    }
+}
+
+DownMixer::DownMixer(uint32_t channelMask, size_t channels, bool dither, Isa isa) :
+    DownMixer(standardMatrix(channelMask, channels), dither, isa) {}
+
+DownMixer::DownMixer(Matrix matrix, bool dither, Isa isa) :
+    matrix_(checked(std::move(matrix))),
+    isa_(kernelIsa(isa, matrix_)),
+    int16Kernel_(dither ? int16KernelFor<true>(isa_) : int16KernelFor<false>(isa_)),
+    floatKernel_(floatKernelFor(isa_)) {
+    if (matrix_.size() <= maxVectorChannels) {
+        for (size_t c = 0; c < matrix_.size(); ++c) {
+            coefficients_[c] = matrix_[c].left;
+            coefficients_[maxVectorChannels + c] = matrix_[c].right;
+        }
+    }
+    // xorshift needs non-zero seeds, different lanes get different sequences
+    for (size_t i = 0; i < dither_.size(); ++i) {
+        dither_[i] = 0x9E3779B9u * static_cast<uint32_t>(i + 1);
+    }
+}
+
+DownMixer::Matrix DownMixer::standardMatrix(uint32_t channelMask, size_t channels) {
+    if (channelMask == 0) {
+        channelMask = defaultChannelMask(channels);
+    }
+    Matrix result(channels);
+    if (channelMask == Speaker::frontCenter && channels > 0) {
+        result[0] = { 1.0f, 1.0f };
+        return result;
+    }
+    // The channels are in the order of the mask bits
+    for (size_t c = 0; c < channels && channelMask != 0; ++c) {
+        const auto speaker = static_cast<Speaker>(channelMask & (~channelMask + 1));
+        result[c] = gainsOf(speaker);
+        channelMask &= channelMask - 1;
+    }
+    return result;
+}
+
+uint32_t DownMixer::defaultChannelMask(size_t channels) {
+    switch (channels) {
+    case 1:
+        return frontCenter;
+    case 2:
+        return frontLeft | frontRight;
+    case 3:
+        return frontLeft | frontRight | frontCenter;
+    case 4:
+        return frontLeft | frontRight | backLeft | backRight;
+    case 5:
+        return frontLeft | frontRight | frontCenter | backLeft | backRight;
+    case 6:
+        return frontLeft | frontRight | frontCenter | lowFrequency | backLeft | backRight;
+    case 7:
+        return frontLeft | frontRight | frontCenter | lowFrequency | backLeft | backRight | backCenter;
+    case 8:
+        return frontLeft | frontRight | frontCenter | lowFrequency | backLeft | backRight | sideLeft | sideRight;
+    default:
+        return 0;
+    }
+}
+
+size_t DownMixer::mix(std::span<const float> input, std::span<int16_t> output) {
+    const auto frames = std::min(input.size() / matrix_.size(), output.size() / 2);
+    int16Kernel_(input.data(), output.data(), frames, matrix_, coefficients_, dither_);
+    return frames;
+}
+
+size_t DownMixer::mix(std::span<const float> input, std::span<float> output) {
+    const auto frames = std::min(input.size() / matrix_.size(), output.size() / 2);
+    floatKernel_(input.data(), output.data(), frames, matrix_, coefficients_);
+    return frames;
+}
+
+size_t DownMixer::channels() const {
+    return matrix_.size();
+}
+
+const DownMixer::Matrix& DownMixer::matrix() const {
+    return matrix_;
+}
+
+DownMixer::Isa DownMixer::isa() const {
+    return isa_;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Simd.h"
+
+/// <summary>
+/// Mixes interleaved float audio of any channel layout down (or up) to stereo. The output is either float or,
+/// converted in the same pass, int16 with clamping and optional TPDF dither, like <c>SampleConverter</c> makes
+/// from float32. The AVX2 kernels handle up to <c>maxVectorChannels</c>, the rest is done by the scalar ones.
+/// Has no platform dependencies besides the x86 intrinsics.
+/// </summary>
+class DownMixer {
+public:
+	using Isa = Simd::Isa;
+
+	// Speaker positions of the channel mask, the same bits as dwChannelMask of WAVEFORMATEXTENSIBLE
+	enum Speaker : uint32_t {
+		frontLeft = 0x1,
+		frontRight = 0x2,
+		frontCenter = 0x4,
+		lowFrequency = 0x8,
+		backLeft = 0x10,
+		backRight = 0x20,
+		frontLeftOfCenter = 0x40,
+		frontRightOfCenter = 0x80,
+		backCenter = 0x100,
+		sideLeft = 0x200,
+		sideRight = 0x400,
+		topCenter = 0x800,
+		topFrontLeft = 0x1000,
+		topFrontCenter = 0x2000,
+		topFrontRight = 0x4000,
+		topBackLeft = 0x8000,
+		topBackCenter = 0x10000,
+		topBackRight = 0x20000
+	};
+
+	// Gains of an input channel in the left and the right output
+	struct Gains {
+		float left = 0.0f;
+		float right = 0.0f;
+	};
+	// Gains of each input channel
+	using Matrix = std::vector<Gains>;
+
+	static constexpr size_t maxVectorChannels = 8;
+
+	/// <summary>
+	/// Creates a mixer with the standard matrix of the layout.
+	/// </summary>
+	/// <param name="channelMask">- speakers of the channels in the order of their bits, 0 for the usual
+	/// layout of the channel count</param>
+	/// <param name="channels">- input channels</param>
+	/// <param name="dither">- add dither to the int16 output</param>
+	/// <param name="isa">- instruction set to use, must be supported by the CPU</param>
+	DownMixer(uint32_t channelMask, size_t channels, bool dither, Isa isa = Simd::bestIsa());
+	/// <summary>
+	/// Creates a mixer with a custom matrix.
+	/// </summary>
+	/// <param name="matrix">- gains of each input channel, not empty</param>
+	/// <exception cref="std::invalid_argument">The matrix is empty.</exception>
+	DownMixer(Matrix matrix, bool dither, Isa isa = Simd::bestIsa());
+
+	/// <summary>
+	/// Gets the ITU-R BS.775 down-mix matrix of the layout: the center and the surrounds at -3 dB, the LFE
+	/// dropped. A mono center goes to both outputs at full level, the channels past the mask are dropped.
+	/// </summary>
+	static Matrix standardMatrix(uint32_t channelMask, size_t channels);
+	/// <summary>
+	/// Gets the usual channel mask for the channel count, like the KSAUDIO_SPEAKER_ layouts.
+	/// </summary>
+	static uint32_t defaultChannelMask(size_t channels);
+
+	/// <summary>
+	/// Mixes the whole frames of the input.
+	/// </summary>
+	/// <param name="input">- interleaved samples, a partial frame at the end is ignored</param>
+	/// <param name="output">- interleaved stereo samples in the int16 range, must hold the input frames</param>
+	/// <returns>Number of the mixed frames.</returns>
+	size_t mix(std::span<const float> input, std::span<int16_t> output);
+	/// <summary>
+	/// Mixes the whole frames of the input to float stereo in the input's range, without dither.
+	/// </summary>
+	/// <returns>Number of the mixed frames.</returns>
+	size_t mix(std::span<const float> input, std::span<float> output);
+	size_t channels() const;
+	const Matrix& matrix() const;
+	/// <summary>
+	/// Gets the instruction set of the kernels, scalar unless AVX2 is used and the channels fit it.
+	/// </summary>
+	Isa isa() const;
+
+	// Per lane state of the dither random generators
+	using DitherState = std::array<uint32_t, 8>;
+	// Input gains of the left output followed by the ones of the right output, padded with zeros
+	using Coefficients = std::array<float, 2 * maxVectorChannels>;
+	using Int16Kernel = void (*)(const float* input, int16_t* output, size_t frames, const Matrix& matrix,
+		const Coefficients& coefficients, DitherState& dither);
+	using FloatKernel = void (*)(const float* input, float* output, size_t frames, const Matrix& matrix,
+		const Coefficients& coefficients);
+private:
+	const Matrix matrix_;
+	const Isa isa_;
+	Coefficients coefficients_{};
+	const Int16Kernel int16Kernel_;
+	const FloatKernel floatKernel_;
+	DitherState dither_;
+};
@@ -5,28 +5,87 @@
 
 #include <opus/opus.h>
 
+#include "AudioUtil.h"
 #include "Util.h"
 
-EncoderOpus::EncoderOpus(Audio::Compression compression, Audio::Opus::SampleRate sampleRate, Audio::Opus::Channels channels) {
-    frameSize_ = getFrameSize(sampleRate);
+namespace {
+    int applicationOf(Audio::Opus::Application application) {
+        switch (application) {
+        case Audio::Opus::Application::voip:
+            return OPUS_APPLICATION_VOIP;
+        case Audio::Opus::Application::lowDelay:
+            return OPUS_APPLICATION_RESTRICTED_LOWDELAY;
+        default:
+            return OPUS_APPLICATION_AUDIO;
+        }
+    }
+
+    int bandwidthOf(Audio::Opus::Bandwidth bandwidth) {
+        switch (bandwidth) {
+        case Audio::Opus::Bandwidth::narrowband:
+            return OPUS_BANDWIDTH_NARROWBAND;
+        case Audio::Opus::Bandwidth::mediumband:
+            return OPUS_BANDWIDTH_MEDIUMBAND;
+        case Audio::Opus::Bandwidth::wideband:
+            return OPUS_BANDWIDTH_WIDEBAND;
+        case Audio::Opus::Bandwidth::superwideband:
+            return OPUS_BANDWIDTH_SUPERWIDEBAND;
+        default:
+            return OPUS_BANDWIDTH_FULLBAND;
+        }
+    }
+
+    // Throws on an error of the request
+    void setOption(OpusEncoder* encoder, int request, int value, Audio::Location location) {
+        const auto ret = opus_encoder_ctl(encoder, request, value);
+        if (ret != OPUS_OK) {
+            Audio::processError(ret, location);
+        }
+    }
+}
+
+EncoderOpus::EncoderOpus(Audio::Compression compression, Audio::Opus::SampleRate sampleRate, Audio::Opus::Channels channels,
+    Audio::SampleType sampleType, const Audio::Opus::Profile& profile) {
+    if (sampleType != Audio::SampleType::SignedInt && sampleType != Audio::SampleType::Float) {
+        throw std::invalid_argument("EncoderOpus: unsupported sample type");
+    }
+    frameSize_ = getFrameSize(sampleRate, profile.frameLength);
+    sampleType_ = sampleType;
 
     int error{};
     encoder_ = Encoder(
-        opus_encoder_create(static_cast<int>(sampleRate), static_cast<int>(channels), OPUS_APPLICATION_AUDIO, &error),
+        opus_encoder_create(static_cast<int>(sampleRate), static_cast<int>(channels),
+            applicationOf(profile.application), &error),
         EncoderDeleter()
     );
     if (OPUS_OK != error || nullptr == encoder_) {
         Audio::processError(error, Audio::Location::ENCODER_CREATE);
     }
-    auto ret = opus_encoder_ctl(encoder_.get(), OPUS_SET_BITRATE(static_cast<int>(compression)));
-    if (ret != OPUS_OK) {
-        Audio::processError(ret, Audio::Location::ENCODER_SET_BITRATE);
-    };
+    const auto encoder = encoder_.get();
+    setOption(encoder, OPUS_SET_BITRATE_REQUEST, static_cast<int>(compression), Audio::Location::ENCODER_SET_BITRATE);
+    // The silence is encoded to packets of 2 bytes or less, which don't need to be sent
+    setOption(encoder, OPUS_SET_DTX_REQUEST, 1, Audio::Location::ENCODER_SET_DTX);
+    setOption(encoder, OPUS_SET_COMPLEXITY_REQUEST, profile.complexity, Audio::Location::ENCODER_SET_COMPLEXITY);
+    setOption(encoder, OPUS_SET_MAX_BANDWIDTH_REQUEST, bandwidthOf(profile.maxBandwidth),
+        Audio::Location::ENCODER_SET_MAX_BANDWIDTH);
+    setOption(encoder, OPUS_SET_VBR_REQUEST, profile.bitrateMode == Audio::Opus::BitrateMode::cbr ? 0 : 1,
+        Audio::Location::ENCODER_SET_VBR);
+    if (profile.bitrateMode != Audio::Opus::BitrateMode::cbr) {
+        setOption(encoder, OPUS_SET_VBR_CONSTRAINT_REQUEST,
+            profile.bitrateMode == Audio::Opus::BitrateMode::constrainedVbr ? 1 : 0, Audio::Location::ENCODER_SET_VBR);
+    }
+    const auto inputDepth = sampleType == Audio::SampleType::Float ? 24 : 16;
+    setOption(encoder, OPUS_SET_LSB_DEPTH_REQUEST, profile.lsbDepth != 0 ? profile.lsbDepth : inputDepth,
+        Audio::Location::ENCODER_SET_LSB_DEPTH);
 }
 
 int EncoderOpus::encode(const char* pcmAudio, char* encodedPacket) {
-    const opus_int32 encodeResult = opus_encode(encoder_.get(), reinterpret_cast<const opus_int16*>(pcmAudio), frameSize_,
-        reinterpret_cast<unsigned char*>(encodedPacket), Audio::Opus::maxPacketSize);
+    const auto packet = reinterpret_cast<unsigned char*>(encodedPacket);
+    const opus_int32 encodeResult = sampleType_ == Audio::SampleType::Float
+        ? opus_encode_float(encoder_.get(), reinterpret_cast<const float*>(pcmAudio), frameSize_, packet,
+            Audio::Opus::maxPacketSize)
+        : opus_encode(encoder_.get(), reinterpret_cast<const opus_int16*>(pcmAudio), frameSize_, packet,
+            Audio::Opus::maxPacketSize);
     // If DTX is on and the return value is 2 bytes or less, then the packet does not need to be transmitted.
     if (encodeResult >= 0 && encodeResult <= 2) {
         return 0;
@@ -37,12 +96,19 @@ int EncoderOpus::encode(const char* pcmAudio, char* encodedPacket) {
     return encodeResult;
 }
 
-int EncoderOpus::getFrameSize(Audio::Opus::SampleRate sampleRate) {
-    return Audio::Opus::frameLength * static_cast<int>(sampleRate) / 1000;
+void EncoderOpus::setPacketLoss(int percent) {
+    setOption(encoder_.get(), OPUS_SET_PACKET_LOSS_PERC_REQUEST, percent, Audio::Location::ENCODER_SET_PACKET_LOSS);
+    setOption(encoder_.get(), OPUS_SET_INBAND_FEC_REQUEST, percent > 0 ? 1 : 0, Audio::Location::ENCODER_SET_INBAND_FEC);
+}
+
+int EncoderOpus::getFrameSize(Audio::Opus::SampleRate sampleRate, Audio::Opus::FrameLength frameLength) {
+    // The frame length is in microseconds, the rates are whole kHz
+    return static_cast<int>(frameLength) * (static_cast<int>(sampleRate) / 1000) / 1000;
 }
 
-int EncoderOpus::getInputSize(int frameSize, Audio::Opus::Channels channels) {
-    return frameSize * static_cast<int>(channels) * 2;   // 2 is sample size in bytes
+int EncoderOpus::getInputSize(int frameSize, Audio::Opus::Channels channels, Audio::SampleType sampleType) {
+    const int sampleSize = sampleType == Audio::SampleType::Float ? sizeof(float) : sizeof(opus_int16);
+    return frameSize * static_cast<int>(channels) * sampleSize;
 }
 
 //---EncoderDeleter---
@@ -2,25 +2,46 @@
 
 #include <memory>
 
-#include "AudioUtil.h"
+#include "AudioDefines.h"
+#include "OpusProfile.h"
 
 struct OpusEncoder;
 
 class EncoderOpus {
 public:
-	EncoderOpus(Audio::Compression compression, Audio::Opus::SampleRate sampleRate, Audio::Opus::Channels channels);
+	/// <param name="sampleType">- type of the input samples, either <c>SignedInt</c> for 16 bit signed int
+	/// or <c>Float</c> for 32 bit float in the [-1, 1] range</param>
+	/// <param name="profile">- frame length and the rest of the encoder settings</param>
+	/// <exception cref="std::invalid_argument">The sample type is neither of these.</exception>
+	EncoderOpus(Audio::Compression compression, Audio::Opus::SampleRate sampleRate, Audio::Opus::Channels channels,
+		Audio::SampleType sampleType = Audio::SampleType::SignedInt, const Audio::Opus::Profile& profile = {});
 
 	/// <summary>
 	/// Encodes a frame of PCM audio.
 	/// </summary>
-	/// <param name="pcmAudio">- input signal in 16 bit signed int format.
+	/// <param name="pcmAudio">- input signal in the sample type of the encoder.
 	/// Use <c>EncoderOpus::getInputSize()</c> to get the required size.</param>
 	/// <param name="encodedPacket">- buffer to contain the encoded packet.
 	/// Use <c>Audio::Opus::maxPacketSize</c> to get the recommended buffer size.</param>
 	/// <returns>Encoded packet length in bytes. If the return value is 0 encoded packet does not need to be transmitted (DTX).</returns>
 	int encode(const char* pcmAudio, char* encodedPacket);
-	static int getFrameSize(Audio::Opus::SampleRate sampleRate);
-	static int getInputSize(int frameSize, Audio::Opus::Channels channels);
+	/// <summary>
+	/// Sets the packet loss expected by the encoder. A loss above 0 turns the in-band FEC on, so the decoder can
+	/// partially recover a lost packet from the next one, at the cost of some bitrate.
+	/// </summary>
+	/// <param name="percent">- expected loss from 0 to 100</param>
+	void setPacketLoss(int percent);
+	/// <summary>
+	/// Gets the number of samples per channel in a frame.
+	/// </summary>
+	static int getFrameSize(Audio::Opus::SampleRate sampleRate,
+		Audio::Opus::FrameLength frameLength = Audio::Opus::FrameLength::ms_10);
+	/// <summary>
+	/// Gets the size of a frame of PCM audio in bytes.
+	/// </summary>
+	/// <param name="frameSize">- samples per channel, see <c>EncoderOpus::getFrameSize()</c></param>
+	static int getInputSize(int frameSize, Audio::Opus::Channels channels,
+		Audio::SampleType sampleType = Audio::SampleType::SignedInt);
 private:
 	struct EncoderDeleter {
 		void operator()(OpusEncoder* enc) const;
@@ -30,6 +51,7 @@ private:
 	Encoder encoder_;
 	// Number of samples per frame
 	int frameSize_;
+	Audio::SampleType sampleType_;
 
 	EncoderOpus(const EncoderOpus&) = delete;
 	EncoderOpus& operator= (const EncoderOpus&) = delete;
@@ -0,0 +1,320 @@
+#include "EncoderStage.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include <boost/asio/post.hpp>
+
+#include "EncoderOpus.h"
+#include "SampleConverter.h"
+
+namespace {
+    // Whole frames of the duration, at least one
+    size_t framesOf(std::chrono::microseconds duration, Audio::Opus::FrameLength frameLength) {
+        return std::max<size_t>(static_cast<size_t>(duration.count() / static_cast<int>(frameLength)), 1);
+    }
+}
+
+// Continues across the stages, a device change doesn't restart the numbering for the clients
+Net::Packet::SequenceNumberType EncoderStage::audioSequenceNumber_ = 1u;
+
+std::shared_ptr<EncoderStage> EncoderStage::create(
+    size_t frameSize,
+    boost::asio::io_context& networkContext,
+    Sink sink,
+    std::shared_ptr<CaptureCounters> counters,
+    std::shared_ptr<PipelineLatency> latency,
+    size_t encoderThreads,
+    size_t queueCapacity,
+    Audio::SampleType sampleType,
+    const Audio::Opus::Profile& profile
+) {
+    return std::shared_ptr<EncoderStage>(new EncoderStage(frameSize, networkContext, std::move(sink),
+        std::move(counters), std::move(latency), encoderThreads, queueCapacity, sampleType, profile));
+}
+
+size_t EncoderStage::defaultEncoderThreads() {
+    constexpr size_t opusCompressions = Audio::compressionCount - 1;
+    return std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, opusCompressions);
+}
+
+EncoderStage::EncoderStage(size_t frameSize, boost::asio::io_context& networkContext, Sink sink,
+    std::shared_ptr<CaptureCounters> counters, std::shared_ptr<PipelineLatency> latency, size_t encoderThreads,
+    size_t queueCapacity, Audio::SampleType sampleType, const Audio::Opus::Profile& profile) :
+    frameSize_(frameSize),
+    sampleType_(sampleType),
+    profile_(profile),
+    silenceHangoverFrames_(framesOf(silenceHangover, profile.frameLength)),
+    silenceMarkerFrames_(framesOf(silenceMarkerInterval, profile.frameLength)),
+    networkContext_(networkContext),
+    sink_(std::move(sink)),
+    counters_(std::move(counters)),
+    latency_(std::move(latency)),
+    // A PCM frame may wait in both queues as the uncompressed packet, a float one is converted to a buffer of its own
+    pcmPool_(PacketPool::create(frameSize, 2 * queueCapacity)),
+    packetPool_(PacketPool::create(Audio::Opus::maxPacketSize, queueCapacity)),
+    frames_(queueCapacity),
+    packets_(queueCapacity),
+    // Dithered like the rest of the float audio made 16 bit
+    sampleConverter_(sampleType == Audio::SampleType::Float
+        ? std::make_unique<SampleConverter>(SampleFormat::float32, true) : nullptr),
+    silenceDetector_(sampleType == Audio::SampleType::Float ? SampleFormat::float32 : SampleFormat::int16),
+    // The stage thread encodes too
+    workers_(std::max<size_t>(encoderThreads, 1) - 1),
+    encodeTask_([this](size_t task) { encodeTask(task); }),
+    thread_(&EncoderStage::run, this) {}
+
+EncoderStage::~EncoderStage() {
+    stopped_.store(true);
+    wakeups_.fetch_add(1, std::memory_order_release);
+    wakeups_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    // The counters outlive the stage, so the frames left in the queues are counted as taken
+    while (frames_.tryPop()) {
+        counters_->countEncodeDequeued();
+    }
+    while (packets_.tryPop()) {
+        counters_->countSendDequeued();
+    }
+}
+
+bool EncoderStage::push(std::span<const char> pcmFrame, PipelineLatency::TimePoint captured) {
+    auto pcm = pcmPool_->acquire();
+    const auto size = std::min(pcmFrame.size(), frameSize_);
+    std::copy_n(pcmFrame.data(), size, pcm->data());
+    pcm->resize(size);
+    return push(std::move(pcm), captured);
+}
+
+bool EncoderStage::push(PacketPtr pcmFrame, PipelineLatency::TimePoint captured) {
+    if (!frames_.tryPush({ std::move(pcmFrame), captured })) {
+        counters_->countCaptureStall();
+        return false;
+    }
+    counters_->countEncodeQueued();
+    wakeups_.fetch_add(1, std::memory_order_release);
+    wakeups_.notify_one();
+    return true;
+}
+
+void EncoderStage::addClient(Audio::Compression compression, int lossPercent) {
+    clientLosses_[Audio::compressionIndex(compression)].insert(lossPercent);
+    publishCompressions();
+}
+
+void EncoderStage::removeClient(Audio::Compression compression, int lossPercent) {
+    auto& losses = clientLosses_[Audio::compressionIndex(compression)];
+    const auto it = losses.find(lossPercent);
+    if (it == losses.end()) {
+        return;
+    }
+    losses.erase(it);
+    publishCompressions();
+}
+
+void EncoderStage::clearClients() {
+    for (auto&& losses : clientLosses_) {
+        losses.clear();
+    }
+    publishCompressions();
+}
+
+bool EncoderStage::haveClients() const {
+    return compressions_.load(std::memory_order_relaxed) != 0;
+}
+
+void EncoderStage::publishCompressions() {
+    CompressionSet compressions = 0;
+    for (size_t i = 0; i < Audio::compressionCount; ++i) {
+        const auto& losses = clientLosses_[i];
+        if (!losses.empty()) {
+            compressions |= 1u << i;
+        }
+        lossPercents_[i].store(losses.empty() ? 0 : *losses.rbegin(), std::memory_order_relaxed);
+    }
+    compressions_.store(compressions, std::memory_order_relaxed);
+}
+
+void EncoderStage::run() {
+    try {
+        for (;;) {
+            // Read before draining, so a frame pushed after the drain changes it and the wait returns at once
+            const auto wakeups = wakeups_.load(std::memory_order_acquire);
+            while (auto frame = frames_.tryPop()) {
+                counters_->countEncodeDequeued();
+                encode(*frame);
+            }
+            if (stopped_.load()) {
+                return;
+            }
+            wakeups_.wait(wakeups, std::memory_order_acquire);
+        }
+    }
+    catch (...) {
+        // Handled on the network thread along with the errors of its own tasks
+        boost::asio::post(networkContext_, [error = std::current_exception()] { std::rethrow_exception(error); });
+    }
+}
+
+void EncoderStage::encode(const Frame& frame) {
+    updateEncoders();
+    if (skipSilence(frame)) {
+        ++audioSequenceNumber_;
+        scheduleSend();
+        return;
+    }
+    size_t taskCount = 0;
+    for (size_t i = 0; i < Audio::compressionCount; ++i) {
+        if (encoders_[i] && (encodedCompressions_ & (1u << i)) != 0) {
+            encodeIndices_[taskCount++] = i;
+        }
+    }
+    encodingFrame_ = &frame;
+    workers_.run(taskCount, encodeTask_);
+    encodingFrame_ = nullptr;
+    for (size_t i = 0; i < Audio::compressionCount; ++i) {
+        if ((encodedCompressions_ & (1u << i)) == 0) {
+            continue;
+        }
+        const auto compression = Audio::compressions[i];
+        if (compression == Audio::Compression::none) {
+            queueSend({ compression, audioSequenceNumber_, uncompressed(frame), frame.captured, PipelineLatency::now() });
+        } else if (encoded_[i].packet) {
+            queueSend(std::exchange(encoded_[i], {}));
+        }
+        // Otherwise DTX, the packet doesn't need to be sent
+    }
+    ++audioSequenceNumber_;
+    scheduleSend();
+}
+
+void EncoderStage::encodeTask(size_t task) {
+    const auto index = encodeIndices_[task];
+    const auto compression = Audio::compressions[index];
+    const auto& frame = *encodingFrame_;
+    PacketPtr encodedPacket = packetPool_->acquire();
+    const auto encodeStarted = PipelineLatency::now();
+    int packetSize = 0;
+    try {
+        packetSize = encoders_[index]->encode(frame.pcm->data(), encodedPacket->data());
+    }
+    catch (const Audio::Error&) {
+        // Only this frame of the compression is lost, the stream goes on
+        counters_->countEncodeFailure();
+        return;
+    }
+    const auto encoded = PipelineLatency::now();
+    latency_->record(PipelineLatency::Stage::encode, encodeStarted, encoded, compression);
+    if (packetSize > 0) {
+        encodedPacket->resize(static_cast<size_t>(packetSize));
+        encoded_[index] = { compression, audioSequenceNumber_, std::move(encodedPacket), frame.captured, encoded };
+    }
+}
+
+PacketPtr EncoderStage::uncompressed(const Frame& frame) {
+    // 16 bit audio is sent straight from the frame
+    if (!sampleConverter_) {
+        return frame.pcm;
+    }
+    auto packet = pcmPool_->acquire();
+    const std::span<int16_t> samples{ reinterpret_cast<int16_t*>(packet->data()), packet->capacity() / sizeof(int16_t) };
+    const auto converted = sampleConverter_->convert({ frame.pcm->data(), frame.pcm->size() }, samples);
+    packet->resize(converted * sizeof(int16_t));
+    return packet;
+}
+
+bool EncoderStage::skipSilence(const Frame& frame) {
+    if (!silenceDetector_.isSilent({ frame.pcm->data(), frame.pcm->size() })) {
+        if (silentFrames_ > silenceHangoverFrames_) {
+            // Covers the frames skipped since the last marker
+            queueSilence(audioSequenceNumber_ - 1, frame.captured);
+        }
+        silentFrames_ = 0;
+        return false;
+    }
+    if (++silentFrames_ <= silenceHangoverFrames_) {
+        return false;
+    }
+    counters_->countSilentFrame();
+    if ((silentFrames_ - silenceHangoverFrames_ - 1) % silenceMarkerFrames_ == 0) {
+        queueSilence(audioSequenceNumber_, frame.captured);
+    }
+    return true;
+}
+
+void EncoderStage::queueSilence(Net::Packet::SequenceNumberType sequenceNumber, PipelineLatency::TimePoint captured) {
+    for (size_t i = 0; i < Audio::compressionCount; ++i) {
+        if ((encodedCompressions_ & (1u << i)) != 0) {
+            queueSend({ Audio::compressions[i], sequenceNumber, nullptr, captured, PipelineLatency::now() });
+        }
+    }
+}
+
+void EncoderStage::updateEncoders() {
+    const auto compressions = compressions_.load(std::memory_order_relaxed);
+    if (compressions != encodedCompressions_) {
+        for (size_t i = 0; i < Audio::compressionCount; ++i) {
+            const auto compression = Audio::compressions[i];
+            if (compression == Audio::Compression::none) {
+                continue;
+            }
+            if ((compressions & (1u << i)) == 0) {
+                encoders_[i].reset();
+            } else if (!encoders_[i]) {
+                encoders_[i] = std::make_unique<EncoderOpus>(compression, Audio::Opus::SampleRate::khz_48,
+                    Audio::Opus::Channels::stereo, sampleType_, profile_);
+                encoderLosses_[i] = 0;
+            }
+        }
+        encodedCompressions_ = compressions;
+    }
+    for (size_t i = 0; i < Audio::compressionCount; ++i) {
+        if (!encoders_[i]) {
+            continue;
+        }
+        const auto lossPercent = lossPercents_[i].load(std::memory_order_relaxed);
+        if (lossPercent != encoderLosses_[i]) {
+            encoders_[i]->setPacketLoss(lossPercent);
+            encoderLosses_[i] = lossPercent;
+        }
+    }
+}
+
+void EncoderStage::queueSend(EncodedFrame&& frame) {
+    if (!packets_.tryPush(std::move(frame))) {
+        counters_->countEncodeStall();
+        return;
+    }
+    counters_->countSendQueued();
+}
+
+void EncoderStage::scheduleSend() {
+    if (packets_.size() == 0 || sendScheduled_.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    boost::asio::post(networkContext_, [weak = weak_from_this()] {
+        if (const auto stage = weak.lock()) {
+            stage->send();
+        }
+    });
+}
+
+void EncoderStage::send() {
+    using Stage = PipelineLatency::Stage;
+    // Cleared before draining, so a packet queued after the drain gets a new send() posted
+    sendScheduled_.exchange(false, std::memory_order_acq_rel);
+    while (auto frame = packets_.tryPop()) {
+        counters_->countSendDequeued();
+        if (!frame->packet) {
+            sink_(frame->compression, frame->sequenceNumber, {});
+            continue;
+        }
+        sink_(frame->compression, frame->sequenceNumber, frame->packet);
+        const auto sent = PipelineLatency::now();
+        latency_->record(Stage::send, frame->encoded, sent, frame->compression);
+        latency_->record(Stage::total, frame->captured, sent, frame->compression);
+    }
+}
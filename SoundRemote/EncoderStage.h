@@ -0,0 +1,204 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <set>
+#include <span>
+#include <thread>
+
+#include <boost/asio/io_context.hpp>
+
+#include "AudioDefines.h"
+#include "CaptureCounters.h"
+#include "NetDefines.h"
+#include "OpusProfile.h"
+#include "PacketPool.h"
+#include "PipelineLatency.h"
+#include "SilenceDetector.h"
+#include "SpscQueue.h"
+#include "WorkerPool.h"
+
+class EncoderOpus;
+class SampleConverter;
+
+/// <summary>
+/// Encoder stage of the capture pipeline. Takes the PCM frames from the capture thread, encodes them on its own
+/// thread for every compression the clients use and hands the packets over to the network thread.
+/// The encodes of a frame run in parallel on a worker pool, the packets are queued in the compression order.
+/// The encoder of a compression is protected with the in-band FEC against the highest loss of its clients.
+/// A frame the encoder fails on isn't sent to the clients of the compression and is counted as an encode failure.
+/// Float frames are encoded as they are, only the uncompressed audio is converted to 16 bit int for the clients.
+/// Silence is sent for a while, so the Opus DTX ends the stream smoothly, then the silent frames are skipped
+/// and the sink gets only the sparse silence markers keeping the sequence numbers accounted for.
+/// The threads are joined by bounded lock-free queues. A thread finding the queue of the next stage full drops
+/// the frame and counts a stall, so a slow encoder or network never holds up the capture.
+/// </summary>
+class EncoderStage : public std::enable_shared_from_this<EncoderStage> {
+public:
+	/// <summary>
+	/// Sends a packet to the clients of the compression, called on the network thread.
+	/// The sink may keep the audio data, shared with the pools of the stage, but must not change it.
+	/// Empty audio data is a silence marker: the frames up to the sequence number not sent are silence.
+	/// </summary>
+	using Sink = std::function<void(Audio::Compression compression, Net::Packet::SequenceNumberType sequenceNumber,
+		const PacketPtr& audioData)>;
+
+	// Frames each of the queues holds, 160 ms of the 10 ms frames
+	static constexpr size_t defaultQueueCapacity = 16;
+	// Silence still sent before the silent frames are skipped, rounded down to whole frames
+	static constexpr std::chrono::milliseconds silenceHangover{ 200 };
+	// Skipped silence per silence marker, rounded down to whole frames
+	static constexpr std::chrono::milliseconds silenceMarkerInterval{ 500 };
+
+	/// <summary>
+	/// Creates the stage and starts its thread.
+	/// </summary>
+	/// <param name="frameSize">- size of a PCM frame in bytes</param>
+	/// <param name="networkContext">- context of the network thread, the sink is called on it</param>
+	/// <param name="sink">- sends the packets</param>
+	/// <param name="counters">- counters of the pipeline, get the queue depths, the stalls and the encode failures</param>
+	/// <param name="latency">- latencies of the pipeline stages</param>
+	/// <param name="encoderThreads">- threads encoding a frame, including the stage thread</param>
+	/// <param name="queueCapacity">- frames each of the queues holds, rounded up to a power of two</param>
+	/// <param name="sampleType">- type of the PCM samples, 16 bit <c>SignedInt</c> or 32 bit <c>Float</c></param>
+	/// <param name="profile">- settings of the Opus encoders, its frame length is the one of the PCM frames</param>
+	static std::shared_ptr<EncoderStage> create(
+		size_t frameSize,
+		boost::asio::io_context& networkContext,
+		Sink sink,
+		std::shared_ptr<CaptureCounters> counters,
+		std::shared_ptr<PipelineLatency> latency,
+		size_t encoderThreads = 1,
+		size_t queueCapacity = defaultQueueCapacity,
+		Audio::SampleType sampleType = Audio::SampleType::SignedInt,
+		const Audio::Opus::Profile& profile = {}
+	);
+	/// <summary>
+	/// Gets the encoder threads for a machine, half of its cores but no more than one per Opus compression.
+	/// </summary>
+	static size_t defaultEncoderThreads();
+	/// <summary>
+	/// Stops the thread. The frames still in the queues are dropped.
+	/// </summary>
+	~EncoderStage();
+
+	/// <summary>
+	/// Queues a frame for the encoding. Capture thread only.
+	/// </summary>
+	/// <param name="pcmFrame">- frame of <c>frameSize</c> bytes, copied</param>
+	/// <param name="captured">- time the captured buffer completing the frame was yielded</param>
+	/// <returns>False if the frame is dropped as the queue is full.</returns>
+	bool push(std::span<const char> pcmFrame, PipelineLatency::TimePoint captured);
+	/// <summary>
+	/// Queues a frame for the encoding without copying it. Capture thread only.
+	/// </summary>
+	/// <param name="pcmFrame">- buffer of the frame, the stage holds it until the frame is sent</param>
+	/// <returns>False if the frame is dropped as the queue is full.</returns>
+	bool push(PacketPtr pcmFrame, PipelineLatency::TimePoint captured);
+	/// <summary>
+	/// Counts a client of the compression, the first one makes the frames encoded for it.
+	/// Called by one thread at a time, like the rest of the clients management.
+	/// </summary>
+	/// <param name="lossPercent">- packet loss of the client, see <c>ClientInfo::lossPercent</c></param>
+	void addClient(Audio::Compression compression, int lossPercent = 0);
+	/// <summary>
+	/// Uncounts a client of the compression, after the last one the frames are not encoded for it anymore.
+	/// </summary>
+	/// <param name="lossPercent">- packet loss the client was added with</param>
+	void removeClient(Audio::Compression compression, int lossPercent = 0);
+	void clearClients();
+	/// <summary>
+	/// Checks if there are clients of any compression. Thread safe.
+	/// </summary>
+	bool haveClients() const;
+
+	EncoderStage(const EncoderStage&) = delete;
+	EncoderStage& operator= (const EncoderStage&) = delete;
+private:
+	// Bit per compressionIndex
+	using CompressionSet = uint32_t;
+
+	struct Frame {
+		PacketPtr pcm;
+		PipelineLatency::TimePoint captured;
+	};
+
+	struct EncodedFrame {
+		Audio::Compression compression = Audio::Compression::none;
+		Net::Packet::SequenceNumberType sequenceNumber = 0;
+		// Shares the PCM frame for the uncompressed 16 bit audio, empty for a silence marker
+		PacketPtr packet;
+		PipelineLatency::TimePoint captured;
+		PipelineLatency::TimePoint encoded;
+	};
+
+	EncoderStage(size_t frameSize, boost::asio::io_context& networkContext, Sink sink,
+		std::shared_ptr<CaptureCounters> counters, std::shared_ptr<PipelineLatency> latency, size_t encoderThreads,
+		size_t queueCapacity, Audio::SampleType sampleType, const Audio::Opus::Profile& profile);
+	// Encoder thread
+	void run();
+	void encode(const Frame& frame);
+	// Encodes encodingFrame_ for the compression of the task, on a worker. Counts a failed encode.
+	void encodeTask(size_t task);
+	// Gets the uncompressed packet of the frame
+	PacketPtr uncompressed(const Frame& frame);
+	// Checks if the frame is skipped as silence, queues the silence markers
+	bool skipSilence(const Frame& frame);
+	void queueSilence(Net::Packet::SequenceNumberType sequenceNumber, PipelineLatency::TimePoint captured);
+	// Makes the encoders match the compressions in use
+	void updateEncoders();
+	void queueSend(EncodedFrame&& frame);
+	// Posts send() unless it's already posted and hasn't started draining yet
+	void scheduleSend();
+	// Network thread
+	void send();
+	void publishCompressions();
+
+	const size_t frameSize_;
+	const Audio::SampleType sampleType_;
+	const Audio::Opus::Profile profile_;
+	const size_t silenceHangoverFrames_;
+	const size_t silenceMarkerFrames_;
+	boost::asio::io_context& networkContext_;
+	Sink sink_;
+	std::shared_ptr<CaptureCounters> counters_;
+	std::shared_ptr<PipelineLatency> latency_;
+	std::shared_ptr<PacketPool> pcmPool_;
+	std::shared_ptr<PacketPool> packetPool_;
+	// Capture thread to the encoder thread
+	SpscQueue<Frame> frames_;
+	// Encoder thread to the network thread
+	SpscQueue<EncodedFrame> packets_;
+	std::atomic_bool sendScheduled_ = false;
+	// Bumped to wake the encoder thread up
+	std::atomic<uint32_t> wakeups_ = 0;
+	std::atomic_bool stopped_ = false;
+	// Clients management, the loss of each client
+	std::array<std::multiset<int>, Audio::compressionCount> clientLosses_;
+	std::atomic<CompressionSet> compressions_ = 0;
+	// Highest loss of the clients of each compression
+	std::array<std::atomic<int>, Audio::compressionCount> lossPercents_{};
+	// Encoder thread
+	CompressionSet encodedCompressions_ = 0;
+	std::array<std::unique_ptr<EncoderOpus>, Audio::compressionCount> encoders_;
+	// Loss each encoder is set to expect
+	std::array<int, Audio::compressionCount> encoderLosses_{};
+	// Makes the uncompressed audio of the float frames
+	std::unique_ptr<SampleConverter> sampleConverter_;
+	const SilenceDetector silenceDetector_;
+	// Silent frames in a row
+	size_t silentFrames_ = 0;
+	WorkerPool workers_;
+	const std::function<void(size_t)> encodeTask_;
+	// The frame being encoded, the compressionIndex of each encode task and their results
+	const Frame* encodingFrame_ = nullptr;
+	std::array<size_t, Audio::compressionCount> encodeIndices_{};
+	std::array<EncodedFrame, Audio::compressionCount> encoded_;
+	static Net::Packet::SequenceNumberType audioSequenceNumber_;
+	// Started last and stopped first, so it sees all of the above constructed
+	std::thread thread_;
+};
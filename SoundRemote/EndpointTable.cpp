@@ -0,0 +1,204 @@
+#include "EndpointTable.h"
+
+#include <algorithm>
+
+#include "Clients.h"
+
+using boost::asio::ip::udp;
+
+namespace {
+    const EndpointTable::Group emptyGroup;
+}
+
+bool EndpointTable::Destinations::empty() const {
+    return endpoints.empty();
+}
+
+bool EndpointTable::Destinations::contains(const udp::endpoint& endpoint) const {
+    return std::ranges::binary_search(endpoints, endpoint);
+}
+
+std::optional<size_t> EndpointTable::Destinations::indexOf(const udp::endpoint& endpoint) const {
+    const auto it = std::ranges::lower_bound(endpoints, endpoint);
+    if (it == endpoints.end() || *it != endpoint) { return {}; }
+    return it - endpoints.begin();
+}
+
+void EndpointTable::Destinations::insert(const udp::endpoint& endpoint, std::shared_ptr<TrafficCounters> endpointCounters) {
+    const auto it = std::ranges::lower_bound(endpoints, endpoint);
+    if (it != endpoints.end() && *it == endpoint) { return; }
+    counters.insert(counters.begin() + (it - endpoints.begin()), std::move(endpointCounters));
+    endpoints.insert(it, endpoint);
+}
+
+void EndpointTable::Destinations::erase(const udp::endpoint& endpoint) {
+    const auto it = std::ranges::lower_bound(endpoints, endpoint);
+    if (it == endpoints.end() || *it != endpoint) { return; }
+    counters.erase(counters.begin() + (it - endpoints.begin()));
+    endpoints.erase(it);
+}
+
+bool EndpointTable::Group::empty() const {
+    return unicast.empty() && multicast.empty() &&
+        std::ranges::all_of(aggregated, &Destinations::empty);
+}
+
+std::shared_ptr<const EndpointTable> EndpointTable::build(
+    const std::forward_list<ClientInfo>& clients,
+    int clientPort,
+    const EndpointTable* previous
+) {
+    // Sorted so the same set of clients always makes the same group regardless of the update order
+    std::vector<std::pair<udp::endpoint, const ClientInfo*>> sorted;
+    for (auto&& client : clients) {
+        sorted.emplace_back(udp::endpoint(client.address, clientPort), &client);
+    }
+    std::ranges::sort(sorted, {}, &std::pair<udp::endpoint, const ClientInfo*>::first);
+    std::array<Group, Audio::compressionCount> groups;
+    for (auto&& [endpoint, client] : sorted) {
+        auto& group = groups[Audio::compressionIndex(client->compression)];
+        group.compression = client->compression;
+        auto& destinations = destinationsOf(group, *client);
+        destinations.endpoints.push_back(endpoint);
+        destinations.counters.push_back(client->counters);
+        auto& keepalives = isProbed(*client) ? group.probed : group.unprobed;
+        keepalives.endpoints.push_back(endpoint);
+        keepalives.counters.push_back(client->counters);
+        if (isSilenceAware(*client)) {
+            group.silenceAware.endpoints.push_back(endpoint);
+            group.silenceAware.counters.push_back(client->counters);
+        }
+        if (getsParity(*client)) {
+            group.parity.endpoints.push_back(endpoint);
+            group.parity.counters.push_back(client->counters);
+        }
+        if (getsRetransmits(*client)) {
+            group.retransmit.endpoints.push_back(endpoint);
+            group.retransmit.counters.push_back(client->counters);
+        }
+    }
+
+    auto table = std::make_shared<EndpointTable>();
+    for (size_t i = 0; i < Audio::compressionCount; ++i) {
+        auto& group = groups[i];
+        if (group.empty()) { continue; }
+        if (previous && previous->groups_[i] && *previous->groups_[i] == group) {
+            table->groups_[i] = previous->groups_[i];
+        } else {
+            table->groups_[i] = std::make_shared<const Group>(std::move(group));
+        }
+    }
+    table->updateNonEmpty();
+    return table;
+}
+
+std::shared_ptr<const EndpointTable> EndpointTable::apply(const ClientsDelta& delta, int clientPort) const {
+    auto table = std::make_shared<EndpointTable>(*this);
+    switch (delta.type) {
+    case ClientsDelta::Type::added:
+        table->insert(delta.client, clientPort);
+        break;
+    case ClientsDelta::Type::removed:
+        table->erase(delta.client, clientPort);
+        break;
+    case ClientsDelta::Type::formatChanged:
+        if (delta.previous) {
+            table->erase(*delta.previous, clientPort);
+        }
+        table->insert(delta.client, clientPort);
+        break;
+    }
+    table->updateNonEmpty();
+    return table;
+}
+
+const EndpointTable::Group& EndpointTable::group(Audio::Compression compression) const {
+    const auto& group = groups_[Audio::compressionIndex(compression)];
+    return group ? *group : emptyGroup;
+}
+
+std::span<const EndpointTable::Group* const> EndpointTable::groups() const {
+    return nonEmpty_;
+}
+
+bool EndpointTable::empty() const {
+    return nonEmpty_.empty();
+}
+
+EndpointTable::Destinations& EndpointTable::destinationsOf(Group& group, const ClientInfo& client) {
+    if (const auto frames = framesPerPacket(client); frames > 1) {
+        return group.aggregated[frames];
+    }
+    return client.protocol >= Net::Protocol::multicast ? group.multicast : group.unicast;
+}
+
+const EndpointTable::Destinations& EndpointTable::destinationsOf(const Group& group, const ClientInfo& client) {
+    if (const auto frames = framesPerPacket(client); frames > 1) {
+        return group.aggregated[frames];
+    }
+    return client.protocol >= Net::Protocol::multicast ? group.multicast : group.unicast;
+}
+
+int EndpointTable::framesPerPacket(const ClientInfo& client) {
+    if (client.protocol < Net::Protocol::aggregation) { return 1; }
+    return std::clamp(client.framesPerPacket, 1, Net::Packet::maxFramesPerPacket);
+}
+
+bool EndpointTable::isProbed(const ClientInfo& client) {
+    return client.protocol >= Net::Protocol::roundTrip;
+}
+
+bool EndpointTable::isSilenceAware(const ClientInfo& client) {
+    return client.protocol >= Net::Protocol::silence;
+}
+
+bool EndpointTable::getsParity(const ClientInfo& client) {
+    // The parity is made of the single frame packets
+    return client.protocol >= Net::Protocol::parity && client.parity && framesPerPacket(client) == 1;
+}
+
+bool EndpointTable::getsRetransmits(const ClientInfo& client) {
+    return client.protocol >= Net::Protocol::retransmit;
+}
+
+void EndpointTable::insert(const ClientInfo& client, int clientPort) {
+    auto& shared = groups_[Audio::compressionIndex(client.compression)];
+    const udp::endpoint endpoint(client.address, clientPort);
+    if (shared && destinationsOf(*shared, client).contains(endpoint)) { return; }
+    auto group = shared ? *shared : Group{ client.compression };
+    destinationsOf(group, client).insert(endpoint, client.counters);
+    (isProbed(client) ? group.probed : group.unprobed).insert(endpoint, client.counters);
+    if (isSilenceAware(client)) {
+        group.silenceAware.insert(endpoint, client.counters);
+    }
+    if (getsParity(client)) {
+        group.parity.insert(endpoint, client.counters);
+    }
+    if (getsRetransmits(client)) {
+        group.retransmit.insert(endpoint, client.counters);
+    }
+    shared = std::make_shared<const Group>(std::move(group));
+}
+
+void EndpointTable::erase(const ClientInfo& client, int clientPort) {
+    auto& shared = groups_[Audio::compressionIndex(client.compression)];
+    const udp::endpoint endpoint(client.address, clientPort);
+    if (!shared || !destinationsOf(*shared, client).contains(endpoint)) { return; }
+    auto group = *shared;
+    destinationsOf(group, client).erase(endpoint);
+    group.probed.erase(endpoint);
+    group.unprobed.erase(endpoint);
+    group.silenceAware.erase(endpoint);
+    group.parity.erase(endpoint);
+    group.retransmit.erase(endpoint);
+    shared = group.empty() ? nullptr : std::make_shared<const Group>(std::move(group));
+}
+
+void EndpointTable::updateNonEmpty() {
+    nonEmpty_.clear();
+    for (auto&& group : groups_) {
+        if (group) {
+            nonEmpty_.push_back(group.get());
+        }
+    }
+}
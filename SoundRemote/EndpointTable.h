@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <forward_list>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <boost/asio/ip/udp.hpp>
+
+#include "AudioUtil.h"
+#include "NetDefines.h"
+#include "TrafficCounters.h"
+
+struct ClientInfo;
+struct ClientsDelta;
+
+/// <summary>
+/// Immutable table of the client endpoints, grouped by compression.
+/// Each group is a contiguous sorted array of ready-made endpoints, so the fan-out is a linear walk over them.
+/// A table is built from the clients snapshot and then a new one is derived from it on every change,
+/// copying only the changed groups and sharing the rest.
+/// </summary>
+class EndpointTable {
+public:
+	// Client endpoints sorted by endpoint, with the client counters in the same order
+	struct Destinations {
+		std::vector<boost::asio::ip::udp::endpoint> endpoints;
+		std::vector<std::shared_ptr<TrafficCounters>> counters;
+
+		bool empty() const;
+		bool contains(const boost::asio::ip::udp::endpoint& endpoint) const;
+		// Position of the endpoint in endpoints and counters, empty if it's missing
+		std::optional<size_t> indexOf(const boost::asio::ip::udp::endpoint& endpoint) const;
+		// Keep the order, do nothing if the endpoint is already there or missing respectively
+		void insert(const boost::asio::ip::udp::endpoint& endpoint, std::shared_ptr<TrafficCounters> endpointCounters);
+		void erase(const boost::asio::ip::udp::endpoint& endpoint);
+		friend bool operator==(const Destinations& lhs, const Destinations& rhs) = default;
+	};
+
+	// Destinations of the clients using the same compression
+	struct Group {
+		Audio::Compression compression = Audio::Compression::none;
+		// Clients getting the audio directly
+		Destinations unicast;
+		// Clients getting the audio from the compression's multicast group in the multicast mode
+		Destinations multicast;
+		// Clients getting several frames per packet by unicast, indexed by the frames per packet from 2 on
+		std::array<Destinations, Net::Packet::maxFramesPerPacket + 1> aggregated;
+		// Clients measuring the round-trip time with the keepalives, also listed in unicast or multicast
+		Destinations probed;
+		// The rest of the clients, getting the plain keepalives
+		Destinations unprobed;
+		// Clients getting AudioSilence instead of the silent audio, also listed in unicast or multicast
+		Destinations silenceAware;
+		// Clients getting the parity packets, also listed in unicast or multicast
+		Destinations parity;
+		// Clients the lost audio is resent to on their Nack, also listed in unicast, multicast or aggregated
+		Destinations retransmit;
+
+		bool empty() const;
+		friend bool operator==(const Group& lhs, const Group& rhs) = default;
+	};
+
+	/// <summary>
+	/// Builds a table for all the clients, for a snapshot. The changes after it go through <c>apply</c>.
+	/// </summary>
+	/// <param name="clients">- current clients</param>
+	/// <param name="clientPort">- port the clients receive on</param>
+	/// <param name="previous">- table to take the unchanged groups from, may be null</param>
+	/// <returns>New table.</returns>
+	static std::shared_ptr<const EndpointTable> build(
+		const std::forward_list<ClientInfo>& clients,
+		int clientPort,
+		const EndpointTable* previous = nullptr
+	);
+
+	/// <summary>
+	/// Makes a table with the change applied. Only the groups the client leaves or joins are copied.
+	/// </summary>
+	/// <param name="delta">- change of the clients</param>
+	/// <param name="clientPort">- port the clients receive on</param>
+	/// <returns>New table.</returns>
+	std::shared_ptr<const EndpointTable> apply(const ClientsDelta& delta, int clientPort) const;
+
+	/// <summary>
+	/// Gets the group of the compression, empty if there are no such clients.
+	/// </summary>
+	const Group& group(Audio::Compression compression) const;
+	/// <summary>
+	/// Gets all the non-empty groups.
+	/// </summary>
+	std::span<const Group* const> groups() const;
+	/// <summary>
+	/// Checks if there are no clients at all.
+	/// </summary>
+	bool empty() const;
+private:
+	static Destinations& destinationsOf(Group& group, const ClientInfo& client);
+	static const Destinations& destinationsOf(const Group& group, const ClientInfo& client);
+	static bool isProbed(const ClientInfo& client);
+	static bool isSilenceAware(const ClientInfo& client);
+	static int framesPerPacket(const ClientInfo& client);
+	static bool getsParity(const ClientInfo& client);
+	static bool getsRetransmits(const ClientInfo& client);
+	void insert(const ClientInfo& client, int clientPort);
+	void erase(const ClientInfo& client, int clientPort);
+	void updateNonEmpty();
+
+	std::array<std::shared_ptr<const Group>, Audio::compressionCount> groups_;
+	// Non-owning pointers to the non-empty groups_, for walking all of them
+	std::vector<const Group*> nonEmpty_;
+};
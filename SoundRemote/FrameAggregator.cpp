@@ -0,0 +1,113 @@
+#include "FrameAggregator.h"
+
+#include <stdexcept>
+
+#include <opus/opus.h>
+
+#include "NetDefines.h"
+
+namespace {
+    const unsigned char* bytesOf(const PacketBuffer& frame) {
+        return reinterpret_cast<const unsigned char*>(frame.data());
+    }
+}
+
+FrameAggregator::FrameAggregator(Audio::Compression compression, size_t framesPerPacket) :
+    framesPerPacket_(framesPerPacket) {
+    if (framesPerPacket < 2 || framesPerPacket > Net::Packet::maxFramesPerPacket) {
+        throw std::invalid_argument("FrameAggregator: frames per packet out of range");
+    }
+    if (compression != Audio::Compression::none) {
+        repacketizer_.reset(opus_repacketizer_create());
+        if (!repacketizer_) {
+            Audio::processError(OPUS_ALLOC_FAIL, Audio::Location::ENCODER_REPACKETIZER_CREATE);
+        }
+    }
+    frames_.reserve(framesPerPacket);
+}
+
+FrameAggregator::~FrameAggregator() = default;
+
+std::optional<AggregatedPacket> FrameAggregator::add(uint32_t sequenceNumber, PacketPtr frame) {
+    if (frames_.empty()) {
+        start(sequenceNumber, std::move(frame));
+        return std::nullopt;
+    }
+    if (!join(sequenceNumber, frame)) {
+        // The packet is made before the repacketizer is reset for the frame
+        auto ended = close();
+        start(sequenceNumber, std::move(frame));
+        return ended;
+    }
+    if (frames_.size() < framesPerPacket_) {
+        return std::nullopt;
+    }
+    return close();
+}
+
+std::optional<AggregatedPacket> FrameAggregator::flush() {
+    if (frames_.empty()) {
+        return std::nullopt;
+    }
+    return close();
+}
+
+size_t FrameAggregator::framesPerPacket() const {
+    return framesPerPacket_;
+}
+
+void FrameAggregator::start(uint32_t sequenceNumber, PacketPtr frame) {
+    first_ = sequenceNumber;
+    audioDataSize_ = frame->size();
+    if (repacketizer_) {
+        opus_repacketizer_init(repacketizer_.get());
+        alone_ = opus_repacketizer_cat(repacketizer_.get(), bytesOf(*frame), static_cast<opus_int32>(frame->size()))
+            != OPUS_OK;
+    }
+    frames_.push_back(std::move(frame));
+}
+
+bool FrameAggregator::join(uint32_t sequenceNumber, PacketPtr& frame) {
+    // The sequence numbers wrap around
+    if (alone_ || sequenceNumber != static_cast<uint32_t>(first_ + frames_.size())) {
+        return false;
+    }
+    if (repacketizer_) {
+        // Fails for another TOC or too long a packet, leaving the repacketizer as it was
+        if (opus_repacketizer_cat(repacketizer_.get(), bytesOf(*frame), static_cast<opus_int32>(frame->size()))
+            != OPUS_OK) {
+            return false;
+        }
+    } else if (audioDataSize_ + frame->size() > Net::Packet::maxAudioDataSize) {
+        return false;
+    }
+    audioDataSize_ += frame->size();
+    frames_.push_back(std::move(frame));
+    return true;
+}
+
+AggregatedPacket FrameAggregator::close() {
+    const auto frames = frames_.size();
+    if (repacketizer_ && !alone_) {
+        // Code 3 packet: the TOC, the frame count and up to 2 bytes of the length of each frame but the last one
+        packet_.resize(audioDataSize_ + 2 + 2 * frames_.size());
+        const auto length = opus_repacketizer_out(repacketizer_.get(),
+            reinterpret_cast<unsigned char*>(packet_.data()), static_cast<opus_int32>(packet_.size()));
+        if (length < 0) {
+            Audio::processError(length, Audio::Location::ENCODER_REPACKETIZER_OUT);
+        }
+        packet_.resize(length);
+    } else {
+        packet_.clear();
+        for (auto&& frame : frames_) {
+            packet_.insert(packet_.end(), frame->data(), frame->data() + frame->size());
+        }
+    }
+    frames_.clear();
+    alone_ = false;
+    return { first_, frames, packet_ };
+}
+
+void FrameAggregator::RepacketizerDeleter::operator()(OpusRepacketizer* repacketizer) const {
+    opus_repacketizer_destroy(repacketizer);
+}
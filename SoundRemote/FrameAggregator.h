@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "AudioUtil.h"
+#include "PacketPool.h"
+
+struct OpusRepacketizer;
+
+/// <summary>
+/// Audio packet carrying several consecutive frames of a stream.
+/// </summary>
+struct AggregatedPacket {
+	// Sequence number of the first frame
+	uint32_t first = 0;
+	size_t frames = 0;
+	// Audio data of the frames
+	std::span<const char> audioData;
+};
+
+/// <summary>
+/// Combines every <c>framesPerPacket</c> consecutive frames of an audio stream into one packet, for the clients
+/// trading some latency for fewer packets and less header overhead. The Opus frames are repacketized into one
+/// multi-frame Opus packet with the libopus repacketizer, the uncompressed ones are concatenated.
+/// A packet ends early at a gap in the sequence numbers or when the next frame can't join it: an Opus frame
+/// of another mode or bandwidth, more than 120 ms of Opus audio or more than <c>Net::Packet::maxAudioDataSize</c>
+/// of the uncompressed one. The combining is done once per stream however many clients get the packets.
+/// Not thread safe.
+/// </summary>
+class FrameAggregator {
+public:
+	/// <summary>
+	/// Creates an aggregator.
+	/// </summary>
+	/// <param name="compression">- compression of the stream, <c>none</c> for the uncompressed audio</param>
+	/// <param name="framesPerPacket">- from 2 to <c>Net::Packet::maxFramesPerPacket</c></param>
+	/// <exception cref="std::invalid_argument">The frames per packet are out of the range.</exception>
+	FrameAggregator(Audio::Compression compression, size_t framesPerPacket);
+	~FrameAggregator();
+
+	/// <summary>
+	/// Adds a frame to the packet. A frame that can't join the packet ends it and starts the next one.
+	/// </summary>
+	/// <param name="sequenceNumber">- sequence number of the frame</param>
+	/// <param name="frame">- audio data of the frame, held without copying until its packet is made,
+	/// so it must not be changed</param>
+	/// <returns>The packet ended by the frame, valid until the next call. Empty while the packet isn't complete.</returns>
+	std::optional<AggregatedPacket> add(uint32_t sequenceNumber, PacketPtr frame);
+	/// <summary>
+	/// Ends the packet early, like before a pause of the stream.
+	/// </summary>
+	/// <returns>The packet, valid until the next call. Empty if there are no frames since the last packet.</returns>
+	std::optional<AggregatedPacket> flush();
+	size_t framesPerPacket() const;
+
+	FrameAggregator(const FrameAggregator&) = delete;
+	FrameAggregator& operator= (const FrameAggregator&) = delete;
+private:
+	struct RepacketizerDeleter {
+		void operator()(OpusRepacketizer* repacketizer) const;
+	};
+
+	// Starts the next packet with the frame
+	void start(uint32_t sequenceNumber, PacketPtr frame);
+	// Adds the frame to the packet if it can join it
+	bool join(uint32_t sequenceNumber, PacketPtr& frame);
+	// Makes the packet of the frames
+	AggregatedPacket close();
+
+	const size_t framesPerPacket_;
+	// Empty for the uncompressed audio
+	std::unique_ptr<OpusRepacketizer, RepacketizerDeleter> repacketizer_;
+	// Frames of the packet being made, the repacketizer references them
+	std::vector<PacketPtr> frames_;
+	uint32_t first_ = 0;
+	size_t audioDataSize_ = 0;
+	// The first frame isn't a packet the repacketizer takes, so it's sent alone
+	bool alone_ = false;
+	std::vector<char> packet_;
+};
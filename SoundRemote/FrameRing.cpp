@@ -0,0 +1,77 @@
+#include "FrameRing.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <utility>
+
+FrameRing::FrameRing(size_t frameSize, size_t frameCount, size_t spareFrames) :
+    frameSize_(frameSize),
+    frameCapacity_(std::bit_ceil(std::max<size_t>(frameCount, 1))),
+    pool_(PacketPool::create(frameSize_, frameCapacity_ + spareFrames)) {
+    slots_.reserve(frameCapacity_);
+    for (size_t i = 0; i < frameCapacity_; ++i) {
+        slots_.push_back(pool_->acquire());
+    }
+}
+
+size_t FrameRing::write(std::span<const char> audio) {
+    size_t written = 0;
+    // The partial frame takes the slot after the complete ones
+    while (written < audio.size() && frames() < frameCapacity_) {
+        const auto chunk = std::min(frameSize_ - partialSize_, audio.size() - written);
+        std::memcpy(slot(tail_) + partialSize_, audio.data() + written, chunk);
+        written += chunk;
+        partialSize_ += chunk;
+        if (partialSize_ == frameSize_) {
+            ++tail_;
+            partialSize_ = 0;
+        }
+    }
+    return written;
+}
+
+std::span<const char> FrameRing::front() const {
+    if (frames() == 0) { return {}; }
+    return { slot(head_), frameSize_ };
+}
+
+void FrameRing::pop() {
+    if (frames() == 0) { return; }
+    ++head_;
+}
+
+PacketPtr FrameRing::take() {
+    if (frames() == 0) { return {}; }
+    auto frame = std::exchange(slots_[slotIndex(head_)], pool_->acquire());
+    ++head_;
+    return frame;
+}
+
+size_t FrameRing::frames() const {
+    return static_cast<size_t>(tail_ - head_);
+}
+
+size_t FrameRing::partialSize() const {
+    return partialSize_;
+}
+
+size_t FrameRing::size() const {
+    return frames() * frameSize_ + partialSize_;
+}
+
+size_t FrameRing::frameSize() const {
+    return frameSize_;
+}
+
+size_t FrameRing::frameCapacity() const {
+    return frameCapacity_;
+}
+
+size_t FrameRing::slotIndex(uint64_t frame) const {
+    return static_cast<size_t>(frame & (frameCapacity_ - 1));
+}
+
+char* FrameRing::slot(uint64_t frame) const {
+    return slots_[slotIndex(frame)]->data();
+}
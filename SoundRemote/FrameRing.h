@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "PacketPool.h"
+
+/// <summary>
+/// Preallocated ring of fixed size audio frames. The audio written is gathered into the frames,
+/// each complete frame is read as a contiguous view or taken out as the pooled buffer it was gathered in.
+/// Not thread-safe.
+/// </summary>
+class FrameRing {
+public:
+	/// <param name="frameSize">- frame size in bytes</param>
+	/// <param name="frameCount">- capacity in frames, rounded up to a power of two</param>
+	/// <param name="spareFrames">- frames taken out that may be in use at once, their buffers are allocated up front</param>
+	FrameRing(size_t frameSize, size_t frameCount, size_t spareFrames = 0);
+	/// <summary>
+	/// Copies the audio into the ring, completing the frames.
+	/// </summary>
+	/// <returns>Bytes written, less than the audio size if the ring is full.</returns>
+	size_t write(std::span<const char> audio);
+	/// <summary>
+	/// Gets the oldest complete frame.
+	/// </summary>
+	/// <returns>View of the frame valid until it's popped, or an empty span if there is no complete frame.</returns>
+	std::span<const char> front() const;
+	/// <summary>
+	/// Removes the oldest complete frame, if any.
+	/// </summary>
+	void pop();
+	/// <summary>
+	/// Takes the oldest complete frame out of the ring, its slot gets a free buffer of the pool.
+	/// </summary>
+	/// <returns>Buffer of the frame, or null if there is no complete frame.</returns>
+	PacketPtr take();
+	/// <summary>
+	/// Gets the number of the complete frames.
+	/// </summary>
+	size_t frames() const;
+	/// <summary>
+	/// Gets the number of bytes written to the frame not complete yet.
+	/// </summary>
+	size_t partialSize() const;
+	/// <summary>
+	/// Gets the number of bytes in the complete and the partial frames.
+	/// </summary>
+	size_t size() const;
+	size_t frameSize() const;
+	size_t frameCapacity() const;
+private:
+	size_t slotIndex(uint64_t frame) const;
+	char* slot(uint64_t frame) const;
+
+	const size_t frameSize_;
+	const size_t frameCapacity_;
+	std::shared_ptr<PacketPool> pool_;
+	std::vector<PacketPtr> slots_;
+	// Frame indices only grow, the slot of a frame is its index modulo the capacity
+	uint64_t head_ = 0;
+	uint64_t tail_ = 0;
+	size_t partialSize_ = 0;
+};
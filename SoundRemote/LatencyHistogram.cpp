@@ -0,0 +1,72 @@
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+void LatencyHistogram::record(std::chrono::microseconds latency) {
+    constexpr auto order = std::memory_order_relaxed;
+    const auto value = std::min(static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0)), maxValue);
+    buckets_[bucketOf(value)].fetch_add(1, order);
+    sum_.fetch_add(value, order);
+    auto min = min_.load(order);
+    while (value < min && !min_.compare_exchange_weak(min, value, order)) {}
+    auto max = max_.load(order);
+    while (value > max && !max_.compare_exchange_weak(max, value, order)) {}
+    count_.fetch_add(1, order);
+}
+
+uint64_t LatencyHistogram::count() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+std::chrono::microseconds LatencyHistogram::percentile(double percentile) const {
+    const auto total = count();
+    if (total == 0) { return {}; }
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(total * std::clamp(percentile, 0.0, 100.0) / 100)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucketCount; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // Not above the largest value actually recorded
+            return std::chrono::microseconds(std::min(upperBoundOf(i), max_.load(std::memory_order_relaxed)));
+        }
+    }
+    return std::chrono::microseconds(max_.load(std::memory_order_relaxed));
+}
+
+LatencyStats LatencyHistogram::stats() const {
+    constexpr auto order = std::memory_order_relaxed;
+    using std::chrono::microseconds;
+    const auto total = count();
+    if (total == 0) { return {}; }
+    return {
+        total,
+        microseconds(min_.load(order)),
+        microseconds(max_.load(order)),
+        microseconds(sum_.load(order) / total),
+        percentile(50),
+        percentile(90),
+        percentile(99),
+        percentile(99.9)
+    };
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t value) {
+    if (value < linearLimit) {
+        return static_cast<size_t>(value);
+    }
+    // The top linearBits bits of the value, the highest one always set
+    const int shift = std::bit_width(value) - linearBits;
+    const auto top = value >> shift;
+    return linearLimit + (shift - 1) * subBuckets + static_cast<size_t>(top - subBuckets);
+}
+
+uint64_t LatencyHistogram::upperBoundOf(size_t bucket) {
+    if (bucket < linearLimit) {
+        return bucket;
+    }
+    const auto shift = static_cast<int>((bucket - linearLimit) / subBuckets) + 1;
+    const auto top = (bucket - linearLimit) % subBuckets + subBuckets;
+    return ((top + 1) << shift) - 1;
+}
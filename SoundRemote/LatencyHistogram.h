@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// Summary of a <c>LatencyHistogram</c>.
+/// </summary>
+struct LatencyStats {
+	uint64_t count = 0;
+	std::chrono::microseconds min{};
+	std::chrono::microseconds max{};
+	std::chrono::microseconds mean{};
+	std::chrono::microseconds p50{};
+	std::chrono::microseconds p90{};
+	std::chrono::microseconds p99{};
+	std::chrono::microseconds p999{};
+	friend bool operator==(const LatencyStats& lhs, const LatencyStats& rhs) = default;
+};
+
+/// <summary>
+/// Histogram of latencies with a bounded relative error, in the manner of HdrHistogram.
+/// The values up to <c>linearLimit</c> microseconds are counted exactly, the larger ones in buckets
+/// whose width doubles with every power of two, keeping the error of a percentile under 1/16.
+/// Recording and reading are lock-free and may happen on any threads.
+/// </summary>
+class LatencyHistogram {
+public:
+	static constexpr int linearBits = 5;
+	// The values from here on are bucketed
+	static constexpr uint64_t linearLimit = uint64_t{ 1 } << linearBits;
+	static constexpr int maxValueBits = 26;
+	// Larger values are counted as this one, about a minute
+	static constexpr uint64_t maxValue = (uint64_t{ 1 } << maxValueBits) - 1;
+
+	void record(std::chrono::microseconds latency);
+	uint64_t count() const;
+	/// <summary>
+	/// Gets the value at or below which the percentage of the recorded values is.
+	/// </summary>
+	/// <param name="percentile">- percentile from 0 to 100</param>
+	/// <returns>Upper bound of the bucket the percentile falls into, 0 if there are no values.</returns>
+	std::chrono::microseconds percentile(double percentile) const;
+	/// <summary>
+	/// Gets the summary. A call concurrent with <c>record()</c> may see the value only partially recorded.
+	/// </summary>
+	LatencyStats stats() const;
+private:
+	static constexpr size_t subBuckets = linearLimit / 2;
+	static constexpr size_t bucketCount = linearLimit + (maxValueBits - linearBits) * subBuckets;
+
+	static size_t bucketOf(uint64_t value);
+	static uint64_t upperBoundOf(size_t bucket);
+
+	std::array<std::atomic<uint64_t>, bucketCount> buckets_{};
+	std::atomic<uint64_t> count_ = 0;
+	std::atomic<uint64_t> sum_ = 0;
+	std::atomic<uint64_t> min_ = UINT64_MAX;
+	std::atomic<uint64_t> max_ = 0;
+};
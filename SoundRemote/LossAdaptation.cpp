@@ -0,0 +1,54 @@
+#include "LossAdaptation.h"
+
+#include <algorithm>
+
+namespace {
+    // Loss rounded to the nearest step
+    int lossPercentOf(uint32_t received, uint32_t lost) {
+        constexpr uint64_t step = LossAdaptation::lossStep;
+        const auto total = static_cast<uint64_t>(received) + lost;
+        const auto steps = (200 * static_cast<uint64_t>(lost) + total * step) / (2 * total * step);
+        return static_cast<int>(steps * step);
+    }
+}
+
+LossAdaptation::LossAdaptation(Audio::Compression requested) :
+    requested_(requested),
+    state_{ requested, 0 } {}
+
+const LossAdaptation::State& LossAdaptation::report(uint32_t received, uint32_t lost, Audio::Compression lowest) {
+    if (requested_ == Audio::Compression::none || (received == 0 && lost == 0)) {
+        return state_;
+    }
+    // Indices of the compressions, the Opus ones are ordered by bitrate
+    const auto highestIndex = Audio::compressionIndex(requested_);
+    const auto lowestIndex = lowest == Audio::Compression::none
+        ? highestIndex
+        : std::min(Audio::compressionIndex(lowest), highestIndex);
+    auto index = std::clamp(Audio::compressionIndex(state_.compression), lowestIndex, highestIndex);
+
+    const auto loss = 100.0 * lost / (static_cast<double>(received) + lost);
+    if (loss >= stepDownLoss) {
+        cleanReports_ = 0;
+        if (index > lowestIndex) {
+            --index;
+        }
+    } else if (loss <= stepUpLoss) {
+        if (++cleanReports_ >= stepUpReports && index < highestIndex) {
+            cleanReports_ = 0;
+            ++index;
+        }
+    } else {
+        cleanReports_ = 0;
+    }
+    state_ = { Audio::compressions[index], lossPercentOf(received, lost) };
+    return state_;
+}
+
+const LossAdaptation::State& LossAdaptation::state() const {
+    return state_;
+}
+
+Audio::Compression LossAdaptation::requested() const {
+    return requested_;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+#include "AudioUtil.h"
+
+/// <summary>
+/// Adapts the audio of a client to the packet loss it reports. Steps the bitrate down while the loss is high and
+/// back up once it's gone, within the compressions the client allows, and gives the loss the encoder protects
+/// the audio against with the in-band FEC.
+/// The loss is rounded to <c>lossStep</c>, so the clients with a similar loss share the encoder settings.
+/// Not thread safe.
+/// </summary>
+class LossAdaptation {
+public:
+	// Loss stepping the bitrate down, in percent
+	static constexpr int stepDownLoss = 10;
+	// Loss the bitrate may step back up with, in percent
+	static constexpr int stepUpLoss = 2;
+	// Reports in a row with the loss within stepUpLoss to step the bitrate up
+	static constexpr int stepUpReports = 3;
+	// Granularity of the loss given to the encoders, in percent
+	static constexpr int lossStep = 5;
+
+	// Encoding of the client's audio
+	struct State {
+		Audio::Compression compression = Audio::Compression::none;
+		// Expected loss of the packets in percent, a multiple of lossStep
+		int lossPercent = 0;
+		friend bool operator==(const State& lhs, const State& rhs) = default;
+	};
+
+	/// <summary>
+	/// Creates the adaptation starting with no loss.
+	/// </summary>
+	/// <param name="requested">- compression the client requested, the highest one it gets</param>
+	explicit LossAdaptation(Audio::Compression requested = Audio::Compression::none);
+
+	/// <summary>
+	/// Applies a loss report. An empty report changes nothing. The uncompressed audio has no bitrate to step
+	/// and no encoder, so it stays as it is.
+	/// </summary>
+	/// <param name="received">- packets received in the window of the report</param>
+	/// <param name="lost">- packets lost in the window of the report</param>
+	/// <param name="lowest">- lowest compression the client allows, <c>Compression::none</c> to keep the requested one</param>
+	/// <returns>The new state.</returns>
+	const State& report(uint32_t received, uint32_t lost, Audio::Compression lowest);
+	const State& state() const;
+	Audio::Compression requested() const;
+private:
+	Audio::Compression requested_;
+	State state_;
+	// Reports in a row with the loss within stepUpLoss
+	int cleanReports_ = 0;
+};
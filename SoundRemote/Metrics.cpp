@@ -0,0 +1,149 @@
+#include "Metrics.h"
+
+#include <sstream>
+
+#include "CaptureCounters.h"
+#include "Clients.h"
+#include "PipelineLatency.h"
+
+namespace {
+    void writeHeader(std::ostream& out, const char* name, const char* type, const char* help) {
+        out << "# HELP " << name << ' ' << help << '\n';
+        out << "# TYPE " << name << ' ' << type << '\n';
+    }
+
+    // Labelled with the bitrate in bits per second, 0 for the uncompressed audio
+    template <typename Value>
+    void writeCompression(std::ostream& out, const char* name, Audio::Compression compression, Value value) {
+        out << name << "{compression=\"" << static_cast<int>(compression) << "\"} " << value << '\n';
+    }
+
+    void writeLatency(
+        std::ostream& out,
+        const char* name,
+        const char* labels,
+        const LatencyStats& stats
+    ) {
+        const std::pair<const char*, std::chrono::microseconds> quantiles[]{
+            { "0.5", stats.p50 }, { "0.9", stats.p90 }, { "0.99", stats.p99 }, { "0.999", stats.p999 }
+        };
+        for (auto&& [quantile, value] : quantiles) {
+            out << name << '{' << labels << ",quantile=\"" << quantile << "\"} " << value.count() << '\n';
+        }
+        out << name << "_sum{" << labels << "} " << stats.mean.count() * stats.count << '\n';
+        out << name << "_count{" << labels << "} " << stats.count << '\n';
+    }
+
+    const char* stageName(PipelineLatency::Stage stage) {
+        switch (stage) {
+        case PipelineLatency::Stage::resample:
+            return "resample";
+        case PipelineLatency::Stage::frame:
+            return "frame";
+        case PipelineLatency::Stage::encode:
+            return "encode";
+        case PipelineLatency::Stage::send:
+            return "send";
+        case PipelineLatency::Stage::total:
+            return "total";
+        }
+        return "";
+    }
+}
+
+Metrics::Metrics(std::shared_ptr<Clients> clients, std::shared_ptr<CaptureCounters> captureCounters,
+    std::shared_ptr<PipelineLatency> pipelineLatency) :
+    clients_(clients),
+    captureCounters_(captureCounters),
+    pipelineLatency_(pipelineLatency) {}
+
+std::string Metrics::render(TimePoint now) {
+    const auto clients = clients_->stats();
+    const auto capture = captureCounters_->load();
+    const std::chrono::duration<double> elapsed = previousRender_ ? now - *previousRender_ : TimePoint::duration::zero();
+    std::ostringstream out;
+
+    writeHeader(out, "soundremote_clients", "gauge", "Connected clients per compression.");
+    for (auto&& compression : clients.compressions) {
+        writeCompression(out, "soundremote_clients", compression.compression, compression.clientCount);
+    }
+    const struct {
+        const char* name;
+        const char* help;
+        uint64_t TrafficStats::* field;
+    } counters[]{
+        { "soundremote_packets_sent_total", "Audio and keepalive datagrams sent.", &TrafficStats::packetsSent },
+        { "soundremote_bytes_sent_total", "Bytes of the datagrams sent.", &TrafficStats::bytesSent },
+        { "soundremote_send_errors_total", "Datagrams that failed to send.", &TrafficStats::sendErrors },
+        { "soundremote_keepalives_received_total", "Keepalives received from the clients.",
+            &TrafficStats::keepalivesReceived }
+    };
+    for (auto&& counter : counters) {
+        writeHeader(out, counter.name, "counter", counter.help);
+        for (auto&& compression : clients.compressions) {
+            writeCompression(out, counter.name, compression.compression, compression.traffic.*counter.field);
+        }
+    }
+    const struct {
+        const char* name;
+        const char* help;
+        uint64_t TrafficStats::* field;
+    } rates[]{
+        { "soundremote_packets_per_second", "Datagrams sent per second since the previous scrape.",
+            &TrafficStats::packetsSent },
+        { "soundremote_bytes_per_second", "Bytes sent per second since the previous scrape.",
+            &TrafficStats::bytesSent }
+    };
+    for (auto&& rate : rates) {
+        writeHeader(out, rate.name, "gauge", rate.help);
+        for (auto&& compression : clients.compressions) {
+            const auto& previous = previousTraffic_[Audio::compressionIndex(compression.compression)];
+            const auto sent = compression.traffic.*rate.field - previous.*rate.field;
+            writeCompression(out, rate.name, compression.compression,
+                elapsed.count() > 0 ? sent / elapsed.count() : 0.0);
+        }
+    }
+
+    writeHeader(out, "soundremote_frame_buffer_bytes", "gauge", "Captured audio waiting for a complete frame.");
+    out << "soundremote_frame_buffer_bytes " << capture.bufferedBytes << '\n';
+    writeHeader(out, "soundremote_capture_glitches_total", "counter",
+        "Gaps in the captured audio the device reported, the audio in them is lost.");
+    out << "soundremote_capture_glitches_total " << capture.captureGlitches << '\n';
+    writeHeader(out, "soundremote_dropped_frames_total", "counter", "Frames lost before sending.");
+    out << "soundremote_dropped_frames_total{reason=\"encode_failed\"} " << capture.encodeFailures << '\n';
+    writeHeader(out, "soundremote_frame_buffer_dropped_bytes_total", "counter",
+        "Captured audio dropped as the frame buffer was full.");
+    out << "soundremote_frame_buffer_dropped_bytes_total " << capture.ringDroppedBytes << '\n';
+    writeHeader(out, "soundremote_queue_depth", "gauge", "Frames waiting in the input queue of a pipeline stage.");
+    out << "soundremote_queue_depth{stage=\"encode\"} " << capture.encodeQueueDepth << '\n';
+    out << "soundremote_queue_depth{stage=\"send\"} " << capture.sendQueueDepth << '\n';
+    writeHeader(out, "soundremote_stalls_total", "counter",
+        "Frames a pipeline stage dropped as the queue of the next stage was full.");
+    out << "soundremote_stalls_total{stage=\"capture\"} " << capture.captureStalls << '\n';
+    out << "soundremote_stalls_total{stage=\"encode\"} " << capture.encodeStalls << '\n';
+    writeHeader(out, "soundremote_silent_frames_total", "counter", "Frames not sent to the clients as they were silence.");
+    out << "soundremote_silent_frames_total " << capture.silentFrames << '\n';
+
+    if constexpr (PipelineLatency::enabled) {
+        using Stage = PipelineLatency::Stage;
+        constexpr auto name = "soundremote_stage_latency_microseconds";
+        writeHeader(out, name, "summary", "Latency of the capture pipeline stages.");
+        for (auto stage : { Stage::resample, Stage::frame }) {
+            const auto labels = std::string("stage=\"") + stageName(stage) + '"';
+            writeLatency(out, name, labels.c_str(), pipelineLatency_->stats(stage));
+        }
+        for (auto stage : { Stage::encode, Stage::send, Stage::total }) {
+            for (auto&& compression : clients.compressions) {
+                std::ostringstream labels;
+                labels << "stage=\"" << stageName(stage) << "\",compression=\"" << static_cast<int>(compression.compression) << '"';
+                writeLatency(out, name, labels.str().c_str(), pipelineLatency_->stats(stage, compression.compression));
+            }
+        }
+    }
+
+    for (auto&& compression : clients.compressions) {
+        previousTraffic_[Audio::compressionIndex(compression.compression)] = compression.traffic;
+    }
+    previousRender_ = now;
+    return out.str();
+}
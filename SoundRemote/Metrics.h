@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "AudioUtil.h"
+#include "TrafficCounters.h"
+
+struct CaptureCounters;
+class Clients;
+class PipelineLatency;
+
+/// <summary>
+/// Renders the server and capture pipeline statistics in the Prometheus text exposition format.
+/// </summary>
+class Metrics {
+public:
+	using TimePoint = std::chrono::steady_clock::time_point;
+
+	Metrics(std::shared_ptr<Clients> clients, std::shared_ptr<CaptureCounters> captureCounters,
+		std::shared_ptr<PipelineLatency> pipelineLatency);
+	/// <summary>
+	/// Renders the current statistics. The rates are over the time since the previous call, zero on the first one.
+	/// Not thread-safe, the sources are read without locking.
+	/// </summary>
+	/// <param name="now">Current time</param>
+	std::string render(TimePoint now = std::chrono::steady_clock::now());
+private:
+	std::shared_ptr<Clients> clients_;
+	std::shared_ptr<CaptureCounters> captureCounters_;
+	std::shared_ptr<PipelineLatency> pipelineLatency_;
+	// Per compression totals at the previous render, for the rates
+	std::array<TrafficStats, Audio::compressionCount> previousTraffic_{};
+	std::optional<TimePoint> previousRender_;
+};
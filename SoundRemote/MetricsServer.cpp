@@ -0,0 +1,79 @@
+#include "MetricsServer.h"
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
+
+#include "Metrics.h"
+
+using boost::asio::ip::tcp;
+using boost::asio::awaitable;
+using boost::asio::use_awaitable;
+
+namespace {
+    // A scrape request is a few hundred bytes, anything longer is not one
+    constexpr size_t maxRequestSize = 4096;
+
+    std::string makeResponse(std::string_view status, std::string_view contentType, std::string_view body) {
+        std::string response;
+        response.append("HTTP/1.1 ").append(status).append("\r\n");
+        response.append("Content-Type: ").append(contentType).append("\r\n");
+        response.append("Content-Length: ").append(std::to_string(body.size())).append("\r\n");
+        response.append("Connection: close\r\n\r\n");
+        response.append(body);
+        return response;
+    }
+}
+
+MetricsServer::MetricsServer(int port, boost::asio::io_context& ioContext, std::shared_ptr<Metrics> metrics) :
+    acceptor_(ioContext, tcp::endpoint(boost::asio::ip::address_v4::loopback(), static_cast<unsigned short>(port))),
+    metrics_(metrics) {
+    boost::asio::co_spawn(ioContext, accept(), boost::asio::detached);
+}
+
+MetricsServer::~MetricsServer() {
+    boost::system::error_code ec;
+    acceptor_.close(ec);
+}
+
+unsigned short MetricsServer::port() const {
+    return acceptor_.local_endpoint().port();
+}
+
+std::string MetricsServer::respond(std::string_view request) {
+    const auto requestLine = request.substr(0, request.find("\r\n"));
+    const auto target = requestLine.starts_with("GET ") ? requestLine.substr(4, requestLine.find(' ', 4) - 4)
+        : std::string_view();
+    if (target != "/metrics" && !target.starts_with("/metrics?")) {
+        return makeResponse("404 Not Found", "text/plain", "Not found\n");
+    }
+    return makeResponse("200 OK", "text/plain; version=0.0.4", metrics_->render());
+}
+
+awaitable<void> MetricsServer::accept() {
+    for (;;) {
+        boost::system::error_code ec;
+        auto socket = co_await acceptor_.async_accept(boost::asio::redirect_error(use_awaitable, ec));
+        if (ec == boost::asio::error::operation_aborted || !acceptor_.is_open()) {
+            co_return;
+        }
+        // A failed accept concerns that connection only
+        if (ec) { continue; }
+        boost::asio::co_spawn(acceptor_.get_executor(), serve(std::move(socket)), boost::asio::detached);
+    }
+}
+
+awaitable<void> MetricsServer::serve(tcp::socket socket) {
+    std::string request;
+    boost::system::error_code ec;
+    co_await boost::asio::async_read_until(socket, boost::asio::dynamic_buffer(request, maxRequestSize), "\r\n\r\n",
+        boost::asio::redirect_error(use_awaitable, ec));
+    // Disconnected or not HTTP, nothing to answer
+    if (ec) { co_return; }
+    const auto response = respond(request);
+    co_await boost::asio::async_write(socket, boost::asio::buffer(response), boost::asio::redirect_error(use_awaitable, ec));
+    socket.shutdown(tcp::socket::shutdown_both, ec);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+class Metrics;
+
+/// <summary>
+/// Minimal HTTP endpoint serving the metrics at <c>GET /metrics</c>, for the monitoring to scrape.
+/// Listens on the loopback interface only, a connection gets one response and is closed.
+/// </summary>
+class MetricsServer {
+public:
+	/// <param name="port">Port to listen on, 0 for any free one</param>
+	/// <exception cref="boost::system::system_error">Thrown if the port can't be listened on.</exception>
+	MetricsServer(int port, boost::asio::io_context& ioContext, std::shared_ptr<Metrics> metrics);
+	~MetricsServer();
+	/// <summary>
+	/// Gets the port listened on.
+	/// </summary>
+	unsigned short port() const;
+	/// <summary>
+	/// Makes the complete HTTP response to the request.
+	/// </summary>
+	/// <param name="request">Request head, the request line and the headers</param>
+	std::string respond(std::string_view request);
+private:
+	boost::asio::awaitable<void> accept();
+	boost::asio::awaitable<void> serve(boost::asio::ip::tcp::socket socket);
+
+	boost::asio::ip::tcp::acceptor acceptor_;
+	std::shared_ptr<Metrics> metrics_;
+};
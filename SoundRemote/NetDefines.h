@@ -18,30 +18,67 @@ namespace Net {
 		using ModsType = uint8_t;
 		using SequenceNumberType = uint32_t;
 		using Advertising = uint32_t;
+		using TimestampType = uint64_t;
+		using PacketCountType = uint32_t;
+		using ConnectOptionsType = uint8_t;
+		using ParityMaskType = uint32_t;
+		using ParitySizeType = uint16_t;
+		using FramesPerPacketType = uint8_t;
 		constexpr int ackCustomDataSize = 4;
 		// Header data
-		constexpr int headerSize = sizeof SignatureType + sizeof CategoryType + sizeof SizeType;
+		constexpr int headerSize = sizeof(SignatureType) + sizeof(CategoryType) + sizeof(SizeType);
 		constexpr int signatureOffset = 0;
-		constexpr int categoryOffset = sizeof SignatureType;
-		constexpr int sizeOffset = sizeof SignatureType + sizeof CategoryType;
+		constexpr int categoryOffset = sizeof(SignatureType);
+		constexpr int sizeOffset = sizeof(SignatureType) + sizeof(CategoryType);
 		constexpr int dataOffset = headerSize;
-		constexpr int advertisingOffset = sizeof Advertising;
+		constexpr int advertisingOffset = sizeof(Advertising);
 		// Packet data
-		constexpr int keystrokeSize = sizeof KeyType + sizeof ModsType;
-		constexpr int ackSize = sizeof RequestIdType + ackCustomDataSize;
-		constexpr int ackCustomDataOffset = dataOffset + sizeof RequestIdType;
-		constexpr int sequenceNumberSize = sizeof SequenceNumberType;
+		constexpr int keystrokeSize = sizeof(KeyType) + sizeof(ModsType);
+		constexpr int ackSize = sizeof(RequestIdType) + ackCustomDataSize;
+		constexpr int ackCustomDataOffset = dataOffset + sizeof(RequestIdType);
+		constexpr int sequenceNumberSize = sizeof(SequenceNumberType);
 		constexpr int audioDataOffset = dataOffset + sequenceNumberSize;
+		constexpr int multicastGroupSize = 4;
+		constexpr int ackMulticastGroupOffset = ackCustomDataOffset + ackCustomDataSize;
+		constexpr int timestampSize = sizeof(TimestampType);
+		// AudioParity: first sequence number, mask and size XOR, then the parity
+		constexpr int parityFieldsSize = sequenceNumberSize + sizeof(ParityMaskType) + sizeof(ParitySizeType);
+		constexpr int parityDataOffset = dataOffset + parityFieldsSize;
+		// Sequence numbers of a Nack taken at most, the rest are ignored
+		constexpr int maxNackSequenceNumbers = 64;
+		// Audio frames an audio packet carries at most
+		constexpr int maxFramesPerPacket = 6;
+		// Audio data an audio packet carries at most, limited by the size field
+		constexpr int maxAudioDataSize = UINT16_MAX - audioDataOffset;
+		// Bits of the Connect options
+		namespace ConnectOption {
+			// Get the AudioParity packets
+			constexpr ConnectOptionsType parity = 0x01u;
+		}
 		struct ConnectData {
 			ProtocolVersionType protocol;
 			RequestIdType requestId;
 			CompressionType compression;
-			static const int size = sizeof ProtocolVersionType + sizeof RequestIdType + sizeof CompressionType;
+			// Follow the rest from Net::Protocol::parity on, 0 if missing
+			ConnectOptionsType options;
+			// Follows the options from Net::Protocol::aggregation on, 1 if missing
+			FramesPerPacketType framesPerPacket;
+			static const int size = sizeof(ProtocolVersionType) + sizeof(RequestIdType) + sizeof(CompressionType);
 		};
 		struct SetFormatData {
 			RequestIdType requestId;
 			CompressionType compression;
-			static const int size = sizeof RequestIdType + sizeof CompressionType;
+			// Follows the rest from Net::Protocol::aggregation on, 1 if missing
+			FramesPerPacketType framesPerPacket;
+			static const int size = sizeof(RequestIdType) + sizeof(CompressionType);
+		};
+		struct LossReportData {
+			// Audio packets received and lost since the previous report, told by the sequence numbers
+			PacketCountType received;
+			PacketCountType lost;
+			// Lowest compression the server may step the bitrate down to
+			CompressionType minCompression;
+			static const int size = 2 * sizeof(PacketCountType) + sizeof(CompressionType);
 		};
 
 		constexpr SignatureType protocolSignature = 0xA571u;
@@ -54,15 +91,48 @@ namespace Net {
 			Keystroke = 0x10u,
 			AudioDataUncompressed = 0x20u,
 			AudioDataOpus = 0x21u,
+			AudioSilence = 0x22u,
+			AudioParity = 0x23u,
 			ClientKeepAlive = 0x30u,
 			ServerKeepAlive = 0x31u,
+			LossReport = 0x32u,
+			Nack = 0x33u,
 			ServerAdvertise = 0x40u,
 			Ack = 0xF0u
 		};
 	}
-	constexpr DWORD integer_ip_address_loopback = 16777343;
+	constexpr uint32_t integer_ip_address_loopback = 16777343;
+
+	constexpr Packet::ProtocolVersionType protocolVersion = 8u;
 
-	constexpr Packet::ProtocolVersionType protocolVersion = 1u;
+	// Protocol versions that introduced optional features.
+	// A feature is used only with the clients that connected with its version or later.
+	namespace Protocol {
+		constexpr Packet::ProtocolVersionType initial = 1u;
+		// Connect and SetFormat acks carry the multicast group of the client's compression
+		constexpr Packet::ProtocolVersionType multicast = 2u;
+		// ServerKeepAlive carries a timestamp the client echoes back in a ClientKeepAlive sent right away.
+		// Each timestamp is echoed at most once, the periodic ClientKeepAlive stays empty.
+		constexpr Packet::ProtocolVersionType roundTrip = 3u;
+		// The audio isn't sent while it's silence. Instead AudioSilence packets carry the sequence number of
+		// the last silent frame, the frames up to it the client hasn't got are silence rather than lost.
+		constexpr Packet::ProtocolVersionType silence = 4u;
+		// The client sends LossReport periodically. The server steps the bitrate of a lossy client down within
+		// the range the report allows, unless the audio is multicast, and turns the in-band FEC of its encoder on.
+		// The Opus packets tell their bitrate, so the client decodes them as before.
+		constexpr Packet::ProtocolVersionType lossReport = 5u;
+		// Connect carries the options. A client opting in for the parity gets an AudioParity after every few
+		// audio packets, to rebuild one lost packet of them, see ParityEncoder.
+		constexpr Packet::ProtocolVersionType parity = 6u;
+		// The client sends Nack listing the sequence numbers of the audio packets it misses. The server resends
+		// the ones it still has, the same audio packets once more, within a rate limit per client.
+		constexpr Packet::ProtocolVersionType retransmit = 7u;
+		// Connect and SetFormat carry the frames per packet the client asks for. Such a client gets the audio
+		// by unicast, several frames with consecutive sequence numbers in a packet, numbered by the first one.
+		// The Opus frames are repacketized into one multi-frame Opus packet, the uncompressed ones are concatenated.
+		// The parity isn't sent for these packets, the retransmits are sent one frame per packet.
+		constexpr Packet::ProtocolVersionType aggregation = 8u;
+	}
 
 	using Address = boost::asio::ip::address;
 
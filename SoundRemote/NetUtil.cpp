@@ -3,6 +3,7 @@
 #include <iphlpapi.h>
 #include <WS2tcpip.h>
 
+#include <algorithm>
 #include <cassert>
 
 namespace {
@@ -14,6 +15,11 @@ namespace {
 			| static_cast<unsigned char>(data[offset + 3]);
 	}
 
+	uint64_t readUInt64B(const std::span<char>& data, size_t offset) {
+		assert((offset + 8) <= data.size_bytes());
+		return (static_cast<uint64_t>(readUInt32B(data, offset)) << 32) | readUInt32B(data, offset + 4);
+	}
+
 	uint32_t readUInt32L(const std::span<char>& data, size_t offset) {
 		assert((offset + 4) <= data.size_bytes());
 		return static_cast<unsigned char>(data[offset])
@@ -47,6 +53,12 @@ namespace {
 		dest[offset + 3] = value >> 0;
 	}
 
+	void writeUInt64B(uint64_t value, const std::span<char>& dest, size_t offset) {
+		assert((offset + 8) <= dest.size_bytes());
+		writeUInt32B(static_cast<uint32_t>(value >> 32), dest, offset);
+		writeUInt32B(static_cast<uint32_t>(value), dest, offset + 4);
+	}
+
 	void writeUInt16B(uint16_t value, const std::span<char>& dest, size_t offset) {
 		assert((offset + 2) <= dest.size_bytes());
 		dest[offset] = value >> 8;
@@ -114,6 +126,24 @@ std::forward_list<std::wstring> Net::getLocalAddresses() {
 	return result;
 }
 
+std::optional<boost::asio::ip::address_v4> Net::getMulticastInterface() {
+	DWORD addrTableSize = 0;
+	std::vector<char> buffer = getRawLocalAddressesTable(&addrTableSize);
+	MIB_IPADDRTABLE* addrTable = reinterpret_cast<MIB_IPADDRTABLE*>(buffer.data());
+
+	if (NO_ERROR != GetIpAddrTable(addrTable, &addrTableSize, 0)) {
+		return {};
+	}
+	for (DWORD i = 0; i < addrTable->dwNumEntries; ++i) {
+		// In the network byte order
+		const boost::asio::ip::address_v4 address(ntohl(addrTable->table[i].dwAddr));
+		if (!address.is_loopback() && !address.is_unspecified()) {
+			return address;
+		}
+	}
+	return {};
+}
+
 std::optional<Audio::Compression> Net::compressionFromNetworkValue(Net::Packet::CompressionType compression) {
 	switch (compression) {
 	case 0:
@@ -133,22 +163,66 @@ std::optional<Audio::Compression> Net::compressionFromNetworkValue(Net::Packet::
 	}
 }
 
+Net::AudioPacket Net::makeAudioPacket(
+	Net::Packet::Category category,
+	Net::Packet::SequenceNumberType sequenceNumber,
+	std::span<const char> audioData
+) {
+	AudioPacket packet{ {}, {}, audioData };
+	writeUInt16B(Net::Packet::protocolSignature, packet.header, Net::Packet::signatureOffset);
+	writeUInt8(static_cast<Net::Packet::CategoryType>(category), packet.header, Net::Packet::categoryOffset);
+	const auto packetSize = Net::Packet::audioDataOffset + audioData.size_bytes();
+	writeUInt16B(static_cast<Net::Packet::SizeType>(packetSize), packet.header, Net::Packet::sizeOffset);
+	writeUInt32B(sequenceNumber, packet.sequenceNumber, 0);
+	return packet;
+}
+
+Net::ParityPacket Net::makeParityPacket(const ParityGroup& group) {
+	ParityPacket packet{ {}, group.parity };
+	writeUInt16B(Net::Packet::protocolSignature, packet.header, Net::Packet::signatureOffset);
+	writeUInt8(static_cast<Net::Packet::CategoryType>(Net::Packet::Category::AudioParity), packet.header,
+		Net::Packet::categoryOffset);
+	const auto packetSize = Net::Packet::parityDataOffset + group.parity.size_bytes();
+	writeUInt16B(static_cast<Net::Packet::SizeType>(packetSize), packet.header, Net::Packet::sizeOffset);
+	int offset = Net::Packet::dataOffset;
+	writeUInt32B(group.first, packet.header, offset);
+	offset += Net::Packet::sequenceNumberSize;
+	writeUInt32B(group.mask, packet.header, offset);
+	offset += sizeof(Net::Packet::ParityMaskType);
+	writeUInt16B(group.sizeXor, packet.header, offset);
+	return packet;
+}
+
 std::vector<char> Net::createAudioPacket(
 	Net::Packet::Category category,
 	Net::Packet::SequenceNumberType sequenceNumber,
 	const std::span<const char>& audioData
 ) {
-	std::vector<char> packet(Net::Packet::headerSize + Net::Packet::sequenceNumberSize + audioData.size_bytes());
+	const auto parts = makeAudioPacket(category, sequenceNumber, audioData);
+	std::vector<char> packet;
+	packet.reserve(Net::Packet::audioDataOffset + audioData.size_bytes());
+	packet.insert(packet.end(), parts.header.begin(), parts.header.end());
+	packet.insert(packet.end(), parts.sequenceNumber.begin(), parts.sequenceNumber.end());
+	packet.insert(packet.end(), audioData.begin(), audioData.end());
+	return packet;
+}
+
+std::vector<char> Net::createKeepAlivePacket(std::optional<Net::Packet::TimestampType> timestamp) {
+	const int timestampSize = timestamp ? Net::Packet::timestampSize : 0;
+	std::vector<char> packet(Net::Packet::headerSize + timestampSize);
 	std::span<char> packetData{ packet.data(), packet.size() };
-	writeHeader(category, packetData);
-	writeUInt32B(sequenceNumber, packetData, Net::Packet::dataOffset);
-	std::copy_n(audioData.data(), audioData.size_bytes(), packet.data() + Net::Packet::audioDataOffset);
+	writeHeader(Net::Packet::Category::ServerKeepAlive, packetData);
+	if (timestamp) {
+		writeUInt64B(*timestamp, packetData, Net::Packet::dataOffset);
+	}
 	return packet;
 }
 
-std::vector<char> Net::createKeepAlivePacket() {
-	std::vector<char> packet(Net::Packet::headerSize);
-	writeHeader(Net::Packet::Category::ServerKeepAlive, { packet.data(), packet.size() });
+std::vector<char> Net::createSilencePacket(Net::Packet::SequenceNumberType sequenceNumber) {
+	std::vector<char> packet(Net::Packet::headerSize + Net::Packet::sequenceNumberSize);
+	std::span<char> packetData{ packet.data(), packet.size() };
+	writeHeader(Net::Packet::Category::AudioSilence, packetData);
+	writeUInt32B(sequenceNumber, packetData, Net::Packet::dataOffset);
 	return packet;
 }
 
@@ -181,23 +255,65 @@ std::vector<char> Net::createDisconnectPacket() {
 	return packet;
 }
 
-std::vector<char> Net::createAckConnectPacket(Net::Packet::RequestIdType requestId) {
-	std::vector<char> packet(Net::Packet::headerSize + Net::Packet::ackSize);
+std::vector<char> Net::createAckConnectPacket(
+	Net::Packet::RequestIdType requestId,
+	Net::Packet::ProtocolVersionType protocol,
+	std::optional<boost::asio::ip::address_v4> multicastGroup
+) {
+	const int groupSize = multicastGroup ? Net::Packet::multicastGroupSize : 0;
+	std::vector<char> packet(Net::Packet::headerSize + Net::Packet::ackSize + groupSize);
 	std::span<char> packetData{ packet.data(), packet.size() };
 	writeHeader(Net::Packet::Category::Ack, packetData);
 	writeAck(requestId, packetData);
-	writeUInt8(Net::protocolVersion, packetData, Net::Packet::ackCustomDataOffset);
+	writeUInt8(protocol, packetData, Net::Packet::ackCustomDataOffset);
+	if (multicastGroup) {
+		writeUInt32B(multicastGroup->to_uint(), packetData, Net::Packet::ackMulticastGroupOffset);
+	}
 	return packet;
 }
 
-std::vector<char> Net::createAckSetFormatPacket(Net::Packet::RequestIdType requestId) {
-	std::vector<char> packet(Net::Packet::headerSize + Net::Packet::ackSize);
+std::vector<char> Net::createAckSetFormatPacket(
+	Net::Packet::RequestIdType requestId,
+	std::optional<boost::asio::ip::address_v4> multicastGroup
+) {
+	const int groupSize = multicastGroup ? Net::Packet::multicastGroupSize : 0;
+	std::vector<char> packet(Net::Packet::headerSize + Net::Packet::ackSize + groupSize);
 	std::span<char> packetData{ packet.data(), packet.size() };
 	writeHeader(Net::Packet::Category::Ack, packetData);
 	writeAck(requestId, packetData);
+	if (multicastGroup) {
+		writeUInt32B(multicastGroup->to_uint(), packetData, Net::Packet::ackMulticastGroupOffset);
+	}
 	return packet;
 }
 
+boost::asio::ip::address_v4 Net::multicastGroup(Audio::Compression compression) {
+	// 239.255.71.x, the last byte is unique for each compression
+	constexpr uint32_t groupBase = 0xEFFF4700u;
+	uint32_t index = 0;
+	switch (compression) {
+	case Audio::Compression::none:
+		index = 1;
+		break;
+	case Audio::Compression::kbps_64:
+		index = 2;
+		break;
+	case Audio::Compression::kbps_128:
+		index = 3;
+		break;
+	case Audio::Compression::kbps_192:
+		index = 4;
+		break;
+	case Audio::Compression::kbps_256:
+		index = 5;
+		break;
+	case Audio::Compression::kbps_320:
+		index = 6;
+		break;
+	}
+	return boost::asio::ip::address_v4(groupBase | index);
+}
+
 Net::Packet::Category Net::getPacketCategory(const std::span<char>& packet) {
 	if (packet.size_bytes() < Packet::headerSize) {
 		return Net::Packet::Category::Error;
@@ -231,9 +347,25 @@ std::optional<Net::Packet::ConnectData> Net::getConnectData(const std::span<char
 	data.requestId = readUInt16B(packet, offset);
 	offset += sizeof(Net::Packet::RequestIdType);
 	data.compression = readUInt8(packet, offset);
+	offset += sizeof(Net::Packet::CompressionType);
+	if (static_cast<int>(packet.size()) >= offset + static_cast<int>(sizeof(Net::Packet::ConnectOptionsType))) {
+		data.options = readUInt8(packet, offset);
+	}
+	offset += sizeof(Net::Packet::ConnectOptionsType);
+	data.framesPerPacket = 1;
+	if (static_cast<int>(packet.size()) >= offset + static_cast<int>(sizeof(Net::Packet::FramesPerPacketType))) {
+		data.framesPerPacket = readUInt8(packet, offset);
+	}
 	return data;
 }
 
+std::optional<Net::Packet::TimestampType> Net::getKeepAliveTimestamp(const std::span<char>& packet) {
+	if (static_cast<int>(packet.size()) < Packet::dataOffset + Packet::timestampSize) {
+		return std::nullopt;
+	}
+	return readUInt64B(packet, Packet::dataOffset);
+}
+
 std::optional<Net::Packet::SetFormatData> Net::getSetFormatData(const std::span<char>& packet) {
 	if (static_cast<int>(packet.size()) < Packet::dataOffset + Packet::SetFormatData::size) {
 		return std::nullopt;
@@ -243,5 +375,38 @@ std::optional<Net::Packet::SetFormatData> Net::getSetFormatData(const std::span<
 	data.requestId = readUInt16B(packet, offset);
 	offset += sizeof(Net::Packet::RequestIdType);
 	data.compression = readUInt8(packet, offset);
+	offset += sizeof(Net::Packet::CompressionType);
+	data.framesPerPacket = 1;
+	if (static_cast<int>(packet.size()) >= offset + static_cast<int>(sizeof(Net::Packet::FramesPerPacketType))) {
+		data.framesPerPacket = readUInt8(packet, offset);
+	}
+	return data;
+}
+
+std::optional<Net::Packet::LossReportData> Net::getLossReportData(const std::span<char>& packet) {
+	if (static_cast<int>(packet.size()) < Packet::dataOffset + Packet::LossReportData::size) {
+		return std::nullopt;
+	}
+	int offset = Packet::dataOffset;
+	Net::Packet::LossReportData data{};
+	data.received = readUInt32B(packet, offset);
+	offset += sizeof(Net::Packet::PacketCountType);
+	data.lost = readUInt32B(packet, offset);
+	offset += sizeof(Net::Packet::PacketCountType);
+	data.minCompression = readUInt8(packet, offset);
 	return data;
 }
+
+std::vector<Net::Packet::SequenceNumberType> Net::getNackSequenceNumbers(const std::span<char>& packet) {
+	std::vector<Net::Packet::SequenceNumberType> result;
+	if (static_cast<int>(packet.size()) < Packet::dataOffset) {
+		return result;
+	}
+	const auto count = std::min<size_t>((packet.size() - Packet::dataOffset) / Packet::sequenceNumberSize,
+		Packet::maxNackSequenceNumbers);
+	result.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		result.push_back(readUInt32B(packet, Packet::dataOffset + i * Packet::sequenceNumberSize));
+	}
+	return result;
+}
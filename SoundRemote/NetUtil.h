@@ -1,3 +1,4 @@
+#include <array>
 #include <forward_list>
 #include <optional>
 #include <span>
@@ -7,6 +8,9 @@
 #include "AudioUtil.h"
 #include "Keystroke.h"
 #include "NetDefines.h"
+#include "ParityEncoder.h"
+
+#include <boost/asio/ip/address_v4.hpp>
 
 namespace Net {
 	/// <summary>
@@ -20,6 +24,11 @@ namespace Net {
 	/// <param name="addrTableSize">address of the list of the addresses</param>
 	/// <returns>List of addresses.</returns>
 	std::vector<char> getRawLocalAddressesTable(DWORD* addrTableSize);
+	/// <summary>
+	/// Gets the first local IPv4 address that is not a loopback one, to send the multicast from.
+	/// </summary>
+	/// <returns>Address or an empty optional if there is none or an error occurs.</returns>
+	std::optional<boost::asio::ip::address_v4> getMulticastInterface();
 
 	/// <summary>
 	/// Converts a compression value used in the network protocol to a value of the <c>Audio::Compression</c> enum.
@@ -29,19 +38,101 @@ namespace Net {
 	/// argument is not a valid compression value.</returns>
 	std::optional<Audio::Compression> compressionFromNetworkValue(Net::Packet::CompressionType compression);
 
+	/// <summary>
+	/// Audio packet split into parts that are sent as a single datagram without copying the audio data.
+	/// </summary>
+	struct AudioPacket {
+		std::array<char, Net::Packet::headerSize> header;
+		std::array<char, Net::Packet::sequenceNumberSize> sequenceNumber;
+		std::span<const char> audioData;
+	};
+
+	/// <summary>
+	/// Parity packet split into parts like <c>AudioPacket</c>.
+	/// </summary>
+	struct ParityPacket {
+		std::array<char, Net::Packet::parityDataOffset> header;
+		std::span<const char> parity;
+	};
+
+	/// <summary>
+	/// Creates an audio packet referencing the audio data.
+	/// </summary>
+	/// <param name="category">Audio packet category</param>
+	/// <param name="sequenceNumber">Sequence number</param>
+	/// <param name="audioData">Audio data, must outlive the returned packet</param>
+	AudioPacket makeAudioPacket(
+		Net::Packet::Category category,
+		Net::Packet::SequenceNumberType sequenceNumber,
+		std::span<const char> audioData
+	);
+	/// <summary>
+	/// Creates an AudioParity referencing the parity of the group.
+	/// Must be sent only to the clients that opted in for <c>Net::Protocol::parity</c>.
+	/// </summary>
+	/// <param name="group">Parity group, its parity must outlive the returned packet</param>
+	ParityPacket makeParityPacket(const ParityGroup& group);
 	std::vector<char> createAudioPacket(
 		Net::Packet::Category category,
 		Net::Packet::SequenceNumberType sequenceNumber,
 		const std::span<const char>& audioData
 		);
-	std::vector<char> createKeepAlivePacket();
+	/// <summary>
+	/// Creates a ServerKeepAlive.
+	/// </summary>
+	/// <param name="timestamp">Timestamp for the client to echo back.
+	/// Must be set only for the clients supporting <c>Net::Protocol::roundTrip</c>.</param>
+	std::vector<char> createKeepAlivePacket(std::optional<Net::Packet::TimestampType> timestamp = std::nullopt);
+	/// <summary>
+	/// Creates an AudioSilence. Must be sent only to the clients supporting <c>Net::Protocol::silence</c>.
+	/// </summary>
+	/// <param name="sequenceNumber">Sequence number of the last silent frame</param>
+	std::vector<char> createSilencePacket(Net::Packet::SequenceNumberType sequenceNumber);
 	std::vector<char> createAdvertisePacket();
 	std::vector<char> createDisconnectPacket();
-	std::vector<char> createAckConnectPacket(Net::Packet::RequestIdType requestId);
-	std::vector<char> createAckSetFormatPacket(Net::Packet::RequestIdType requestId);
+	/// <summary>
+	/// Creates a Connect ack.
+	/// </summary>
+	/// <param name="requestId">Id of the Connect request</param>
+	/// <param name="protocol">Protocol version negotiated with the client</param>
+	/// <param name="multicastGroup">Multicast group the client gets the audio from, if any.
+	/// Must be set only for the clients supporting <c>Net::Protocol::multicast</c>.</param>
+	std::vector<char> createAckConnectPacket(
+		Net::Packet::RequestIdType requestId,
+		Net::Packet::ProtocolVersionType protocol = Net::protocolVersion,
+		std::optional<boost::asio::ip::address_v4> multicastGroup = std::nullopt
+	);
+	/// <summary>
+	/// Creates a SetFormat ack.
+	/// </summary>
+	/// <param name="requestId">Id of the SetFormat request</param>
+	/// <param name="multicastGroup">Multicast group for the new compression, if any.
+	/// Must be set only for the clients supporting <c>Net::Protocol::multicast</c>.</param>
+	std::vector<char> createAckSetFormatPacket(
+		Net::Packet::RequestIdType requestId,
+		std::optional<boost::asio::ip::address_v4> multicastGroup = std::nullopt
+	);
+
+	/// <summary>
+	/// Gets the multicast group the audio with the given compression is sent to in the multicast mode.
+	/// </summary>
+	/// <param name="compression">Audio compression</param>
+	/// <returns>Administratively scoped IPv4 multicast address, different for each compression.</returns>
+	boost::asio::ip::address_v4 multicastGroup(Audio::Compression compression);
 
 	Net::Packet::Category getPacketCategory(const std::span<char>& packet);
 	std::optional<Keystroke> getKeystroke(const std::span<char>& packet);
 	std::optional<Net::Packet::ConnectData> getConnectData(const std::span<char>& packet);
 	std::optional<Net::Packet::SetFormatData> getSetFormatData(const std::span<char>& packet);
+	std::optional<Net::Packet::LossReportData> getLossReportData(const std::span<char>& packet);
+	/// <summary>
+	/// Gets the sequence numbers listed by a Nack, no more than <c>Net::Packet::maxNackSequenceNumbers</c>.
+	/// </summary>
+	/// <returns>Sequence numbers in the packet order, empty if the packet lists none.</returns>
+	std::vector<Net::Packet::SequenceNumberType> getNackSequenceNumbers(const std::span<char>& packet);
+	/// <summary>
+	/// Gets the timestamp echoed in a ClientKeepAlive.
+	/// </summary>
+	/// <returns>Echoed timestamp or <c>std::nullopt</c> for an empty keepalive.</returns>
+	std::optional<Net::Packet::TimestampType> getKeepAliveTimestamp(const std::span<char>& packet);
 };
@@ -0,0 +1,50 @@
+#include "OpusProfile.h"
+
+#include <initializer_list>
+#include <optional>
+#include <string>
+
+#include "Settings.h"
+
+namespace {
+    using namespace Audio::Opus;
+
+    // The values of the options are the ones of the enums
+    template <typename Enum>
+    std::optional<Enum> enumOf(std::optional<int> value, std::initializer_list<Enum> values) {
+        if (!value) {
+            return {};
+        }
+        for (auto candidate : values) {
+            if (static_cast<int>(candidate) == *value) {
+                return candidate;
+            }
+        }
+        return {};
+    }
+
+    std::optional<int> intOf(std::optional<int> value, int min, int max) {
+        if (!value || *value < min || *value > max) {
+            return {};
+        }
+        return value;
+    }
+}
+
+Profile Audio::Opus::profileFrom(const Settings& settings) {
+    Profile result;
+    result.frameLength = enumOf(settings.get<int>(Settings::OpusFrameLength), { FrameLength::ms_2_5,
+        FrameLength::ms_5, FrameLength::ms_10, FrameLength::ms_20, FrameLength::ms_40, FrameLength::ms_60 })
+        .value_or(result.frameLength);
+    result.complexity = intOf(settings.get<int>(Settings::OpusComplexity), 0, 10).value_or(result.complexity);
+    result.application = enumOf(settings.get<int>(Settings::OpusApplication), { Application::audio,
+        Application::voip, Application::lowDelay }).value_or(result.application);
+    result.maxBandwidth = enumOf(settings.get<int>(Settings::OpusMaxBandwidth), { Bandwidth::narrowband,
+        Bandwidth::mediumband, Bandwidth::wideband, Bandwidth::superwideband, Bandwidth::fullband })
+        .value_or(result.maxBandwidth);
+    result.bitrateMode = enumOf(settings.get<int>(Settings::OpusBitrateMode), { BitrateMode::cbr, BitrateMode::vbr,
+        BitrateMode::constrainedVbr }).value_or(result.bitrateMode);
+    const auto lsbDepth = settings.get<int>(Settings::OpusLsbDepth);
+    result.lsbDepth = lsbDepth == 0 ? 0 : intOf(lsbDepth, 8, 24).value_or(result.lsbDepth);
+    return result;
+}
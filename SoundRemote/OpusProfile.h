@@ -0,0 +1,38 @@
+#pragma once
+
+class Settings;
+
+namespace Audio {
+	namespace Opus {
+		// Frame lengths Opus can encode, in microseconds
+		enum class FrameLength { ms_2_5 = 2'500, ms_5 = 5'000, ms_10 = 10'000, ms_20 = 20'000, ms_40 = 40'000, ms_60 = 60'000 };
+		// Kind of the signal the encoder is tuned for
+		enum class Application { audio, voip, lowDelay };
+		// Audio bandwidths, in kHz
+		enum class Bandwidth { narrowband = 4, mediumband = 6, wideband = 8, superwideband = 12, fullband = 20 };
+		enum class BitrateMode { cbr, vbr, constrainedVbr };
+
+		/// <summary>
+		/// Settings of the Opus encoders, the defaults are the ones of libopus with the 10 ms frames.
+		/// </summary>
+		struct Profile {
+			FrameLength frameLength = FrameLength::ms_10;
+			// From 0 to 10, the higher the better quality and the more CPU it takes
+			int complexity = 10;
+			Application application = Application::audio;
+			// Upper limit of the encoded bandwidth
+			Bandwidth maxBandwidth = Bandwidth::fullband;
+			BitrateMode bitrateMode = BitrateMode::constrainedVbr;
+			// Significant bits of the input from 8 to 24, 0 for the ones of its sample type
+			int lsbDepth = 0;
+
+			friend bool operator==(const Profile& lhs, const Profile& rhs) = default;
+		};
+
+		/// <summary>
+		/// Reads the profile from the <c>Settings::Opus*</c> options.
+		/// A missing or invalid option leaves its field with the default value.
+		/// </summary>
+		Profile profileFrom(const Settings& settings);
+	}
+}
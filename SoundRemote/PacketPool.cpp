@@ -0,0 +1,90 @@
+#include "PacketPool.h"
+
+#include <cassert>
+
+// PacketBuffer
+
+PacketBuffer::PacketBuffer(size_t capacity) :
+    data_(std::make_unique<char[]>(capacity)),
+    capacity_(capacity) {}
+
+char* PacketBuffer::data() {
+    return data_.get();
+}
+
+const char* PacketBuffer::data() const {
+    return data_.get();
+}
+
+size_t PacketBuffer::size() const {
+    return size_;
+}
+
+void PacketBuffer::resize(size_t size) {
+    assert(size <= capacity_);
+    size_ = size;
+}
+
+size_t PacketBuffer::capacity() const {
+    return capacity_;
+}
+
+void intrusive_ptr_add_ref(PacketBuffer* buffer) {
+    buffer->refCount_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void intrusive_ptr_release(PacketBuffer* buffer) {
+    if (buffer->refCount_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // Hold the pool until the buffer is back in it, the pool may be released together with the buffer.
+        const auto pool = std::move(buffer->pool_);
+        pool->recycle(buffer);
+    }
+}
+
+// PacketPool
+
+std::shared_ptr<PacketPool> PacketPool::create(size_t bufferCapacity, size_t initialCount) {
+    return std::shared_ptr<PacketPool>(new PacketPool(bufferCapacity, initialCount));
+}
+
+PacketPool::PacketPool(size_t bufferCapacity, size_t initialCount) : bufferCapacity_(bufferCapacity) {
+    buffers_.reserve(initialCount);
+    free_.reserve(initialCount);
+    for (size_t i = 0; i < initialCount; ++i) {
+        buffers_.push_back(std::unique_ptr<PacketBuffer>(new PacketBuffer(bufferCapacity_)));
+        free_.push_back(buffers_.back().get());
+    }
+}
+
+PacketPtr PacketPool::acquire() {
+    PacketBuffer* buffer = nullptr;
+    {
+        const std::lock_guard lock(mutex_);
+        if (free_.empty()) {
+            buffers_.push_back(std::unique_ptr<PacketBuffer>(new PacketBuffer(bufferCapacity_)));
+            // Make sure recycling the new buffer never needs to grow the free list.
+            free_.reserve(buffers_.capacity());
+            buffer = buffers_.back().get();
+        } else {
+            buffer = free_.back();
+            free_.pop_back();
+        }
+    }
+    buffer->pool_ = shared_from_this();
+    buffer->size_ = buffer->capacity_;
+    return PacketPtr(buffer);
+}
+
+size_t PacketPool::bufferCapacity() const {
+    return bufferCapacity_;
+}
+
+size_t PacketPool::allocatedCount() const {
+    const std::lock_guard lock(mutex_);
+    return buffers_.size();
+}
+
+void PacketPool::recycle(PacketBuffer* buffer) {
+    const std::lock_guard lock(mutex_);
+    free_.push_back(buffer);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <boost/smart_ptr/intrusive_ptr.hpp>
+
+class PacketPool;
+
+/// <summary>
+/// Fixed capacity packet buffer owned by a <c>PacketPool</c>.
+/// Reference counted intrusively, goes back to its pool when the last <c>PacketPtr</c> to it is gone.
+/// </summary>
+class PacketBuffer {
+public:
+	char* data();
+	const char* data() const;
+	/// <summary>
+	/// Gets the size of the packet data, which is the whole capacity for a freshly acquired buffer.
+	/// </summary>
+	size_t size() const;
+	/// <summary>
+	/// Sets the size of the packet data.
+	/// </summary>
+	/// <param name="size">- new size, must not exceed <c>capacity()</c></param>
+	void resize(size_t size);
+	size_t capacity() const;
+
+	PacketBuffer(const PacketBuffer&) = delete;
+	PacketBuffer& operator= (const PacketBuffer&) = delete;
+private:
+	friend class PacketPool;
+	friend void intrusive_ptr_add_ref(PacketBuffer* buffer);
+	friend void intrusive_ptr_release(PacketBuffer* buffer);
+
+	PacketBuffer(size_t capacity);
+
+	std::unique_ptr<char[]> data_;
+	const size_t capacity_;
+	size_t size_ = 0;
+	std::atomic_int refCount_ = 0;
+	// Set while the buffer is in use, keeps the pool alive until all of its buffers are returned.
+	std::shared_ptr<PacketPool> pool_;
+};
+
+using PacketPtr = boost::intrusive_ptr<PacketBuffer>;
+
+/// <summary>
+/// Pool of fixed capacity packet buffers. Buffers are allocated up front and reused, so acquiring one
+/// allocates only if all the existing buffers are in use.
+/// </summary>
+class PacketPool : public std::enable_shared_from_this<PacketPool> {
+public:
+	/// <summary>
+	/// Creates a pool.
+	/// </summary>
+	/// <param name="bufferCapacity">- capacity of each buffer in bytes</param>
+	/// <param name="initialCount">- number of buffers to allocate up front</param>
+	static std::shared_ptr<PacketPool> create(size_t bufferCapacity, size_t initialCount);
+	/// <summary>
+	/// Gets a free buffer. Thread safe.
+	/// </summary>
+	PacketPtr acquire();
+	size_t bufferCapacity() const;
+	/// <summary>
+	/// Gets the number of buffers allocated by the pool, both free and in use.
+	/// </summary>
+	size_t allocatedCount() const;
+private:
+	friend void intrusive_ptr_release(PacketBuffer* buffer);
+
+	PacketPool(size_t bufferCapacity, size_t initialCount);
+	void recycle(PacketBuffer* buffer);
+
+	const size_t bufferCapacity_;
+	mutable std::mutex mutex_;
+	std::vector<std::unique_ptr<PacketBuffer>> buffers_;
+	std::vector<PacketBuffer*> free_;
+};
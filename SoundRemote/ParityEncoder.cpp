@@ -0,0 +1,78 @@
+#include "ParityEncoder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    void xorInto(std::vector<char>& parity, std::span<const char> data) {
+        if (parity.size() < data.size()) {
+            parity.resize(data.size());
+        }
+        for (size_t i = 0; i < data.size(); ++i) {
+            parity[i] ^= data[i];
+        }
+    }
+}
+
+ParityEncoder::ParityEncoder(size_t groupSize) :
+    groupSize_(groupSize) {
+    if (groupSize < 2 || groupSize > maxSpan) {
+        throw std::invalid_argument("ParityEncoder: group size out of range");
+    }
+}
+
+std::optional<ParityGroup> ParityEncoder::add(uint32_t sequenceNumber, std::span<const char> audioData) {
+    std::optional<ParityGroup> ended;
+    // Wraps around like the sequence numbers
+    const auto offset = sequenceNumber - first_;
+    if (packets_ != 0 && (offset >= maxSpan || sequenceNumber - last_ - 1 >= maxSpan)) {
+        ended = close();
+    }
+    auto& parity = buffers_[current_];
+    if (packets_ == 0) {
+        // Keeps the size, so the buffer isn't reallocated
+        std::fill(parity.begin(), parity.end(), '\0');
+        parityLength_ = 0;
+        first_ = sequenceNumber;
+        mask_ = 0;
+        sizeXor_ = 0;
+    }
+    xorInto(parity, audioData);
+    parityLength_ = std::max(parityLength_, audioData.size());
+    mask_ |= 1u << (sequenceNumber - first_);
+    sizeXor_ ^= static_cast<uint16_t>(audioData.size());
+    last_ = sequenceNumber;
+    if (++packets_ == groupSize_) {
+        ended = close();
+    }
+    return ended;
+}
+
+std::optional<ParityGroup> ParityEncoder::flush() {
+    if (packets_ == 0) {
+        return std::nullopt;
+    }
+    return close();
+}
+
+size_t ParityEncoder::groupSize() const {
+    return groupSize_;
+}
+
+std::vector<char> ParityEncoder::recover(const ParityGroup& group, std::span<const std::span<const char>> received) {
+    std::vector<char> result(group.parity.begin(), group.parity.end());
+    uint16_t size = group.sizeXor;
+    for (auto&& data : received) {
+        xorInto(result, data);
+        size ^= static_cast<uint16_t>(data.size());
+    }
+    result.resize(std::min<size_t>(size, result.size()));
+    return result;
+}
+
+ParityGroup ParityEncoder::close() {
+    const ParityGroup group{ first_, mask_, sizeXor_, { buffers_[current_].data(), parityLength_ } };
+    current_ ^= 1;
+    packets_ = 0;
+    return group;
+}
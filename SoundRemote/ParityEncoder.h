@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+/// <summary>
+/// XOR parity of a group of audio packets of a stream. A client that got all the packets of the group but one
+/// rebuilds the missing one from the parity and the rest, see <c>ParityEncoder::recover()</c>.
+/// </summary>
+struct ParityGroup {
+	// Sequence number of the first packet of the group
+	uint32_t first = 0;
+	// Bit i is set if the packet first + i is in the group, the rest of the sequence numbers weren't sent
+	uint32_t mask = 0;
+	// XOR of the audio data sizes
+	uint16_t sizeXor = 0;
+	// XOR of the audio data, each padded with zeros to the longest
+	std::span<const char> parity;
+};
+
+/// <summary>
+/// Makes the XOR parity of every <c>groupSize</c> audio packets of a stream, so one lost packet per group
+/// is repaired without a retransmit. The sequence numbers may have gaps, as the DTX and the silence
+/// aren't sent, a group spans no more than <c>maxSpan</c> of them.
+/// The parity is computed once per stream however many clients get it. Not thread safe.
+/// </summary>
+class ParityEncoder {
+public:
+	// Sequence numbers a group may span, the bits of ParityGroup::mask
+	static constexpr uint32_t maxSpan = 32;
+
+	/// <summary>
+	/// Creates an encoder.
+	/// </summary>
+	/// <param name="groupSize">- packets per parity, from 2 to maxSpan</param>
+	/// <exception cref="std::invalid_argument">The group size is out of the range.</exception>
+	explicit ParityEncoder(size_t groupSize);
+
+	/// <summary>
+	/// Adds a sent packet to the group. A packet past the span of the group or not after its last one
+	/// ends the group and starts the next one.
+	/// </summary>
+	/// <param name="sequenceNumber">- sequence number of the packet</param>
+	/// <param name="audioData">- audio data of the packet</param>
+	/// <returns>The group ended by the packet, valid until the next call. Empty while the group isn't complete.</returns>
+	std::optional<ParityGroup> add(uint32_t sequenceNumber, std::span<const char> audioData);
+	/// <summary>
+	/// Ends the group early, like before a pause of the stream.
+	/// </summary>
+	/// <returns>The group, valid until the next call. Empty if there are no packets since the last group.</returns>
+	std::optional<ParityGroup> flush();
+	size_t groupSize() const;
+
+	/// <summary>
+	/// Rebuilds the audio data of the only packet of the group that wasn't received.
+	/// </summary>
+	/// <param name="group">- parity of the group</param>
+	/// <param name="received">- audio data of the rest of the packets of the group, in any order</param>
+	/// <returns>Audio data of the missing packet.</returns>
+	static std::vector<char> recover(const ParityGroup& group, std::span<const std::span<const char>> received);
+private:
+	// Ends the current group and switches to the other buffer
+	ParityGroup close();
+
+	const size_t groupSize_;
+	// The parity being built and the one of the last ended group
+	std::array<std::vector<char>, 2> buffers_;
+	size_t current_ = 0;
+	// Bytes of the current parity in use
+	size_t parityLength_ = 0;
+	uint32_t first_ = 0;
+	uint32_t last_ = 0;
+	uint32_t mask_ = 0;
+	uint16_t sizeXor_ = 0;
+	size_t packets_ = 0;
+};
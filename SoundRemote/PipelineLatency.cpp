@@ -0,0 +1,20 @@
+#include "PipelineLatency.h"
+
+LatencyStats PipelineLatency::stats(Stage stage, Audio::Compression compression) const {
+#ifdef SOUNDREMOTE_PIPELINE_LATENCY
+    return histograms_[indexOf(stage, compression)].stats();
+#else
+    return {};
+#endif
+}
+
+#ifdef SOUNDREMOTE_PIPELINE_LATENCY
+size_t PipelineLatency::indexOf(Stage stage, Audio::Compression compression) {
+    const auto stageIndex = static_cast<size_t>(stage);
+    if (stageIndex < sharedStageCount) {
+        return stageIndex;
+    }
+    return sharedStageCount + (stageIndex - sharedStageCount) * Audio::compressionCount
+        + Audio::compressionIndex(compression);
+}
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+
+#include "AudioDefines.h"
+#include "LatencyHistogram.h"
+
+/// <summary>
+/// Latencies of the stages of the capture pipeline, from a captured buffer to the sent audio datagram.
+/// Measured only if <c>SOUNDREMOTE_PIPELINE_LATENCY</c> is defined, otherwise the time points are empty
+/// and the recording compiles to nothing. The projects define it, so the metrics report the stage latencies.
+/// </summary>
+class PipelineLatency {
+public:
+#ifdef SOUNDREMOTE_PIPELINE_LATENCY
+	static constexpr bool enabled = true;
+	using TimePoint = std::chrono::steady_clock::time_point;
+#else
+	static constexpr bool enabled = false;
+	struct TimePoint {};
+#endif
+
+	enum class Stage {
+		// Captured buffer yielded to resampled into the frame buffer
+		resample,
+		// First audio of the frame resampled to the frame complete, the wait for the rest of its audio
+		frame,
+		// Encoding of the frame, per compression
+		encode,
+		// Encoded to sent, including the wait for the network thread, per compression
+		send,
+		// Captured buffer yielded to sent, per compression.
+		// A frame made of several captured buffers counts from the one that completed it.
+		total
+	};
+
+	static TimePoint now();
+	/// <summary>
+	/// Records the latency of the stage.
+	/// </summary>
+	/// <param name="compression">Compression of a per compression stage, ignored for the others</param>
+	void record(Stage stage, TimePoint from, TimePoint to, Audio::Compression compression = Audio::Compression::none);
+	/// <summary>
+	/// Gets the latencies of the stage. Empty if the measuring is off.
+	/// </summary>
+	/// <param name="compression">Compression of a per compression stage, ignored for the others</param>
+	LatencyStats stats(Stage stage, Audio::Compression compression = Audio::Compression::none) const;
+private:
+#ifdef SOUNDREMOTE_PIPELINE_LATENCY
+	// The stages before the encoding have a single histogram, the rest one per compression
+	static constexpr size_t sharedStageCount = 2;
+	static constexpr size_t histogramCount = sharedStageCount + 3 * Audio::compressionCount;
+
+	static size_t indexOf(Stage stage, Audio::Compression compression);
+
+	std::array<LatencyHistogram, histogramCount> histograms_;
+#endif
+};
+
+inline PipelineLatency::TimePoint PipelineLatency::now() {
+#ifdef SOUNDREMOTE_PIPELINE_LATENCY
+	return std::chrono::steady_clock::now();
+#else
+	return {};
+#endif
+}
+
+inline void PipelineLatency::record(Stage stage, TimePoint from, TimePoint to, Audio::Compression compression) {
+#ifdef SOUNDREMOTE_PIPELINE_LATENCY
+	histograms_[indexOf(stage, compression)].record(std::chrono::duration_cast<std::chrono::microseconds>(to - from));
+#endif
+}
@@ -0,0 +1,260 @@
+#include "PolyphaseResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+    using Isa = PolyphaseResampler::Isa;
+    using Quality = PolyphaseResampler::Quality;
+
+    struct Preset {
+        // Multiple of 16 for the vector kernels
+        size_t taps;
+        // Kaiser window shape, higher gives a stronger stopband and a wider transition band
+        double beta;
+        // Cutoff relative to the Nyquist frequency of the lower rate
+        double passband;
+    };
+
+    Preset presetOf(Quality quality) {
+        switch (quality) {
+        case Quality::low:
+            return { 16, 5.0, 0.80 };
+        case Quality::high:
+            return { 64, 9.0, 0.93 };
+        default:
+            return { 32, 7.0, 0.88 };
+        }
+    }
+
+    double besselI0(double x) {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 64 && term > sum * 1e-12; ++k) {
+            const auto factor = x / (2.0 * k);
+            term *= factor * factor;
+            sum += term;
+        }
+        return sum;
+    }
+
+    double sinc(double x) {
+        if (x == 0.0) {
+            return 1.0;
+        }
+        return std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+    }
+
+    // Filters of all the phases, each normalized to the unity gain at DC
+    std::vector<float> makeCoefficients(uint32_t phases, size_t taps, double cutoff, double beta) {
+        std::vector<float> result(phases * taps);
+        const double half = static_cast<double>(taps) / 2;
+        const double windowScale = 1.0 / besselI0(beta);
+        std::vector<double> phase(taps);
+        for (uint32_t p = 0; p < phases; ++p) {
+            // The tap a phase is centered at, past the middle by the fraction of the input frame
+            const double center = half - 1 + static_cast<double>(p) / phases;
+            for (size_t j = 0; j < taps; ++j) {
+                const double t = static_cast<double>(j) - center;
+                const double x = std::clamp(t / half, -1.0, 1.0);
+                const double window = besselI0(beta * std::sqrt(1.0 - x * x)) * windowScale;
+                phase[j] = window * 2 * cutoff * sinc(2 * cutoff * t);
+            }
+            const double sum = std::accumulate(phase.begin(), phase.end(), 0.0);
+            for (size_t j = 0; j < taps; ++j) {
+                result[p * taps + j] = static_cast<float>(phase[j] / sum);
+            }
+        }
+        return result;
+    }
+
+    float dotScalar(const float* a, const float* b, size_t size) {
+        float sum = 0.0f;
+        for (size_t i = 0; i < size; ++i) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+#ifdef SOUNDREMOTE_X86
+    SOUNDREMOTE_TARGET_SSE2 float horizontalSum(__m128 sum) {
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+    }
+
+    // Size is a multiple of 8
+    SOUNDREMOTE_TARGET_SSE2 float dotSse2(const float* a, const float* b, size_t size) {
+        auto first = _mm_setzero_ps();
+        auto second = _mm_setzero_ps();
+        for (size_t i = 0; i < size; i += 8) {
+            first = _mm_add_ps(first, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            second = _mm_add_ps(second, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+        return horizontalSum(_mm_add_ps(first, second));
+    }
+
+    // Size is a multiple of 16
+    SOUNDREMOTE_TARGET_AVX2 float dotAvx2(const float* a, const float* b, size_t size) {
+        auto first = _mm256_setzero_ps();
+        auto second = _mm256_setzero_ps();
+        for (size_t i = 0; i < size; i += 16) {
+            first = _mm256_add_ps(first, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            second = _mm256_add_ps(second, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+        }
+        const auto sum = _mm256_add_ps(first, second);
+        return horizontalSum(_mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1)));
+    }
+#endif
+
+    // Scalar unless specialized for the instruction set
+    template <Isa KernelIsa>
+    struct DotKernel {
+        static float product(const float* a, const float* b, size_t size) {
+            return dotScalar(a, b, size);
+        }
+    };
+
+#ifdef SOUNDREMOTE_X86
+    template <>
+    struct DotKernel<Isa::sse2> {
+        static float product(const float* a, const float* b, size_t size) {
+            return dotSse2(a, b, size);
+        }
+    };
+
+    template <>
+    struct DotKernel<Isa::avx2> {
+        static float product(const float* a, const float* b, size_t size) {
+            return dotAvx2(a, b, size);
+        }
+    };
+#endif
+
+    PolyphaseResampler::DotProduct dotProductFor(Isa isa) {
+        switch (isa) {
+        case Isa::avx2:
+            return &DotKernel<Isa::avx2>::product;
+        case Isa::sse2:
+            return &DotKernel<Isa::sse2>::product;
+        default:
+            return &DotKernel<Isa::scalar>::product;
+        }
+    }
+
+    size_t tapsOf(Quality quality, uint32_t inputRate, uint32_t outputRate) {
+        const auto decimation = (inputRate + outputRate - 1) / outputRate;
+        return presetOf(quality).taps * std::max<uint32_t>(decimation, 1);
+    }
+
+    uint32_t checkedDivisor(uint32_t inputRate, uint32_t outputRate, size_t channels) {
+        if (!PolyphaseResampler::supports(inputRate, outputRate)) {
+            throw std::invalid_argument("PolyphaseResampler: unsupported rates");
+        }
+        if (channels == 0) {
+            throw std::invalid_argument("PolyphaseResampler: no channels");
+        }
+        return std::gcd(inputRate, outputRate);
+    }
+}
+
+PolyphaseResampler::PolyphaseResampler(uint32_t inputRate, uint32_t outputRate, size_t channels, Quality quality,
+    Isa isa) :
+    interpolation_(outputRate / checkedDivisor(inputRate, outputRate, channels)),
+    decimation_(inputRate / std::gcd(inputRate, outputRate)),
+    channels_(channels),
+    taps_(tapsOf(quality, inputRate, outputRate)),
+    isa_(isa),
+    dotProduct_(dotProductFor(isa)),
+    historyStride_(blockFrames + taps_) {
+    const auto preset = presetOf(quality);
+    // Cycles per input frame, below the Nyquist frequency of the lower rate
+    const double cutoff = 0.5 * std::min(1.0, static_cast<double>(outputRate) / inputRate) * preset.passband;
+    coefficients_ = makeCoefficients(interpolation_, taps_, cutoff, preset.beta);
+    history_.resize(channels_ * historyStride_);
+    reset();
+}
+
+bool PolyphaseResampler::supports(uint32_t inputRate, uint32_t outputRate) {
+    return inputRate > 0 && outputRate > 0 && outputRate / std::gcd(inputRate, outputRate) <= maxPhases &&
+        inputRate <= static_cast<uint64_t>(outputRate) * maxDecimation;
+}
+
+size_t PolyphaseResampler::process(std::span<const float> input, std::span<float> output) {
+    const auto frames = input.size() / channels_;
+    if (output.size() < maxOutputFrames(frames) * channels_) {
+        throw std::length_error("PolyphaseResampler: output is too small");
+    }
+    size_t outputFrames = 0;
+    for (size_t done = 0; done < frames;) {
+        const auto block = std::min(blockFrames, frames - done);
+        append(input.data() + done * channels_, block);
+        outputFrames += produce(output.data() + outputFrames * channels_);
+        done += block;
+    }
+    return outputFrames;
+}
+
+size_t PolyphaseResampler::maxOutputFrames(size_t inputFrames) const {
+    // The outputs of the previous calls took all the input they could, what's left covers less than one
+    const auto upsampled = static_cast<uint64_t>(inputFrames) * interpolation_;
+    return static_cast<size_t>((upsampled + decimation_ - 1) / decimation_);
+}
+
+void PolyphaseResampler::reset() {
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    // Silence before the stream, makes the center of the filter fall on the first input frame
+    historyFrames_ = taps_ / 2 - 1;
+    position_ = 0;
+}
+
+size_t PolyphaseResampler::channels() const {
+    return channels_;
+}
+
+size_t PolyphaseResampler::taps() const {
+    return taps_;
+}
+
+PolyphaseResampler::Isa PolyphaseResampler::isa() const {
+    return isa_;
+}
+
+void PolyphaseResampler::append(const float* input, size_t frames) {
+    for (size_t c = 0; c < channels_; ++c) {
+        auto history = history_.data() + c * historyStride_ + historyFrames_;
+        for (size_t i = 0; i < frames; ++i) {
+            history[i] = input[i * channels_ + c];
+        }
+    }
+    historyFrames_ += frames;
+}
+
+size_t PolyphaseResampler::produce(float* output) {
+    size_t outputFrames = 0;
+    for (;; position_ += decimation_) {
+        const auto first = static_cast<size_t>(position_ / interpolation_);
+        if (first + taps_ > historyFrames_) {
+            break;
+        }
+        const auto phase = static_cast<size_t>(position_ % interpolation_);
+        const auto coefficients = coefficients_.data() + phase * taps_;
+        for (size_t c = 0; c < channels_; ++c) {
+            *output++ = dotProduct_(coefficients, history_.data() + c * historyStride_ + first, taps_);
+        }
+        ++outputFrames;
+    }
+    // Less than taps_ frames are left, the next block fits after them
+    const auto consumed = static_cast<size_t>(position_ / interpolation_);
+    for (size_t c = 0; c < channels_; ++c) {
+        auto history = history_.data() + c * historyStride_;
+        std::memmove(history, history + consumed, (historyFrames_ - consumed) * sizeof(float));
+    }
+    historyFrames_ -= consumed;
+    position_ -= static_cast<uint64_t>(consumed) * interpolation_;
+    return outputFrames;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Simd.h"
+
+/// <summary>
+/// Polyphase windowed-sinc resampler of interleaved float samples, for rates in a ratio of small integers
+/// like 44.1 to 48 kHz. The filter of each output phase is precomputed and the buffers are allocated on
+/// construction, processing allocates nothing. Keeps the input needed by the next call, so a stream can be
+/// processed in the chunks of any size. Has no platform dependencies besides the x86 intrinsics.
+/// Not synchronized.
+/// </summary>
+class PolyphaseResampler {
+public:
+	using Isa = Simd::Isa;
+
+	// Trades the filter length for CPU, a longer filter has a steeper cutoff and a stronger stopband
+	enum class Quality { low, medium, high };
+
+	// Input frames processed at once, the buffers are sized for them
+	static constexpr size_t blockFrames = 1024;
+	// Limits the phase filters, the rates needing more aren't supported
+	static constexpr uint32_t maxPhases = 1024;
+	// Limits the downsampling, the filters get longer with it
+	static constexpr uint32_t maxDecimation = 4;
+
+	/// <summary>
+	/// Creates a resampler and computes its filters.
+	/// </summary>
+	/// <param name="inputRate">- sample rate of the input</param>
+	/// <param name="outputRate">- sample rate of the output</param>
+	/// <param name="channels">- channels of the interleaved samples</param>
+	/// <param name="quality">- quality preset</param>
+	/// <param name="isa">- instruction set to use, must be supported by the CPU</param>
+	/// <exception cref="std::invalid_argument">The rates aren't supported or there are no channels.</exception>
+	PolyphaseResampler(uint32_t inputRate, uint32_t outputRate, size_t channels, Quality quality = Quality::medium,
+		Isa isa = Simd::bestIsa());
+
+	/// <summary>
+	/// Checks if the conversion between the rates needs no more than <c>maxPhases</c> phase filters
+	/// and downsamples by no more than <c>maxDecimation</c>.
+	/// </summary>
+	static bool supports(uint32_t inputRate, uint32_t outputRate);
+
+	/// <summary>
+	/// Resamples the whole frames of the input. The output is aligned with the input, the first frames of
+	/// the stream are delayed until the filter has enough input following them.
+	/// </summary>
+	/// <param name="input">- interleaved samples, a partial frame at the end is ignored</param>
+	/// <param name="output">- resampled samples, must hold <c>maxOutputFrames</c> of the input frames</param>
+	/// <returns>Number of the output frames.</returns>
+	/// <exception cref="std::length_error">The output is too small.</exception>
+	size_t process(std::span<const float> input, std::span<float> output);
+	/// <summary>
+	/// Gets the most output frames <c>process</c> can return for the input frames.
+	/// </summary>
+	size_t maxOutputFrames(size_t inputFrames) const;
+	/// <summary>
+	/// Drops the kept input and starts a new stream.
+	/// </summary>
+	void reset();
+	size_t channels() const;
+	/// <summary>
+	/// Gets the length of the phase filters in the input frames. Set by the quality and lengthened for
+	/// the downsampling, so the filters span the same number of the output frames.
+	/// </summary>
+	size_t taps() const;
+	Isa isa() const;
+
+	using DotProduct = float (*)(const float* a, const float* b, size_t size);
+private:
+	// Appends a block of frames to the history of the channels
+	void append(const float* input, size_t frames);
+	// Computes the outputs the history has enough frames for and drops the frames no longer needed
+	size_t produce(float* output);
+
+	// Ratio of the rates reduced to the smallest integers, the output is computed at multiples of
+	// decimation_ on the input upsampled by interpolation_
+	const uint32_t interpolation_;
+	const uint32_t decimation_;
+	const size_t channels_;
+	const size_t taps_;
+	const Isa isa_;
+	const DotProduct dotProduct_;
+	// taps_ coefficients per phase
+	std::vector<float> coefficients_;
+	// Planar history, blockFrames + taps_ frames per channel
+	std::vector<float> history_;
+	const size_t historyStride_;
+	size_t historyFrames_ = 0;
+	// Position of the next output in the history, in the upsampled frames
+	uint64_t position_ = 0;
+};
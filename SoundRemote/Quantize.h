@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "Simd.h"
+
+/// <summary>
+/// Rounding of the float samples scaled to the int16 range to int16, clamping the values out of range and
+/// turning NaN into the minimum. The dither is triangular (TPDF) noise of ±1 LSB from xorshift generators.
+/// The vector versions give the same results as the scalar ones, lane by lane.
+/// </summary>
+namespace Quantize {
+	constexpr float minValue = -32768.0f;
+	constexpr float maxValue = 32767.0f;
+	// Scales a 24 bit random value to [0, 1)
+	constexpr float randomScale = 1.0f / (1 << 24);
+
+	// xorshift32, cheap and good enough for the dither noise
+	inline uint32_t nextRandom(uint32_t& state) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	// Difference of two uniform values, triangular in (-1, 1)
+	inline float tpdf(uint32_t& state) {
+		const auto first = static_cast<int32_t>(nextRandom(state) >> 8);
+		const auto second = static_cast<int32_t>(nextRandom(state) >> 8);
+		return static_cast<float>(first - second) * randomScale;
+	}
+
+	// Clamps like max and then min of the vector versions
+	inline int16_t toInt16(float value) {
+		value = value > minValue ? value : minValue;
+		value = value < maxValue ? value : maxValue;
+		return static_cast<int16_t>(std::lrint(value));
+	}
+
+#ifdef SOUNDREMOTE_X86
+	inline SOUNDREMOTE_TARGET_SSE2 __m128i nextRandom(__m128i& state) {
+		state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+		state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+		state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+		return state;
+	}
+
+	inline SOUNDREMOTE_TARGET_SSE2 __m128 tpdf(__m128i& state) {
+		const auto first = _mm_srli_epi32(nextRandom(state), 8);
+		const auto second = _mm_srli_epi32(nextRandom(state), 8);
+		return _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(first, second)), _mm_set1_ps(randomScale));
+	}
+
+	// 8 samples, in order
+	inline SOUNDREMOTE_TARGET_SSE2 __m128i toInt16(__m128 low, __m128 high) {
+		const auto minimum = _mm_set1_ps(minValue);
+		const auto maximum = _mm_set1_ps(maxValue);
+		low = _mm_min_ps(_mm_max_ps(low, minimum), maximum);
+		high = _mm_min_ps(_mm_max_ps(high, minimum), maximum);
+		return _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+	}
+
+	inline SOUNDREMOTE_TARGET_AVX2 __m256i nextRandom(__m256i& state) {
+		state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+		state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+		state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+		return state;
+	}
+
+	inline SOUNDREMOTE_TARGET_AVX2 __m256 tpdf(__m256i& state) {
+		const auto first = _mm256_srli_epi32(nextRandom(state), 8);
+		const auto second = _mm256_srli_epi32(nextRandom(state), 8);
+		return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(first, second)), _mm256_set1_ps(randomScale));
+	}
+
+	// 16 samples, in order
+	inline SOUNDREMOTE_TARGET_AVX2 __m256i toInt16(__m256 low, __m256 high) {
+		const auto minimum = _mm256_set1_ps(minValue);
+		const auto maximum = _mm256_set1_ps(maxValue);
+		low = _mm256_min_ps(_mm256_max_ps(low, minimum), maximum);
+		high = _mm256_min_ps(_mm256_max_ps(high, minimum), maximum);
+		// Packs within the 128 bit halves, the permutation puts the quarters in order
+		const auto packed = _mm256_packs_epi32(_mm256_cvtps_epi32(low), _mm256_cvtps_epi32(high));
+		return _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+	}
+#endif
+}
@@ -0,0 +1,41 @@
+#include "RetransmitRing.h"
+
+#include <bit>
+#include <stdexcept>
+
+RetransmitRing::RetransmitRing(size_t capacity) {
+    if (capacity == 0 || capacity > maxCapacity) {
+        throw std::invalid_argument("RetransmitRing: capacity out of range");
+    }
+    entries_.resize(std::bit_ceil(capacity));
+}
+
+void RetransmitRing::store(uint32_t sequenceNumber, PacketPtr packet) {
+    auto& entry = entries_[sequenceNumber & (entries_.size() - 1)];
+    held_ += !entry.packet;
+    held_ -= !packet;
+    entry.sequenceNumber = sequenceNumber;
+    entry.packet = std::move(packet);
+    newest_ = sequenceNumber;
+}
+
+PacketPtr RetransmitRing::find(uint32_t sequenceNumber) const {
+    // Unsigned, so the ones after the newest are too old as well
+    if (newest_ - sequenceNumber >= entries_.size()) {
+        return {};
+    }
+    const auto& entry = entries_[sequenceNumber & (entries_.size() - 1)];
+    return entry.sequenceNumber == sequenceNumber ? entry.packet : PacketPtr{};
+}
+
+void RetransmitRing::clear() {
+    if (held_ == 0) { return; }
+    for (auto&& entry : entries_) {
+        entry.packet.reset();
+    }
+    held_ = 0;
+}
+
+size_t RetransmitRing::capacity() const {
+    return entries_.size();
+}
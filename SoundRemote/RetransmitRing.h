@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PacketPool.h"
+
+/// <summary>
+/// The last sent audio packets of a stream, kept for resending the ones the clients report lost.
+/// Holds the sent packet buffers themselves rather than copies, so storing costs no copying. The memory is bounded
+/// by the capacity: the pool of the buffers allocates up to <c>capacity()</c> more of them while they're held.
+/// Not thread safe.
+/// </summary>
+class RetransmitRing {
+public:
+	// Largest capacity, 10 s of the 10 ms frames
+	static constexpr size_t maxCapacity = 1024;
+
+	/// <summary>
+	/// Creates a ring.
+	/// </summary>
+	/// <param name="capacity">- packets the ring holds, from 1 to maxCapacity, rounded up to a power of two</param>
+	/// <exception cref="std::invalid_argument">The capacity is out of the range.</exception>
+	explicit RetransmitRing(size_t capacity);
+
+	/// <summary>
+	/// Keeps the sent packet. The sequence numbers are expected to grow, with gaps for the packets not sent,
+	/// the packets older than <c>capacity()</c> sequence numbers are dropped.
+	/// </summary>
+	/// <param name="sequenceNumber">- sequence number of the packet</param>
+	/// <param name="packet">- audio data of the packet, must not be changed while the ring holds it</param>
+	void store(uint32_t sequenceNumber, PacketPtr packet);
+	/// <summary>
+	/// Gets a packet to resend.
+	/// </summary>
+	/// <returns>The packet, empty if it wasn't sent or is too old.</returns>
+	PacketPtr find(uint32_t sequenceNumber) const;
+	/// <summary>
+	/// Releases all the packets, like when no client can ask for them.
+	/// </summary>
+	void clear();
+	size_t capacity() const;
+private:
+	struct Entry {
+		uint32_t sequenceNumber = 0;
+		PacketPtr packet;
+	};
+
+	// Indexed by the sequence number modulo the capacity
+	std::vector<Entry> entries_;
+	uint32_t newest_ = 0;
+	// Entries holding a packet
+	size_t held_ = 0;
+};
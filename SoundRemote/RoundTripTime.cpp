@@ -0,0 +1,44 @@
+#include "RoundTripTime.h"
+
+#include <algorithm>
+
+namespace {
+    // Weights of the new sample as in RFC 6298 for the smoothed time and RFC 3550 for the jitter
+    constexpr int64_t smoothingDivisor = 8;
+    constexpr int64_t jitterDivisor = 16;
+}
+
+void RoundTripTime::addSample(std::chrono::microseconds roundTrip) {
+    constexpr auto order = std::memory_order_relaxed;
+    const auto sample = roundTrip.count();
+    const auto samples = samples_.load(order);
+    if (samples == 0) {
+        min_.store(sample, order);
+        smoothed_.store(sample, order);
+    } else {
+        const auto difference = sample - last_.load(order);
+        const auto jitter = jitter_.load(order);
+        jitter_.store(jitter + ((difference < 0 ? -difference : difference) - jitter) / jitterDivisor, order);
+        const auto smoothed = smoothed_.load(order);
+        smoothed_.store(smoothed + (sample - smoothed) / smoothingDivisor, order);
+        min_.store(std::min(min_.load(order), sample), order);
+    }
+    last_.store(sample, order);
+    sum_.store(sum_.load(order) + sample, order);
+    samples_.store(samples + 1, order);
+}
+
+RoundTripStats RoundTripTime::load() const {
+    constexpr auto order = std::memory_order_relaxed;
+    using std::chrono::microseconds;
+    const auto samples = samples_.load(order);
+    if (samples == 0) { return {}; }
+    return {
+        samples,
+        microseconds(last_.load(order)),
+        microseconds(min_.load(order)),
+        microseconds(sum_.load(order) / static_cast<int64_t>(samples)),
+        microseconds(smoothed_.load(order)),
+        microseconds(jitter_.load(order))
+    };
+}
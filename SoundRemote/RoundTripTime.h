@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/// <summary>
+/// Plain copy of <c>RoundTripTime</c>.
+/// </summary>
+struct RoundTripStats {
+	uint64_t samples = 0;
+	std::chrono::microseconds last{};
+	std::chrono::microseconds min{};
+	std::chrono::microseconds average{};
+	// Exponentially weighted moving average, reacts to the changes faster than the average
+	std::chrono::microseconds smoothed{};
+	// Smoothed difference between the consecutive samples
+	std::chrono::microseconds jitter{};
+	friend bool operator==(const RoundTripStats& lhs, const RoundTripStats& rhs) = default;
+};
+
+/// <summary>
+/// Round-trip time to a client, measured with the keepalives.
+/// The samples must be added from one thread, <c>load()</c> may be called from any thread without locking.
+/// </summary>
+class RoundTripTime {
+public:
+	void addSample(std::chrono::microseconds roundTrip);
+	/// <summary>
+	/// Gets the statistics. A call concurrent with <c>addSample()</c> may see the sample only partially applied.
+	/// </summary>
+	RoundTripStats load() const;
+private:
+	std::atomic<uint64_t> samples_ = 0;
+	// In microseconds
+	std::atomic<int64_t> last_ = 0;
+	std::atomic<int64_t> min_ = 0;
+	std::atomic<int64_t> sum_ = 0;
+	std::atomic<int64_t> smoothed_ = 0;
+	std::atomic<int64_t> jitter_ = 0;
+};
@@ -0,0 +1,243 @@
+#include "SampleConverter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Quantize.h"
+
+namespace {
+    using Isa = SampleConverter::Isa;
+    using DitherState = SampleConverter::DitherState;
+
+    // Scales to the int16 range
+    constexpr float floatScale = 32768.0f;
+    constexpr float intScale = 1.0f / 65536.0f;
+
+    template <SampleFormat Format>
+    float loadScalar(const char* input) {
+        if constexpr (Format == SampleFormat::float32) {
+            float value;
+            std::memcpy(&value, input, sizeof(value));
+            return value * floatScale;
+        } else if constexpr (Format == SampleFormat::int32) {
+            int32_t value;
+            std::memcpy(&value, input, sizeof(value));
+            return static_cast<float>(value) * intScale;
+        } else {
+            // Little endian, into the upper 3 bytes so it scales like int32
+            const auto bytes = reinterpret_cast<const unsigned char*>(input);
+            const auto value = static_cast<int32_t>(static_cast<uint32_t>(bytes[0]) << 8 |
+                static_cast<uint32_t>(bytes[1]) << 16 | static_cast<uint32_t>(bytes[2]) << 24);
+            return static_cast<float>(value) * intScale;
+        }
+    }
+
+    template <SampleFormat Format, bool Dither>
+    void convertScalar(const char* input, int16_t* output, size_t samples, DitherState& dither) {
+        if constexpr (Format == SampleFormat::int16) {
+            std::memcpy(output, input, samples * sizeof(int16_t));
+        } else {
+            const auto inputSize = SampleConverter::sampleSize(Format);
+            for (size_t i = 0; i < samples; ++i) {
+                auto value = loadScalar<Format>(input + i * inputSize);
+                if constexpr (Dither) {
+                    value += Quantize::tpdf(dither[0]);
+                }
+                output[i] = Quantize::toInt16(value);
+            }
+        }
+    }
+
+#ifdef SOUNDREMOTE_X86
+    // SSE2: float32 and int32, 8 samples per iteration
+
+    template <SampleFormat Format>
+    SOUNDREMOTE_TARGET_SSE2 __m128 loadSse2(const char* input) {
+        if constexpr (Format == SampleFormat::float32) {
+            return _mm_mul_ps(_mm_loadu_ps(reinterpret_cast<const float*>(input)), _mm_set1_ps(floatScale));
+        } else {
+            const auto samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+            return _mm_mul_ps(_mm_cvtepi32_ps(samples), _mm_set1_ps(intScale));
+        }
+    }
+
+    template <SampleFormat Format, bool Dither>
+    SOUNDREMOTE_TARGET_SSE2 void convertSse2(const char* input, int16_t* output, size_t samples, DitherState& dither) {
+        constexpr size_t inputSize = 4;
+        constexpr size_t step = 8;
+        auto state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dither.data()));
+        size_t i = 0;
+        for (; i + step <= samples; i += step) {
+            auto low = loadSse2<Format>(input + i * inputSize);
+            auto high = loadSse2<Format>(input + (i + 4) * inputSize);
+            if constexpr (Dither) {
+                low = _mm_add_ps(low, Quantize::tpdf(state));
+                high = _mm_add_ps(high, Quantize::tpdf(state));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), Quantize::toInt16(low, high));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dither.data()), state);
+        convertScalar<Format, Dither>(input + i * inputSize, output + i, samples - i, dither);
+    }
+
+    // AVX2: float32, int32 and int24, 16 samples per iteration
+
+    template <SampleFormat Format>
+    SOUNDREMOTE_TARGET_AVX2 __m256 loadAvx2(const char* input) {
+        if constexpr (Format == SampleFormat::float32) {
+            return _mm256_mul_ps(_mm256_loadu_ps(reinterpret_cast<const float*>(input)), _mm256_set1_ps(floatScale));
+        } else if constexpr (Format == SampleFormat::int32) {
+            const auto samples = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input));
+            return _mm256_mul_ps(_mm256_cvtepi32_ps(samples), _mm256_set1_ps(intScale));
+        } else {
+            // 4 packed samples of 12 bytes each into the upper 3 bytes of the 32 bit lanes.
+            // Reads 4 bytes past the 8 samples.
+            const auto spread = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+            const auto low = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input)), spread);
+            const auto high = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 12)), spread);
+            const auto samples = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+            return _mm256_mul_ps(_mm256_cvtepi32_ps(samples), _mm256_set1_ps(intScale));
+        }
+    }
+
+    template <SampleFormat Format, bool Dither>
+    SOUNDREMOTE_TARGET_AVX2 void convertAvx2(const char* input, int16_t* output, size_t samples, DitherState& dither) {
+        const size_t inputSize = SampleConverter::sampleSize(Format);
+        constexpr size_t overread = Format == SampleFormat::int24 ? 4 : 0;
+        constexpr size_t step = 16;
+        auto state = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dither.data()));
+        size_t i = 0;
+        for (; (i + step) * inputSize + overread <= samples * inputSize; i += step) {
+            auto low = loadAvx2<Format>(input + i * inputSize);
+            auto high = loadAvx2<Format>(input + (i + 8) * inputSize);
+            if constexpr (Dither) {
+                low = _mm256_add_ps(low, Quantize::tpdf(state));
+                high = _mm256_add_ps(high, Quantize::tpdf(state));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), Quantize::toInt16(low, high));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dither.data()), state);
+        convertScalar<Format, Dither>(input + i * inputSize, output + i, samples - i, dither);
+    }
+#endif
+
+    // Scalar unless specialized for the format and the instruction set
+    template <SampleFormat Format, Isa KernelIsa, bool Dither>
+    struct ConvertKernel {
+        static void convert(const char* input, int16_t* output, size_t samples, DitherState& dither) {
+            convertScalar<Format, Dither>(input, output, samples, dither);
+        }
+    };
+
+#ifdef SOUNDREMOTE_X86
+    template <bool Dither>
+    struct ConvertKernel<SampleFormat::float32, Isa::sse2, Dither> {
+        static void convert(const char* input, int16_t* output, size_t samples, DitherState& dither) {
+            convertSse2<SampleFormat::float32, Dither>(input, output, samples, dither);
+        }
+    };
+
+    template <bool Dither>
+    struct ConvertKernel<SampleFormat::int32, Isa::sse2, Dither> {
+        static void convert(const char* input, int16_t* output, size_t samples, DitherState& dither) {
+            convertSse2<SampleFormat::int32, Dither>(input, output, samples, dither);
+        }
+    };
+
+    template <bool Dither>
+    struct ConvertKernel<SampleFormat::float32, Isa::avx2, Dither> {
+        static void convert(const char* input, int16_t* output, size_t samples, DitherState& dither) {
+            convertAvx2<SampleFormat::float32, Dither>(input, output, samples, dither);
+        }
+    };
+
+    template <bool Dither>
+    struct ConvertKernel<SampleFormat::int32, Isa::avx2, Dither> {
+        static void convert(const char* input, int16_t* output, size_t samples, DitherState& dither) {
+            convertAvx2<SampleFormat::int32, Dither>(input, output, samples, dither);
+        }
+    };
+
+    template <bool Dither>
+    struct ConvertKernel<SampleFormat::int24, Isa::avx2, Dither> {
+        static void convert(const char* input, int16_t* output, size_t samples, DitherState& dither) {
+            convertAvx2<SampleFormat::int24, Dither>(input, output, samples, dither);
+        }
+    };
+#endif
+
+    template <SampleFormat Format, bool Dither>
+    SampleConverter::Kernel kernelFor(Isa isa) {
+        switch (isa) {
+        case Isa::avx2:
+            return &ConvertKernel<Format, Isa::avx2, Dither>::convert;
+        case Isa::sse2:
+            return &ConvertKernel<Format, Isa::sse2, Dither>::convert;
+        default:
+            return &ConvertKernel<Format, Isa::scalar, Dither>::convert;
+        }
+    }
+
+    template <SampleFormat Format>
+    SampleConverter::Kernel kernelFor(bool dither, Isa isa) {
+        return dither ? kernelFor<Format, true>(isa) : kernelFor<Format, false>(isa);
+    }
+
+    SampleConverter::Kernel kernelFor(SampleFormat format, bool dither, Isa isa) {
+        switch (format) {
+        case SampleFormat::int16:
+            return kernelFor<SampleFormat::int16, false>(isa);
+        case SampleFormat::int24:
+            return kernelFor<SampleFormat::int24>(dither, isa);
+        case SampleFormat::int32:
+            return kernelFor<SampleFormat::int32>(dither, isa);
+        case SampleFormat::float32:
+            return kernelFor<SampleFormat::float32>(dither, isa);
+        default:
+            throw std::invalid_argument("SampleConverter: unsupported sample format");
+        }
+    }
+}
+
+SampleConverter::SampleConverter(SampleFormat format, bool dither, Isa isa) :
+    format_(format),
+    isa_(isa),
+    kernel_(kernelFor(format, dither, isa)) {
+    // xorshift needs non-zero seeds, different lanes get different sequences
+    for (size_t i = 0; i < dither_.size(); ++i) {
+        dither_[i] = 0x9E3779B9u * static_cast<uint32_t>(i + 1);
+    }
+}
+
+size_t SampleConverter::convert(std::span<const char> input, std::span<int16_t> output) {
+    const auto samples = std::min(sampleCount(input.size()), output.size());
+    kernel_(input.data(), output.data(), samples, dither_);
+    return samples;
+}
+
+size_t SampleConverter::sampleCount(size_t bytes) const {
+    return bytes / sampleSize(format_);
+}
+
+SampleFormat SampleConverter::format() const {
+    return format_;
+}
+
+SampleConverter::Isa SampleConverter::isa() const {
+    return isa_;
+}
+
+size_t SampleConverter::sampleSize(SampleFormat format) {
+    switch (format) {
+    case SampleFormat::int16:
+        return 2;
+    case SampleFormat::int24:
+        return 3;
+    case SampleFormat::int32:
+    case SampleFormat::float32:
+        return 4;
+    default:
+        return 0;
+    }
+}
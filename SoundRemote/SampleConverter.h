@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "Simd.h"
+
+/// <summary>
+/// Sample formats the <c>SampleConverter</c> takes.
+/// </summary>
+enum class SampleFormat {
+	unsupported,
+	int16,
+	// Packed 3 byte samples
+	int24,
+	int32,
+	float32
+};
+
+/// <summary>
+/// Converts interleaved samples to 16 bit signed int, clamping the values out of range and optionally adding
+/// triangular (TPDF) dither. The kernel for the format and the instruction set is picked once on construction.
+/// Has no platform dependencies besides the x86 intrinsics, the other architectures use the scalar kernels.
+/// </summary>
+class SampleConverter {
+public:
+	using Isa = Simd::Isa;
+
+	/// <summary>
+	/// Creates a converter.
+	/// </summary>
+	/// <param name="format">- format of the input samples, other than <c>SampleFormat::unsupported</c></param>
+	/// <param name="dither">- add dither of ±1 LSB of the output, doesn't apply to the int16 input</param>
+	/// <param name="isa">- instruction set to use, must be supported by the CPU</param>
+	SampleConverter(SampleFormat format, bool dither, Isa isa = Simd::bestIsa());
+
+	/// <summary>
+	/// Converts the whole samples of the input.
+	/// </summary>
+	/// <param name="input">- interleaved samples, a partial sample at the end is ignored</param>
+	/// <param name="output">- converted samples, must hold <c>sampleCount(input.size())</c> samples</param>
+	/// <returns>Number of the converted samples.</returns>
+	size_t convert(std::span<const char> input, std::span<int16_t> output);
+	/// <summary>
+	/// Gets the number of the whole samples in the bytes of the input format.
+	/// </summary>
+	size_t sampleCount(size_t bytes) const;
+	SampleFormat format() const;
+	Isa isa() const;
+
+	/// <summary>
+	/// Gets the size of a sample in bytes, 0 for <c>SampleFormat::unsupported</c>.
+	/// </summary>
+	static size_t sampleSize(SampleFormat format);
+
+	// Per lane state of the dither random generators, enough lanes for the widest kernel
+	using DitherState = std::array<uint32_t, 8>;
+	using Kernel = void (*)(const char* input, int16_t* output, size_t samples, DitherState& dither);
+private:
+	const SampleFormat format_;
+	const Isa isa_;
+	const Kernel kernel_;
+	DitherState dither_;
+};
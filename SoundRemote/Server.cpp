@@ -1,7 +1,10 @@
 #include "Server.h"
 
+#include <algorithm>
+
 #include <boost/asio/co_spawn.hpp>
 #include <boost/asio/detached.hpp>
+#include <boost/asio/ip/multicast.hpp>
 
 #include "Clients.h"
 #include "NetUtil.h"
@@ -15,13 +18,74 @@ using boost::asio::use_awaitable;
 using namespace std::chrono_literals;
 using namespace std::placeholders;
 
-Server::Server(int clientPort, int serverPort, boost::asio::io_context& ioContext, std::shared_ptr<Clients> clients) :
+namespace {
+    constexpr auto maintenanceInterval = 1s;
+    // Maintenance ticks per probe of the clients getting the audio
+    constexpr uint64_t probeTicksWhileSending = 5;
+    // Longer echoes are stale or garbled, the client would have timed out anyway
+    constexpr auto maxRoundTrip = 5s;
+    // Retransmits a client gets per second at most, a fifth of the stream of the 10 ms frames
+    constexpr double retransmitRate = 20.0;
+    constexpr double retransmitBurst = 10.0;
+    // Batches waiting for the socket at most, a few frames of every compression
+    constexpr size_t maxPendingSends = 32;
+    // Audio delayed longer is late for the clients, so a batch waiting longer is dropped
+    constexpr auto pendingSendTimeout = 100ms;
+
+    Net::Packet::TimestampType timestampOf(std::chrono::steady_clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    }
+
+    Net::Packet::Category audioCategory(Audio::Compression compression) {
+        return compression == Audio::Compression::none ?
+            Net::Packet::Category::AudioDataUncompressed :
+            Net::Packet::Category::AudioDataOpus;
+    }
+
+    std::array<boost::asio::const_buffer, 3> datagramOf(const Net::AudioPacket& packet) {
+        return {
+            boost::asio::const_buffer(packet.header.data(), packet.header.size()),
+            boost::asio::const_buffer(packet.sequenceNumber.data(), packet.sequenceNumber.size()),
+            boost::asio::const_buffer(packet.audioData.data(), packet.audioData.size_bytes())
+        };
+    }
+}
+
+Server::Server(int clientPort, int serverPort, boost::asio::io_context& ioContext, std::shared_ptr<Clients> clients,
+    std::optional<boost::asio::ip::address_v4> multicastInterface, int parityGroupSize, size_t retransmitPackets) :
     clientPort_(clientPort),
     clients_(clients),
     socketSend_(ioContext, udp::v4()),
     socketReceive_(ioContext, udp::endpoint(udp::v4(), serverPort)),
     socketBroadcast_(ioContext, udp::v4()),
-    maintainenanceTimer_(ioContext) {
+    maintainenanceTimer_(ioContext),
+    batchSender_(socketSend_) {
+
+    socketSend_.non_blocking(true);
+    if (multicastInterface) {
+        // Keep the groups within the local network, deliver to the clients on this host as well.
+        // The interface is set, as the default one is picked by the routes and may be a VPN or a virtual adapter.
+        boost::system::error_code ec;
+        socketSend_.set_option(boost::asio::ip::multicast::outbound_interface(*multicastInterface), ec);
+        if (!ec) {
+            socketSend_.set_option(boost::asio::ip::multicast::hops(1), ec);
+        }
+        if (!ec) {
+            socketSend_.set_option(boost::asio::ip::multicast::enable_loopback(true), ec);
+        }
+        multicast_ = !ec;
+    }
+    if (parityGroupSize >= 2 && parityGroupSize <= static_cast<int>(ParityEncoder::maxSpan)) {
+        for (auto compression : Audio::compressions) {
+            parityEncoders_[Audio::compressionIndex(compression)] = std::make_unique<ParityEncoder>(parityGroupSize);
+        }
+    }
+    if (retransmitPackets > 0) {
+        for (auto compression : Audio::compressions) {
+            retransmitRings_[Audio::compressionIndex(compression)] = std::make_unique<RetransmitRing>(
+                std::min(retransmitPackets, RetransmitRing::maxCapacity));
+        }
+    }
 
     socketBroadcast_.set_option(udp::socket::reuse_address(true));
     socketBroadcast_.set_option(boost::asio::socket_base::broadcast(true));
@@ -39,41 +103,177 @@ Server::~Server() {
     socketBroadcast_.close();
 }
 
-void Server::onClientsUpdate(std::forward_list<ClientInfo> clients) {
-    std::unordered_map<Audio::Compression, std::forward_list<Net::Address>> newClients;
-    for (auto&& client: clients) {
-        if (!newClients.contains(client.compression)) {
-            newClients[client.compression] = std::forward_list<Net::Address>();
+void Server::onClientsSnapshot(const std::forward_list<ClientInfo>& clients, uint64_t version) {
+    const auto previous = clientsCache_.load();
+    clientsCache_.store(EndpointTable::build(clients, clientPort_, previous.get()));
+}
+
+void Server::onClientsDelta(const ClientsDelta& delta) {
+    clientsCache_.store(clientsCache_.load()->apply(delta, clientPort_));
+}
+
+void Server::sendAudio(
+    Audio::Compression compression,
+    Net::Packet::SequenceNumberType sequenceNumber,
+    const PacketPtr& audioData
+) {
+    const std::span<const char> audio(audioData->data(), audioData->size());
+    const auto packet = Net::makeAudioPacket(audioCategory(compression), sequenceNumber, audio);
+    const auto datagram = datagramOf(packet);
+    const auto clients = clientsCache_.load();
+    const auto& group = clients->group(compression);
+    lastAudioSent_[Audio::compressionIndex(compression)] = std::chrono::steady_clock::now();
+    sendToClients(group.unicast, compression, datagram);
+    if (!group.multicast.empty()) {
+        sendMulticast(group, compression, datagram);
+    }
+    addToParity(group, compression, sequenceNumber, audio);
+    keepForRetransmit(group, compression, sequenceNumber, audioData);
+    addToAggregates(group, compression, sequenceNumber, audioData);
+}
+
+void Server::sendMulticast(
+    const EndpointTable::Group& group,
+    Audio::Compression compression,
+    std::span<const boost::asio::const_buffer> datagram
+) {
+    if (multicast_) {
+        const std::array groupDestination{ udp::endpoint(Net::multicastGroup(compression), clientPort_) };
+        boost::system::error_code ec;
+        sendBatch(groupDestination, datagram, clients_->compressionCounters(compression), ec);
+        if (!ec) {
+            // Every member gets the one datagram sent to the group
+            const auto size = boost::asio::buffer_size(datagram);
+            for (auto&& counters : group.multicast.counters) {
+                if (counters) { counters->countSent(1, size); }
+            }
+            const auto members = group.multicast.endpoints.size();
+            clients_->compressionCounters(compression).countSent(members, members * size);
+            return;
+        }
+        // No multicast route or similar, the clients keep getting the audio by unicast
+        multicast_ = false;
+    }
+    sendToClients(group.multicast, compression, datagram);
+}
+
+void Server::sendSilence(Audio::Compression compression, Net::Packet::SequenceNumberType sequenceNumber) {
+    const auto clients = clientsCache_.load();
+    const auto& group = clients->group(compression);
+    if (const auto& encoder = parityEncoders_[Audio::compressionIndex(compression)]) {
+        if (const auto parity = encoder->flush(); parity && !group.parity.empty()) {
+            sendParity(group, compression, *parity);
         }
-        newClients[client.compression].push_front(client.address);
     }
-    clientsCache_ = std::move(newClients);
+    flushAggregates(group, compression);
+    if (group.silenceAware.empty()) { return; }
+    const auto packet = Net::createSilencePacket(sequenceNumber);
+    const std::array datagram{ boost::asio::const_buffer(packet.data(), packet.size()) };
+    sendToClients(group.silenceAware, compression, datagram);
 }
 
-void Server::sendAudio(
+void Server::addToParity(
+    const EndpointTable::Group& group,
+    Audio::Compression compression,
+    Net::Packet::SequenceNumberType sequenceNumber,
+    std::span<const char> audioData
+) {
+    const auto& encoder = parityEncoders_[Audio::compressionIndex(compression)];
+    if (!encoder) { return; }
+    // Without the clients the group is dropped, so the next one starts with them
+    if (group.parity.empty()) {
+        encoder->flush();
+        return;
+    }
+    if (const auto parity = encoder->add(sequenceNumber, audioData)) {
+        sendParity(group, compression, *parity);
+    }
+}
+
+void Server::sendParity(const EndpointTable::Group& group, Audio::Compression compression, const ParityGroup& parity) {
+    const auto packet = Net::makeParityPacket(parity);
+    const std::array datagram{
+        boost::asio::const_buffer(packet.header.data(), packet.header.size()),
+        boost::asio::const_buffer(packet.parity.data(), packet.parity.size_bytes())
+    };
+    sendToClients(group.parity, compression, datagram);
+}
+
+void Server::addToAggregates(
+    const EndpointTable::Group& group,
+    Audio::Compression compression,
+    Net::Packet::SequenceNumberType sequenceNumber,
+    const PacketPtr& audioData
+) {
+    auto& aggregators = aggregators_[Audio::compressionIndex(compression)];
+    for (size_t frames = 2; frames < aggregators.size(); ++frames) {
+        auto& aggregator = aggregators[frames];
+        const auto& destinations = group.aggregated[frames];
+        // Without the clients the frames are dropped, so the next ones start with a new packet
+        if (destinations.empty()) {
+            aggregator.reset();
+            continue;
+        }
+        if (!aggregator) {
+            aggregator = std::make_unique<FrameAggregator>(compression, frames);
+        }
+        if (const auto packet = aggregator->add(sequenceNumber, audioData)) {
+            sendAggregated(destinations, compression, *packet);
+        }
+    }
+}
+
+void Server::flushAggregates(const EndpointTable::Group& group, Audio::Compression compression) {
+    auto& aggregators = aggregators_[Audio::compressionIndex(compression)];
+    for (size_t frames = 2; frames < aggregators.size(); ++frames) {
+        if (!aggregators[frames]) { continue; }
+        const auto& destinations = group.aggregated[frames];
+        if (const auto packet = aggregators[frames]->flush(); packet && !destinations.empty()) {
+            sendAggregated(destinations, compression, *packet);
+        }
+    }
+}
+
+void Server::sendAggregated(
+    const EndpointTable::Destinations& destinations,
+    Audio::Compression compression,
+    const AggregatedPacket& packet
+) {
+    const auto audioPacket = Net::makeAudioPacket(audioCategory(compression), packet.first, packet.audioData);
+    sendToClients(destinations, compression, datagramOf(audioPacket));
+}
+
+void Server::keepForRetransmit(
+    const EndpointTable::Group& group,
     Audio::Compression compression,
     Net::Packet::SequenceNumberType sequenceNumber,
-    std::vector<char> data
+    const PacketPtr& audioData
 ) {
-    auto category = compression == Audio::Compression::none ?
-        Net::Packet::Category::AudioDataUncompressed :
-        Net::Packet::Category::AudioDataOpus;
-    auto packet = std::make_shared<std::vector<char>>(
-        Net::createAudioPacket(category, sequenceNumber, { data.data(), data.size() })
-    );
-    for (auto&& address : clientsCache_[compression]) {
-        send(address, packet);
+    const auto& ring = retransmitRings_[Audio::compressionIndex(compression)];
+    if (!ring) { return; }
+    // Gives the buffers back to their pools
+    if (group.retransmit.empty()) {
+        ring->clear();
+        return;
     }
+    ring->store(sequenceNumber, audioData);
 }
 
 void Server::sendDisconnectBlocking() {
-    if (clientsCache_.empty()) { return; }
-    auto destination = udp::endpoint(udp::v4(), clientPort_);
+    const auto clients = clientsCache_.load();
+    if (clients->empty()) { return; }
+    socketSend_.non_blocking(false);
     auto packet = std::make_shared<std::vector<char>>(Net::createDisconnectPacket());
-    for (auto&& [compression, addresses] : clientsCache_) {
-        for (auto&& address : addresses) {
-            destination.address(address);
-            socketSend_.send_to(boost::asio::buffer(packet->data(), packet->size()), destination);
+    for (auto&& group : clients->groups()) {
+        for (auto&& destinations : { std::cref(group->unicast), std::cref(group->multicast) }) {
+            for (auto&& destination : destinations.get().endpoints) {
+                socketSend_.send_to(boost::asio::buffer(packet->data(), packet->size()), destination);
+            }
+        }
+        for (auto&& destinations : group->aggregated) {
+            for (auto&& destination : destinations.endpoints) {
+                socketSend_.send_to(boost::asio::buffer(packet->data(), packet->size()), destination);
+            }
         }
     }
 }
@@ -106,7 +306,13 @@ awaitable<void> Server::receive(udp::socket& socket) {
                 processKeystroke(receivedData);
                 break;
             case Net::Packet::Category::ClientKeepAlive:
-                processKeepAlive(sender.address());
+                processKeepAlive(sender.address(), receivedData);
+                break;
+            case Net::Packet::Category::LossReport:
+                processLossReport(sender.address(), receivedData);
+                break;
+            case Net::Packet::Category::Nack:
+                processNack(sender.address(), receivedData);
                 break;
             default:
                 break;
@@ -134,10 +340,15 @@ void Server::processConnect(const Net::Address& address, const std::span<char>&
     if (!connectData) { return; }
     auto compression = Net::compressionFromNetworkValue(connectData->compression);
     if (!compression) { return; }
-    clients_->add(address, *compression);
+    const auto protocol = std::min(connectData->protocol, Net::protocolVersion);
+    const auto parity = protocol >= Net::Protocol::parity &&
+        (connectData->options & Net::Packet::ConnectOption::parity) != 0;
+    const auto framesPerPacket = protocol >= Net::Protocol::aggregation ?
+        std::clamp<int>(connectData->framesPerPacket, 1, Net::Packet::maxFramesPerPacket) : 1;
+    clients_->add(address, *compression, protocol, parity, framesPerPacket);
 
     send(address, std::make_shared<std::vector<char>>(
-        Net::createAckConnectPacket(connectData->requestId)
+        Net::createAckConnectPacket(connectData->requestId, protocol, multicastGroupFor(address, *compression))
     ));
 }
 
@@ -150,10 +361,12 @@ void Server::processSetFormat(const Net::Address& address, const std::span<char>
     if (!setFormatData) { return; }
     auto compression = Net::compressionFromNetworkValue(setFormatData->compression);
     if (!compression) { return; }
-    clients_->setCompression(address, *compression);
+    // The older clients don't send it, so they get one frame per packet
+    clients_->setCompression(address, *compression,
+        std::clamp<int>(setFormatData->framesPerPacket, 1, Net::Packet::maxFramesPerPacket));
 
     send(address, std::make_shared<std::vector<char>>(
-        Net::createAckSetFormatPacket(setFormatData->requestId)
+        Net::createAckSetFormatPacket(setFormatData->requestId, multicastGroupFor(address, *compression))
     ));
 }
 
@@ -166,13 +379,67 @@ void Server::processKeystroke(const std::span<char>& packet) const {
     }
 }
 
-void Server::processKeepAlive(const Net::Address& address) const {
-    clients_->keep(address);
+void Server::processKeepAlive(const Net::Address& address, const std::span<char>& packet) const {
+    std::optional<std::chrono::microseconds> roundTrip;
+    if (const auto timestamp = Net::getKeepAliveTimestamp(packet)) {
+        const std::chrono::microseconds elapsed(
+            static_cast<int64_t>(timestampOf(std::chrono::steady_clock::now()) - *timestamp));
+        if (elapsed >= 0us && elapsed <= maxRoundTrip) {
+            roundTrip = elapsed;
+        }
+    }
+    clients_->keep(address, roundTrip);
+}
+
+void Server::processLossReport(const Net::Address& address, const std::span<char>& packet) const {
+    const auto report = Net::getLossReportData(packet);
+    if (!report) { return; }
+    const auto lowest = Net::compressionFromNetworkValue(report->minCompression);
+    if (!lowest) { return; }
+    // The members of a multicast group share its stream, so only the FEC adapts to their loss
+    clients_->reportLoss(address, report->received, report->lost,
+        isMulticastMember(address) ? Audio::Compression::none : *lowest);
+}
+
+bool Server::isMulticastMember(const Net::Address& address) const {
+    if (!multicast_) { return false; }
+    const udp::endpoint endpoint(address, clientPort_);
+    const auto clients = clientsCache_.load();
+    return std::ranges::any_of(clients->groups(), [&endpoint](const EndpointTable::Group* group) {
+        return group->multicast.contains(endpoint);
+    });
+}
+
+void Server::processNack(const Net::Address& address, const std::span<char>& packet) {
+    // The rings are made for all the compressions or for none
+    if (!retransmitRings_.front()) { return; }
+    const auto sequenceNumbers = Net::getNackSequenceNumbers(packet);
+    if (sequenceNumbers.empty()) { return; }
+    const udp::endpoint endpoint(address, clientPort_);
+    const auto clients = clientsCache_.load();
+    for (auto&& group : clients->groups()) {
+        const auto index = group->retransmit.indexOf(endpoint);
+        if (!index) { continue; }
+        const auto& ring = *retransmitRings_[Audio::compressionIndex(group->compression)];
+        const auto now = TokenBucket::Clock::now();
+        auto& budget = retransmitBudgets_.try_emplace(address, retransmitRate, retransmitBurst, now).first->second;
+        const std::array destination{ endpoint };
+        const std::array counters{ group->retransmit.counters[*index] };
+        auto& compressionCounters = clients_->compressionCounters(group->compression);
+        for (auto sequenceNumber : sequenceNumbers) {
+            const auto audioData = ring.find(sequenceNumber);
+            if (!audioData) { continue; }
+            if (!budget.tryTake(now)) { return; }
+            const auto resent = Net::makeAudioPacket(audioCategory(group->compression), sequenceNumber,
+                { audioData->data(), audioData->size() });
+            sendToClients(destination, counters, compressionCounters, datagramOf(resent));
+        }
+        return;
+    }
 }
 
 void Server::send(const Net::Address& address, const std::shared_ptr<std::vector<char>> packet) {
-    auto destination = udp::endpoint(address, clientPort_);
-    destination.address(address);
+    const udp::endpoint destination(address, clientPort_);
     socketSend_.async_send_to(boost::asio::buffer(packet->data(), packet->size()), destination,
         std::bind(&Server::handleSend, this, packet, _1, _2));
 }
@@ -184,8 +451,175 @@ void Server::handleSend(const std::shared_ptr<std::vector<char>> packet, const b
     }
 }
 
+void Server::sendToClients(
+    const EndpointTable::Destinations& destinations,
+    Audio::Compression compression,
+    std::span<const boost::asio::const_buffer> datagram
+) {
+    sendToClients(destinations.endpoints, destinations.counters, clients_->compressionCounters(compression), datagram);
+}
+
+void Server::sendToClients(
+    std::span<const udp::endpoint> endpoints,
+    std::span<const std::shared_ptr<TrafficCounters>> counters,
+    TrafficCounters& compressionCounters,
+    std::span<const boost::asio::const_buffer> datagram
+) {
+    if (endpoints.empty()) { return; }
+    if (pendingSends_.empty()) {
+        boost::system::error_code ec;
+        const auto handled = sendCounted(endpoints, counters, compressionCounters, datagram, ec);
+        if (!ec) { return; }
+        endpoints = endpoints.subspan(handled);
+        counters = counters.subspan(handled);
+    }
+    // The datagram parts may not outlive this call, so the rest of the batch gets a copy.
+    std::vector<char> copy(boost::asio::buffer_size(datagram));
+    boost::asio::buffer_copy(boost::asio::buffer(copy), datagram);
+    queuePending({
+        { endpoints.begin(), endpoints.end() },
+        { counters.begin(), counters.end() },
+        &compressionCounters,
+        std::move(copy),
+        std::chrono::steady_clock::now()
+    });
+}
+
+size_t Server::sendCounted(
+    std::span<const udp::endpoint> endpoints,
+    std::span<const std::shared_ptr<TrafficCounters>> counters,
+    TrafficCounters& compressionCounters,
+    std::span<const boost::asio::const_buffer> datagram,
+    boost::system::error_code& ec
+) {
+    const auto size = boost::asio::buffer_size(datagram);
+    size_t next = 0;
+    while (next < endpoints.size()) {
+        const auto sent = batchSender_.send(datagram, endpoints.subspan(next), ec);
+        for (auto&& clientCounters : counters.subspan(next, sent)) {
+            if (clientCounters) { clientCounters->countSent(1, size); }
+        }
+        compressionCounters.countSent(sent, sent * size);
+        next += sent;
+        if (!ec || ec == boost::asio::error::would_block) { break; }
+        // Unreachable client or similar, skip it
+        if (counters[next]) { counters[next]->countSendError(); }
+        compressionCounters.countSendError();
+        ++next;
+        ec.clear();
+    }
+    return next;
+}
+
+void Server::sendBatch(
+    std::span<const udp::endpoint> destinations,
+    std::span<const boost::asio::const_buffer> datagram,
+    TrafficCounters& compressionCounters,
+    boost::system::error_code& ec
+) {
+    ec.clear();
+    if (destinations.empty()) { return; }
+    size_t sent = 0;
+    if (pendingSends_.empty()) {
+        sent = batchSender_.send(datagram, destinations, ec);
+        if (ec != boost::asio::error::would_block) { return; }
+        ec.clear();
+    }
+    // The datagram parts may not outlive this call, so the rest of the batch gets a copy.
+    std::vector<char> copy(boost::asio::buffer_size(datagram));
+    boost::asio::buffer_copy(boost::asio::buffer(copy), datagram);
+    queuePending({
+        { destinations.begin() + sent, destinations.end() },
+        {},
+        &compressionCounters,
+        std::move(copy),
+        std::chrono::steady_clock::now()
+    });
+}
+
+void Server::queuePending(PendingSend pending) {
+    if (pendingSends_.size() == maxPendingSends) {
+        // The socket doesn't keep up, the oldest audio is the least worth sending
+        dropPending(pendingSends_.front());
+        pendingSends_.pop_front();
+    }
+    pendingSends_.push_back(std::move(pending));
+    if (!waitingWritable_) {
+        waitWritable();
+    }
+}
+
+void Server::waitWritable() {
+    waitingWritable_ = true;
+    socketSend_.async_wait(udp::socket::wait_write, std::bind(&Server::resumePending, this, _1));
+}
+
+void Server::resumePending(const boost::system::error_code& ec) {
+    waitingWritable_ = false;
+    if (ec) {
+        if (ec == boost::asio::error::operation_aborted) { return; }
+        throw std::runtime_error(Util::makeAppErrorText("Server send", ec.what()));
+    }
+    const auto staleBefore = std::chrono::steady_clock::now() - pendingSendTimeout;
+    while (!pendingSends_.empty()) {
+        auto& pending = pendingSends_.front();
+        if (pending.queued < staleBefore) {
+            dropPending(pending);
+            pendingSends_.pop_front();
+            continue;
+        }
+        const std::array datagram{ boost::asio::const_buffer(pending.datagram.data(), pending.datagram.size()) };
+        boost::system::error_code sendEc;
+        size_t handled = 0;
+        if (pending.counters.empty()) {
+            handled = batchSender_.send(datagram, pending.endpoints, sendEc);
+            // Nobody is there to take the error of the rest, so it's counted like in sendToClients
+            // and the rest is dropped like sendBatch does
+            if (sendEc && sendEc != boost::asio::error::would_block) {
+                pending.compressionCounters->countSendError();
+                handled = pending.endpoints.size();
+                sendEc.clear();
+            }
+        } else {
+            handled = sendCounted(pending.endpoints, pending.counters, *pending.compressionCounters, datagram, sendEc);
+        }
+        if (sendEc) {
+            pending.endpoints.erase(pending.endpoints.begin(), pending.endpoints.begin() + handled);
+            if (!pending.counters.empty()) {
+                pending.counters.erase(pending.counters.begin(), pending.counters.begin() + handled);
+            }
+            waitWritable();
+            return;
+        }
+        pendingSends_.pop_front();
+    }
+}
+
+void Server::dropPending(const PendingSend& pending) {
+    if (pending.counters.empty()) {
+        pending.compressionCounters->countSendError();
+        return;
+    }
+    for (auto&& clientCounters : pending.counters) {
+        if (clientCounters) { clientCounters->countSendError(); }
+        pending.compressionCounters->countSendError();
+    }
+}
+
+std::optional<boost::asio::ip::address_v4> Server::multicastGroupFor(
+    const Net::Address& address,
+    Audio::Compression compression
+) {
+    if (!multicast_) { return {}; }
+    const auto clients = clientsCache_.load();
+    const auto& destinations = clients->group(compression).multicast;
+    const auto isMember = destinations.contains(udp::endpoint(address, clientPort_));
+    if (!isMember) { return {}; }
+    return Net::multicastGroup(compression);
+}
+
 void Server::startMaintenanceTimer() {
-    maintainenanceTimer_.expires_after(1s);
+    maintainenanceTimer_.expires_after(maintenanceInterval);
     maintainenanceTimer_.async_wait(std::bind(&Server::maintain, this, std::placeholders::_1));
 }
 
@@ -200,17 +634,41 @@ void Server::maintain(boost::system::error_code ec) {
     keepalive();
     advertise();
     clients_->maintain();
+    dropRetransmitBudgets();
 
     startMaintenanceTimer();
 }
 
+void Server::dropRetransmitBudgets() {
+    if (retransmitBudgets_.empty()) { return; }
+    const auto clients = clientsCache_.load();
+    std::erase_if(retransmitBudgets_, [&](const auto& budget) {
+        const udp::endpoint endpoint(budget.first, clientPort_);
+        return std::ranges::none_of(clients->groups(), [&](const EndpointTable::Group* group) {
+            return group->retransmit.contains(endpoint);
+        });
+    });
+}
+
 void Server::keepalive() {
-    if (clientsCache_.empty()) { return; }
-    auto packet = std::make_shared<std::vector<char>>(Net::createKeepAlivePacket());
-    for (auto&& [compression, addresses] : clientsCache_) {
-        for (auto&& address : addresses) {
-            send(address, packet);
+    const auto clients = clientsCache_.load();
+    if (clients->empty()) { return; }
+    const auto packet = Net::createKeepAlivePacket();
+    const std::array datagram{ boost::asio::const_buffer(packet.data(), packet.size()) };
+    const auto now = std::chrono::steady_clock::now();
+    const auto probePacket = Net::createKeepAlivePacket(timestampOf(now));
+    const std::array probeDatagram{ boost::asio::const_buffer(probePacket.data(), probePacket.size()) };
+    const bool probeWhileSending = ++keepaliveTicks_ % probeTicksWhileSending == 0;
+    for (auto&& group : clients->groups()) {
+        // The audio keeps the clients alive, so the probes only keep the round-trip times current
+        if (now - lastAudioSent_[Audio::compressionIndex(group->compression)] < maintenanceInterval) {
+            if (probeWhileSending) {
+                sendToClients(group->probed, group->compression, probeDatagram);
+            }
+            continue;
         }
+        sendToClients(group->probed, group->compression, probeDatagram);
+        sendToClients(group->unprobed, group->compression, datagram);
     }
 }
 
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <forward_list>
 #include <memory>
+#include <optional>
 #include <span>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/asio/awaitable.hpp>
 #include <boost/asio/io_context.hpp>
@@ -11,24 +17,61 @@
 #include <boost/asio/steady_timer.hpp>
 
 #include "AudioUtil.h"
+#include "BatchSender.h"
+#include "EndpointTable.h"
+#include "FrameAggregator.h"
 #include "Keystroke.h"
 #include "NetDefines.h"
+#include "PacketPool.h"
+#include "ParityEncoder.h"
+#include "RetransmitRing.h"
+#include "TokenBucket.h"
 
 class Clients;
 struct ClientInfo;
+struct ClientsDelta;
 
 class Server {
 public:
 	using KeystrokeCallback = std::function<void(const Keystroke& keystroke)>;
 
-	Server(int clientPort, int serverPort, boost::asio::io_context& ioContext, std::shared_ptr<Clients> clients);
+	/// <param name="multicastInterface">Address of the local interface to send the audio from once per compression
+	/// to a multicast group instead of to each client, for the clients supporting it. Empty to send by unicast only.
+	/// Falls back to unicast if the socket can't send multicast.</param>
+	/// <param name="parityGroupSize">Audio packets per parity packet for the clients opting in for the parity,
+	/// from 2 to <c>ParityEncoder::maxSpan</c>. Other values disable the parity.</param>
+	/// <param name="retransmitPackets">Audio packets of each compression kept for resending to the clients
+	/// reporting them lost, capped at <c>RetransmitRing::maxCapacity</c>. 0 disables the retransmits.</param>
+	Server(int clientPort, int serverPort, boost::asio::io_context& ioContext, std::shared_ptr<Clients> clients,
+		std::optional<boost::asio::ip::address_v4> multicastInterface = std::nullopt, int parityGroupSize = 0,
+		size_t retransmitPackets = 0);
 	~Server();
-	void onClientsUpdate(std::forward_list<ClientInfo> clients);
+	void onClientsSnapshot(const std::forward_list<ClientInfo>& clients, uint64_t version);
+	void onClientsDelta(const ClientsDelta& delta);
+	/// <summary>
+	/// Sends audio data to all the clients using the compression.
+	/// The packet header and the audio data are gathered into a datagram without copying.
+	/// The parity of the compression's stream is made once and sent to the clients opting in for it.
+	/// The packet is kept for the retransmits while there are clients of the compression asking for them.
+	/// The clients getting several frames per packet get it combined with the next frames, made once for each
+	/// frames per packet in use.
+	/// </summary>
+	/// <param name="compression">Compression of the audio data</param>
+	/// <param name="sequenceNumber">Sequence number</param>
+	/// <param name="audioData">Audio data, not empty. Kept without copying, so it must not be changed.</param>
 	void sendAudio(
 		Audio::Compression compression,
 		Net::Packet::SequenceNumberType sequenceNumber,
-		std::vector<char> data
+		const PacketPtr& audioData
 	);
+	/// <summary>
+	/// Tells the clients using the compression that the frames up to the sequence number they haven't got
+	/// are silence. Only the clients supporting <c>Net::Protocol::silence</c> get it, the rest get nothing.
+	/// The parity of the packets sent before the silence and the incomplete multi-frame packets go out right away.
+	/// </summary>
+	/// <param name="compression">Compression of the skipped audio</param>
+	/// <param name="sequenceNumber">Sequence number of the last silent frame</param>
+	void sendSilence(Audio::Compression compression, Net::Packet::SequenceNumberType sequenceNumber);
 	/*
 	* Sends disconnect packet to all the clients blocking the current thread.
 	*
@@ -42,11 +85,116 @@ private:
 	void processDisconnect(const Net::Address& address);
 	void processSetFormat(const Net::Address& address, const std::span<char>& packet);
 	void processKeystroke(const std::span<char>& packet) const;
-	void processKeepAlive(const Net::Address& address) const;
+	void processKeepAlive(const Net::Address& address, const std::span<char>& packet) const;
+	void processLossReport(const Net::Address& address, const std::span<char>& packet) const;
+	// Checks if the client gets the audio through a multicast group, not by unicast
+	bool isMulticastMember(const Net::Address& address) const;
+	// Resends the listed packets still in the ring of the client's compression, within its rate limit
+	void processNack(const Net::Address& address, const std::span<char>& packet);
 	void send(const Net::Address& address, const std::shared_ptr<std::vector<char>> packet);
 	void handleSend(const std::shared_ptr<std::vector<char>> packet, const boost::system::error_code& ec, std::size_t bytes);
+	// Sends to the members of the group's multicast, by unicast if the multicast fails
+	void sendMulticast(
+		const EndpointTable::Group& group,
+		Audio::Compression compression,
+		std::span<const boost::asio::const_buffer> datagram
+	);
+	// Adds the packet to the parity of the compression, sends the parity of a complete group
+	void addToParity(
+		const EndpointTable::Group& group,
+		Audio::Compression compression,
+		Net::Packet::SequenceNumberType sequenceNumber,
+		std::span<const char> audioData
+	);
+	void sendParity(const EndpointTable::Group& group, Audio::Compression compression, const ParityGroup& parity);
+	// Adds the frame to the multi-frame packets of the compression, sends the complete ones
+	void addToAggregates(
+		const EndpointTable::Group& group,
+		Audio::Compression compression,
+		Net::Packet::SequenceNumberType sequenceNumber,
+		const PacketPtr& audioData
+	);
+	// Sends the incomplete multi-frame packets of the compression
+	void flushAggregates(const EndpointTable::Group& group, Audio::Compression compression);
+	void sendAggregated(
+		const EndpointTable::Destinations& destinations,
+		Audio::Compression compression,
+		const AggregatedPacket& packet
+	);
+	// Keeps the packet for the retransmits, releases the kept ones if no client can ask for them
+	void keepForRetransmit(
+		const EndpointTable::Group& group,
+		Audio::Compression compression,
+		Net::Packet::SequenceNumberType sequenceNumber,
+		const PacketPtr& audioData
+	);
+	/// <summary>
+	/// Sends the datagram to the clients as a single batch, counting the traffic per client and per compression.
+	/// A client the datagram can't be sent to gets a send error counted, the rest of the clients still get it.
+	/// If the socket can't take the whole batch at once, or the earlier batches are still waiting for it,
+	/// the datagram is copied and the rest is queued behind them until the socket becomes writable,
+	/// so the datagram buffers need to stay valid only for the duration of the call.
+	/// </summary>
+	void sendToClients(
+		const EndpointTable::Destinations& destinations,
+		Audio::Compression compression,
+		std::span<const boost::asio::const_buffer> datagram
+	);
+	/// <param name="counters">Counters of the clients, in the same order as the endpoints</param>
+	void sendToClients(
+		std::span<const boost::asio::ip::udp::endpoint> endpoints,
+		std::span<const std::shared_ptr<TrafficCounters>> counters,
+		TrafficCounters& compressionCounters,
+		std::span<const boost::asio::const_buffer> datagram
+	);
+	/// <summary>
+	/// Sends the datagram to the destinations as a single batch like <c>sendToClients</c>, without counting the datagrams sent.
+	/// Stops at the first failed destination and reports the error through <c>ec</c>.
+	/// The error of the rest sent when the socket becomes writable is counted to the compression counters instead.
+	/// </summary>
+	void sendBatch(
+		std::span<const boost::asio::ip::udp::endpoint> destinations,
+		std::span<const boost::asio::const_buffer> datagram,
+		TrafficCounters& compressionCounters,
+		boost::system::error_code& ec
+	);
+	// Rest of a batch waiting for the socket to become writable, with a copy of the datagram
+	struct PendingSend {
+		std::vector<boost::asio::ip::udp::endpoint> endpoints;
+		// Counters of the clients, in the same order as the endpoints. Empty for a batch of sendBatch.
+		std::vector<std::shared_ptr<TrafficCounters>> counters;
+		TrafficCounters* compressionCounters;
+		std::vector<char> datagram;
+		std::chrono::steady_clock::time_point queued;
+	};
+	// Sends the datagram to each client like sendToClients, stops only when the socket would block.
+	// Returns the number of the clients handled, sent to or failed.
+	size_t sendCounted(
+		std::span<const boost::asio::ip::udp::endpoint> endpoints,
+		std::span<const std::shared_ptr<TrafficCounters>> counters,
+		TrafficCounters& compressionCounters,
+		std::span<const boost::asio::const_buffer> datagram,
+		boost::system::error_code& ec
+	);
+	// Queues the batch behind the pending ones, drops the oldest if the socket doesn't keep up
+	void queuePending(PendingSend pending);
+	void waitWritable();
+	// Sends the pending batches in order once the socket becomes writable, drops the stale ones
+	void resumePending(const boost::system::error_code& ec);
+	// Counts the batch as failed for each of its clients
+	void dropPending(const PendingSend& pending);
+	/// <summary>
+	/// Gets the multicast group the client should join to receive the audio with the compression.
+	/// </summary>
+	/// <returns>Group address or an empty optional if the client gets the audio by unicast.</returns>
+	std::optional<boost::asio::ip::address_v4> multicastGroupFor(
+		const Net::Address& address,
+		Audio::Compression compression
+	);
 	void keepalive();
 	void advertise();
+	// Drops the rate limits of the clients that are gone, keeping their number bounded
+	void dropRetransmitBudgets();
 
 	void startMaintenanceTimer();
 	void maintain(boost::system::error_code ec);
@@ -55,8 +203,30 @@ private:
 	boost::asio::ip::udp::socket socketReceive_;
 	boost::asio::ip::udp::socket socketBroadcast_;
 	boost::asio::steady_timer maintainenanceTimer_;
+	BatchSender batchSender_;
+	// Network thread, batches the socket couldn't take yet, oldest first. Nothing is sent past them, so every
+	// client gets the datagrams in order.
+	std::deque<PendingSend> pendingSends_;
+	// Network thread, waiting for the socket to become writable to resume pendingSends_
+	bool waitingWritable_ = false;
 	int clientPort_;
+	// Network thread, cleared when sending to a multicast group fails
+	bool multicast_ = false;
 	KeystrokeCallback keystrokeCallback_;
 	std::shared_ptr<Clients> clients_;
-	std::unordered_map<Audio::Compression, std::forward_list<Net::Address>> clientsCache_;
+	// Network thread, maintenance ticks so far, paces the probes of the clients getting the audio
+	uint64_t keepaliveTicks_ = 0;
+	// Network thread, empty without the parity
+	std::array<std::unique_ptr<ParityEncoder>, Audio::compressionCount> parityEncoders_;
+	// Network thread, indexed by the frames per packet, made for the ones the clients of the compression get
+	std::array<std::array<std::unique_ptr<FrameAggregator>, Net::Packet::maxFramesPerPacket + 1>,
+		Audio::compressionCount> aggregators_;
+	// Network thread, empty without the retransmits
+	std::array<std::unique_ptr<RetransmitRing>, Audio::compressionCount> retransmitRings_;
+	// Network thread, retransmit rate limit of each client that sent a Nack, dropped with the client
+	std::unordered_map<Net::Address, TokenBucket> retransmitBudgets_;
+	// Network thread, time the audio was last sent to each compression group
+	std::array<std::chrono::steady_clock::time_point, Audio::compressionCount> lastAudioSent_{};
+	// Replaced as a whole on the clients update, read by the audio thread without locking
+	std::atomic<std::shared_ptr<const EndpointTable>> clientsCache_{ std::make_shared<const EndpointTable>() };
 };
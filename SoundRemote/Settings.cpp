@@ -3,3 +3,15 @@
 // Settings' names must be underscore.
 const std::string Settings::ServerPort{ "server_port" };
 const std::string Settings::ClientPort{ "client_port" };
+const std::string Settings::Multicast{ "multicast" };
+const std::string Settings::MulticastInterface{ "multicast_interface" };
+const std::string Settings::MetricsPort{ "metrics_port" };
+const std::string Settings::EncoderThreads{ "encoder_threads" };
+const std::string Settings::OpusFrameLength{ "opus_frame_length_us" };
+const std::string Settings::OpusComplexity{ "opus_complexity" };
+const std::string Settings::OpusApplication{ "opus_application" };
+const std::string Settings::OpusMaxBandwidth{ "opus_max_bandwidth_khz" };
+const std::string Settings::OpusBitrateMode{ "opus_bitrate_mode" };
+const std::string Settings::OpusLsbDepth{ "opus_lsb_depth" };
+const std::string Settings::ParityGroupSize{ "parity_group_size" };
+const std::string Settings::RetransmitBuffer{ "retransmit_buffer_ms" };
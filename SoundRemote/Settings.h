@@ -6,16 +6,41 @@
 
 class Settings {
 public:
-	using Value = std::variant<int>;
+	using Value = std::variant<int, std::string>;
 	// This enum must contain all the types supported by the Settings::Value.
 	// Enum's values must be in the same order and hold the same zero-based index.
 	enum class ValueType {
-		Int = 0
+		Int = 0,
+		String = 1
 	};
 
 	// Supported options
 	static const std::string ServerPort;
 	static const std::string ClientPort;
+	// Non-zero to send the audio to the multicast groups
+	static const std::string Multicast;
+	// IPv4 address of the interface to send the multicast from, empty for the first non-loopback one
+	static const std::string MulticastInterface;
+	// Loopback port to serve the metrics on, 0 to not serve them
+	static const std::string MetricsPort;
+	// Threads encoding each frame, 0 to pick by the number of cores
+	static const std::string EncoderThreads;
+	// Opus encoder profile. Frame length in microseconds: 2500, 5000, 10000, 20000, 40000 or 60000
+	static const std::string OpusFrameLength;
+	// From 0 to 10
+	static const std::string OpusComplexity;
+	// 0 for music and other audio, 1 for voice, 2 for the lowest delay
+	static const std::string OpusApplication;
+	// Highest encoded audio bandwidth in kHz: 4, 6, 8, 12 or 20
+	static const std::string OpusMaxBandwidth;
+	// 0 for the constant bitrate, 1 for the variable one, 2 for the constrained variable one
+	static const std::string OpusBitrateMode;
+	// Significant bits of the input from 8 to 24, 0 for the ones of its sample type
+	static const std::string OpusLsbDepth;
+	// Audio packets per parity packet for the clients opting in, from 2 to 32, 0 to send no parity
+	static const std::string ParityGroupSize;
+	// Audio kept for resending to the clients reporting it lost, in milliseconds, 0 to not resend
+	static const std::string RetransmitBuffer;
 
 	virtual ~Settings() {};
 	template <typename T>
@@ -81,6 +81,9 @@ bool SettingsImpl::parseLine(const std::string& line, const SettingsMap& default
             case static_cast<int>(ValueType::Int):
                 settingValue = std::stoi(propValue);
                 break;
+            case static_cast<int>(ValueType::String):
+                settingValue = propValue;
+                break;
             default:
                 return false;
             }
@@ -115,6 +118,9 @@ void SettingsImpl::writeToFile(const std::string& fileName, const SettingsMap& d
         case static_cast<int>(ValueType::Int):
             valueStr = std::to_string(std::get<int>(value));
             break;
+        case static_cast<int>(ValueType::String):
+            valueStr = std::get<std::string>(value);
+            break;
         default:
             break;
         }
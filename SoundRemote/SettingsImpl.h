@@ -20,7 +20,8 @@ private:
 	SettingsMap settings_;
 	SettingsMap defaults_;
 	const std::regex section_{ "^\\[.*\\]$" };
-	const std::regex property_{ "^\\s*(.+?)\\s*=\\s*(.+?)\\s*$" };
+	// The value may be empty, for the string settings
+	const std::regex property_{ "^\\s*(.+?)\\s*=\\s*(.*?)\\s*$" };
 
 	bool parseLine(const std::string& line, const SettingsMap& defaults, SettingsMap& settings);
 	void writeToFile(const std::string& fileName, const SettingsMap& defaults, const SettingsMap& settings);
@@ -0,0 +1,179 @@
+#include "SilenceDetector.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    using Isa = SilenceDetector::Isa;
+
+    constexpr float floatThreshold = SilenceDetector::threshold / 32768.0f;
+
+    // Samples of the silence are within [-threshold, threshold], so they're within [0, 2 * threshold] shifted
+    bool silentScalarInt16(const char* pcm, size_t samples) {
+        for (size_t i = 0; i < samples; ++i) {
+            int16_t sample;
+            std::memcpy(&sample, pcm + i * sizeof(sample), sizeof(sample));
+            if (static_cast<uint16_t>(sample + SilenceDetector::threshold) > 2 * SilenceDetector::threshold) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // NaN isn't silence
+    bool silentScalarFloat(const char* pcm, size_t samples) {
+        for (size_t i = 0; i < samples; ++i) {
+            float sample;
+            std::memcpy(&sample, pcm + i * sizeof(sample), sizeof(sample));
+            if (!(std::fabs(sample) <= floatThreshold)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+#ifdef SOUNDREMOTE_X86
+    // SSE2: 8 int16 or 4 float samples per vector
+
+    SOUNDREMOTE_TARGET_SSE2 bool silentSse2Int16(const char* pcm, size_t samples) {
+        constexpr size_t step = 8;
+        const auto shift = _mm_set1_epi16(SilenceDetector::threshold);
+        const auto range = _mm_set1_epi16(2 * SilenceDetector::threshold);
+        size_t i = 0;
+        for (; i + step <= samples; i += step) {
+            const auto shifted = _mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pcm) + i / step), shift);
+            // Non-zero past the range, unsigned
+            const auto excess = _mm_subs_epu16(shifted, range);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(excess, _mm_setzero_si128())) != 0xFFFF) {
+                return false;
+            }
+        }
+        return silentScalarInt16(pcm + i * sizeof(int16_t), samples - i);
+    }
+
+    SOUNDREMOTE_TARGET_SSE2 bool silentSse2Float(const char* pcm, size_t samples) {
+        constexpr size_t step = 4;
+        const auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        const auto limit = _mm_set1_ps(floatThreshold);
+        size_t i = 0;
+        for (; i + step <= samples; i += step) {
+            const auto magnitude = _mm_and_ps(_mm_loadu_ps(reinterpret_cast<const float*>(pcm) + i), absMask);
+            if (_mm_movemask_ps(_mm_cmple_ps(magnitude, limit)) != 0xF) {
+                return false;
+            }
+        }
+        return silentScalarFloat(pcm + i * sizeof(float), samples - i);
+    }
+
+    // AVX2: 16 int16 or 8 float samples per vector
+
+    SOUNDREMOTE_TARGET_AVX2 bool silentAvx2Int16(const char* pcm, size_t samples) {
+        constexpr size_t step = 16;
+        const auto shift = _mm256_set1_epi16(SilenceDetector::threshold);
+        const auto range = _mm256_set1_epi16(2 * SilenceDetector::threshold);
+        size_t i = 0;
+        for (; i + step <= samples; i += step) {
+            const auto shifted = _mm256_add_epi16(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pcm) + i / step), shift);
+            const auto excess = _mm256_subs_epu16(shifted, range);
+            if (!_mm256_testz_si256(excess, excess)) {
+                return false;
+            }
+        }
+        return silentScalarInt16(pcm + i * sizeof(int16_t), samples - i);
+    }
+
+    SOUNDREMOTE_TARGET_AVX2 bool silentAvx2Float(const char* pcm, size_t samples) {
+        constexpr size_t step = 8;
+        const auto absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+        const auto limit = _mm256_set1_ps(floatThreshold);
+        size_t i = 0;
+        for (; i + step <= samples; i += step) {
+            const auto magnitude = _mm256_and_ps(_mm256_loadu_ps(reinterpret_cast<const float*>(pcm) + i), absMask);
+            // Ordered, so NaN fails
+            if (_mm256_movemask_ps(_mm256_cmp_ps(magnitude, limit, _CMP_LE_OQ)) != 0xFF) {
+                return false;
+            }
+        }
+        return silentScalarFloat(pcm + i * sizeof(float), samples - i);
+    }
+#endif
+
+    // Scalar unless specialized for the instruction set
+    template <SampleFormat Format, Isa KernelIsa>
+    struct SilenceKernel {
+        static bool isSilent(const char* pcm, size_t samples) {
+            if constexpr (Format == SampleFormat::int16) {
+                return silentScalarInt16(pcm, samples);
+            } else {
+                return silentScalarFloat(pcm, samples);
+            }
+        }
+    };
+
+#ifdef SOUNDREMOTE_X86
+    template <SampleFormat Format>
+    struct SilenceKernel<Format, Isa::sse2> {
+        static bool isSilent(const char* pcm, size_t samples) {
+            if constexpr (Format == SampleFormat::int16) {
+                return silentSse2Int16(pcm, samples);
+            } else {
+                return silentSse2Float(pcm, samples);
+            }
+        }
+    };
+
+    template <SampleFormat Format>
+    struct SilenceKernel<Format, Isa::avx2> {
+        static bool isSilent(const char* pcm, size_t samples) {
+            if constexpr (Format == SampleFormat::int16) {
+                return silentAvx2Int16(pcm, samples);
+            } else {
+                return silentAvx2Float(pcm, samples);
+            }
+        }
+    };
+#endif
+
+    template <SampleFormat Format>
+    SilenceDetector::Kernel kernelFor(Isa isa) {
+        switch (isa) {
+        case Isa::avx2:
+            return &SilenceKernel<Format, Isa::avx2>::isSilent;
+        case Isa::sse2:
+            return &SilenceKernel<Format, Isa::sse2>::isSilent;
+        default:
+            return &SilenceKernel<Format, Isa::scalar>::isSilent;
+        }
+    }
+
+    SilenceDetector::Kernel kernelFor(SampleFormat format, Isa isa) {
+        switch (format) {
+        case SampleFormat::int16:
+            return kernelFor<SampleFormat::int16>(isa);
+        case SampleFormat::float32:
+            return kernelFor<SampleFormat::float32>(isa);
+        default:
+            throw std::invalid_argument("SilenceDetector: unsupported sample format");
+        }
+    }
+}
+
+SilenceDetector::SilenceDetector(SampleFormat format, Isa isa) :
+    format_(format),
+    isa_(isa),
+    kernel_(kernelFor(format, isa)) {}
+
+bool SilenceDetector::isSilent(std::span<const char> pcm) const {
+    return kernel_(pcm.data(), pcm.size() / SampleConverter::sampleSize(format_));
+}
+
+SampleFormat SilenceDetector::format() const {
+    return format_;
+}
+
+SilenceDetector::Isa SilenceDetector::isa() const {
+    return isa_;
+}
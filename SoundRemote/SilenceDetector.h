@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include "SampleConverter.h"
+#include "Simd.h"
+
+/// <summary>
+/// Tells the frames of digital silence: no sample louder than the dither of the conversion to 16 bit int.
+/// Takes the 16 bit int or the 32 bit float frames of the capture pipeline. The kernels stop at the first loud
+/// vector, so the frames of audio cost little, only the silent ones are scanned through.
+/// Has no platform dependencies besides the x86 intrinsics.
+/// </summary>
+class SilenceDetector {
+public:
+	using Isa = Simd::Isa;
+
+	// Loudest sample of the silence, in the steps of 16 bit int
+	static constexpr int threshold = 1;
+
+	/// <summary>
+	/// Creates a detector.
+	/// </summary>
+	/// <param name="format">- format of the samples, <c>SampleFormat::int16</c> or <c>SampleFormat::float32</c></param>
+	/// <param name="isa">- instruction set to use, must be supported by the CPU</param>
+	/// <exception cref="std::invalid_argument">The format is neither of these.</exception>
+	SilenceDetector(SampleFormat format, Isa isa = Simd::bestIsa());
+
+	/// <summary>
+	/// Checks if the whole samples of the frame are silence. An empty frame is.
+	/// </summary>
+	bool isSilent(std::span<const char> pcm) const;
+	SampleFormat format() const;
+	Isa isa() const;
+
+	using Kernel = bool (*)(const char* pcm, size_t samples);
+private:
+	const SampleFormat format_;
+	const Isa isa_;
+	const Kernel kernel_;
+};
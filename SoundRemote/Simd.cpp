@@ -0,0 +1,35 @@
+#include "Simd.h"
+
+#if defined(SOUNDREMOTE_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+Simd::Isa Simd::bestIsa() {
+    static const Isa best = [] {
+#if defined(SOUNDREMOTE_X86) && defined(_MSC_VER)
+        int info[4]{};
+        __cpuid(info, 0);
+        const auto maxLeaf = info[0];
+        __cpuid(info, 1);
+        const bool sse2 = (info[3] & (1 << 26)) != 0;
+        // The OS has to save the AVX registers too
+        const bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+        bool avx2 = false;
+        if (avx && maxLeaf >= 7) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+        return avx2 ? Isa::avx2 : sse2 ? Isa::sse2 : Isa::scalar;
+#elif defined(SOUNDREMOTE_X86)
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? Isa::avx2 : __builtin_cpu_supports("sse2") ? Isa::sse2 : Isa::scalar;
+#else
+        return Isa::scalar;
+#endif
+    }();
+    return best;
+}
+
+bool Simd::supported(Isa isa) {
+    return static_cast<int>(isa) <= static_cast<int>(bestIsa());
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+// x86 intrinsics, the other architectures get the scalar code only
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SOUNDREMOTE_X86
+#include <immintrin.h>
+#endif
+
+// GCC and Clang need the functions using the intrinsics marked with their instruction set,
+// MSVC compiles the intrinsics for any target
+#if defined(SOUNDREMOTE_X86) && defined(__GNUC__)
+#define SOUNDREMOTE_TARGET_SSE2 __attribute__((target("sse2")))
+#define SOUNDREMOTE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SOUNDREMOTE_TARGET_SSE2
+#define SOUNDREMOTE_TARGET_AVX2
+#endif
+
+namespace Simd {
+	// Instruction sets of the vectorized kernels, from the slowest
+	enum class Isa { scalar, sse2, avx2 };
+
+	/// <summary>
+	/// Gets the best instruction set the CPU supports.
+	/// </summary>
+	Isa bestIsa();
+	/// <summary>
+	/// Checks if the CPU supports the instruction set.
+	/// </summary>
+	bool supported(Isa isa);
+}
@@ -15,7 +15,12 @@ processorArchitecture='*' publicKeyToken='6595b64144ccf1df' language='*'\"")
 #include "CapturePipe.h"
 #include "Clients.h"
 #include "Controls.h"
+#include "EncoderStage.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
 #include "NetUtil.h"
+#include "OpusProfile.h"
+#include "PipelineLatency.h"
 #include "Server.h"
 #include "SettingsImpl.h"
 #include "Util.h"
@@ -28,6 +33,22 @@ namespace {
     constexpr int windowHeight = 300;			// main window height
     constexpr int timerIdPeakMeter = 1;
     constexpr int timerPeriodPeakMeter = 33;    // in milliseconds
+    constexpr int defaultParityGroupSize = 5;   // a fifth more audio traffic for the clients opting in
+    constexpr int defaultRetransmitBuffer = 300;    // in milliseconds, a few Wi-Fi round trips
+
+    // Interface set in the settings, or the first non-loopback one if it's not set
+    std::optional<boost::asio::ip::address_v4> multicastInterfaceFrom(const Settings& settings) {
+        const auto address = settings.get<std::string>(Settings::MulticastInterface).value_or("");
+        if (address.empty()) {
+            return Net::getMulticastInterface();
+        }
+        boost::system::error_code ec;
+        const auto result = boost::asio::ip::make_address_v4(address, ec);
+        if (ec) {
+            throw std::runtime_error(Util::makeAppErrorText("Settings", "Can't parse multicast interface"));
+        }
+        return result;
+    }
 }
 
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
@@ -87,12 +108,29 @@ void SoundRemoteApp::run() {
         if (!serverPort) {
             throw std::runtime_error(Util::makeAppErrorText("Settings", "Can't get server port"));
         }
+        const auto multicast = settings_->get<int>(Settings::Multicast).value_or(0) != 0;
+        const auto multicastInterface = multicast ? multicastInterfaceFrom(*settings_) : std::nullopt;
+        const auto parityGroupSize = settings_->get<int>(Settings::ParityGroupSize).value_or(0);
+        const auto retransmitBuffer = settings_->get<int>(Settings::RetransmitBuffer).value_or(0);
+        // A packet per frame
+        const size_t retransmitPackets = retransmitBuffer <= 0 ? 0 : static_cast<size_t>(retransmitBuffer) * 1000 /
+            static_cast<size_t>(Audio::Opus::profileFrom(*settings_).frameLength);
 
         clients_ = std::make_shared<Clients>();
-        clients_->addClientsListener(std::bind(&SoundRemoteApp::onClientsUpdate, this, _1));
-        server_ = std::make_shared<Server>(*clientPort, *serverPort, ioContext_, clients_);
-        clients_->addClientsListener(std::bind(&Server::onClientsUpdate, server_.get(), _1));
+        captureCounters_ = std::make_shared<CaptureCounters>();
+        pipelineLatency_ = std::make_shared<PipelineLatency>();
+        clients_->addClientsListener({
+            std::bind(&SoundRemoteApp::onClientsSnapshot, this, _1, _2),
+            std::bind(&SoundRemoteApp::onClientsDelta, this, _1)
+        });
+        server_ = std::make_shared<Server>(*clientPort, *serverPort, ioContext_, clients_, multicastInterface,
+            parityGroupSize, retransmitPackets);
+        clients_->addClientsListener({
+            std::bind(&Server::onClientsSnapshot, server_.get(), _1, _2),
+            std::bind(&Server::onClientsDelta, server_.get(), _1)
+        });
         server_->setKeystrokeCallback(std::bind(&SoundRemoteApp::onReceiveKeystroke, this, _1));
+        startMetricsServer();
         // io_context will run as long as the server works and waiting for incoming packets.
         ioContextThread_ = std::make_unique<std::thread>(std::bind(&SoundRemoteApp::asioEventLoop, this, _1), std::ref(ioContext_));
     }
@@ -108,6 +146,21 @@ void SoundRemoteApp::run() {
     onDeviceSelect();
 }
 
+void SoundRemoteApp::startMetricsServer() {
+    const auto metricsPort = settings_->get<int>(Settings::MetricsPort).value_or(0);
+    if (metricsPort <= 0) {
+        return;
+    }
+    auto metrics = std::make_shared<Metrics>(clients_, captureCounters_, pipelineLatency_);
+    try {
+        metricsServer_ = std::make_unique<MetricsServer>(metricsPort, ioContext_, metrics);
+    }
+    catch (const boost::system::system_error& e) {
+        // The audio works without the metrics
+        Util::showError(Util::makeAppErrorText("Metrics", e.what()));
+    }
+}
+
 void SoundRemoteApp::shutdown() {
     server_->sendDisconnectBlocking();
     stopCapture();
@@ -210,17 +263,21 @@ void SoundRemoteApp::changeCaptureDevice(const std::wstring& deviceId) {
     }
     currentDeviceId_.clear();
     stopCapture();
-    capturePipe_ = std::make_unique<CapturePipe>(deviceId, server_, ioContext_);
-    clients_->addClientsListener(std::bind(&CapturePipe::onClientsUpdate, capturePipe_.get(), _1));
+    const auto encoderThreads = settings_->get<int>(Settings::EncoderThreads).value_or(0);
+    capturePipe_ = std::make_unique<CapturePipe>(deviceId, server_, ioContext_, captureCounters_, pipelineLatency_,
+        encoderThreads > 0 ? encoderThreads : EncoderStage::defaultEncoderThreads(), false,
+        Audio::Opus::profileFrom(*settings_));
+    capturePipeListenerId_ = clients_->addClientsListener({
+        std::bind(&CapturePipe::onClientsSnapshot, capturePipe_.get(), _1, _2),
+        std::bind(&CapturePipe::onClientsDelta, capturePipe_.get(), _1)
+    });
     currentDeviceId_ = deviceId;
     capturePipe_->start();
 }
 
 void SoundRemoteApp::stopCapture() {
     if (capturePipe_) {
-        auto removed = clients_->removeClientsListener(
-            std::bind(&CapturePipe::onClientsUpdate, capturePipe_.get(), _1)
-        );
+        auto removed = clients_->removeClientsListener(capturePipeListenerId_);
         if (removed != 1) {
             throw std::runtime_error(
                 Util::makeFatalErrorText(ErrorCode::REMOVE_CAPTURE_PIPE_CLIENTS_LISTENER)
@@ -238,10 +295,33 @@ void SoundRemoteApp::onClientListUpdate(std::forward_list<std::string> clients)
     SetWindowTextA(clientsList_, addresses.str().c_str());
 }
 
-void SoundRemoteApp::onClientsUpdate(std::forward_list<ClientInfo> clients) {
-    std::ostringstream addresses;
+void SoundRemoteApp::onClientsSnapshot(const std::forward_list<ClientInfo>& clients, uint64_t version) {
+    clientAddresses_.clear();
     for (auto&& client : clients) {
-        addresses << client.address.to_string() << "\r\n";
+        clientAddresses_.insert(client.address);
+    }
+    showClients();
+}
+
+void SoundRemoteApp::onClientsDelta(const ClientsDelta& delta) {
+    switch (delta.type) {
+    case ClientsDelta::Type::added:
+        clientAddresses_.insert(delta.client.address);
+        break;
+    case ClientsDelta::Type::removed:
+        clientAddresses_.erase(delta.client.address);
+        break;
+    case ClientsDelta::Type::formatChanged:
+        // The list shows the addresses only
+        return;
+    }
+    showClients();
+}
+
+void SoundRemoteApp::showClients() {
+    std::ostringstream addresses;
+    for (auto&& address : clientAddresses_) {
+        addresses << address.to_string() << "\r\n";
     }
     SetWindowTextA(clientsList_, addresses.str().c_str());
 }
@@ -445,6 +525,19 @@ void SoundRemoteApp::initSettings() {
     auto settings = std::make_shared<SettingsImpl>();
     settings->addSetting(Settings::ServerPort, Net::defaultServerPort);
     settings->addSetting(Settings::ClientPort, Net::defaultClientPort);
+    settings->addSetting(Settings::Multicast, 0);
+    settings->addSetting(Settings::MulticastInterface, std::string());
+    settings->addSetting(Settings::MetricsPort, 0);
+    settings->addSetting(Settings::EncoderThreads, 0);
+    const Audio::Opus::Profile opusProfile;
+    settings->addSetting(Settings::OpusFrameLength, static_cast<int>(opusProfile.frameLength));
+    settings->addSetting(Settings::OpusComplexity, opusProfile.complexity);
+    settings->addSetting(Settings::OpusApplication, static_cast<int>(opusProfile.application));
+    settings->addSetting(Settings::OpusMaxBandwidth, static_cast<int>(opusProfile.maxBandwidth));
+    settings->addSetting(Settings::OpusBitrateMode, static_cast<int>(opusProfile.bitrateMode));
+    settings->addSetting(Settings::OpusLsbDepth, opusProfile.lsbDepth);
+    settings->addSetting(Settings::ParityGroupSize, defaultParityGroupSize);
+    settings->addSetting(Settings::RetransmitBuffer, defaultRetransmitBuffer);
     settings->setFile("settings.ini");
     settings_ = settings;
 }
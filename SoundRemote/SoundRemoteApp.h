@@ -3,18 +3,25 @@
 #include <mmdeviceapi.h>
 
 #include <atomic>
+#include <cstdint>
 #include <memory>
+#include <set>
 #include <string>
 
 #include <boost/asio/io_context.hpp>
 
+#include "NetDefines.h"
 #include "resource.h"
 
 class MuteButton;
+struct CaptureCounters;
 class CapturePipe;
 class Clients;
 struct ClientInfo;
+struct ClientsDelta;
 class Keystroke;
+class MetricsServer;
+class PipelineLatency;
 class Server;
 class Settings;
 class UpdateChecker;
@@ -57,6 +64,14 @@ private:
 	std::unique_ptr<CapturePipe> capturePipe_;
 	std::shared_ptr<Settings> settings_;
 	std::shared_ptr<Clients> clients_;
+	// Kept across the capture pipes, so the numbers survive a device change
+	std::shared_ptr<CaptureCounters> captureCounters_;
+	std::shared_ptr<PipelineLatency> pipelineLatency_;
+	std::unique_ptr<MetricsServer> metricsServer_;
+	// Clients::ListenerId of the current capture pipe
+	uint64_t capturePipeListenerId_ = 0;
+	// Addresses shown in the clients list
+	std::set<Net::Address> clientAddresses_;
 	std::unique_ptr<UpdateChecker> updateChecker_;
 
 	bool initInstance(int nCmdShow);
@@ -96,7 +111,9 @@ private:
 	// Event handlers
 	void onDeviceSelect();
 	void onClientListUpdate(std::forward_list<std::string> clients);
-	void onClientsUpdate(std::forward_list<ClientInfo> clients);
+	void onClientsSnapshot(const std::forward_list<ClientInfo>& clients, uint64_t version);
+	void onClientsDelta(const ClientsDelta& delta);
+	void showClients();
 	void onAddressButtonClick() const;
 	void updatePeakMeter();
 	void onReceiveKeystroke(const Keystroke& keystroke);
@@ -108,6 +125,8 @@ private:
 	/// Starts server and audio processing.
 	/// </summary>
 	void run();
+	// Serves the metrics if their port is set
+	void startMetricsServer();
 	void shutdown();
 	void changeCaptureDevice(const std::wstring& deviceId);
 	void stopCapture();
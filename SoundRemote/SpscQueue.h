@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/// <summary>
+/// Bounded lock-free queue for one producer thread and one consumer thread.
+/// The slots are allocated up front and the capacity is rounded up to a power of two, so pushing and popping
+/// never allocate. Each side keeps a copy of the other side's index and rereads the shared one only when
+/// the copy says the queue is full or empty.
+/// </summary>
+template <typename T>
+class SpscQueue {
+public:
+	/// <summary>
+	/// Creates an empty queue.
+	/// </summary>
+	/// <param name="capacity">- minimum number of the elements the queue holds</param>
+	explicit SpscQueue(size_t capacity);
+
+	/// <summary>
+	/// Adds the element at the end. Producer only.
+	/// </summary>
+	/// <returns>False if the queue is full, the element is left as is then.</returns>
+	bool tryPush(T&& value);
+	/// <summary>
+	/// Removes the element at the front. Consumer only.
+	/// </summary>
+	/// <returns>The element or an empty optional if the queue is empty.</returns>
+	std::optional<T> tryPop();
+	/// <summary>
+	/// Gets the number of the elements. Exact for the producer and the consumer, a snapshot for the other threads.
+	/// </summary>
+	size_t size() const;
+	size_t capacity() const;
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator= (const SpscQueue&) = delete;
+private:
+	// Keeps the indices written by different threads in different cache lines
+	static constexpr size_t cacheLineSize = 64;
+
+	std::vector<T> slots_;
+	const uint64_t mask_;
+	// Next element to pop, written by the consumer
+	alignas(cacheLineSize) std::atomic<uint64_t> head_ = 0;
+	// Consumer's copy of tail_
+	uint64_t tailCache_ = 0;
+	// Next slot to push to, written by the producer
+	alignas(cacheLineSize) std::atomic<uint64_t> tail_ = 0;
+	// Producer's copy of head_
+	uint64_t headCache_ = 0;
+};
+
+template <typename T>
+inline SpscQueue<T>::SpscQueue(size_t capacity) :
+	slots_(std::bit_ceil(std::max<size_t>(capacity, 1))),
+	mask_(slots_.size() - 1) {}
+
+template <typename T>
+inline bool SpscQueue<T>::tryPush(T&& value) {
+	const auto tail = tail_.load(std::memory_order_relaxed);
+	if (tail - headCache_ == slots_.size()) {
+		headCache_ = head_.load(std::memory_order_acquire);
+		if (tail - headCache_ == slots_.size()) { return false; }
+	}
+	slots_[tail & mask_] = std::move(value);
+	tail_.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+template <typename T>
+inline std::optional<T> SpscQueue<T>::tryPop() {
+	const auto head = head_.load(std::memory_order_relaxed);
+	if (head == tailCache_) {
+		tailCache_ = tail_.load(std::memory_order_acquire);
+		if (head == tailCache_) { return std::nullopt; }
+	}
+	// Moved out and reset, so the slot doesn't hold on to the resources of a popped element
+	std::optional<T> result(std::exchange(slots_[head & mask_], T()));
+	head_.store(head + 1, std::memory_order_release);
+	return result;
+}
+
+template <typename T>
+inline size_t SpscQueue<T>::size() const {
+	// Head first, so it's never ahead of the tail
+	const auto head = head_.load(std::memory_order_acquire);
+	const auto tail = tail_.load(std::memory_order_acquire);
+	return static_cast<size_t>(tail - head);
+}
+
+template <typename T>
+inline size_t SpscQueue<T>::capacity() const {
+	return slots_.size();
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// Hashed timer wheel. Keys are put into slots by their deadline tick, advancing the wheel
+/// touches only the slots of the elapsed ticks, so its cost depends on the number of the due keys
+/// rather than on the number of the scheduled ones.
+/// Keys are not unique and can't be cancelled, the owner is supposed to check whether a due key is still relevant.
+/// Not synchronized.
+/// </summary>
+template <typename Key>
+class TimerWheel {
+public:
+	using Clock = std::chrono::steady_clock;
+	using TimePoint = Clock::time_point;
+	using Duration = Clock::duration;
+
+	/// <summary>
+	/// Creates an empty wheel.
+	/// </summary>
+	/// <param name="tick">- resolution, deadlines are rounded up to it</param>
+	/// <param name="slotCount">- number of slots, deadlines further than slotCount ticks stay in their slot for more rounds</param>
+	/// <param name="start">- time of the tick zero</param>
+	TimerWheel(Duration tick, size_t slotCount, TimePoint start = Clock::now());
+
+	/// <summary>
+	/// Schedules the key. Deadlines in the past are due on the next advance.
+	/// </summary>
+	void schedule(const Key& key, TimePoint deadline);
+	/// <summary>
+	/// Removes the keys due by <c>now</c> and passes each to <c>onDue</c>.
+	/// <c>onDue</c> may schedule keys again, they won't be due within the same advance.
+	/// </summary>
+	template <typename Callback>
+	void advance(TimePoint now, Callback&& onDue);
+	size_t size() const;
+private:
+	struct Entry {
+		Key key;
+		uint64_t tick;
+	};
+
+	uint64_t tickOf(TimePoint time) const;
+
+	const Duration tick_;
+	const TimePoint start_;
+	std::vector<std::vector<Entry>> slots_;
+	// The first tick not processed yet
+	uint64_t nextTick_ = 0;
+	size_t size_ = 0;
+	// Kept between the advances so they don't allocate once it has grown
+	std::vector<Key> due_;
+};
+
+template <typename Key>
+inline TimerWheel<Key>::TimerWheel(Duration tick, size_t slotCount, TimePoint start) :
+	tick_(tick), start_(start), slots_(std::max<size_t>(slotCount, 1)) {}
+
+template <typename Key>
+inline void TimerWheel<Key>::schedule(const Key& key, TimePoint deadline) {
+	// Rounded up so a key is never due before its deadline
+	const auto tick = std::max(tickOf(deadline + tick_ - Duration(1)), nextTick_);
+	slots_[tick % slots_.size()].push_back({ key, tick });
+	++size_;
+}
+
+template <typename Key>
+template <typename Callback>
+inline void TimerWheel<Key>::advance(TimePoint now, Callback&& onDue) {
+	const auto nowTick = tickOf(now);
+	if (nowTick < nextTick_) { return; }
+	// After a long pause every slot is visited once at most
+	const auto ticksToVisit = std::min<uint64_t>(nowTick - nextTick_ + 1, slots_.size());
+	due_.clear();
+	for (uint64_t i = 0; i < ticksToVisit; ++i) {
+		auto& slot = slots_[(nextTick_ + i) % slots_.size()];
+		const auto notDue = std::ranges::partition(slot, [=](const Entry& entry) {
+			return entry.tick > nowTick;
+		});
+		for (auto it = notDue.begin(); it != notDue.end(); ++it) {
+			due_.push_back(std::move(it->key));
+		}
+		slot.erase(notDue.begin(), notDue.end());
+	}
+	size_ -= due_.size();
+	nextTick_ = nowTick + 1;
+	for (auto&& key : due_) {
+		onDue(key);
+	}
+}
+
+template <typename Key>
+inline size_t TimerWheel<Key>::size() const {
+	return size_;
+}
+
+template <typename Key>
+inline uint64_t TimerWheel<Key>::tickOf(TimePoint time) const {
+	if (time <= start_) { return 0; }
+	return static_cast<uint64_t>((time - start_) / tick_);
+}
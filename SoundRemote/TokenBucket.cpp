@@ -0,0 +1,22 @@
+#include "TokenBucket.h"
+
+#include <algorithm>
+
+TokenBucket::TokenBucket(double ratePerSecond, double burst, Clock::time_point now) :
+    ratePerSecond_(ratePerSecond),
+    burst_(burst),
+    tokens_(burst),
+    updated_(now) {}
+
+bool TokenBucket::tryTake(Clock::time_point now) {
+    if (now > updated_) {
+        const std::chrono::duration<double> elapsed = now - updated_;
+        tokens_ = std::min(burst_, tokens_ + elapsed.count() * ratePerSecond_);
+        updated_ = now;
+    }
+    if (tokens_ < 1.0) {
+        return false;
+    }
+    tokens_ -= 1.0;
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+
+/// <summary>
+/// Token bucket limiting the rate of an event, like the retransmits to a client. The bucket refills at the rate
+/// and holds up to the burst, an event takes a token or is refused. Not thread safe.
+/// </summary>
+class TokenBucket {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/// <summary>
+	/// Creates a full bucket.
+	/// </summary>
+	/// <param name="ratePerSecond">- tokens added per second</param>
+	/// <param name="burst">- tokens the bucket holds at most</param>
+	/// <param name="now">- current time</param>
+	TokenBucket(double ratePerSecond, double burst, Clock::time_point now);
+
+	/// <summary>
+	/// Takes a token if there is one.
+	/// </summary>
+	/// <param name="now">- current time, not earlier than the one of the previous call</param>
+	/// <returns>False if the event is over the rate.</returns>
+	bool tryTake(Clock::time_point now);
+private:
+	const double ratePerSecond_;
+	const double burst_;
+	double tokens_;
+	Clock::time_point updated_;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+/// <summary>
+/// Plain copy of <c>TrafficCounters</c>.
+/// </summary>
+struct TrafficStats {
+	uint64_t packetsSent = 0;
+	uint64_t bytesSent = 0;
+	uint64_t sendErrors = 0;
+	uint64_t keepalivesReceived = 0;
+	uint64_t formatChanges = 0;
+
+	TrafficStats& operator+=(const TrafficStats& other) {
+		packetsSent += other.packetsSent;
+		bytesSent += other.bytesSent;
+		sendErrors += other.sendErrors;
+		keepalivesReceived += other.keepalivesReceived;
+		formatChanges += other.formatChanges;
+		return *this;
+	}
+	friend bool operator==(const TrafficStats& lhs, const TrafficStats& rhs) = default;
+};
+
+/// <summary>
+/// Traffic counters updated from the hot paths without locking.
+/// The updates are guarded by a sequence like a seqlock that takes any number of writers, so <c>load()</c> gets
+/// the counters between the updates, never with an update half applied. The readers retry while it's in progress.
+/// </summary>
+struct TrafficCounters {
+	std::atomic<uint64_t> packetsSent = 0;
+	std::atomic<uint64_t> bytesSent = 0;
+	std::atomic<uint64_t> sendErrors = 0;
+	std::atomic<uint64_t> keepalivesReceived = 0;
+	std::atomic<uint64_t> formatChanges = 0;
+
+	void countSent(uint64_t packets, uint64_t bytes) {
+		beginUpdate();
+		packetsSent.fetch_add(packets, std::memory_order_relaxed);
+		bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+		endUpdate();
+	}
+	void countSendError() {
+		beginUpdate();
+		sendErrors.fetch_add(1, std::memory_order_relaxed);
+		endUpdate();
+	}
+	void countKeepalive() {
+		beginUpdate();
+		keepalivesReceived.fetch_add(1, std::memory_order_relaxed);
+		endUpdate();
+	}
+	void countFormatChange() {
+		beginUpdate();
+		formatChanges.fetch_add(1, std::memory_order_relaxed);
+		endUpdate();
+	}
+	TrafficStats load() const {
+		for (;;) {
+			const auto before = sequence_.load(std::memory_order_acquire);
+			if ((before & updatingMask) == 0) {
+				const TrafficStats result{
+					packetsSent.load(std::memory_order_relaxed),
+					bytesSent.load(std::memory_order_relaxed),
+					sendErrors.load(std::memory_order_relaxed),
+					keepalivesReceived.load(std::memory_order_relaxed),
+					formatChanges.load(std::memory_order_relaxed)
+				};
+				// Keeps the sequence from being read before the counters
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (sequence_.load(std::memory_order_relaxed) == before) {
+					return result;
+				}
+			}
+			std::this_thread::yield();
+		}
+	}
+private:
+	// The low half of the sequence counts the updates in progress, the high half the completed ones
+	static constexpr uint64_t updatingMask = 0xFFFF'FFFFu;
+	static constexpr uint64_t completedUpdate = updatingMask + 1;
+
+	void beginUpdate() {
+		sequence_.fetch_add(1, std::memory_order_relaxed);
+		// Keeps the counters from being changed before the update shows as in progress
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+	void endUpdate() {
+		sequence_.fetch_add(completedUpdate - 1, std::memory_order_release);
+	}
+
+	std::atomic<uint64_t> sequence_ = 0;
+};
@@ -0,0 +1,81 @@
+#include "WorkerPool.h"
+
+#include <utility>
+
+WorkerPool::WorkerPool(size_t workerCount) {
+    workers_.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers_.emplace_back(&WorkerPool::work, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        const std::lock_guard lock(mutex_);
+        stopped_ = true;
+    }
+    submitted_.notify_all();
+    for (auto&& worker : workers_) {
+        worker.join();
+    }
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t)>& task) {
+    if (workers_.empty() || count <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+    std::unique_lock lock(mutex_);
+    task_ = &task;
+    count_ = count;
+    next_ = 0;
+    pending_ = count;
+    error_ = nullptr;
+    submitted_.notify_all();
+    while (next_ < count_) {
+        runNext(lock);
+    }
+    finished_.wait(lock, [this] { return pending_ == 0; });
+    task_ = nullptr;
+    count_ = 0;
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+size_t WorkerPool::workerCount() const {
+    return workers_.size();
+}
+
+void WorkerPool::work() {
+    std::unique_lock lock(mutex_);
+    for (;;) {
+        submitted_.wait(lock, [this] { return stopped_ || next_ < count_; });
+        if (stopped_) {
+            return;
+        }
+        runNext(lock);
+    }
+}
+
+void WorkerPool::runNext(std::unique_lock<std::mutex>& lock) {
+    const auto& task = *task_;
+    const auto index = next_++;
+    lock.unlock();
+    std::exception_ptr error;
+    try {
+        task(index);
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+    lock.lock();
+    if (error && !error_) {
+        error_ = error;
+    }
+    if (--pending_ == 0) {
+        finished_.notify_one();
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Fixed set of threads running the tasks of a batch in parallel with the thread submitting it,
+/// which waits until the whole batch is done. Meant for short batches of independent tasks, like the encodes of a frame.
+/// </summary>
+class WorkerPool {
+public:
+	/// <summary>
+	/// Starts the workers.
+	/// </summary>
+	/// <param name="workerCount">- threads besides the submitting one, 0 to run the tasks on the submitting thread only</param>
+	explicit WorkerPool(size_t workerCount);
+	/// <summary>
+	/// Stops the workers, waiting for the running tasks.
+	/// </summary>
+	~WorkerPool();
+
+	/// <summary>
+	/// Runs <c>task(i)</c> for each <c>i</c> less than <c>count</c> on the workers and the calling thread.
+	/// Returns when all of them are done, rethrowing the first exception a task has thrown.
+	/// Called by one thread at a time.
+	/// </summary>
+	void run(size_t count, const std::function<void(size_t)>& task);
+	size_t workerCount() const;
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator= (const WorkerPool&) = delete;
+private:
+	void work();
+	// Runs the next task of the batch, the lock is released while it runs
+	void runNext(std::unique_lock<std::mutex>& lock);
+
+	std::mutex mutex_;
+	// A batch is submitted or the pool is stopping
+	std::condition_variable submitted_;
+	// The last task of the batch is done
+	std::condition_variable finished_;
+	const std::function<void(size_t)>* task_ = nullptr;
+	size_t count_ = 0;
+	// Next task to start
+	size_t next_ = 0;
+	// Tasks not done yet
+	size_t pending_ = 0;
+	std::exception_ptr error_;
+	bool stopped_ = false;
+	std::vector<std::thread> workers_;
+};
@@ -0,0 +1,76 @@
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "pch.h"
+#include "BatchSender.h"
+
+// Benchmarks are disabled by default. To run:
+// Tests.exe --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+namespace {
+	using boost::asio::ip::udp;
+
+	constexpr int framesPerRun = 1000;
+	constexpr int frameSize = 1929;	// Uncompressed audio packet
+
+	struct Result {
+		double nanosecondsPerDatagram = 0.0;
+		double syscallsPerFrame = 0.0;
+	};
+
+	// Sends framesPerRun frames to all the destinations, either as one batch per frame or one call per destination.
+	// Only the time spent in the send calls is measured, not the waits for the socket to become writable.
+	Result run(udp::socket& sender, const std::vector<udp::endpoint>& destinations, bool batched) {
+		const std::vector<char> frame(frameSize);
+		const std::array datagram{ boost::asio::const_buffer(frame.data(), frame.size()) };
+		BatchSender batchSender(sender);
+		boost::system::error_code ec;
+		std::chrono::steady_clock::duration sending{};
+		auto sendAll = [&](std::span<const udp::endpoint> batch) {
+			size_t sent = 0;
+			while (sent < batch.size()) {
+				const auto start = std::chrono::steady_clock::now();
+				sent += batchSender.send(datagram, batch.subspan(sent), ec);
+				sending += std::chrono::steady_clock::now() - start;
+				if (ec == boost::asio::error::would_block) {
+					sender.wait(udp::socket::wait_write);
+				}
+			}
+		};
+		for (int i = 0; i < framesPerRun; ++i) {
+			if (batched) {
+				sendAll(destinations);
+			} else {
+				for (auto&& destination : destinations) {
+					sendAll({ &destination, 1 });
+				}
+			}
+		}
+		const std::chrono::duration<double, std::nano> elapsed = sending;
+		return {
+			elapsed.count() / (static_cast<double>(framesPerRun) * destinations.size()),
+			static_cast<double>(batchSender.stats().syscalls) / framesPerRun
+		};
+	}
+
+	TEST(BatchSenderBenchmark, DISABLED_FanOutPerFrame) {
+		boost::asio::io_context ioContext;
+		udp::socket sender(ioContext, udp::v4());
+		sender.non_blocking(true);
+		// All the clients point at one socket that never reads, loopback drops what doesn't fit its buffer.
+		udp::socket receiver(ioContext, udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+		std::cout << std::setw(8) << "clients"
+			<< std::setw(16) << "loop ns/dgram" << std::setw(16) << "loop calls"
+			<< std::setw(16) << "batch ns/dgram" << std::setw(16) << "batch calls" << '\n';
+		for (int clientCount : { 1, 10, 25, 50, 100, 250 }) {
+			const std::vector<udp::endpoint> destinations(clientCount, receiver.local_endpoint());
+			const auto loop = run(sender, destinations, false);
+			const auto batch = run(sender, destinations, true);
+			std::cout << std::setw(8) << clientCount << std::fixed << std::setprecision(2)
+				<< std::setw(16) << loop.nanosecondsPerDatagram << std::setw(16) << loop.syscallsPerFrame
+				<< std::setw(16) << batch.nanosecondsPerDatagram << std::setw(16) << batch.syscallsPerFrame << '\n';
+		}
+	}
+}
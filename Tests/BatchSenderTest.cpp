@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "pch.h"
+#include "BatchSender.h"
+
+#include <boost/asio/ip/multicast.hpp>
+
+namespace {
+	using boost::asio::ip::udp;
+
+	class BatchSenderTest : public testing::Test {
+	protected:
+		void SetUp() override {
+			sender_.non_blocking(true);
+			for (int i = 0; i < receiverCount; ++i) {
+				auto& receiver = receivers_.emplace_back(ioContext_,
+					udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+				destinations_.push_back(receiver.local_endpoint());
+			}
+		}
+		std::vector<char> receive(udp::socket& receiver) {
+			std::vector<char> datagram(64);
+			const auto size = receiver.receive(boost::asio::buffer(datagram));
+			datagram.resize(size);
+			return datagram;
+		}
+		static constexpr int receiverCount = 3;
+		boost::asio::io_context ioContext_;
+		udp::socket sender_{ ioContext_, udp::v4() };
+		std::vector<udp::socket> receivers_;
+		std::vector<udp::endpoint> destinations_;
+	};
+
+	TEST_F(BatchSenderTest, SendsToAllDestinations) {
+		const std::vector<char> expected{ 1, 2, 3, 4 };
+		const std::array datagram{ boost::asio::const_buffer(expected.data(), expected.size()) };
+		BatchSender batchSender(sender_);
+		boost::system::error_code ec;
+
+		const auto sent = batchSender.send(datagram, destinations_, ec);
+
+		EXPECT_FALSE(ec);
+		EXPECT_EQ(sent, destinations_.size());
+		EXPECT_EQ(batchSender.stats().datagrams, destinations_.size());
+		for (auto&& receiver : receivers_) {
+			EXPECT_EQ(receive(receiver), expected);
+		}
+	}
+
+	TEST_F(BatchSenderTest, GathersBuffersIntoOneDatagram) {
+		const std::vector<char> header{ 1, 2 };
+		const std::vector<char> payload{ 3, 4, 5 };
+		const std::array datagram{
+			boost::asio::const_buffer(header.data(), header.size()),
+			boost::asio::const_buffer(payload.data(), payload.size())
+		};
+		const std::vector<char> expected{ 1, 2, 3, 4, 5 };
+		BatchSender batchSender(sender_);
+		boost::system::error_code ec;
+
+		batchSender.send(datagram, destinations_, ec);
+
+		EXPECT_FALSE(ec);
+		for (auto&& receiver : receivers_) {
+			EXPECT_EQ(receive(receiver), expected);
+		}
+	}
+
+	TEST_F(BatchSenderTest, EmptyDestinations) {
+		const std::vector<char> data{ 1 };
+		const std::array datagram{ boost::asio::const_buffer(data.data(), data.size()) };
+		BatchSender batchSender(sender_);
+		boost::system::error_code ec;
+
+		const auto sent = batchSender.send(datagram, {}, ec);
+
+		EXPECT_FALSE(ec);
+		EXPECT_EQ(sent, 0);
+		EXPECT_EQ(batchSender.stats().syscalls, 0);
+	}
+
+	TEST_F(BatchSenderTest, SendsToMulticastGroup) {
+		namespace multicast = boost::asio::ip::multicast;
+		const auto loopback = boost::asio::ip::address_v4::loopback();
+		const auto group = boost::asio::ip::make_address_v4("239.255.71.1");
+		udp::socket groupReceiver(ioContext_, udp::v4());
+		boost::system::error_code ec;
+		groupReceiver.set_option(udp::socket::reuse_address(true));
+		groupReceiver.bind(udp::endpoint(udp::v4(), 0));
+		groupReceiver.set_option(multicast::join_group(group, loopback), ec);
+		if (!ec) {
+			sender_.set_option(multicast::outbound_interface(loopback), ec);
+		}
+		if (!ec) {
+			sender_.set_option(multicast::enable_loopback(true), ec);
+		}
+		if (ec) {
+			GTEST_SKIP() << "Multicast is not available: " << ec.message();
+		}
+		const std::vector<char> expected{ 1, 2, 3 };
+		const std::array datagram{ boost::asio::const_buffer(expected.data(), expected.size()) };
+		const std::array destinations{ udp::endpoint(group, groupReceiver.local_endpoint().port()) };
+		BatchSender batchSender(sender_);
+
+		const auto sent = batchSender.send(datagram, destinations, ec);
+
+		EXPECT_FALSE(ec);
+		EXPECT_EQ(sent, 1);
+		for (int i = 0; i < 100 && groupReceiver.available() == 0; ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		ASSERT_GT(groupReceiver.available(), 0);
+		EXPECT_EQ(receive(groupReceiver), expected);
+	}
+}
@@ -0,0 +1,177 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include "pch.h"
+#include "CaptureFeeder.h"
+#include "CaptureSource.h"
+#include "EncoderOpus.h"
+#include "EncoderStage.h"
+#include "FrameRing.h"
+
+namespace {
+	using namespace std::chrono_literals;
+	using Audio::Compression;
+
+	// Delivers the blocks, then fails or waits to be stopped like the device does
+	class FakeSource : public CaptureSource {
+	public:
+		void capture(const Handler& handler) override {
+			for (auto& block : blocks) {
+				handler(block);
+			}
+			if (fail) {
+				throw std::runtime_error("capture failed");
+			}
+			std::unique_lock lock(mutex_);
+			delivered_ = true;
+			cv_.notify_all();
+			cv_.wait(lock, [this] { return stopped_; });
+		}
+		void stopCapture() override {
+			std::lock_guard lock(mutex_);
+			stopped_ = true;
+			cv_.notify_all();
+		}
+		uint64_t glitchCount() const override {
+			return glitches;
+		}
+		std::span<char> convert(std::span<char> audio) override {
+			return audio;
+		}
+		bool waitDelivered() {
+			std::unique_lock lock(mutex_);
+			return cv_.wait_for(lock, 5s, [this] { return delivered_; });
+		}
+
+		std::vector<std::vector<char>> blocks;
+		bool fail = false;
+		uint64_t glitches = 0;
+	private:
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		bool delivered_ = false;
+		bool stopped_ = false;
+	};
+
+	class CaptureFeederTest : public testing::Test {
+	protected:
+		// Stereo 16 bit audio counting the samples, cut into blocks of one and a half frames
+		std::vector<char> addBlocks(int count) {
+			std::vector<int16_t> pcm(count * frameSize_ * 3 / 2 / sizeof(int16_t));
+			std::iota(pcm.begin(), pcm.end(), int16_t{ 0 });
+			const auto bytes = reinterpret_cast<const char*>(pcm.data());
+			const std::vector<char> audio(bytes, bytes + pcm.size() * sizeof(int16_t));
+			const auto blockSize = frameSize_ * 3 / 2;
+			for (size_t offset = 0; offset < audio.size(); offset += blockSize) {
+				source_.blocks.emplace_back(audio.begin() + offset, audio.begin() + offset + blockSize);
+			}
+			return audio;
+		}
+
+		// Runs the network thread until the sink gets the frames or the time is out
+		void runNetwork(size_t frames) {
+			const auto deadline = std::chrono::steady_clock::now() + 5s;
+			while (sent_.size() < frames && std::chrono::steady_clock::now() < deadline) {
+				network_.run_for(10ms);
+				network_.restart();
+			}
+		}
+
+		const size_t frameSize_ = EncoderOpus::getInputSize(EncoderOpus::getFrameSize(Audio::Opus::SampleRate::khz_48),
+			Audio::Opus::Channels::stereo, Audio::SampleType::SignedInt);
+		boost::asio::io_context network_;
+		std::shared_ptr<CaptureCounters> counters_ = std::make_shared<CaptureCounters>();
+		std::shared_ptr<PipelineLatency> latency_ = std::make_shared<PipelineLatency>();
+		std::vector<std::vector<char>> sent_;
+		std::shared_ptr<EncoderStage> encoder_ = EncoderStage::create(frameSize_, network_,
+			[this](Compression, Net::Packet::SequenceNumberType, const PacketPtr& audioData) {
+				sent_.emplace_back(audioData->data(), audioData->data() + audioData->size());
+			}, counters_, latency_);
+		FakeSource source_;
+		FrameRing frameRing_{ frameSize_, 4 };
+		CaptureFeeder feeder_{ source_, frameRing_, encoder_, network_, counters_, latency_ };
+	};
+
+	TEST_F(CaptureFeederTest, FramesAudioInOrder) {
+		encoder_->addClient(Compression::none);
+		const auto audio = addBlocks(4);
+
+		feeder_.start();
+		runNetwork(6);
+		feeder_.stop();
+
+		ASSERT_EQ(sent_.size(), 6);
+		for (size_t i = 0; i < sent_.size(); ++i) {
+			const auto expected = audio.begin() + i * frameSize_;
+			EXPECT_TRUE(std::equal(sent_[i].begin(), sent_[i].end(), expected, expected + frameSize_)) << i;
+		}
+		EXPECT_EQ(counters_->load().bufferedBytes, 0);
+	}
+
+	TEST_F(CaptureFeederTest, KeepsPartialFrameForNextBlock) {
+		encoder_->addClient(Compression::none);
+		addBlocks(1);
+
+		feeder_.start();
+		ASSERT_TRUE(source_.waitDelivered());
+		runNetwork(1);
+		feeder_.stop();
+
+		EXPECT_EQ(sent_.size(), 1);
+		EXPECT_EQ(counters_->load().bufferedBytes, frameSize_ / 2);
+	}
+
+	TEST_F(CaptureFeederTest, SkipsAudioWhileMuted) {
+		encoder_->addClient(Compression::none);
+		addBlocks(2);
+		feeder_.setMuted(true);
+
+		feeder_.start();
+		ASSERT_TRUE(source_.waitDelivered());
+		feeder_.stop();
+		network_.run();
+
+		EXPECT_TRUE(sent_.empty());
+	}
+
+	TEST_F(CaptureFeederTest, SkipsAudioWithoutClients) {
+		addBlocks(2);
+
+		feeder_.start();
+		ASSERT_TRUE(source_.waitDelivered());
+		feeder_.stop();
+		network_.run();
+
+		EXPECT_TRUE(sent_.empty());
+		EXPECT_EQ(counters_->load().bufferedBytes, 0);
+	}
+
+	TEST_F(CaptureFeederTest, CountsGlitches) {
+		addBlocks(2);
+		source_.glitches = 3;
+
+		feeder_.start();
+		ASSERT_TRUE(source_.waitDelivered());
+		feeder_.stop();
+
+		EXPECT_EQ(counters_->load().captureGlitches, 3);
+	}
+
+	TEST_F(CaptureFeederTest, PostsCaptureErrorToNetworkThread) {
+		addBlocks(1);
+		source_.fail = true;
+		const auto work = boost::asio::make_work_guard(network_);
+
+		feeder_.start();
+
+		EXPECT_THROW(network_.run_for(5s), std::runtime_error);
+	}
+}
@@ -0,0 +1,80 @@
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "pch.h"
+#include "Clients.h"
+
+// Benchmarks are disabled by default. To run:
+// Tests.exe --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+namespace {
+	using Audio::Compression;
+	using namespace std::chrono_literals;
+
+	constexpr int clientCount = 100;
+	constexpr auto runTime = 500ms;
+
+	Net::Address clientAddress(int i) {
+		return boost::asio::ip::address_v4(0xC0A80000u + i);
+	}
+
+	struct Result {
+		double keepsPerSecond = 0.0;
+		double changesPerSecond = 0.0;
+	};
+
+	// Keepalive threads hammer keep() on all the clients while one thread keeps changing the registry
+	Result run(int keeperCount) {
+		Clients clients;
+		std::atomic_size_t deltas = 0;
+		clients.addClientsListener({
+			[](const std::forward_list<ClientInfo>&, uint64_t) {},
+			[&](const ClientsDelta&) { ++deltas; }
+		});
+		for (int i = 0; i < clientCount; ++i) {
+			clients.add(clientAddress(i), Compression::none);
+		}
+		std::atomic_bool stop = false;
+		std::atomic_size_t keeps = 0;
+		size_t changes = 0;
+		{
+			std::vector<std::jthread> keepers;
+			for (int k = 0; k < keeperCount; ++k) {
+				keepers.emplace_back([&, k] {
+					size_t count = 0;
+					for (int i = k; !stop.load(std::memory_order_relaxed); i = (i + 1) % clientCount) {
+						clients.keep(clientAddress(i));
+						++count;
+					}
+					keeps += count;
+				});
+			}
+			std::jthread writer([&] {
+				for (int i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+					const auto address = clientAddress(clientCount + i % clientCount);
+					clients.add(address, Compression::kbps_128);
+					clients.setCompression(address, Compression::kbps_320);
+					clients.remove(address);
+					changes += 3;
+				}
+			});
+			std::this_thread::sleep_for(runTime);
+			stop = true;
+		}
+		const std::chrono::duration<double> seconds = runTime;
+		return { keeps / seconds.count(), changes / seconds.count() };
+	}
+
+	TEST(ClientsBenchmark, DISABLED_KeepUnderChanges) {
+		std::cout << std::setw(8) << "keepers" << std::setw(16) << "keeps/s" << std::setw(16) << "changes/s" << '\n';
+		for (int keeperCount : { 1, 2, 4, 8 }) {
+			const auto result = run(keeperCount);
+			std::cout << std::setw(8) << keeperCount << std::fixed << std::setprecision(0)
+				<< std::setw(16) << result.keepsPerSecond << std::setw(16) << result.changesPerSecond << '\n';
+			EXPECT_GT(result.keepsPerSecond, 0);
+		}
+	}
+}
@@ -1,7 +1,10 @@
 #include <barrier>
+#include <chrono>
 #include <forward_list>
 #include <functional>
+#include <future>
 #include <memory>
+#include <stdexcept>
 #include <thread>
 
 #include "pch.h"
@@ -9,16 +12,21 @@
 
 namespace {
 	using boost::asio::ip::make_address_v4;
+	using ::testing::_;
+	using ::testing::Field;
+	using namespace std::chrono_literals;
 	using namespace std::placeholders;
 
-	class ClientsListener {
+	class MockClientsListener {
 	public:
-		virtual void onClientsUpdate(std::forward_list<ClientInfo> clients) = 0;
-	};
-
-	class MockClientsListener : public ClientsListener {
-	public:
-		MOCK_METHOD(void, onClientsUpdate, (std::forward_list<ClientInfo> clients), (override));
+		MOCK_METHOD(void, onClientsSnapshot, (const std::forward_list<ClientInfo>& clients, uint64_t version));
+		MOCK_METHOD(void, onClientsDelta, (const ClientsDelta& delta));
+		ClientsListener listener() {
+			return {
+				std::bind(&MockClientsListener::onClientsSnapshot, this, _1, _2),
+				std::bind(&MockClientsListener::onClientsDelta, this, _1)
+			};
+		}
 	};
 
     class ClientsTest : public testing::Test {
@@ -35,25 +43,54 @@ namespace {
 	TEST_F(ClientsTest, AddClientsListener) {
 		std::vector<MockClientsListener> listeners(10);
 		for (auto&& listener : listeners) {
-			// Expect 2 calls - the initial update and on a new client
-			EXPECT_CALL(listener, onClientsUpdate).Times(2);
+			// Expect the snapshot on subscribe and a delta on a new client
+			EXPECT_CALL(listener, onClientsSnapshot(std::forward_list<ClientInfo>{}, 0));
+			EXPECT_CALL(listener, onClientsDelta);
 		}
 
 		for (auto&& listener : listeners) {
-			clients_->addClientsListener(std::bind(&MockClientsListener::onClientsUpdate, &listener, _1));
+			clients_->addClientsListener(listener.listener());
 		}
 		clients_->add(make_address_v4("127.0.0.1"), Audio::Compression::none);
 	}
 
+	TEST_F(ClientsTest, SnapshotOnSubscribe) {
+		const auto address = make_address_v4("127.0.0.1");
+		clients_->add(address, Audio::Compression::kbps_128);
+		MockClientsListener listener;
+		std::forward_list<ClientInfo> clients;
+		clients.push_front(ClientInfo(address, Audio::Compression::kbps_128));
+		EXPECT_CALL(listener, onClientsSnapshot(clients, 1));
+
+		clients_->addClientsListener(listener.listener());
+	}
+
+	TEST_F(ClientsTest, RemoveClientsListener) {
+		MockClientsListener listener;
+		EXPECT_CALL(listener, onClientsSnapshot);
+		EXPECT_CALL(listener, onClientsDelta).Times(0);
+
+		const auto id = clients_->addClientsListener(listener.listener());
+		EXPECT_EQ(clients_->removeClientsListener(id), 1);
+		EXPECT_EQ(clients_->removeClientsListener(id), 0);
+		clients_->add(make_address_v4("127.0.0.1"), Audio::Compression::none);
+	}
+
 	TEST_F(ClientsTest, Add) {
 		const auto threadCount = 5;
 		const auto operationsPerThread = 50;
 		const auto operationCount = threadCount * operationsPerThread;
 		MockClientsListener listener;
-		// Add 1 expected call for the initial update
-		EXPECT_CALL(listener, onClientsUpdate).Times(operationCount + 1);
+		EXPECT_CALL(listener, onClientsSnapshot);
+		uint64_t lastVersion = 0;
+		EXPECT_CALL(listener, onClientsDelta(Field(&ClientsDelta::type, ClientsDelta::Type::added)))
+			.Times(operationCount)
+			.WillRepeatedly([&](const ClientsDelta& delta) {
+				// Versions come in order without gaps
+				EXPECT_EQ(delta.version, ++lastVersion);
+			});
 
-		clients_->addClientsListener(std::bind(&MockClientsListener::onClientsUpdate, &listener, _1));
+		clients_->addClientsListener(listener.listener());
 		std::barrier barrier(threadCount);
 		auto addClients = [&](int start) {
 			barrier.arrive_and_wait();
@@ -81,17 +118,19 @@ namespace {
 		const auto threadCount = 5;
 
 		MockClientsListener listener;
-		// Expect the initial update
-		EXPECT_CALL(listener, onClientsUpdate);
-		std::forward_list<ClientInfo> clients;
-		clients.push_front(ClientInfo(address, Compression::none));
-		EXPECT_CALL(listener, onClientsUpdate(clients));
-		for (auto&& c : compressions) {
-			clients.front().compression = c;
-			EXPECT_CALL(listener, onClientsUpdate(clients));
-		}
+		EXPECT_CALL(listener, onClientsSnapshot);
+		EXPECT_CALL(listener, onClientsDelta(Field(&ClientsDelta::type, ClientsDelta::Type::added)));
+		// Each change starts from the compression the previous one has set
+		auto current = Compression::none;
+		EXPECT_CALL(listener, onClientsDelta(Field(&ClientsDelta::type, ClientsDelta::Type::formatChanged)))
+			.Times(std::size(compressions))
+			.WillRepeatedly([&](const ClientsDelta& delta) {
+				ASSERT_TRUE(delta.previous);
+				EXPECT_EQ(delta.previous->compression, current);
+				current = delta.client.compression;
+			});
 
-		clients_->addClientsListener(std::bind(&MockClientsListener::onClientsUpdate, &listener, _1));
+		clients_->addClientsListener(listener.listener());
 		clients_->add(address, Compression::none);
 		std::barrier barrier(threadCount);
 		auto compressionsSetter = [&](Audio::Compression compression) {
@@ -104,19 +143,188 @@ namespace {
 		}
 	}
 
+	TEST_F(ClientsTest, AddUpdatesProtocol) {
+		using Audio::Compression;
+		const auto address = make_address_v4("127.0.0.1");
+		MockClientsListener listener;
+		EXPECT_CALL(listener, onClientsSnapshot);
+		EXPECT_CALL(listener, onClientsDelta(ClientsDelta{
+			ClientsDelta::Type::added, { address, Compression::none, Net::Protocol::initial }, {}, 1
+		}));
+		EXPECT_CALL(listener, onClientsDelta(ClientsDelta{
+			ClientsDelta::Type::formatChanged,
+			{ address, Compression::none, Net::Protocol::multicast },
+			ClientInfo{ address, Compression::none, Net::Protocol::initial },
+			2
+		}));
+
+		clients_->addClientsListener(listener.listener());
+		clients_->add(address, Compression::none, Net::Protocol::initial);
+		// Same protocol, no delta expected
+		clients_->add(address, Compression::none, Net::Protocol::initial);
+		clients_->add(address, Compression::none, Net::Protocol::multicast);
+	}
+
+	TEST_F(ClientsTest, SetCompressionChangesFramesPerPacket) {
+		using Audio::Compression;
+		const auto address = make_address_v4("127.0.0.1");
+		const auto protocol = Net::Protocol::aggregation;
+		clients_->add(address, Compression::kbps_64, protocol, false, 2);
+		MockClientsListener listener;
+		EXPECT_CALL(listener, onClientsSnapshot);
+		EXPECT_CALL(listener, onClientsDelta(ClientsDelta{
+			ClientsDelta::Type::formatChanged,
+			{ address, Compression::kbps_64, protocol, nullptr, 0, false, 4 },
+			ClientInfo{ address, Compression::kbps_64, protocol, nullptr, 0, false, 2 },
+			2
+		}));
+
+		clients_->addClientsListener(listener.listener());
+		clients_->setCompression(address, Compression::kbps_64, 4);
+		// Same format, no delta expected
+		clients_->setCompression(address, Compression::kbps_64, 4);
+	}
+
+	TEST_F(ClientsTest, MaintainRemovesTimedOutClients) {
+		using Audio::Compression;
+		clients_ = std::make_unique<Clients>(2);
+		const auto start = std::chrono::steady_clock::now();
+		const auto address = make_address_v4("192.168.0.1");
+		clients_->add(address, Compression::none);
+		MockClientsListener listener;
+		EXPECT_CALL(listener, onClientsSnapshot);
+		EXPECT_CALL(listener, onClientsDelta(ClientsDelta{
+			ClientsDelta::Type::removed, { address, Compression::none }, {}, 2
+		}));
+
+		clients_->addClientsListener(listener.listener());
+		clients_->maintain(start + 1s);
+		clients_->maintain(start + 3s);
+	}
+
+	TEST_F(ClientsTest, StatsCountTraffic) {
+		using Audio::Compression;
+		const auto first = make_address_v4("192.168.0.1");
+		const auto second = make_address_v4("192.168.0.2");
+		clients_->add(first, Compression::kbps_64);
+		clients_->add(second, Compression::kbps_64);
+		clients_->keep(first);
+		clients_->keep(first);
+		clients_->keep(second);
+		clients_->compressionCounters(Compression::kbps_64).countSent(2, 200);
+		// The counters stay with the client when it changes the format
+		clients_->setCompression(first, Compression::kbps_128);
+
+		const auto stats = clients_->stats();
+
+		EXPECT_EQ(stats.version, 3);
+		ASSERT_EQ(stats.clients.size(), 2);
+		for (auto&& client : stats.clients) {
+			if (client.address == first) {
+				EXPECT_EQ(client.compression, Compression::kbps_128);
+				EXPECT_EQ(client.traffic.keepalivesReceived, 2);
+				EXPECT_EQ(client.traffic.formatChanges, 1);
+			} else {
+				EXPECT_EQ(client.traffic.keepalivesReceived, 1);
+				EXPECT_EQ(client.traffic.formatChanges, 0);
+			}
+		}
+		ASSERT_EQ(stats.compressions.size(), Audio::compressionCount);
+		const auto& kbps64 = stats.compressions[Audio::compressionIndex(Compression::kbps_64)];
+		EXPECT_EQ(kbps64.compression, Compression::kbps_64);
+		EXPECT_EQ(kbps64.clientCount, 1);
+		EXPECT_EQ(kbps64.traffic.keepalivesReceived, 3);
+		EXPECT_EQ(kbps64.traffic.packetsSent, 2);
+		EXPECT_EQ(kbps64.traffic.bytesSent, 200);
+		const auto& kbps128 = stats.compressions[Audio::compressionIndex(Compression::kbps_128)];
+		EXPECT_EQ(kbps128.clientCount, 1);
+		EXPECT_EQ(kbps128.traffic.formatChanges, 1);
+	}
+
+	TEST_F(ClientsTest, KeepAddsRoundTripSamples) {
+		const auto address = make_address_v4("192.168.0.1");
+		clients_->add(address, Audio::Compression::none, Net::Protocol::roundTrip);
+
+		clients_->keep(address);
+		clients_->keep(address, 2ms);
+		clients_->keep(address, 4ms);
+
+		const auto stats = clients_->stats();
+		ASSERT_EQ(stats.clients.size(), 1);
+		EXPECT_EQ(stats.clients.front().traffic.keepalivesReceived, 3);
+		EXPECT_EQ(stats.clients.front().roundTrip.samples, 2);
+		EXPECT_EQ(stats.clients.front().roundTrip.min, 2ms);
+		EXPECT_EQ(stats.clients.front().roundTrip.average, 3ms);
+	}
+
+	TEST_F(ClientsTest, ReportLossAdaptsFormat) {
+		using Audio::Compression;
+		const auto address = make_address_v4("192.168.0.1");
+		MockClientsListener listener;
+		EXPECT_CALL(listener, onClientsSnapshot);
+		EXPECT_CALL(listener, onClientsDelta(ClientsDelta{
+			ClientsDelta::Type::formatChanged,
+			{ address, Compression::kbps_128, Net::Protocol::lossReport, nullptr, 20 },
+			ClientInfo{ address, Compression::kbps_192, Net::Protocol::lossReport },
+			2
+		}));
+
+		clients_->add(address, Compression::kbps_192, Net::Protocol::lossReport);
+		clients_->addClientsListener(listener.listener());
+		clients_->reportLoss(address, 80, 20, Compression::kbps_64);
+		// The same loss again after stepping down to the lowest allowed, no delta expected
+		clients_->reportLoss(address, 80, 20, Compression::kbps_128);
+
+		const auto stats = clients_->stats();
+		ASSERT_EQ(stats.clients.size(), 1);
+		EXPECT_EQ(stats.clients.front().compression, Compression::kbps_128);
+		EXPECT_EQ(stats.clients.front().traffic.formatChanges, 0);
+	}
+
+	TEST_F(ClientsTest, ReportLossIgnoredForOlderProtocol) {
+		using Audio::Compression;
+		const auto address = make_address_v4("192.168.0.1");
+		clients_->add(address, Compression::kbps_192, Net::Protocol::silence);
+		MockClientsListener listener;
+		EXPECT_CALL(listener, onClientsSnapshot);
+		EXPECT_CALL(listener, onClientsDelta).Times(0);
+
+		clients_->addClientsListener(listener.listener());
+		clients_->reportLoss(address, 50, 50, Compression::kbps_64);
+	}
+
+	TEST_F(ClientsTest, SetCompressionRestartsAdaptation) {
+		using Audio::Compression;
+		const auto address = make_address_v4("192.168.0.1");
+		clients_->add(address, Compression::kbps_192, Net::Protocol::lossReport);
+		clients_->reportLoss(address, 50, 50, Compression::kbps_64);
+		MockClientsListener listener;
+		EXPECT_CALL(listener, onClientsSnapshot);
+		EXPECT_CALL(listener, onClientsDelta(ClientsDelta{
+			ClientsDelta::Type::formatChanged,
+			{ address, Compression::kbps_256, Net::Protocol::lossReport },
+			ClientInfo{ address, Compression::kbps_128, Net::Protocol::lossReport, nullptr, 50 },
+			3
+		}));
+
+		clients_->addClientsListener(listener.listener());
+		clients_->setCompression(address, Compression::kbps_256);
+	}
+
 	TEST_F(ClientsTest, Remove) {
 		const auto threadCount = 5;
 		const auto operationsPerThread = 50;
 		const auto operationCount = threadCount * operationsPerThread;
 		MockClientsListener listener;
-		// Add 1 expected call for the initial update
-		EXPECT_CALL(listener, onClientsUpdate).Times(operationCount + 1);
+		EXPECT_CALL(listener, onClientsSnapshot);
+		EXPECT_CALL(listener, onClientsDelta(Field(&ClientsDelta::type, ClientsDelta::Type::removed)))
+			.Times(operationCount);
 		for (int i = 0; i < operationCount; i++) {
 			auto address = "192.168.0." + std::to_string(i);
 			clients_->add(make_address_v4(address), Audio::Compression::none);
 		}
 
-		clients_->addClientsListener(std::bind(&MockClientsListener::onClientsUpdate, &listener, _1));
+		clients_->addClientsListener(listener.listener());
 		std::barrier barrier(threadCount);
 		auto removeClients = [&](int start) {
 			barrier.arrive_and_wait();
@@ -130,4 +338,107 @@ namespace {
 			threads.emplace_back(removeClients, i);
 		}
 	}
+
+	TEST_F(ClientsTest, ListenerChangesClients) {
+		const auto address = make_address_v4("192.168.0.1");
+		std::vector<ClientsDelta::Type> types;
+		const auto id = clients_->addClientsListener({
+			[](const std::forward_list<ClientInfo>&, uint64_t) {},
+			[&](const ClientsDelta& delta) {
+				types.push_back(delta.type);
+				if (delta.type == ClientsDelta::Type::added) {
+					// Returns before the listeners get the removal
+					clients_->remove(delta.client.address);
+					EXPECT_EQ(types.size(), 1);
+				}
+			}
+		});
+
+		clients_->add(address, Audio::Compression::none);
+
+		const std::vector expected{ ClientsDelta::Type::added, ClientsDelta::Type::removed };
+		EXPECT_EQ(types, expected);
+		EXPECT_EQ(clients_->removeClientsListener(id), 1);
+	}
+
+	TEST_F(ClientsTest, ListenerRemovesItself) {
+		int deltas = 0;
+		Clients::ListenerId id = 0;
+		id = clients_->addClientsListener({
+			[](const std::forward_list<ClientInfo>&, uint64_t) {},
+			[&](const ClientsDelta&) {
+				deltas++;
+				EXPECT_EQ(clients_->removeClientsListener(id), 1);
+			}
+		});
+
+		clients_->add(make_address_v4("192.168.0.1"), Audio::Compression::none);
+		clients_->add(make_address_v4("192.168.0.2"), Audio::Compression::none);
+
+		EXPECT_EQ(deltas, 1);
+	}
+
+	TEST_F(ClientsTest, ThrowingListenerDoesNotBlockLaterChanges) {
+		std::vector<uint64_t> versions;
+		clients_->addClientsListener({
+			[](const std::forward_list<ClientInfo>&, uint64_t) {},
+			[&](const ClientsDelta& delta) {
+				versions.push_back(delta.version);
+				if (versions.size() == 1) {
+					throw std::runtime_error("listener failed");
+				}
+			}
+		});
+
+		EXPECT_THROW(clients_->add(make_address_v4("192.168.0.1"), Audio::Compression::none), std::runtime_error);
+		clients_->add(make_address_v4("192.168.0.2"), Audio::Compression::none);
+
+		const std::vector<uint64_t> expected{ 1, 2 };
+		EXPECT_EQ(versions, expected);
+	}
+
+	TEST_F(ClientsTest, ThrowingSnapshotDoesNotSubscribe) {
+		int deltas = 0;
+		EXPECT_THROW(clients_->addClientsListener({
+			[](const std::forward_list<ClientInfo>&, uint64_t) { throw std::runtime_error("listener failed"); },
+			[&](const ClientsDelta&) { deltas++; }
+		}), std::runtime_error);
+
+		clients_->add(make_address_v4("192.168.0.1"), Audio::Compression::none);
+
+		EXPECT_EQ(deltas, 0);
+	}
+
+	TEST_F(ClientsTest, ListenersCalledWithoutLock) {
+		// The listener waits for another thread that subscribes and unsubscribes meanwhile,
+		// like the UI listener waiting for the UI thread
+		std::promise<void> entered;
+		std::promise<void> subscribed;
+		auto subscribedFuture = subscribed.get_future().share();
+		std::future_status waited = std::future_status::deferred;
+		MockClientsListener removed;
+		EXPECT_CALL(removed, onClientsSnapshot);
+		EXPECT_CALL(removed, onClientsDelta).Times(0);
+		const auto removedId = clients_->addClientsListener(removed.listener());
+		// Subscribed later, so called first
+		clients_->addClientsListener({
+			[](const std::forward_list<ClientInfo>&, uint64_t) {},
+			[&](const ClientsDelta&) {
+				entered.set_value();
+				waited = subscribedFuture.wait_for(5s);
+			}
+		});
+
+		std::jthread adder([&] { clients_->add(make_address_v4("192.168.0.1"), Audio::Compression::none); });
+		entered.get_future().wait();
+		EXPECT_EQ(clients_->removeClientsListener(removedId), 1);
+		MockClientsListener added;
+		EXPECT_CALL(added, onClientsSnapshot);
+		const auto addedId = clients_->addClientsListener(added.listener());
+		subscribed.set_value();
+		adder.join();
+
+		EXPECT_EQ(waited, std::future_status::ready);
+		clients_->removeClientsListener(addedId);
+	}
 }
@@ -0,0 +1,80 @@
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <vector>
+
+#include "pch.h"
+#include "DownMixer.h"
+#include "SampleConverter.h"
+
+// Benchmarks are disabled by default. To run:
+// Tests.exe --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+namespace {
+	using Isa = DownMixer::Isa;
+
+	// 10 ms of 48 kHz audio, a typical capture buffer
+	constexpr size_t bufferFrames = 480;
+	constexpr int buffersPerRun = 50'000;
+
+	std::vector<float> makeInput(size_t channels) {
+		std::vector<float> result(bufferFrames * channels);
+		for (size_t i = 0; i < result.size(); ++i) {
+			result[i] = static_cast<float>(i % 97) / 97 - 0.5f;
+		}
+		return result;
+	}
+
+	template <typename Run>
+	double timeBuffers(Run run) {
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < buffersPerRun; ++i) {
+			run();
+		}
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / buffersPerRun;
+	}
+
+	// Mixed and converted to int16 in one pass
+	double runFused(size_t channels, Isa isa) {
+		DownMixer mixer(0, channels, true, isa);
+		const auto input = makeInput(channels);
+		std::vector<int16_t> output(2 * bufferFrames);
+		return timeBuffers([&] { mixer.mix(input, output); });
+	}
+
+	// Mixed to float, then converted to int16
+	double runTwoPasses(size_t channels, Isa isa) {
+		DownMixer mixer(0, channels, false, isa);
+		SampleConverter converter(SampleFormat::float32, true, isa);
+		const auto input = makeInput(channels);
+		std::vector<float> mixed(2 * bufferFrames);
+		std::vector<int16_t> output(2 * bufferFrames);
+		return timeBuffers([&] {
+			mixer.mix(input, mixed);
+			converter.convert({ reinterpret_cast<const char*>(mixed.data()), mixed.size() * sizeof(float) }, output);
+		});
+	}
+
+	TEST(DownMixerBenchmark, DISABLED_MixBuffer) {
+		const std::pair<Isa, const char*> isas[]{ { Isa::scalar, "scalar" }, { Isa::avx2, "avx2" } };
+		std::cout << "10 ms buffers to dithered stereo int16\n";
+		std::cout << std::setw(10) << "channels";
+		for (auto&& [isa, name] : isas) {
+			std::cout << std::setw(9) << name << " fused ns" << std::setw(9) << name << " 2pass ns";
+		}
+		std::cout << '\n';
+		for (size_t channels : { 2, 6, 8 }) {
+			std::cout << std::setw(10) << channels << std::fixed << std::setprecision(0);
+			for (auto&& [isa, name] : isas) {
+				if (!Simd::supported(isa)) {
+					std::cout << std::setw(18) << "-" << std::setw(18) << "-";
+					continue;
+				}
+				std::cout << std::setw(18) << runFused(channels, isa) << std::setw(18) << runTwoPasses(channels, isa);
+			}
+			std::cout << '\n';
+		}
+	}
+}
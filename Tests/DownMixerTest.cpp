@@ -0,0 +1,160 @@
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "pch.h"
+#include "DownMixer.h"
+
+namespace {
+	using Isa = DownMixer::Isa;
+	using Speaker = DownMixer::Speaker;
+
+	constexpr float attenuated = 0.70710678f;
+	const uint32_t surround51 = DownMixer::defaultChannelMask(6);
+
+	std::vector<float> randomFrames(size_t frames, size_t channels, unsigned seed = 42) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> distribution(-0.5f, 0.5f);
+		std::vector<float> result(frames * channels);
+		for (auto& sample : result) {
+			sample = distribution(random);
+		}
+		return result;
+	}
+
+	std::vector<int16_t> mixInt16(DownMixer& mixer, const std::vector<float>& input) {
+		std::vector<int16_t> output(input.size() / mixer.channels() * 2);
+		EXPECT_EQ(mixer.mix(input, output), output.size() / 2);
+		return output;
+	}
+
+	std::vector<float> mixFloat(DownMixer& mixer, const std::vector<float>& input) {
+		std::vector<float> output(input.size() / mixer.channels() * 2);
+		EXPECT_EQ(mixer.mix(input, output), output.size() / 2);
+		return output;
+	}
+
+	TEST(DownMixer, StandardMatrixOf51) {
+		const auto matrix = DownMixer::standardMatrix(surround51, 6);
+
+		ASSERT_EQ(matrix.size(), 6);
+		// FL, FR, FC, LFE, BL, BR
+		EXPECT_FLOAT_EQ(matrix[0].left, 1.0f);
+		EXPECT_FLOAT_EQ(matrix[0].right, 0.0f);
+		EXPECT_FLOAT_EQ(matrix[1].right, 1.0f);
+		EXPECT_FLOAT_EQ(matrix[2].left, attenuated);
+		EXPECT_FLOAT_EQ(matrix[2].right, attenuated);
+		EXPECT_FLOAT_EQ(matrix[3].left, 0.0f);
+		EXPECT_FLOAT_EQ(matrix[3].right, 0.0f);
+		EXPECT_FLOAT_EQ(matrix[4].left, attenuated);
+		EXPECT_FLOAT_EQ(matrix[5].right, attenuated);
+	}
+
+	TEST(DownMixer, StandardMatrixFollowsMaskOrder) {
+		// 7.1 with the side speakers, their bits come after the back ones
+		const uint32_t mask = Speaker::frontLeft | Speaker::frontRight | Speaker::sideLeft | Speaker::sideRight;
+
+		const auto matrix = DownMixer::standardMatrix(mask, 5);
+
+		ASSERT_EQ(matrix.size(), 5);
+		EXPECT_FLOAT_EQ(matrix[2].left, attenuated);
+		EXPECT_FLOAT_EQ(matrix[3].right, attenuated);
+		// Past the mask
+		EXPECT_FLOAT_EQ(matrix[4].left, 0.0f);
+		EXPECT_FLOAT_EQ(matrix[4].right, 0.0f);
+	}
+
+	TEST(DownMixer, UpmixesMono) {
+		DownMixer mixer(0, 1, false);
+		const std::vector<float> input{ 0.5f, -0.25f };
+
+		EXPECT_EQ(mixInt16(mixer, input), (std::vector<int16_t>{ 16384, 16384, -8192, -8192 }));
+	}
+
+	TEST(DownMixer, MixesInt16) {
+		DownMixer mixer(surround51, 6, false, Isa::scalar);
+		// FL, FR, FC, LFE, BL, BR
+		const std::vector<float> input{ 0.25f, -0.25f, 0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.5f, -0.5f };
+
+		const auto output = mixInt16(mixer, input);
+
+		EXPECT_EQ(output, (std::vector<int16_t>{ 19777, 3393, 11585, -11585 }));
+	}
+
+	TEST(DownMixer, ClampsInt16) {
+		DownMixer mixer(surround51, 6, false);
+		const std::vector<float> input{ 1.0f, -1.0f, 1.0f, 0.0f, 1.0f, -1.0f };
+
+		EXPECT_EQ(mixInt16(mixer, input), (std::vector<int16_t>{ 32767, -32768 }));
+	}
+
+	TEST(DownMixer, CustomMatrix) {
+		DownMixer mixer({ { 0.0f, 1.0f }, { 1.0f, 0.0f }, { 0.5f, 0.5f } }, false);
+		const std::vector<float> input{ 0.25f, 0.5f, 0.5f };
+
+		EXPECT_EQ(mixFloat(mixer, input), (std::vector<float>{ 0.75f, 0.5f }));
+		EXPECT_THROW(DownMixer({}, false), std::invalid_argument);
+	}
+
+	TEST(DownMixer, IgnoresPartialFrame) {
+		DownMixer mixer(surround51, 6, false);
+		const std::vector<float> input(10, 0.5f);
+		std::vector<int16_t> output(4, -1);
+
+		EXPECT_EQ(mixer.mix(input, output), 1);
+		EXPECT_EQ(output[2], -1);
+	}
+
+	TEST(DownMixer, FallsBackToScalar) {
+		EXPECT_EQ(DownMixer(0, 12, false, Isa::avx2).isa(), Isa::scalar);
+		EXPECT_EQ(DownMixer(0, 6, false, Isa::sse2).isa(), Isa::scalar);
+		EXPECT_EQ(DownMixer(0, 8, false, Isa::avx2).isa(), Isa::avx2);
+	}
+
+	// Odd frame counts cover the scalar tails, the sums of the vector kernel are in another order
+	TEST(DownMixer, VectorKernelMatchesScalar) {
+		if (!Simd::supported(Isa::avx2)) {
+			GTEST_SKIP() << "AVX2 is not supported";
+		}
+		for (size_t channels = 1; channels <= DownMixer::maxVectorChannels; ++channels) {
+			for (size_t frames : { 0, 1, 7, 9, 480, 481 }) {
+				const auto input = randomFrames(frames, channels);
+				DownMixer scalar(0, channels, false, Isa::scalar);
+				DownMixer vector(0, channels, false, Isa::avx2);
+
+				const auto expected = mixInt16(scalar, input);
+				const auto actual = mixInt16(vector, input);
+				const auto expectedFloat = mixFloat(scalar, input);
+				const auto actualFloat = mixFloat(vector, input);
+
+				ASSERT_EQ(actual.size(), expected.size());
+				for (size_t i = 0; i < actual.size(); ++i) {
+					ASSERT_NEAR(actual[i], expected[i], 1) << channels << " channels, sample " << i;
+					ASSERT_NEAR(actualFloat[i], expectedFloat[i], 1e-6f) << channels << " channels, sample " << i;
+				}
+			}
+		}
+	}
+
+	TEST(DownMixer, DitherStaysWithinLsb) {
+		for (auto isa : { Isa::scalar, Isa::avx2 }) {
+			if (!Simd::supported(isa)) {
+				continue;
+			}
+			DownMixer mixer(0, 2, true, isa);
+			// Halfway between 100 and 101
+			const std::vector<float> input(2 * 24'000, 100.5f / 32768);
+
+			const auto output = mixInt16(mixer, input);
+
+			double sum = 0;
+			for (auto sample : output) {
+				ASSERT_GE(sample, 99);
+				ASSERT_LE(sample, 102);
+				sum += sample;
+			}
+			EXPECT_NEAR(sum / output.size(), 100.5, 0.02) << "isa " << static_cast<int>(isa);
+		}
+	}
+}
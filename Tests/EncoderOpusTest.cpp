@@ -1,3 +1,8 @@
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
 #include "pch.h"
 #include "EncoderOpus.h"
 #include "AudioUtil.h"
@@ -50,4 +55,72 @@ namespace {
 		const int value = static_cast<int>(info.param);
 		return std::to_string(value);
 	});
+
+	TEST(EncoderOpusTest, FrameSizeOfFrameLength) {
+		EXPECT_EQ(EncoderOpus::getFrameSize(Opus::SampleRate::khz_48), 480);
+		EXPECT_EQ(EncoderOpus::getFrameSize(Opus::SampleRate::khz_48, Opus::FrameLength::ms_2_5), 120);
+		EXPECT_EQ(EncoderOpus::getFrameSize(Opus::SampleRate::khz_48, Opus::FrameLength::ms_60), 2880);
+		EXPECT_EQ(EncoderOpus::getFrameSize(Opus::SampleRate::khz_8, Opus::FrameLength::ms_2_5), 20);
+	}
+
+	TEST(EncoderOpusTest, EncodesWithProfile) {
+		Opus::Profile profile;
+		profile.frameLength = Opus::FrameLength::ms_20;
+		profile.complexity = 3;
+		profile.application = Opus::Application::lowDelay;
+		profile.maxBandwidth = Opus::Bandwidth::wideband;
+		profile.bitrateMode = Opus::BitrateMode::cbr;
+		profile.lsbDepth = 16;
+		EncoderOpus encoder(Compression::kbps_64, Opus::SampleRate::khz_48, Opus::Channels::stereo, SampleType::SignedInt,
+			profile);
+		const auto frameSize = EncoderOpus::getFrameSize(Opus::SampleRate::khz_48, profile.frameLength);
+		std::vector<int16_t> pcm(2 * frameSize);
+		for (size_t i = 0; i < pcm.size(); ++i) {
+			pcm[i] = static_cast<int16_t>((i % 64) * 256 - 8192);
+		}
+		std::array<char, Opus::maxPacketSize> packet{};
+
+		EXPECT_GT(encoder.encode(reinterpret_cast<const char*>(pcm.data()), packet.data()), 0);
+	}
+
+	TEST(EncoderOpusTest, EncodesWithPacketLoss) {
+		EncoderOpus encoder(Compression::kbps_64, Opus::SampleRate::khz_48, Opus::Channels::stereo);
+		const auto frameSize = EncoderOpus::getFrameSize(Opus::SampleRate::khz_48);
+		std::vector<int16_t> pcm(2 * frameSize);
+		for (size_t i = 0; i < pcm.size(); ++i) {
+			pcm[i] = static_cast<int16_t>((i % 64) * 256 - 8192);
+		}
+		std::array<char, Opus::maxPacketSize> packet{};
+
+		encoder.setPacketLoss(20);
+		EXPECT_GT(encoder.encode(reinterpret_cast<const char*>(pcm.data()), packet.data()), 0);
+		encoder.setPacketLoss(0);
+		EXPECT_GT(encoder.encode(reinterpret_cast<const char*>(pcm.data()), packet.data()), 0);
+	}
+
+	TEST(EncoderOpusTest, InputSizeOfSampleType) {
+		const auto frameSize = EncoderOpus::getFrameSize(Opus::SampleRate::khz_48);
+
+		EXPECT_EQ(EncoderOpus::getInputSize(frameSize, Opus::Channels::stereo), 480 * 2 * 2);
+		EXPECT_EQ(EncoderOpus::getInputSize(frameSize, Opus::Channels::stereo, SampleType::Float), 480 * 2 * 4);
+		EXPECT_EQ(EncoderOpus::getInputSize(frameSize, Opus::Channels::mono, SampleType::Float), 480 * 4);
+	}
+
+	TEST(EncoderOpusTest, EncodesFloat) {
+		EncoderOpus encoder(Compression::kbps_128, Opus::SampleRate::khz_48, Opus::Channels::stereo, SampleType::Float);
+		const auto inputSize = EncoderOpus::getInputSize(EncoderOpus::getFrameSize(Opus::SampleRate::khz_48),
+			Opus::Channels::stereo, SampleType::Float);
+		std::vector<float> pcm(inputSize / sizeof(float));
+		for (size_t i = 0; i < pcm.size(); ++i) {
+			pcm[i] = static_cast<float>(i % 64) / 64 - 0.5f;
+		}
+		std::array<char, Opus::maxPacketSize> packet{};
+
+		EXPECT_GT(encoder.encode(reinterpret_cast<const char*>(pcm.data()), packet.data()), 0);
+	}
+
+	TEST(EncoderOpusTest, ThrowsOnUnsupportedSampleType) {
+		EXPECT_THROW(EncoderOpus(Compression::kbps_128, Opus::SampleRate::khz_48, Opus::Channels::stereo,
+			SampleType::UnSignedInt), std::invalid_argument);
+	}
 }
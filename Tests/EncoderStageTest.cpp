@@ -0,0 +1,322 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include "pch.h"
+#include "EncoderOpus.h"
+#include "EncoderStage.h"
+
+namespace {
+	using namespace std::chrono_literals;
+	using Audio::Compression;
+
+	struct Sent {
+		Compression compression;
+		Net::Packet::SequenceNumberType sequenceNumber;
+		std::vector<char> audioData;
+	};
+
+	// Stereo 16 bit sine, a frame of the synthetic capture
+	std::vector<char> sineFrame(int index) {
+		const auto samples = EncoderOpus::getFrameSize(Audio::Opus::SampleRate::khz_48);
+		std::vector<int16_t> pcm(2 * samples);
+		for (int i = 0; i < samples; ++i) {
+			const auto t = static_cast<double>(index * samples + i) / 48'000;
+			pcm[2 * i] = pcm[2 * i + 1] = static_cast<int16_t>(8'000 * std::sin(2 * std::numbers::pi * 440 * t));
+		}
+		const auto bytes = reinterpret_cast<const char*>(pcm.data());
+		return { bytes, bytes + pcm.size() * sizeof(int16_t) };
+	}
+
+	// 20 ms frame of the sine
+	std::vector<char> longSineFrame(int index) {
+		auto result = sineFrame(2 * index);
+		const auto next = sineFrame(2 * index + 1);
+		result.insert(result.end(), next.begin(), next.end());
+		return result;
+	}
+
+	std::vector<char> silentFrame(int index) {
+		return std::vector<char>(sineFrame(index).size());
+	}
+
+	// The same sine in float
+	std::vector<char> floatSineFrame(int index) {
+		const auto int16Frame = sineFrame(index);
+		const auto int16Samples = reinterpret_cast<const int16_t*>(int16Frame.data());
+		std::vector<float> pcm(int16Frame.size() / sizeof(int16_t));
+		for (size_t i = 0; i < pcm.size(); ++i) {
+			pcm[i] = int16Samples[i] / 32768.0f;
+		}
+		const auto bytes = reinterpret_cast<const char*>(pcm.data());
+		return { bytes, bytes + pcm.size() * sizeof(float) };
+	}
+
+	class EncoderStageTest : public testing::Test {
+	protected:
+		std::shared_ptr<EncoderStage> createStage(size_t encoderThreads = 1,
+			size_t queueCapacity = EncoderStage::defaultQueueCapacity,
+			Audio::SampleType sampleType = Audio::SampleType::SignedInt, const Audio::Opus::Profile& profile = {}) {
+			const auto frameSize = EncoderOpus::getInputSize(
+				EncoderOpus::getFrameSize(Audio::Opus::SampleRate::khz_48, profile.frameLength),
+				Audio::Opus::Channels::stereo, sampleType);
+			return EncoderStage::create(frameSize, network_, [this](Compression compression,
+				Net::Packet::SequenceNumberType sequenceNumber, const PacketPtr& audioData) {
+				sent_.push_back({ compression, sequenceNumber, audioData ?
+					std::vector<char>(audioData->data(), audioData->data() + audioData->size()) : std::vector<char>{} });
+			}, counters_, latency_, encoderThreads, queueCapacity, sampleType, profile);
+		}
+
+		// Pushes the frames from a thread of its own, like the capture does
+		void capture(EncoderStage& stage, int frames, std::vector<char> (*makeFrame)(int) = sineFrame) {
+			std::thread([&] {
+				for (int i = 0; i < frames; ++i) {
+					stage.push(makeFrame(i), PipelineLatency::now());
+				}
+			}).join();
+		}
+
+		// Runs the network thread until the sink gets the packets or the time is out
+		void runNetwork(size_t packets) {
+			const auto deadline = std::chrono::steady_clock::now() + 5s;
+			while (sent_.size() < packets && std::chrono::steady_clock::now() < deadline) {
+				network_.run_for(10ms);
+				network_.restart();
+			}
+		}
+
+		// Waits until every pushed frame is either queued for sending or dropped
+		bool waitEncoded(uint64_t frames) {
+			const auto deadline = std::chrono::steady_clock::now() + 5s;
+			for (;;) {
+				const auto stats = counters_->load();
+				if (stats.captureStalls + stats.encodeStalls + stats.sendQueueDepth == frames) {
+					return true;
+				}
+				if (std::chrono::steady_clock::now() > deadline) {
+					return false;
+				}
+				std::this_thread::sleep_for(1ms);
+			}
+		}
+
+		boost::asio::io_context network_;
+		std::shared_ptr<CaptureCounters> counters_ = std::make_shared<CaptureCounters>();
+		std::shared_ptr<PipelineLatency> latency_ = std::make_shared<PipelineLatency>();
+		std::vector<Sent> sent_;
+	};
+
+	TEST_F(EncoderStageTest, HaveClients) {
+		const auto stage = createStage();
+		EXPECT_FALSE(stage->haveClients());
+
+		stage->addClient(Compression::kbps_64);
+		stage->addClient(Compression::kbps_64);
+		stage->removeClient(Compression::kbps_64);
+		EXPECT_TRUE(stage->haveClients());
+
+		stage->removeClient(Compression::kbps_64);
+		EXPECT_FALSE(stage->haveClients());
+
+		stage->addClient(Compression::none);
+		stage->clearClients();
+		EXPECT_FALSE(stage->haveClients());
+	}
+
+	TEST_F(EncoderStageTest, RemovesClientWithItsLoss) {
+		const auto stage = createStage();
+
+		stage->addClient(Compression::kbps_64, 10);
+		stage->removeClient(Compression::kbps_64);
+		EXPECT_TRUE(stage->haveClients());
+
+		stage->removeClient(Compression::kbps_64, 10);
+		EXPECT_FALSE(stage->haveClients());
+	}
+
+	TEST_F(EncoderStageTest, SendsUncompressedFramesInOrder) {
+		constexpr int frames = 10;
+		const auto stage = createStage();
+		stage->addClient(Compression::none);
+
+		capture(*stage, frames);
+		runNetwork(frames);
+
+		ASSERT_EQ(sent_.size(), frames);
+		for (int i = 0; i < frames; ++i) {
+			EXPECT_EQ(sent_[i].compression, Compression::none);
+			EXPECT_EQ(sent_[i].audioData, sineFrame(i));
+			EXPECT_EQ(static_cast<Net::Packet::SequenceNumberType>(sent_[i].sequenceNumber - sent_[0].sequenceNumber), i);
+		}
+		EXPECT_EQ(counters_->load().sendQueueDepth, 0);
+	}
+
+	TEST_F(EncoderStageTest, EncodesForEachCompression) {
+		constexpr int frames = 4;
+		const auto stage = createStage();
+		stage->addClient(Compression::none);
+		stage->addClient(Compression::kbps_128);
+
+		capture(*stage, frames);
+		runNetwork(2 * frames);
+
+		ASSERT_EQ(sent_.size(), 2 * frames);
+		for (int i = 0; i < frames; ++i) {
+			const auto& uncompressed = sent_[2 * i];
+			const auto& encoded = sent_[2 * i + 1];
+			EXPECT_EQ(uncompressed.compression, Compression::none);
+			EXPECT_EQ(encoded.compression, Compression::kbps_128);
+			EXPECT_EQ(encoded.sequenceNumber, uncompressed.sequenceNumber);
+			EXPECT_LT(encoded.audioData.size(), uncompressed.audioData.size());
+		}
+	}
+
+	TEST_F(EncoderStageTest, EncodesForLossyClients) {
+		constexpr int frames = 4;
+		const auto stage = createStage();
+		stage->addClient(Compression::kbps_64, 20);
+		stage->addClient(Compression::kbps_64, 5);
+
+		capture(*stage, frames / 2);
+		// The encoder goes back to no FEC
+		stage->removeClient(Compression::kbps_64, 20);
+		capture(*stage, frames / 2);
+		runNetwork(frames);
+
+		ASSERT_EQ(sent_.size(), frames);
+		for (auto&& packet : sent_) {
+			EXPECT_EQ(packet.compression, Compression::kbps_64);
+			EXPECT_FALSE(packet.audioData.empty());
+		}
+	}
+
+	TEST_F(EncoderStageTest, SendsFloatFramesUncompressedAsInt16) {
+		constexpr int frames = 4;
+		const auto stage = createStage(1, EncoderStage::defaultQueueCapacity, Audio::SampleType::Float);
+		stage->addClient(Compression::none);
+		stage->addClient(Compression::kbps_128);
+
+		capture(*stage, frames, floatSineFrame);
+		runNetwork(2 * frames);
+
+		ASSERT_EQ(sent_.size(), 2 * frames);
+		for (int i = 0; i < frames; ++i) {
+			const auto& uncompressed = sent_[2 * i];
+			const auto expected = sineFrame(i);
+			ASSERT_EQ(uncompressed.compression, Compression::none);
+			ASSERT_EQ(uncompressed.audioData.size(), expected.size());
+			const auto actualSamples = reinterpret_cast<const int16_t*>(uncompressed.audioData.data());
+			const auto expectedSamples = reinterpret_cast<const int16_t*>(expected.data());
+			for (size_t s = 0; s < expected.size() / sizeof(int16_t); ++s) {
+				// Off by the dither at most
+				ASSERT_NEAR(actualSamples[s], expectedSamples[s], 1) << "frame " << i << ", sample " << s;
+			}
+			EXPECT_EQ(sent_[2 * i + 1].compression, Compression::kbps_128);
+		}
+		EXPECT_EQ(counters_->load().encodeFailures, 0);
+	}
+
+	TEST_F(EncoderStageTest, EncodesFramesOfProfileLength) {
+		constexpr int frames = 3;
+		Audio::Opus::Profile profile;
+		profile.frameLength = Audio::Opus::FrameLength::ms_20;
+		profile.complexity = 1;
+		const auto stage = createStage(1, EncoderStage::defaultQueueCapacity, Audio::SampleType::SignedInt, profile);
+		stage->addClient(Compression::none);
+		stage->addClient(Compression::kbps_64);
+
+		capture(*stage, frames, longSineFrame);
+		runNetwork(2 * frames);
+
+		ASSERT_EQ(sent_.size(), 2 * frames);
+		for (int i = 0; i < frames; ++i) {
+			EXPECT_EQ(sent_[2 * i].audioData, longSineFrame(i));
+			EXPECT_EQ(sent_[2 * i + 1].compression, Compression::kbps_64);
+			EXPECT_FALSE(sent_[2 * i + 1].audioData.empty());
+		}
+	}
+
+	TEST_F(EncoderStageTest, SkipsSilenceAfterHangover) {
+		// Of the 10 ms frames
+		constexpr int hangover = EncoderStage::silenceHangover / 10ms;
+		constexpr int markerInterval = EncoderStage::silenceMarkerInterval / 10ms;
+		constexpr int silent = hangover + markerInterval + 5;
+		const auto stage = createStage(1, 128);
+		stage->addClient(Compression::none);
+
+		// The silence followed by a frame of audio
+		capture(*stage, silent + 1, [](int index) { return index < silent ? silentFrame(index) : sineFrame(index); });
+		runNetwork(hangover + 4);
+
+		ASSERT_EQ(sent_.size(), hangover + 4);
+		const auto first = sent_[0].sequenceNumber;
+		for (int i = 0; i < hangover; ++i) {
+			EXPECT_EQ(sent_[i].audioData, silentFrame(i));
+		}
+		// Markers on the first skipped frame, a marker interval later and before the audio goes on
+		const int markers[]{ hangover, hangover + markerInterval, silent - 1 };
+		for (int i = 0; i < 3; ++i) {
+			const auto& marker = sent_[hangover + i];
+			EXPECT_TRUE(marker.audioData.empty());
+			EXPECT_EQ(marker.sequenceNumber - first, markers[i]);
+		}
+		EXPECT_EQ(sent_.back().sequenceNumber - first, silent);
+		EXPECT_EQ(sent_.back().audioData, sineFrame(silent));
+		EXPECT_EQ(counters_->load().silentFrames, silent - hangover);
+	}
+
+	TEST_F(EncoderStageTest, ParallelEncodesKeepCompressionOrder) {
+		constexpr int frames = 4;
+		const auto stage = createStage(3);
+		for (auto compression : { Compression::kbps_320, Compression::kbps_64, Compression::none, Compression::kbps_192 }) {
+			stage->addClient(compression);
+		}
+
+		capture(*stage, frames);
+		runNetwork(4 * frames);
+
+		ASSERT_EQ(sent_.size(), 4 * frames);
+		const Compression order[]{ Compression::none, Compression::kbps_64, Compression::kbps_192, Compression::kbps_320 };
+		for (size_t i = 0; i < sent_.size(); ++i) {
+			EXPECT_EQ(sent_[i].compression, order[i % 4]);
+			EXPECT_EQ(sent_[i].sequenceNumber, sent_[i - i % 4].sequenceNumber);
+		}
+		EXPECT_EQ(counters_->load().encodeFailures, 0);
+	}
+
+	TEST_F(EncoderStageTest, CountsStallsWhileNetworkIsBusy) {
+		constexpr int frames = 10;
+		constexpr size_t capacity = 2;
+		const auto stage = createStage(1, capacity);
+		stage->addClient(Compression::none);
+
+		// The network thread doesn't run, so the send queue fills up and the rest is dropped
+		capture(*stage, frames);
+		ASSERT_TRUE(waitEncoded(frames));
+		runNetwork(capacity);
+
+		const auto stats = counters_->load();
+		EXPECT_EQ(sent_.size(), capacity);
+		EXPECT_EQ(stats.captureStalls + stats.encodeStalls, frames - capacity);
+		EXPECT_EQ(stats.sendQueueDepth, 0);
+	}
+
+	TEST_F(EncoderStageTest, DropsPendingSendsWhenDestroyed) {
+		auto stage = createStage();
+		stage->addClient(Compression::none);
+		capture(*stage, 1);
+		ASSERT_TRUE(waitEncoded(1));
+
+		stage.reset();
+		network_.run();
+
+		EXPECT_TRUE(sent_.empty());
+		EXPECT_EQ(counters_->load().sendQueueDepth, 0);
+	}
+}
@@ -0,0 +1,120 @@
+#include <chrono>
+#include <forward_list>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+#include "pch.h"
+#include "Clients.h"
+#include "EndpointTable.h"
+
+// Benchmarks are disabled by default. To run:
+// Tests.exe --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+namespace {
+	using Audio::Compression;
+	using boost::asio::ip::udp;
+
+	constexpr int framesPerRun = 10'000;
+	constexpr int clientPort = 55555;
+
+	std::forward_list<ClientInfo> makeClients(int count) {
+		std::forward_list<ClientInfo> clients;
+		for (int i = 0; i < count; ++i) {
+			// Every other client on the uncompressed stream, the rest spread over the Opus bitrates
+			const auto compression = i % 2 == 0 ? Compression::none :
+				i % 4 == 1 ? Compression::kbps_128 : Compression::kbps_320;
+			clients.emplace_front(boost::asio::ip::address_v4(0xC0A80000u + i), compression);
+		}
+		return clients;
+	}
+
+	// Stands in for the send call, so the compiler can't drop the walk over the destinations
+	struct Sink {
+		size_t value = 0;
+		void send(const udp::endpoint& destination) {
+			value += destination.port() + destination.address().to_v4().to_uint();
+		}
+	};
+
+	// Per frame: the previous cache layout, a fresh endpoint made for every destination
+	double runMap(const std::forward_list<ClientInfo>& clients, Sink& sink) {
+		std::unordered_map<Compression, std::forward_list<Net::Address>> cache;
+		for (auto&& client : clients) {
+			cache[client.compression].push_front(client.address);
+		}
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < framesPerRun; ++i) {
+			for (auto compression : { Compression::none, Compression::kbps_128, Compression::kbps_320 }) {
+				for (auto&& address : cache[compression]) {
+					auto destination = udp::endpoint(address, clientPort);
+					destination.address(address);
+					sink.send(destination);
+				}
+			}
+		}
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / framesPerRun;
+	}
+
+	// Per frame: a snapshot of the table and a walk over the ready-made endpoints
+	double runTable(const std::forward_list<ClientInfo>& clients, Sink& sink) {
+		std::atomic<std::shared_ptr<const EndpointTable>> cache{ EndpointTable::build(clients, clientPort) };
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < framesPerRun; ++i) {
+			for (auto compression : { Compression::none, Compression::kbps_128, Compression::kbps_320 }) {
+				const auto table = cache.load();
+				for (auto&& destination : table->group(compression).unicast.endpoints) {
+					sink.send(destination);
+				}
+			}
+		}
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / framesPerRun;
+	}
+
+	// Per clients update: building and publishing a new table
+	double runRebuild(const std::forward_list<ClientInfo>& clients) {
+		constexpr int rebuilds = 1000;
+		std::atomic<std::shared_ptr<const EndpointTable>> cache{ EndpointTable::build(clients, clientPort) };
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < rebuilds; ++i) {
+			const auto previous = cache.load();
+			cache.store(EndpointTable::build(clients, clientPort, previous.get()));
+		}
+		const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / rebuilds;
+	}
+
+	// Per clients update: applying the change of one client and publishing the table
+	double runApply(const std::forward_list<ClientInfo>& clients) {
+		constexpr int updates = 1000;
+		std::atomic<std::shared_ptr<const EndpointTable>> cache{ EndpointTable::build(clients, clientPort) };
+		const ClientInfo client(boost::asio::ip::address_v4(0xC0A8FFFFu), Compression::kbps_128);
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < updates; ++i) {
+			const auto type = i % 2 == 0 ? ClientsDelta::Type::added : ClientsDelta::Type::removed;
+			cache.store(cache.load()->apply({ type, client }, clientPort));
+		}
+		const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / updates;
+	}
+
+	TEST(EndpointTableBenchmark, DISABLED_FanOutPerFrame) {
+		Sink sink;
+		std::cout << std::setw(8) << "clients"
+			<< std::setw(16) << "map ns/frame" << std::setw(16) << "table ns/frame"
+			<< std::setw(16) << "rebuild us" << std::setw(16) << "apply us" << '\n';
+		for (int clientCount : { 1, 10, 100, 1000 }) {
+			const auto clients = makeClients(clientCount);
+			const auto map = runMap(clients, sink);
+			const auto table = runTable(clients, sink);
+			const auto rebuild = runRebuild(clients);
+			const auto apply = runApply(clients);
+			std::cout << std::setw(8) << clientCount << std::fixed << std::setprecision(1)
+				<< std::setw(16) << map << std::setw(16) << table << std::setw(16) << rebuild
+				<< std::setw(16) << apply << '\n';
+		}
+		EXPECT_NE(sink.value, 0);
+	}
+}
@@ -0,0 +1,210 @@
+#include <forward_list>
+
+#include "pch.h"
+#include "Clients.h"
+#include "EndpointTable.h"
+
+namespace {
+	using Audio::Compression;
+	using boost::asio::ip::make_address_v4;
+	using boost::asio::ip::udp;
+
+	constexpr int clientPort = 55555;
+
+	TEST(EndpointTable, EmptyTable) {
+		const auto table = EndpointTable::build({}, clientPort);
+
+		EXPECT_TRUE(table->empty());
+		EXPECT_TRUE(table->groups().empty());
+		EXPECT_TRUE(table->group(Compression::kbps_128).empty());
+	}
+
+	TEST(EndpointTable, GroupsByCompressionAndProtocol) {
+		const std::forward_list<ClientInfo> clients{
+			{ make_address_v4("192.168.0.3"), Compression::none },
+			{ make_address_v4("192.168.0.1"), Compression::none },
+			{ make_address_v4("192.168.0.2"), Compression::kbps_64, Net::Protocol::multicast }
+		};
+
+		const auto table = EndpointTable::build(clients, clientPort);
+
+		EXPECT_EQ(table->groups().size(), 2);
+		const std::vector<udp::endpoint> expectedNone{
+			{ make_address_v4("192.168.0.1"), clientPort },
+			{ make_address_v4("192.168.0.3"), clientPort }
+		};
+		EXPECT_EQ(table->group(Compression::none).unicast.endpoints, expectedNone);
+		EXPECT_TRUE(table->group(Compression::none).multicast.endpoints.empty());
+		const std::vector<udp::endpoint> expected64{ { make_address_v4("192.168.0.2"), clientPort } };
+		EXPECT_EQ(table->group(Compression::kbps_64).multicast.endpoints, expected64);
+		EXPECT_TRUE(table->group(Compression::kbps_64).unicast.endpoints.empty());
+		EXPECT_TRUE(table->group(Compression::kbps_320).empty());
+	}
+
+	TEST(EndpointTable, SharesUnchangedGroups) {
+		std::forward_list<ClientInfo> clients{
+			{ make_address_v4("192.168.0.1"), Compression::none },
+			{ make_address_v4("192.168.0.2"), Compression::kbps_64 }
+		};
+		const auto previous = EndpointTable::build(clients, clientPort);
+		clients.push_front({ make_address_v4("192.168.0.3"), Compression::kbps_64 });
+
+		const auto table = EndpointTable::build(clients, clientPort, previous.get());
+
+		EXPECT_EQ(&table->group(Compression::none), &previous->group(Compression::none));
+		EXPECT_NE(&table->group(Compression::kbps_64), &previous->group(Compression::kbps_64));
+		EXPECT_EQ(table->group(Compression::kbps_64).unicast.endpoints.size(), 2);
+	}
+
+	TEST(EndpointTable, AppliesDeltas) {
+		const ClientInfo first{ make_address_v4("192.168.0.1"), Compression::none };
+		const ClientInfo second{ make_address_v4("192.168.0.2"), Compression::none };
+		const ClientInfo secondChanged{ second.address, Compression::kbps_128 };
+		const auto empty = EndpointTable::build({}, clientPort);
+
+		const auto added = empty
+			->apply({ ClientsDelta::Type::added, second }, clientPort)
+			->apply({ ClientsDelta::Type::added, first }, clientPort);
+		const auto changed = added->apply({ ClientsDelta::Type::formatChanged, secondChanged, second }, clientPort);
+		const auto removed = changed->apply({ ClientsDelta::Type::removed, first }, clientPort);
+
+		const std::vector<udp::endpoint> expectedAdded{ { first.address, clientPort }, { second.address, clientPort } };
+		EXPECT_EQ(added->group(Compression::none).unicast.endpoints, expectedAdded);
+		EXPECT_EQ(changed->group(Compression::none).unicast.endpoints.size(), 1);
+		EXPECT_EQ(changed->group(Compression::kbps_128).unicast.endpoints.size(), 1);
+		EXPECT_TRUE(removed->group(Compression::none).empty());
+		EXPECT_EQ(removed->groups().size(), 1);
+		// Groups not touched by the change are shared
+		EXPECT_EQ(&removed->group(Compression::kbps_128), &changed->group(Compression::kbps_128));
+	}
+
+	TEST(EndpointTable, ProbesRoundTripClients) {
+		const ClientInfo initial{ make_address_v4("192.168.0.1"), Compression::none, Net::Protocol::initial };
+		const ClientInfo multicast{ make_address_v4("192.168.0.2"), Compression::none, Net::Protocol::multicast };
+		const ClientInfo roundTrip{ make_address_v4("192.168.0.3"), Compression::none, Net::Protocol::roundTrip };
+		const ClientInfo roundTripChanged{ roundTrip.address, Compression::kbps_128, Net::Protocol::roundTrip };
+
+		const auto built = EndpointTable::build({ initial, multicast, roundTrip }, clientPort);
+		const auto changed = built->apply({ ClientsDelta::Type::formatChanged, roundTripChanged, roundTrip }, clientPort);
+
+		const std::vector<udp::endpoint> expected{ { roundTrip.address, clientPort } };
+		EXPECT_EQ(built->group(Compression::none).probed.endpoints, expected);
+		// Probed clients get the audio like the others
+		EXPECT_TRUE(built->group(Compression::none).multicast.contains({ roundTrip.address, clientPort }));
+		EXPECT_TRUE(changed->group(Compression::none).probed.empty());
+		EXPECT_EQ(changed->group(Compression::kbps_128).probed.endpoints, expected);
+		const std::vector<udp::endpoint> expectedUnprobed{ { initial.address, clientPort },
+			{ multicast.address, clientPort } };
+		EXPECT_EQ(built->group(Compression::none).unprobed.endpoints, expectedUnprobed);
+		EXPECT_EQ(changed->group(Compression::none).unprobed.endpoints, expectedUnprobed);
+		EXPECT_TRUE(changed->group(Compression::kbps_128).unprobed.empty());
+	}
+
+	TEST(EndpointTable, ListsSilenceAwareClients) {
+		const ClientInfo roundTrip{ make_address_v4("192.168.0.1"), Compression::none, Net::Protocol::roundTrip };
+		const ClientInfo silence{ make_address_v4("192.168.0.2"), Compression::none, Net::Protocol::silence };
+		const ClientInfo silenceChanged{ silence.address, Compression::kbps_128, Net::Protocol::silence };
+
+		const auto built = EndpointTable::build({ roundTrip, silence }, clientPort);
+		const auto changed = built->apply({ ClientsDelta::Type::formatChanged, silenceChanged, silence }, clientPort);
+
+		const std::vector<udp::endpoint> expected{ { silence.address, clientPort } };
+		EXPECT_EQ(built->group(Compression::none).silenceAware.endpoints, expected);
+		EXPECT_EQ(built->group(Compression::none).probed.endpoints.size(), 2);
+		EXPECT_TRUE(changed->group(Compression::none).silenceAware.empty());
+		EXPECT_EQ(changed->group(Compression::kbps_128).silenceAware.endpoints, expected);
+	}
+
+	TEST(EndpointTable, ListsParityClients) {
+		const ClientInfo optedIn{ make_address_v4("192.168.0.1"), Compression::kbps_64, Net::Protocol::parity, nullptr, 0,
+			true };
+		const ClientInfo optedOut{ make_address_v4("192.168.0.2"), Compression::kbps_64, Net::Protocol::parity };
+		// Too old to get the parity
+		const ClientInfo older{ make_address_v4("192.168.0.3"), Compression::kbps_64, Net::Protocol::lossReport, nullptr,
+			0, true };
+		const ClientInfo optedOutChanged{ optedOut.address, Compression::kbps_64, Net::Protocol::parity, nullptr, 0,
+			true };
+
+		const auto built = EndpointTable::build({ optedIn, optedOut, older }, clientPort);
+		const auto changed = built->apply({ ClientsDelta::Type::formatChanged, optedOutChanged, optedOut }, clientPort);
+		const auto removed = changed->apply({ ClientsDelta::Type::removed, optedIn }, clientPort);
+
+		const std::vector<udp::endpoint> expected{ { optedIn.address, clientPort } };
+		EXPECT_EQ(built->group(Compression::kbps_64).parity.endpoints, expected);
+		EXPECT_EQ(changed->group(Compression::kbps_64).parity.endpoints.size(), 2);
+		const std::vector<udp::endpoint> expectedRemoved{ { optedOut.address, clientPort } };
+		EXPECT_EQ(removed->group(Compression::kbps_64).parity.endpoints, expectedRemoved);
+	}
+
+	TEST(EndpointTable, ListsRetransmitClients) {
+		const ClientInfo current{ make_address_v4("192.168.0.1"), Compression::none, Net::Protocol::retransmit };
+		const ClientInfo older{ make_address_v4("192.168.0.2"), Compression::none, Net::Protocol::parity };
+		const ClientInfo added{ make_address_v4("192.168.0.3"), Compression::none, Net::Protocol::retransmit };
+
+		const auto built = EndpointTable::build({ current, older }, clientPort);
+		const auto applied = built->apply({ ClientsDelta::Type::added, added }, clientPort);
+		const auto removed = applied->apply({ ClientsDelta::Type::removed, current }, clientPort);
+
+		const auto& retransmit = applied->group(Compression::none).retransmit;
+		const std::vector<udp::endpoint> expected{ { current.address, clientPort }, { added.address, clientPort } };
+		EXPECT_EQ(retransmit.endpoints, expected);
+		EXPECT_EQ(retransmit.indexOf({ added.address, clientPort }), 1u);
+		EXPECT_FALSE(retransmit.indexOf({ older.address, clientPort }));
+		EXPECT_EQ(built->group(Compression::none).retransmit.endpoints.size(), 1);
+		EXPECT_EQ(removed->group(Compression::none).retransmit.endpoints.size(), 1);
+	}
+
+	TEST(EndpointTable, ListsAggregatedClients) {
+		const auto protocol = Net::Protocol::aggregation;
+		const ClientInfo single{ make_address_v4("192.168.0.1"), Compression::kbps_64, protocol, nullptr, 0, true, 1 };
+		const ClientInfo triple{ make_address_v4("192.168.0.2"), Compression::kbps_64, protocol, nullptr, 0, true, 3 };
+		// Too old to get several frames per packet
+		const ClientInfo older{ make_address_v4("192.168.0.3"), Compression::kbps_64, Net::Protocol::retransmit,
+			nullptr, 0, false, 3 };
+		const ClientInfo tripleChanged{ triple.address, Compression::kbps_64, protocol, nullptr, 0, true, 1 };
+
+		const auto built = EndpointTable::build({ single, triple, older }, clientPort);
+		const auto changed = built->apply({ ClientsDelta::Type::formatChanged, tripleChanged, triple }, clientPort);
+		const auto removed = built->apply({ ClientsDelta::Type::removed, triple }, clientPort);
+
+		const auto& group = built->group(Compression::kbps_64);
+		const std::vector<udp::endpoint> expectedTriple{ { triple.address, clientPort } };
+		EXPECT_EQ(group.aggregated[3].endpoints, expectedTriple);
+		EXPECT_EQ(group.multicast.endpoints.size(), 2);
+		// The parity is made of the single frame packets
+		const std::vector<udp::endpoint> expectedParity{ { single.address, clientPort } };
+		EXPECT_EQ(group.parity.endpoints, expectedParity);
+		// The retransmits are single frame packets, any client takes them
+		EXPECT_EQ(group.retransmit.endpoints.size(), 3);
+		EXPECT_TRUE(changed->group(Compression::kbps_64).aggregated[3].empty());
+		EXPECT_EQ(changed->group(Compression::kbps_64).multicast.endpoints.size(), 3);
+		EXPECT_TRUE(removed->group(Compression::kbps_64).aggregated[3].empty());
+	}
+
+	TEST(EndpointTable, KeepsAggregatedGroup) {
+		const ClientInfo client{ make_address_v4("192.168.0.1"), Compression::none, Net::Protocol::aggregation, nullptr,
+			0, false, 2 };
+
+		const auto table = EndpointTable::build({ client }, clientPort);
+
+		EXPECT_FALSE(table->empty());
+		EXPECT_EQ(table->group(Compression::none).aggregated[2].endpoints.size(), 1);
+	}
+
+	TEST(EndpointTable, KeepsCountersInEndpointOrder) {
+		const auto firstCounters = std::make_shared<TrafficCounters>();
+		const auto secondCounters = std::make_shared<TrafficCounters>();
+		const ClientInfo first{ make_address_v4("192.168.0.1"), Compression::none, Net::Protocol::initial, firstCounters };
+		const ClientInfo second{ make_address_v4("192.168.0.2"), Compression::none, Net::Protocol::initial, secondCounters };
+		const auto empty = EndpointTable::build({}, clientPort);
+
+		const auto built = EndpointTable::build({ second, first }, clientPort);
+		const auto applied = empty
+			->apply({ ClientsDelta::Type::added, second }, clientPort)
+			->apply({ ClientsDelta::Type::added, first }, clientPort);
+
+		const std::vector expected{ firstCounters, secondCounters };
+		EXPECT_EQ(built->group(Compression::none).unicast.counters, expected);
+		EXPECT_EQ(applied->group(Compression::none).unicast.counters, expected);
+	}
+}
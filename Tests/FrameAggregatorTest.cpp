@@ -0,0 +1,196 @@
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "pch.h"
+#include "FrameAggregator.h"
+#include "NetDefines.h"
+
+namespace {
+	using Audio::Compression;
+
+	// TOC bytes of the stereo single frame Opus packets
+	constexpr char celt10ms = static_cast<char>((30 << 3) | 0x04);
+	constexpr char celt5ms = static_cast<char>((29 << 3) | 0x04);
+	constexpr char silk60ms = static_cast<char>((3 << 3) | 0x04);
+
+	std::vector<char> opusFrame(char toc, size_t payloadSize, char fill) {
+		std::vector<char> result(payloadSize + 1, fill);
+		result[0] = toc;
+		return result;
+	}
+
+	class FrameAggregatorTest : public testing::Test {
+	protected:
+		PacketPtr packet(const std::vector<char>& data) {
+			auto result = pool_->acquire();
+			result->resize(data.size());
+			if (!data.empty()) {
+				std::memcpy(result->data(), data.data(), data.size());
+			}
+			return result;
+		}
+
+		// Payloads of the frames of an Opus packet, RFC 6716 section 3.2
+		static std::vector<std::vector<char>> opusPayloads(std::span<const char> opusPacket) {
+			const auto bytes = [&](size_t i) { return static_cast<uint8_t>(opusPacket[i]); };
+			// Reads a frame length, one or two bytes
+			const auto readLength = [&](size_t& position) {
+				size_t length = bytes(position++);
+				if (length >= 252) {
+					length += 4 * bytes(position++);
+				}
+				return length;
+			};
+			size_t position = 1;
+			size_t end = opusPacket.size();
+			std::vector<size_t> sizes;
+			switch (bytes(0) & 0x03) {
+			case 0:
+				sizes = { end - position };
+				break;
+			case 1:
+				sizes = { (end - position) / 2, (end - position) / 2 };
+				break;
+			case 2:
+				sizes = { readLength(position) };
+				sizes.push_back(end - position - sizes[0]);
+				break;
+			default: {
+				const auto countByte = bytes(position++);
+				const size_t count = countByte & 0x3F;
+				if (countByte & 0x40) {
+					size_t padding = 0;
+					do {
+						padding += bytes(position) == 255 ? 254 : bytes(position);
+					} while (bytes(position++) == 255);
+					end -= padding;
+				}
+				if (countByte & 0x80) {
+					for (size_t i = 0; i + 1 < count; ++i) {
+						sizes.push_back(readLength(position));
+					}
+					size_t rest = end - position;
+					for (auto size : sizes) {
+						rest -= size;
+					}
+					sizes.push_back(rest);
+				} else {
+					sizes.assign(count, (end - position) / count);
+				}
+			}
+			}
+			std::vector<std::vector<char>> result;
+			for (auto size : sizes) {
+				result.emplace_back(opusPacket.begin() + position, opusPacket.begin() + position + size);
+				position += size;
+			}
+			return result;
+		}
+
+		std::shared_ptr<PacketPool> pool_ = PacketPool::create(4000, 8);
+	};
+
+	TEST_F(FrameAggregatorTest, RepacketizesOpusFrames) {
+		FrameAggregator aggregator(Compression::kbps_64, 3);
+		const std::vector frames{ opusFrame(celt10ms, 80, 1), opusFrame(celt10ms, 3, 2), opusFrame(celt10ms, 300, 3) };
+
+		EXPECT_FALSE(aggregator.add(7, packet(frames[0])));
+		EXPECT_FALSE(aggregator.add(8, packet(frames[1])));
+		const auto actual = aggregator.add(9, packet(frames[2]));
+
+		ASSERT_TRUE(actual);
+		EXPECT_EQ(actual->first, 7u);
+		EXPECT_EQ(actual->frames, 3);
+		EXPECT_EQ(actual->audioData[0] & ~0x03, celt10ms & ~0x03);
+		const auto payloads = opusPayloads(actual->audioData);
+		ASSERT_EQ(payloads.size(), 3);
+		for (size_t i = 0; i < frames.size(); ++i) {
+			EXPECT_EQ(payloads[i], std::vector<char>(frames[i].begin() + 1, frames[i].end())) << "frame " << i;
+		}
+	}
+
+	TEST_F(FrameAggregatorTest, ConcatenatesUncompressedFrames) {
+		FrameAggregator aggregator(Compression::none, 2);
+		const std::vector<char> first(1920, 1);
+		const std::vector<char> second(1920, 2);
+
+		EXPECT_FALSE(aggregator.add(0xFFFF'FFFFu, packet(first)));
+		const auto actual = aggregator.add(0, packet(second));
+
+		ASSERT_TRUE(actual);
+		EXPECT_EQ(actual->first, 0xFFFF'FFFFu);
+		EXPECT_EQ(actual->frames, 2);
+		auto expected = first;
+		expected.insert(expected.end(), second.begin(), second.end());
+		EXPECT_EQ(std::vector<char>(actual->audioData.begin(), actual->audioData.end()), expected);
+	}
+
+	TEST_F(FrameAggregatorTest, EndsPacketAtSequenceGap) {
+		FrameAggregator aggregator(Compression::none, 3);
+		aggregator.add(1, packet({ 1 }));
+		aggregator.add(2, packet({ 2 }));
+
+		const auto ended = aggregator.add(4, packet({ 4 }));
+
+		ASSERT_TRUE(ended);
+		EXPECT_EQ(ended->first, 1u);
+		EXPECT_EQ(ended->frames, 2);
+		EXPECT_EQ(std::vector<char>(ended->audioData.begin(), ended->audioData.end()), std::vector<char>({ 1, 2 }));
+		const auto flushed = aggregator.flush();
+		ASSERT_TRUE(flushed);
+		EXPECT_EQ(flushed->first, 4u);
+		EXPECT_EQ(flushed->frames, 1);
+		EXPECT_FALSE(aggregator.flush());
+	}
+
+	TEST_F(FrameAggregatorTest, EndsOpusPacketOnOtherFrameLength) {
+		FrameAggregator aggregator(Compression::kbps_128, 3);
+		const auto first = opusFrame(celt10ms, 50, 1);
+		aggregator.add(1, packet(first));
+
+		const auto ended = aggregator.add(2, packet(opusFrame(celt5ms, 30, 2)));
+
+		ASSERT_TRUE(ended);
+		EXPECT_EQ(ended->frames, 1);
+		const std::vector<std::vector<char>> expected{ { first.begin() + 1, first.end() } };
+		EXPECT_EQ(opusPayloads(ended->audioData), expected);
+		const auto flushed = aggregator.flush();
+		ASSERT_TRUE(flushed);
+		EXPECT_EQ(flushed->first, 2u);
+	}
+
+	TEST_F(FrameAggregatorTest, EndsOpusPacketPast120Ms) {
+		FrameAggregator aggregator(Compression::kbps_64, 3);
+		aggregator.add(1, packet(opusFrame(silk60ms, 40, 1)));
+		EXPECT_FALSE(aggregator.add(2, packet(opusFrame(silk60ms, 40, 2))));
+
+		const auto ended = aggregator.add(3, packet(opusFrame(silk60ms, 40, 3)));
+
+		ASSERT_TRUE(ended);
+		EXPECT_EQ(ended->frames, 2);
+		EXPECT_EQ(opusPayloads(ended->audioData).size(), 2);
+	}
+
+	TEST_F(FrameAggregatorTest, SendsFrameRepacketizerRejectsAlone) {
+		FrameAggregator aggregator(Compression::kbps_64, 2);
+		const std::vector<char> empty{};
+		const auto valid = opusFrame(celt10ms, 20, 1);
+
+		aggregator.add(1, packet(empty));
+		const auto ended = aggregator.add(2, packet(valid));
+
+		ASSERT_TRUE(ended);
+		EXPECT_EQ(ended->first, 1u);
+		EXPECT_TRUE(ended->audioData.empty());
+		EXPECT_EQ(aggregator.flush()->first, 2u);
+	}
+
+	TEST_F(FrameAggregatorTest, RejectsFramesPerPacketOutOfRange) {
+		EXPECT_THROW(FrameAggregator(Compression::none, 1), std::invalid_argument);
+		EXPECT_THROW(FrameAggregator(Compression::none, Net::Packet::maxFramesPerPacket + 1), std::invalid_argument);
+		EXPECT_EQ(FrameAggregator(Compression::kbps_64, Net::Packet::maxFramesPerPacket).framesPerPacket(),
+			Net::Packet::maxFramesPerPacket);
+	}
+}
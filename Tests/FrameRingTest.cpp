@@ -0,0 +1,118 @@
+#include <numeric>
+#include <vector>
+
+#include "pch.h"
+#include "FrameRing.h"
+
+namespace {
+	constexpr size_t frameSize = 4;
+
+	std::vector<char> sequence(size_t size, char first = 0) {
+		std::vector<char> result(size);
+		std::iota(result.begin(), result.end(), first);
+		return result;
+	}
+
+	std::vector<char> toVector(std::span<const char> frame) {
+		return { frame.begin(), frame.end() };
+	}
+
+	TEST(FrameRing, RoundsCapacityToPowerOfTwo) {
+		FrameRing ring(frameSize, 5);
+
+		EXPECT_EQ(ring.frameCapacity(), 8);
+		EXPECT_EQ(ring.frameSize(), frameSize);
+		EXPECT_EQ(ring.size(), 0);
+		EXPECT_TRUE(ring.front().empty());
+	}
+
+	TEST(FrameRing, GathersWritesIntoFrames) {
+		FrameRing ring(frameSize, 4);
+		const auto audio = sequence(10);
+
+		ring.write({ audio.data(), 3 });
+		EXPECT_EQ(ring.frames(), 0);
+		EXPECT_EQ(ring.partialSize(), 3);
+		ring.write({ audio.data() + 3, 7 });
+
+		EXPECT_EQ(ring.frames(), 2);
+		EXPECT_EQ(ring.partialSize(), 2);
+		EXPECT_EQ(ring.size(), 10);
+		EXPECT_EQ(toVector(ring.front()), sequence(4));
+		ring.pop();
+		EXPECT_EQ(toVector(ring.front()), sequence(4, 4));
+	}
+
+	TEST(FrameRing, WrapsAroundWithoutMovingFrames) {
+		FrameRing ring(frameSize, 2);
+		const auto first = sequence(frameSize, 0);
+		const auto second = sequence(frameSize, 10);
+		const auto third = sequence(frameSize, 20);
+		ring.write(first);
+		ring.write(second);
+		const auto* firstSlot = ring.front().data();
+		ring.pop();
+
+		ring.write(third);
+
+		ASSERT_EQ(ring.frames(), 2);
+		EXPECT_EQ(toVector(ring.front()), second);
+		ring.pop();
+		EXPECT_EQ(toVector(ring.front()), third);
+		// The third frame reuses the slot of the first one
+		EXPECT_EQ(ring.front().data(), firstSlot);
+	}
+
+	TEST(FrameRing, StopsWritingWhenFull) {
+		FrameRing ring(frameSize, 2);
+		const auto audio = sequence(3 * frameSize);
+
+		const auto written = ring.write(audio);
+
+		EXPECT_EQ(written, 2 * frameSize);
+		EXPECT_EQ(ring.frames(), 2);
+		EXPECT_EQ(ring.partialSize(), 0);
+	}
+
+	TEST(FrameRing, TakesFrameBufferOut) {
+		FrameRing ring(frameSize, 2);
+		const auto audio = sequence(frameSize + 2);
+		ring.write(audio);
+		const auto* slot = ring.front().data();
+
+		const auto frame = ring.take();
+
+		ASSERT_TRUE(frame);
+		EXPECT_EQ(frame->data(), slot);
+		EXPECT_EQ(toVector({ frame->data(), frame->size() }), sequence(frameSize));
+		EXPECT_EQ(ring.frames(), 0);
+		EXPECT_EQ(ring.partialSize(), 2);
+		EXPECT_FALSE(ring.take());
+	}
+
+	TEST(FrameRing, RefillsTakenSlot) {
+		FrameRing ring(frameSize, 2);
+		const auto first = sequence(frameSize, 0);
+		const auto second = sequence(frameSize, 10);
+		const auto third = sequence(frameSize, 20);
+		ring.write(first);
+		ring.write(second);
+		const auto taken = ring.take();
+
+		ring.write(third);
+
+		// The frame taken out keeps its audio while its slot gets the new one
+		EXPECT_EQ(toVector({ taken->data(), taken->size() }), first);
+		ASSERT_EQ(ring.frames(), 2);
+		EXPECT_EQ(toVector({ ring.take()->data(), frameSize }), second);
+		EXPECT_EQ(toVector({ ring.take()->data(), frameSize }), third);
+	}
+
+	TEST(FrameRing, PopEmpty) {
+		FrameRing ring(frameSize, 2);
+
+		ring.pop();
+
+		EXPECT_EQ(ring.frames(), 0);
+	}
+}
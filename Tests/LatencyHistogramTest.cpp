@@ -0,0 +1,82 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "pch.h"
+#include "LatencyHistogram.h"
+
+namespace {
+	using namespace std::chrono_literals;
+
+	TEST(LatencyHistogram, Empty) {
+		LatencyHistogram histogram;
+
+		EXPECT_EQ(histogram.count(), 0);
+		EXPECT_EQ(histogram.percentile(50), 0us);
+		EXPECT_EQ(histogram.stats(), LatencyStats{});
+	}
+
+	TEST(LatencyHistogram, SmallValuesAreExact) {
+		LatencyHistogram histogram;
+		for (int i = 1; i <= 20; ++i) {
+			histogram.record(std::chrono::microseconds(i));
+		}
+
+		const auto stats = histogram.stats();
+
+		EXPECT_EQ(stats.count, 20);
+		EXPECT_EQ(stats.min, 1us);
+		EXPECT_EQ(stats.max, 20us);
+		EXPECT_EQ(stats.mean, 10us);
+		EXPECT_EQ(stats.p50, 10us);
+		EXPECT_EQ(stats.p90, 18us);
+		EXPECT_EQ(histogram.percentile(100), 20us);
+	}
+
+	TEST(LatencyHistogram, LargeValuesWithinRelativeError) {
+		const std::vector<std::chrono::microseconds> values{ 100us, 1'000us, 12'345us, 987'654us, 10s };
+		for (auto&& value : values) {
+			LatencyHistogram histogram;
+			// Another value above, so the percentile is not capped by the maximum
+			histogram.record(value);
+			histogram.record(value * 2);
+
+			const auto actual = histogram.percentile(50);
+
+			EXPECT_GE(actual, value);
+			EXPECT_LE(actual - value, value / 16);
+		}
+	}
+
+	TEST(LatencyHistogram, ClampsOutOfRange) {
+		LatencyHistogram histogram;
+
+		histogram.record(-5us);
+		histogram.record(std::chrono::hours(1));
+
+		const auto stats = histogram.stats();
+		EXPECT_EQ(stats.min, 0us);
+		EXPECT_EQ(stats.max, std::chrono::microseconds(LatencyHistogram::maxValue));
+	}
+
+	TEST(LatencyHistogram, ConcurrentRecording) {
+		constexpr int threadCount = 4;
+		constexpr int valuesPerThread = 10'000;
+		LatencyHistogram histogram;
+		{
+			std::vector<std::jthread> threads;
+			for (int t = 0; t < threadCount; ++t) {
+				threads.emplace_back([&] {
+					for (int i = 0; i < valuesPerThread; ++i) {
+						histogram.record(std::chrono::microseconds(i));
+					}
+				});
+			}
+		}
+
+		const auto stats = histogram.stats();
+
+		EXPECT_EQ(stats.count, threadCount * valuesPerThread);
+		EXPECT_EQ(stats.max, std::chrono::microseconds(valuesPerThread - 1));
+	}
+}
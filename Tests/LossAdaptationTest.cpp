@@ -0,0 +1,92 @@
+#include "pch.h"
+#include "LossAdaptation.h"
+
+namespace {
+	using Audio::Compression;
+	using State = LossAdaptation::State;
+
+	// Reports the loss in percent of 100 packets
+	const State& reportLoss(LossAdaptation& adaptation, uint32_t lost, Compression lowest = Compression::kbps_64) {
+		return adaptation.report(100 - lost, lost, lowest);
+	}
+
+	TEST(LossAdaptation, StartsWithRequested) {
+		const LossAdaptation adaptation(Compression::kbps_256);
+
+		EXPECT_EQ(adaptation.state(), (State{ Compression::kbps_256, 0 }));
+		EXPECT_EQ(adaptation.requested(), Compression::kbps_256);
+	}
+
+	TEST(LossAdaptation, StepsDownToLowest) {
+		LossAdaptation adaptation(Compression::kbps_256);
+
+		EXPECT_EQ(reportLoss(adaptation, 10, Compression::kbps_128), (State{ Compression::kbps_192, 10 }));
+		EXPECT_EQ(reportLoss(adaptation, 20, Compression::kbps_128), (State{ Compression::kbps_128, 20 }));
+		EXPECT_EQ(reportLoss(adaptation, 20, Compression::kbps_128), (State{ Compression::kbps_128, 20 }));
+	}
+
+	TEST(LossAdaptation, StepsUpAfterCleanReports) {
+		LossAdaptation adaptation(Compression::kbps_192);
+		reportLoss(adaptation, 30);
+		reportLoss(adaptation, 30);
+
+		for (int i = 1; i < LossAdaptation::stepUpReports; ++i) {
+			EXPECT_EQ(reportLoss(adaptation, LossAdaptation::stepUpLoss), (State{ Compression::kbps_64, 0 }));
+		}
+		EXPECT_EQ(reportLoss(adaptation, 0), (State{ Compression::kbps_128, 0 }));
+		for (int i = 0; i < LossAdaptation::stepUpReports; ++i) {
+			reportLoss(adaptation, 0);
+		}
+		EXPECT_EQ(adaptation.state().compression, Compression::kbps_192);
+		for (int i = 0; i < LossAdaptation::stepUpReports; ++i) {
+			reportLoss(adaptation, 0);
+		}
+		EXPECT_EQ(adaptation.state().compression, Compression::kbps_192);
+	}
+
+	TEST(LossAdaptation, ModerateLossHoldsBitrate) {
+		LossAdaptation adaptation(Compression::kbps_128);
+		reportLoss(adaptation, 10);
+
+		for (int i = 1; i < LossAdaptation::stepUpReports; ++i) {
+			reportLoss(adaptation, 0);
+		}
+		EXPECT_EQ(reportLoss(adaptation, 5), (State{ Compression::kbps_64, 5 }));
+		for (int i = 1; i < LossAdaptation::stepUpReports; ++i) {
+			reportLoss(adaptation, 0);
+		}
+		EXPECT_EQ(adaptation.state().compression, Compression::kbps_64);
+	}
+
+	TEST(LossAdaptation, KeepsRequestedWithoutLowest) {
+		LossAdaptation adaptation(Compression::kbps_128);
+
+		EXPECT_EQ(reportLoss(adaptation, 40, Compression::none), (State{ Compression::kbps_128, 40 }));
+		// Above the requested one
+		EXPECT_EQ(reportLoss(adaptation, 40, Compression::kbps_320), (State{ Compression::kbps_128, 40 }));
+	}
+
+	TEST(LossAdaptation, RoundsLossToSteps) {
+		LossAdaptation adaptation(Compression::kbps_320);
+
+		EXPECT_EQ(reportLoss(adaptation, 2).lossPercent, 0);
+		EXPECT_EQ(reportLoss(adaptation, 3).lossPercent, 5);
+		EXPECT_EQ(reportLoss(adaptation, 7).lossPercent, 5);
+		EXPECT_EQ(reportLoss(adaptation, 8).lossPercent, 10);
+		EXPECT_EQ(adaptation.report(0, 7, Compression::kbps_64).lossPercent, 100);
+		EXPECT_EQ(adaptation.report(999'999'999, 1, Compression::kbps_64).lossPercent, 0);
+	}
+
+	TEST(LossAdaptation, IgnoresEmptyReport) {
+		LossAdaptation adaptation(Compression::kbps_128);
+		reportLoss(adaptation, 50);
+
+		EXPECT_EQ(adaptation.report(0, 0, Compression::kbps_64), (State{ Compression::kbps_64, 50 }));
+	}
+
+	TEST(LossAdaptation, UncompressedStaysAsIs) {
+		LossAdaptation adaptation(Compression::none);
+
+		EXPECT_EQ(reportLoss(adaptation, 50), (State{ Compression::none, 0 }));
+	}
+}
@@ -0,0 +1,65 @@
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "pch.h"
+#include "CaptureCounters.h"
+#include "Clients.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "PipelineLatency.h"
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+namespace {
+	using boost::asio::ip::tcp;
+	using ::testing::HasSubstr;
+	using ::testing::StartsWith;
+
+	class MetricsServerTest : public testing::Test {
+	protected:
+		std::string request(const std::string& request) {
+			tcp::socket socket(ioContext_);
+			socket.connect({ boost::asio::ip::address_v4::loopback(), server_.port() });
+			boost::asio::write(socket, boost::asio::buffer(request));
+			std::string response;
+			// The server closes the connection after the response
+			boost::system::error_code ec;
+			boost::asio::read(socket, boost::asio::dynamic_buffer(response), ec);
+			return response;
+		}
+		boost::asio::io_context ioContext_;
+		std::shared_ptr<Metrics> metrics_ = std::make_shared<Metrics>(std::make_shared<Clients>(),
+			std::make_shared<CaptureCounters>(), std::make_shared<PipelineLatency>());
+		MetricsServer server_{ 0, ioContext_, metrics_ };
+		// Serves while the test talks to the server synchronously
+		boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_ =
+			boost::asio::make_work_guard(ioContext_);
+		std::jthread ioThread_{ [this] { ioContext_.run(); } };
+
+		void TearDown() override {
+			ioContext_.stop();
+		}
+	};
+
+	TEST_F(MetricsServerTest, ServesMetrics) {
+		const auto response = request("GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+
+		EXPECT_THAT(response, StartsWith("HTTP/1.1 200 OK\r\n"));
+		EXPECT_THAT(response, HasSubstr("Connection: close\r\n"));
+		EXPECT_THAT(response, HasSubstr("\r\n\r\n# HELP soundremote_clients"));
+	}
+
+	TEST_F(MetricsServerTest, UnknownPath) {
+		const auto response = request("GET /other HTTP/1.1\r\n\r\n");
+
+		EXPECT_THAT(response, StartsWith("HTTP/1.1 404 Not Found\r\n"));
+	}
+
+	TEST_F(MetricsServerTest, RespondsToGetOnly) {
+		EXPECT_THAT(server_.respond("POST /metrics HTTP/1.1\r\n\r\n"), StartsWith("HTTP/1.1 404"));
+		EXPECT_THAT(server_.respond("GET /metrics?name=x HTTP/1.1\r\n\r\n"), StartsWith("HTTP/1.1 200"));
+	}
+}
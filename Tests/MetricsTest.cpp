@@ -0,0 +1,100 @@
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "pch.h"
+#include "CaptureCounters.h"
+#include "Clients.h"
+#include "Metrics.h"
+#include "PipelineLatency.h"
+
+namespace {
+	using Audio::Compression;
+	using boost::asio::ip::make_address_v4;
+	using ::testing::HasSubstr;
+	using namespace std::chrono_literals;
+
+	class MetricsTest : public testing::Test {
+	protected:
+		std::shared_ptr<Clients> clients_ = std::make_shared<Clients>();
+		std::shared_ptr<CaptureCounters> captureCounters_ = std::make_shared<CaptureCounters>();
+		std::shared_ptr<PipelineLatency> pipelineLatency_ = std::make_shared<PipelineLatency>();
+		Metrics metrics_{ clients_, captureCounters_, pipelineLatency_ };
+		const Metrics::TimePoint start_ = std::chrono::steady_clock::now();
+	};
+
+	TEST_F(MetricsTest, ClientsPerCompression) {
+		clients_->add(make_address_v4("192.168.0.1"), Compression::kbps_128);
+		clients_->add(make_address_v4("192.168.0.2"), Compression::kbps_128);
+
+		const auto text = metrics_.render(start_);
+
+		EXPECT_THAT(text, HasSubstr("# TYPE soundremote_clients gauge\n"));
+		EXPECT_THAT(text, HasSubstr("soundremote_clients{compression=\"128000\"} 2\n"));
+		EXPECT_THAT(text, HasSubstr("soundremote_clients{compression=\"0\"} 0\n"));
+	}
+
+	TEST_F(MetricsTest, TrafficCountersAndRates) {
+		auto& counters = clients_->compressionCounters(Compression::kbps_64);
+		counters.countSent(10, 1000);
+		counters.countSendError();
+		metrics_.render(start_);
+		counters.countSent(100, 20'000);
+
+		const auto text = metrics_.render(start_ + 2s);
+
+		EXPECT_THAT(text, HasSubstr("soundremote_packets_sent_total{compression=\"64000\"} 110\n"));
+		EXPECT_THAT(text, HasSubstr("soundremote_bytes_sent_total{compression=\"64000\"} 21000\n"));
+		EXPECT_THAT(text, HasSubstr("soundremote_send_errors_total{compression=\"64000\"} 1\n"));
+		EXPECT_THAT(text, HasSubstr("soundremote_packets_per_second{compression=\"64000\"} 50\n"));
+		EXPECT_THAT(text, HasSubstr("soundremote_bytes_per_second{compression=\"64000\"} 10000\n"));
+	}
+
+	TEST_F(MetricsTest, CaptureCounters) {
+		captureCounters_->setBuffered(1920);
+		captureCounters_->countGlitches(2);
+		captureCounters_->countEncodeFailure();
+		captureCounters_->countSilentFrame();
+		captureCounters_->countRingDropped(480);
+
+		const auto text = metrics_.render(start_);
+
+		EXPECT_THAT(text, HasSubstr("soundremote_frame_buffer_bytes 1920\n"));
+		EXPECT_THAT(text, HasSubstr("soundremote_capture_glitches_total 2\n"));
+		EXPECT_THAT(text, HasSubstr("soundremote_dropped_frames_total{reason=\"encode_failed\"} 1\n"));
+		EXPECT_THAT(text, HasSubstr("soundremote_silent_frames_total 1\n"));
+		EXPECT_THAT(text, HasSubstr("soundremote_frame_buffer_dropped_bytes_total 480\n"));
+	}
+
+	TEST_F(MetricsTest, StageQueues) {
+		for (int i = 0; i < 4; ++i) {
+			captureCounters_->countEncodeQueued();
+		}
+		captureCounters_->countEncodeDequeued();
+		captureCounters_->countSendQueued();
+		captureCounters_->countCaptureStall();
+		captureCounters_->countEncodeStall();
+		captureCounters_->countEncodeStall();
+
+		const auto text = metrics_.render(start_);
+
+		EXPECT_THAT(text, HasSubstr("soundremote_queue_depth{stage=\"encode\"} 3\n"));
+		EXPECT_THAT(text, HasSubstr("soundremote_queue_depth{stage=\"send\"} 1\n"));
+		EXPECT_THAT(text, HasSubstr("soundremote_stalls_total{stage=\"capture\"} 1\n"));
+		EXPECT_THAT(text, HasSubstr("soundremote_stalls_total{stage=\"encode\"} 2\n"));
+	}
+
+	TEST_F(MetricsTest, StageLatencies) {
+		pipelineLatency_->record(PipelineLatency::Stage::encode, PipelineLatency::now(), PipelineLatency::now(),
+			Compression::kbps_320);
+
+		const auto text = metrics_.render(start_);
+
+		if constexpr (PipelineLatency::enabled) {
+			EXPECT_THAT(text, HasSubstr(
+				"soundremote_stage_latency_microseconds_count{stage=\"encode\",compression=\"320000\"} 1\n"));
+		} else {
+			EXPECT_THAT(text, ::testing::Not(HasSubstr("soundremote_stage_latency_microseconds")));
+		}
+	}
+}
@@ -1,4 +1,5 @@
 #include <vector>
+#include <set>
 #include <sstream>
 #include <tuple>
 #include <span>
@@ -49,6 +50,20 @@ namespace {
 		EXPECT_EQ(actual, expectedBE);
 	}
 
+	// makeAudioPacket
+	TEST(Net, makeAudioPacket) {
+		std::vector<char> expectedHeaderBE = initPacket({ 0xA5, 0x71, 0x21, 0x00, 0x0D });
+		std::vector<char> expectedSequenceNumberBE = initPacket({ 0xEE, 0x6B, 0x28, 0x00 });
+
+		const auto actual = Net::makeAudioPacket(Category::AudioDataOpus, 4'000'000'000u, audioData);
+
+		EXPECT_EQ(std::vector<char>(actual.header.begin(), actual.header.end()), expectedHeaderBE);
+		EXPECT_EQ(std::vector<char>(actual.sequenceNumber.begin(), actual.sequenceNumber.end()), expectedSequenceNumberBE);
+		// Audio data is referenced, not copied
+		EXPECT_EQ(actual.audioData.data(), audioData.data());
+		EXPECT_EQ(actual.audioData.size(), audioData.size());
+	}
+
 	// createKeepAlivePacket
 	TEST(Net, createKeepAlivePacket) {
 		std::vector<char> expectedBE = initPacket({ 0xA5, 0x71, 0x31, 0 , 0x05 });
@@ -58,6 +73,175 @@ namespace {
 		EXPECT_EQ(actual, expectedBE);
 	}
 
+	TEST(Net, createKeepAlivePacketWithTimestamp) {
+		std::vector<char> expectedBE = initPacket({
+			0xA5, 0x71, 0x31, 0, 0x0D,
+			0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 });
+
+		const auto actual = Net::createKeepAlivePacket(0x0102030405060708u);
+
+		EXPECT_EQ(actual, expectedBE);
+	}
+
+	// createSilencePacket
+	TEST(Net, createSilencePacket) {
+		std::vector<char> expectedBE = initPacket({
+			0xA5, 0x71, 0x22, 0, 0x09,
+			0x01, 0x02, 0x03, 0x04 });
+
+		const auto actual = Net::createSilencePacket(0x01020304u);
+
+		EXPECT_EQ(actual, expectedBE);
+	}
+
+	// getKeepAliveTimestamp
+	TEST(Net, getKeepAliveTimestamp) {
+		auto packet = initPacket({
+			0xA5, 0x71, 0x30, 0, 0x0D,
+			0xF1, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 });
+
+		const auto actual = Net::getKeepAliveTimestamp({ packet.data(), packet.size() });
+
+		EXPECT_EQ(actual, 0xF102030405060708u);
+	}
+
+	TEST(Net, getKeepAliveTimestampEmpty) {
+		auto packet = initPacket({ 0xA5, 0x71, 0x30, 0, 0x05 });
+
+		const auto actual = Net::getKeepAliveTimestamp({ packet.data(), packet.size() });
+
+		EXPECT_FALSE(actual);
+	}
+
+	// getConnectData
+	TEST(Net, getConnectDataWithoutOptions) {
+		auto packet = initPacket({ 0xA5, 0x71, 0x01, 0, 0x09, 0x05, 0xF0, 0xF1, 0x02 });
+
+		const auto actual = Net::getConnectData({ packet.data(), packet.size() });
+
+		ASSERT_TRUE(actual);
+		EXPECT_EQ(actual->protocol, 5);
+		EXPECT_EQ(actual->requestId, 0xF0F1);
+		EXPECT_EQ(actual->compression, 2);
+		EXPECT_EQ(actual->options, 0);
+		EXPECT_EQ(actual->framesPerPacket, 1);
+	}
+
+	TEST(Net, getConnectDataWithOptions) {
+		auto packet = initPacket({ 0xA5, 0x71, 0x01, 0, 0x0A, 0x06, 0xF0, 0xF1, 0x02, 0x01 });
+
+		const auto actual = Net::getConnectData({ packet.data(), packet.size() });
+
+		ASSERT_TRUE(actual);
+		EXPECT_EQ(actual->options, Net::Packet::ConnectOption::parity);
+		EXPECT_EQ(actual->framesPerPacket, 1);
+	}
+
+	TEST(Net, getConnectDataWithFramesPerPacket) {
+		auto packet = initPacket({ 0xA5, 0x71, 0x01, 0, 0x0B, 0x08, 0xF0, 0xF1, 0x02, 0x00, 0x04 });
+
+		const auto actual = Net::getConnectData({ packet.data(), packet.size() });
+
+		ASSERT_TRUE(actual);
+		EXPECT_EQ(actual->options, 0);
+		EXPECT_EQ(actual->framesPerPacket, 4);
+	}
+
+	// getSetFormatData
+	TEST(Net, getSetFormatData) {
+		auto packet = initPacket({ 0xA5, 0x71, 0x03, 0, 0x08, 0xF0, 0xF1, 0x02 });
+
+		const auto actual = Net::getSetFormatData({ packet.data(), packet.size() });
+
+		ASSERT_TRUE(actual);
+		EXPECT_EQ(actual->requestId, 0xF0F1);
+		EXPECT_EQ(actual->compression, 2);
+		EXPECT_EQ(actual->framesPerPacket, 1);
+	}
+
+	TEST(Net, getSetFormatDataWithFramesPerPacket) {
+		auto packet = initPacket({ 0xA5, 0x71, 0x03, 0, 0x09, 0xF0, 0xF1, 0x02, 0x03 });
+
+		const auto actual = Net::getSetFormatData({ packet.data(), packet.size() });
+
+		ASSERT_TRUE(actual);
+		EXPECT_EQ(actual->framesPerPacket, 3);
+	}
+
+	// makeParityPacket
+	TEST(Net, makeParityPacket) {
+		const std::vector<char> parity{ 0x11, 0x22, 0x33 };
+		const ParityGroup group{ 0x01020304u, 0x8000000Bu, 0x0506, parity };
+		const std::vector<char> expectedHeader = initPacket({
+			0xA5, 0x71, 0x23, 0, 0x12,
+			0x01, 0x02, 0x03, 0x04,
+			0x80, 0, 0, 0x0B,
+			0x05, 0x06 });
+
+		const auto actual = Net::makeParityPacket(group);
+
+		EXPECT_EQ(std::vector<char>(actual.header.begin(), actual.header.end()), expectedHeader);
+		EXPECT_EQ(actual.parity.data(), parity.data());
+		EXPECT_EQ(actual.parity.size(), parity.size());
+	}
+
+	// getLossReportData
+	TEST(Net, getLossReportData) {
+		auto packet = initPacket({
+			0xA5, 0x71, 0x32, 0, 0x0E,
+			0, 0, 0x01, 0xF4,
+			0x80, 0, 0, 0x0A,
+			0x02 });
+
+		const auto actual = Net::getLossReportData({ packet.data(), packet.size() });
+
+		ASSERT_TRUE(actual);
+		EXPECT_EQ(actual->received, 500u);
+		EXPECT_EQ(actual->lost, 0x8000000Au);
+		EXPECT_EQ(actual->minCompression, 2);
+	}
+
+	TEST(Net, getLossReportDataShort) {
+		auto packet = initPacket({ 0xA5, 0x71, 0x32, 0, 0x0D, 0, 0, 0x01, 0xF4, 0, 0, 0, 0x0A });
+
+		const auto actual = Net::getLossReportData({ packet.data(), packet.size() });
+
+		EXPECT_FALSE(actual);
+	}
+
+	// getNackSequenceNumbers
+	TEST(Net, getNackSequenceNumbers) {
+		// The partial sequence number at the end is ignored
+		auto packet = initPacket({
+			0xA5, 0x71, 0x33, 0, 0x0F,
+			0, 0, 0x01, 0xF4,
+			0xFF, 0xFF, 0xFF, 0xFF,
+			0, 0 });
+
+		const auto actual = Net::getNackSequenceNumbers({ packet.data(), packet.size() });
+
+		const std::vector<SequenceNumberType> expected{ 500u, 0xFFFFFFFFu };
+		EXPECT_EQ(actual, expected);
+	}
+
+	TEST(Net, getNackSequenceNumbersLimited) {
+		auto packet = initPacket({ 0xA5, 0x71, 0x33, 0, 0x05 });
+		for (int i = 0; i <= Net::Packet::maxNackSequenceNumbers; ++i) {
+			packet.insert(packet.end(), { 0, 0, 0, static_cast<char>(i) });
+		}
+
+		const auto actual = Net::getNackSequenceNumbers({ packet.data(), packet.size() });
+
+		ASSERT_EQ(actual.size(), Net::Packet::maxNackSequenceNumbers);
+		EXPECT_EQ(actual.back(), Net::Packet::maxNackSequenceNumbers - 1u);
+	}
+
+	TEST(Net, getNackSequenceNumbersEmpty) {
+		auto packet = initPacket({ 0xA5, 0x71, 0x33, 0, 0x05 });
+
+		EXPECT_TRUE(Net::getNackSequenceNumbers({ packet.data(), packet.size() }).empty());
+	}
+
 	// createDisconnectPacket
 	TEST(Net, createDisconnectPacket) {
 		std::vector<char> expectedBE = initPacket({ 0xA5, 0x71, 0x02, 0, 0x05 });
@@ -107,6 +291,19 @@ namespace {
 		EXPECT_EQ(actual, expectedBE);
 	}
 
+	TEST(Net, createAckConnectPacketMulticast) {
+		std::vector<char> expectedBE = initPacket({
+			0xA5, 0x71, 0xF0, 0, 0x0F,
+			0xDD, 0xD5, Net::Protocol::multicast, 0, 0, 0,
+			239, 255, 71, 3 });
+
+		RequestIdType requestId = 0xDDD5;
+		const auto actual = Net::createAckConnectPacket(requestId, Net::Protocol::multicast,
+			boost::asio::ip::make_address_v4("239.255.71.3"));
+
+		EXPECT_EQ(actual, expectedBE);
+	}
+
 	// createAckSetFormatPacket
 	TEST(Net, createAckSetFormatPacket) {
 		std::vector<char> expectedBE = initPacket({
@@ -119,6 +316,34 @@ namespace {
 		EXPECT_EQ(actual, expectedBE);
 	}
 
+	TEST(Net, createAckSetFormatPacketMulticast) {
+		std::vector<char> expectedBE = initPacket({
+			0xA5, 0x71, 0xF0, 0, 0x0F,
+			0xF0, 0xF1, 0, 0, 0, 0,
+			239, 255, 71, 1 });
+
+		RequestIdType requestId = 0xF0F1;
+		const auto actual = Net::createAckSetFormatPacket(requestId, boost::asio::ip::make_address_v4("239.255.71.1"));
+
+		EXPECT_EQ(actual, expectedBE);
+	}
+
+	// multicastGroup
+	TEST(Net, multicastGroupIsUniquePerCompression) {
+		const std::vector compressions{
+			Compression::none, Compression::kbps_64, Compression::kbps_128,
+			Compression::kbps_192, Compression::kbps_256, Compression::kbps_320
+		};
+		std::set<boost::asio::ip::address_v4> groups;
+		for (auto&& compression : compressions) {
+			const auto group = Net::multicastGroup(compression);
+			EXPECT_TRUE(group.is_multicast());
+			groups.insert(group);
+		}
+
+		EXPECT_EQ(groups.size(), compressions.size());
+	}
+
 	// getPacketCategory
 	TEST(Net, getPacketCategory) {
 		Net::Packet::Category expected = Net::Packet::Category::Disconnect;
@@ -0,0 +1,61 @@
+#include <map>
+#include <optional>
+#include <string>
+
+#include "pch.h"
+#include "OpusProfile.h"
+#include "Settings.h"
+
+namespace {
+	using namespace Audio::Opus;
+
+	class TestSettings : public Settings {
+	public:
+		void set(const std::string& name, int value) { values_[name] = value; }
+	protected:
+		std::optional<Value> getValue(const std::string& settingName) const override {
+			const auto it = values_.find(settingName);
+			if (it == values_.end()) {
+				return {};
+			}
+			return it->second;
+		}
+	private:
+		std::map<std::string, Value> values_;
+	};
+
+	TEST(OpusProfile, DefaultsWithoutOptions) {
+		EXPECT_EQ(profileFrom(TestSettings()), Profile());
+	}
+
+	TEST(OpusProfile, ReadsOptions) {
+		TestSettings settings;
+		settings.set(Settings::OpusFrameLength, 2'500);
+		settings.set(Settings::OpusComplexity, 3);
+		settings.set(Settings::OpusApplication, 2);
+		settings.set(Settings::OpusMaxBandwidth, 12);
+		settings.set(Settings::OpusBitrateMode, 0);
+		settings.set(Settings::OpusLsbDepth, 16);
+
+		const auto profile = profileFrom(settings);
+
+		EXPECT_EQ(profile.frameLength, FrameLength::ms_2_5);
+		EXPECT_EQ(profile.complexity, 3);
+		EXPECT_EQ(profile.application, Application::lowDelay);
+		EXPECT_EQ(profile.maxBandwidth, Bandwidth::superwideband);
+		EXPECT_EQ(profile.bitrateMode, BitrateMode::cbr);
+		EXPECT_EQ(profile.lsbDepth, 16);
+	}
+
+	TEST(OpusProfile, IgnoresInvalidOptions) {
+		TestSettings settings;
+		settings.set(Settings::OpusFrameLength, 15'000);
+		settings.set(Settings::OpusComplexity, 11);
+		settings.set(Settings::OpusApplication, 3);
+		settings.set(Settings::OpusMaxBandwidth, 10);
+		settings.set(Settings::OpusBitrateMode, -1);
+		settings.set(Settings::OpusLsbDepth, 7);
+
+		EXPECT_EQ(profileFrom(settings), Profile());
+	}
+}
@@ -0,0 +1,67 @@
+#include <memory>
+#include <vector>
+
+#include "pch.h"
+#include "PacketPool.h"
+
+namespace {
+	constexpr size_t bufferCapacity = 100;
+	constexpr size_t initialCount = 4;
+
+	TEST(PacketPool, AcquiresBufferWithFullCapacity) {
+		auto pool = PacketPool::create(bufferCapacity, initialCount);
+
+		const auto packet = pool->acquire();
+
+		EXPECT_EQ(packet->capacity(), bufferCapacity);
+		EXPECT_EQ(packet->size(), bufferCapacity);
+	}
+
+	TEST(PacketPool, ReusesReleasedBuffer) {
+		auto pool = PacketPool::create(bufferCapacity, initialCount);
+		auto packet = pool->acquire();
+		const char* data = packet->data();
+		packet->resize(10);
+
+		packet.reset();
+		const auto reacquired = pool->acquire();
+
+		EXPECT_EQ(reacquired->data(), data);
+		EXPECT_EQ(reacquired->size(), bufferCapacity);
+	}
+
+	TEST(PacketPool, KeepsBufferWhileReferenced) {
+		auto pool = PacketPool::create(bufferCapacity, 1);
+		auto packet = pool->acquire();
+		auto copy = packet;
+
+		packet.reset();
+		const auto other = pool->acquire();
+
+		EXPECT_NE(other.get(), copy.get());
+		EXPECT_EQ(pool->allocatedCount(), 2);
+	}
+
+	TEST(PacketPool, DoesNotGrowInSteadyState) {
+		auto pool = PacketPool::create(bufferCapacity, initialCount);
+
+		for (int i = 0; i < 1000; ++i) {
+			std::vector<PacketPtr> packets;
+			for (size_t j = 0; j < initialCount; ++j) {
+				packets.push_back(pool->acquire());
+			}
+		}
+
+		EXPECT_EQ(pool->allocatedCount(), initialCount);
+	}
+
+	TEST(PacketPool, BufferOutlivesPool) {
+		auto pool = PacketPool::create(bufferCapacity, initialCount);
+		auto packet = pool->acquire();
+
+		pool.reset();
+		packet->data()[0] = 1;
+
+		EXPECT_NO_FATAL_FAILURE(packet.reset());
+	}
+}
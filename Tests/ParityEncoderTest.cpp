@@ -0,0 +1,223 @@
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "pch.h"
+#include "ParityEncoder.h"
+
+namespace {
+	std::vector<char> makePacket(uint32_t sequenceNumber, size_t size) {
+		std::vector<char> result(size);
+		for (size_t i = 0; i < size; ++i) {
+			result[i] = static_cast<char>(sequenceNumber * 31 + i * 7);
+		}
+		return result;
+	}
+
+	TEST(ParityEncoder, RecoversEachPacketOfGroup) {
+		const std::vector<std::vector<char>> packets{ makePacket(0, 120), makePacket(1, 3), makePacket(2, 0),
+			makePacket(3, 257) };
+		ParityEncoder encoder(packets.size());
+		std::optional<ParityGroup> group;
+		for (uint32_t i = 0; i < packets.size(); ++i) {
+			group = encoder.add(i, packets[i]);
+			ASSERT_EQ(group.has_value(), i + 1 == packets.size());
+		}
+		EXPECT_EQ(group->first, 0u);
+		EXPECT_EQ(group->mask, 0b1111u);
+
+		for (size_t missing = 0; missing < packets.size(); ++missing) {
+			std::vector<std::span<const char>> received;
+			for (size_t i = 0; i < packets.size(); ++i) {
+				if (i != missing) {
+					received.emplace_back(packets[i]);
+				}
+			}
+			EXPECT_EQ(ParityEncoder::recover(*group, received), packets[missing]) << "missing " << missing;
+		}
+	}
+
+	TEST(ParityEncoder, StartsEachGroupClean) {
+		ParityEncoder encoder(2);
+		encoder.add(0, makePacket(0, 200));
+		encoder.add(1, makePacket(1, 200));
+		const std::vector<char> next = makePacket(2, 10);
+
+		encoder.add(2, next);
+		const auto group = encoder.add(3, {});
+
+		ASSERT_TRUE(group);
+		EXPECT_EQ(group->parity.size(), next.size());
+		const std::vector<std::span<const char>> received{ std::span<const char>{} };
+		EXPECT_EQ(ParityEncoder::recover(*group, received), next);
+	}
+
+	TEST(ParityEncoder, MasksSequenceGaps) {
+		ParityEncoder encoder(4);
+		encoder.add(10, makePacket(10, 8));
+		encoder.add(12, makePacket(12, 8));
+		encoder.add(13, makePacket(13, 8));
+
+		const auto group = encoder.add(15, makePacket(15, 8));
+
+		ASSERT_TRUE(group);
+		EXPECT_EQ(group->first, 10u);
+		EXPECT_EQ(group->mask, 0b101101u);
+	}
+
+	TEST(ParityEncoder, EndsGroupPastSpan) {
+		ParityEncoder encoder(4);
+		const auto first = makePacket(0xFFFF'FFF0u, 16);
+		encoder.add(0xFFFF'FFF0u, first);
+
+		// Wraps around to 16
+		const auto ended = encoder.add(0xFFFF'FFF0u + ParityEncoder::maxSpan, makePacket(16, 16));
+
+		ASSERT_TRUE(ended);
+		EXPECT_EQ(ended->first, 0xFFFF'FFF0u);
+		EXPECT_EQ(ended->mask, 1u);
+		EXPECT_EQ(std::vector<char>(ended->parity.begin(), ended->parity.end()), first);
+		const auto next = encoder.flush();
+		ASSERT_TRUE(next);
+		EXPECT_EQ(next->first, 16u);
+	}
+
+	TEST(ParityEncoder, EndsGroupOnRepeatedSequence) {
+		ParityEncoder encoder(4);
+		encoder.add(5, makePacket(5, 4));
+		encoder.add(6, makePacket(6, 4));
+
+		const auto ended = encoder.add(6, makePacket(6, 4));
+
+		ASSERT_TRUE(ended);
+		EXPECT_EQ(ended->mask, 0b11u);
+	}
+
+	TEST(ParityEncoder, FlushEndsPartialGroup) {
+		ParityEncoder encoder(4);
+		EXPECT_FALSE(encoder.flush());
+		encoder.add(1, makePacket(1, 4));
+		encoder.add(2, makePacket(2, 4));
+
+		const auto group = encoder.flush();
+
+		ASSERT_TRUE(group);
+		EXPECT_EQ(group->mask, 0b11u);
+		EXPECT_FALSE(encoder.flush());
+	}
+
+	TEST(ParityEncoder, RejectsGroupSizeOutOfRange) {
+		EXPECT_THROW(ParityEncoder(1), std::invalid_argument);
+		EXPECT_THROW(ParityEncoder(ParityEncoder::maxSpan + 1), std::invalid_argument);
+		EXPECT_EQ(ParityEncoder(ParityEncoder::maxSpan).groupSize(), ParityEncoder::maxSpan);
+	}
+
+	// Loss simulation
+
+	constexpr int simulatedPackets = 20'000;
+	constexpr int frameMs = 10;
+
+	struct SimulationResult {
+		int lost = 0;
+		int recovered = 0;
+		// Wait for the parity of the recovered packets, in frames
+		int64_t delaySum = 0;
+		int maxDelay = 0;
+	};
+
+	// Sends the packets and the parity through the channel, rebuilding what the parity allows at the client.
+	// The channel tells if the next packet is lost.
+	SimulationResult simulate(size_t groupSize, const std::function<bool()>& isLost) {
+		std::mt19937 random(7);
+		std::uniform_int_distribution<size_t> sizes(40, 400);
+		ParityEncoder encoder(groupSize);
+		std::vector<std::vector<char>> sent;
+		std::vector<bool> arrived;
+		SimulationResult result;
+		for (uint32_t sequenceNumber = 0; sequenceNumber < simulatedPackets; ++sequenceNumber) {
+			sent.push_back(makePacket(sequenceNumber, sizes(random)));
+			arrived.push_back(!isLost());
+			result.lost += !arrived.back();
+			const auto group = encoder.add(sequenceNumber, sent.back());
+			if (!group || isLost()) {
+				continue;
+			}
+			std::vector<std::span<const char>> received;
+			std::vector<uint32_t> missing;
+			uint32_t last = group->first;
+			for (uint32_t bit = 0; bit < ParityEncoder::maxSpan; ++bit) {
+				if ((group->mask & (1u << bit)) == 0) {
+					continue;
+				}
+				last = group->first + bit;
+				if (arrived[last]) {
+					received.emplace_back(sent[last]);
+				} else {
+					missing.push_back(last);
+				}
+			}
+			if (missing.size() != 1) {
+				continue;
+			}
+			EXPECT_EQ(ParityEncoder::recover(*group, received), sent[missing.front()]);
+			const auto delay = static_cast<int>(last - missing.front());
+			++result.recovered;
+			result.delaySum += delay;
+			result.maxDelay = std::max(result.maxDelay, delay);
+		}
+		return result;
+	}
+
+	// Independent losses
+	std::function<bool()> randomLoss(double probability) {
+		return [random = std::mt19937(11), loss = std::bernoulli_distribution(probability)]() mutable {
+			return loss(random);
+		};
+	}
+
+	// Gilbert-Elliott: every packet of the bad state is lost, the bursts are 1 / leaveBad long on average
+	std::function<bool()> burstLoss(double enterBad, double leaveBad) {
+		return [random = std::mt19937(13), enter = std::bernoulli_distribution(enterBad),
+			leave = std::bernoulli_distribution(leaveBad), bad = false]() mutable {
+			bad = bad ? !leave(random) : enter(random);
+			return bad;
+		};
+	}
+
+	// Records the recovery of each channel in the test report, checks the rebuilt packets and the bounds of the random loss
+	TEST(ParityEncoder, LossSimulation) {
+		struct Channel {
+			std::string name;
+			std::function<bool()> (*make)();
+		};
+		const Channel channels[]{
+			{ "random 2%", [] { return randomLoss(0.02); } },
+			{ "random 5%", [] { return randomLoss(0.05); } },
+			{ "bursts of 2.5", [] { return burstLoss(0.02, 0.4); } }
+		};
+		for (auto&& channel : channels) {
+			for (size_t groupSize : { 3, 5, 10 }) {
+				const auto result = simulate(groupSize, channel.make());
+				const auto rate = result.lost == 0 ? 0.0 : 100.0 * result.recovered / result.lost;
+				const auto averageDelay = result.recovered == 0 ? 0.0
+					: static_cast<double>(result.delaySum) * frameMs / result.recovered;
+				const auto summary = std::format("lost {}, recovered {} ({:.1f}%), delay avg {:.1f} ms, max {} ms",
+					result.lost, result.recovered, rate, averageDelay, result.maxDelay * frameMs);
+				RecordProperty(std::format("{}, group {}", channel.name, groupSize), summary);
+
+				// The parity comes after the last packet of the group
+				EXPECT_LE(result.maxDelay, static_cast<int>(groupSize) - 1);
+				if (channel.name == "random 5%" && groupSize == 5) {
+					// A loss is recovered if the other 4 packets and the parity arrive, 0.95^5 = 77%
+					EXPECT_GT(rate, 70.0);
+					EXPECT_LT(rate, 85.0);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#include "pch.h"
+#include "PipelineLatency.h"
+
+namespace {
+	using Audio::Compression;
+	using Stage = PipelineLatency::Stage;
+
+	TEST(PipelineLatency, RecordsPerCompression) {
+		PipelineLatency latency;
+		const auto from = PipelineLatency::now();
+
+		latency.record(Stage::encode, from, PipelineLatency::now(), Compression::kbps_128);
+		latency.record(Stage::resample, from, PipelineLatency::now());
+
+		if constexpr (PipelineLatency::enabled) {
+			EXPECT_EQ(latency.stats(Stage::encode, Compression::kbps_128).count, 1);
+			EXPECT_EQ(latency.stats(Stage::encode, Compression::kbps_64).count, 0);
+			EXPECT_EQ(latency.stats(Stage::resample).count, 1);
+			// Not per compression
+			EXPECT_EQ(latency.stats(Stage::resample, Compression::kbps_320).count, 1);
+		} else {
+			EXPECT_EQ(latency.stats(Stage::encode, Compression::kbps_128), LatencyStats{});
+			EXPECT_EQ(latency.stats(Stage::resample), LatencyStats{});
+		}
+	}
+}
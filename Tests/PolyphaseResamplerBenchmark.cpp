@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <numbers>
+#include <span>
+#include <vector>
+
+#include "pch.h"
+#include "PolyphaseResampler.h"
+
+// Benchmarks are disabled by default. To run:
+// Tests.exe --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+namespace {
+	using Isa = PolyphaseResampler::Isa;
+	using Quality = PolyphaseResampler::Quality;
+
+	constexpr uint32_t inputRate = 44'100;
+	constexpr uint32_t outputRate = 48'000;
+	constexpr size_t channels = 2;
+	// 10 ms of the input, a typical capture buffer
+	constexpr size_t bufferFrames = inputRate / 100;
+	constexpr int buffersPerRun = 20'000;
+
+	std::vector<float> sine(double frequency, size_t frames) {
+		std::vector<float> result(frames * channels);
+		for (size_t i = 0; i < frames; ++i) {
+			const auto value = static_cast<float>(0.5 * std::sin(2 * std::numbers::pi * frequency * i / inputRate));
+			for (size_t c = 0; c < channels; ++c) {
+				result[i * channels + c] = value;
+			}
+		}
+		return result;
+	}
+
+	double runBuffers(Quality quality, Isa isa) {
+		PolyphaseResampler resampler(inputRate, outputRate, channels, quality, isa);
+		const auto input = sine(1'000, bufferFrames);
+		std::vector<float> output(resampler.maxOutputFrames(bufferFrames) * channels);
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < buffersPerRun; ++i) {
+			resampler.process(input, output);
+		}
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / buffersPerRun;
+	}
+
+	// Signal to the error ratio in dB, against the reference sine computed at the output rate.
+	// The output is aligned with the input, so the reference needs no delay.
+	double snr(Quality quality, double frequency) {
+		PolyphaseResampler resampler(inputRate, outputRate, channels, quality);
+		const auto input = sine(frequency, inputRate);
+		std::vector<float> output(resampler.maxOutputFrames(inputRate) * channels);
+		const auto frames = resampler.process(input, output);
+		double signal = 0, noise = 0;
+		// Skips the silence before the stream
+		for (size_t i = resampler.taps(); i < frames; ++i) {
+			const auto reference = 0.5 * std::sin(2 * std::numbers::pi * frequency * i / outputRate);
+			signal += reference * reference;
+			noise += (output[i * channels] - reference) * (output[i * channels] - reference);
+		}
+		return 10 * std::log10(signal / noise);
+	}
+
+	TEST(PolyphaseResamplerBenchmark, DISABLED_ResampleBuffer) {
+		const std::pair<Quality, const char*> qualities[]{ { Quality::low, "low" }, { Quality::medium, "medium" },
+			{ Quality::high, "high" } };
+		const std::pair<Isa, const char*> isas[]{ { Isa::scalar, "scalar" }, { Isa::sse2, "sse2" },
+			{ Isa::avx2, "avx2" } };
+		std::cout << "44.1 to 48 kHz stereo, 10 ms buffers\n";
+		std::cout << std::setw(8) << "quality" << std::setw(6) << "taps" << std::setw(12) << "1 kHz dB"
+			<< std::setw(12) << "15 kHz dB";
+		for (auto&& [isa, name] : isas) {
+			std::cout << std::setw(12) << name << " ns";
+		}
+		std::cout << '\n';
+		for (auto&& [quality, qualityName] : qualities) {
+			const PolyphaseResampler resampler(inputRate, outputRate, channels, quality);
+			std::cout << std::setw(8) << qualityName << std::setw(6) << resampler.taps() << std::fixed
+				<< std::setprecision(1) << std::setw(12) << snr(quality, 1'000) << std::setw(12) << snr(quality, 15'000)
+				<< std::setprecision(0);
+			for (auto&& [isa, name] : isas) {
+				if (!Simd::supported(isa)) {
+					std::cout << std::setw(15) << "-";
+					continue;
+				}
+				std::cout << std::setw(15) << runBuffers(quality, isa);
+			}
+			std::cout << '\n';
+		}
+	}
+}
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "pch.h"
+#include "PolyphaseResampler.h"
+
+namespace {
+	using Isa = PolyphaseResampler::Isa;
+	using Quality = PolyphaseResampler::Quality;
+
+	std::vector<float> sine(double frequency, uint32_t rate, size_t frames, size_t channels = 1, double amplitude = 0.5) {
+		std::vector<float> result(frames * channels);
+		for (size_t i = 0; i < frames; ++i) {
+			const auto value = amplitude * std::sin(2 * std::numbers::pi * frequency * i / rate);
+			for (size_t c = 0; c < channels; ++c) {
+				result[i * channels + c] = static_cast<float>(value);
+			}
+		}
+		return result;
+	}
+
+	// Processes the input in chunks of the frames, a chunk of 0 takes the whole input
+	std::vector<float> resample(PolyphaseResampler& resampler, const std::vector<float>& input, size_t chunkFrames = 0) {
+		const auto channels = resampler.channels();
+		const auto chunk = chunkFrames == 0 ? input.size() : chunkFrames * channels;
+		std::vector<float> result;
+		std::vector<float> output;
+		for (size_t done = 0; done < input.size(); done += chunk) {
+			const auto part = std::span(input).subspan(done, std::min(chunk, input.size() - done));
+			output.resize(resampler.maxOutputFrames(part.size() / channels) * channels);
+			const auto frames = resampler.process(part, output);
+			result.insert(result.end(), output.begin(), output.begin() + frames * channels);
+		}
+		return result;
+	}
+
+	// Signal to the residual ratio in dB, of the sine of the frequency fitting the samples best
+	double sineSnr(std::span<const float> samples, double frequency, uint32_t rate) {
+		double ss = 0, cc = 0, sc = 0, xs = 0, xc = 0;
+		for (size_t i = 0; i < samples.size(); ++i) {
+			const auto s = std::sin(2 * std::numbers::pi * frequency * i / rate);
+			const auto c = std::cos(2 * std::numbers::pi * frequency * i / rate);
+			ss += s * s;
+			cc += c * c;
+			sc += s * c;
+			xs += samples[i] * s;
+			xc += samples[i] * c;
+		}
+		const auto determinant = ss * cc - sc * sc;
+		const auto a = (xs * cc - xc * sc) / determinant;
+		const auto b = (xc * ss - xs * sc) / determinant;
+		double signal = 0, noise = 0;
+		for (size_t i = 0; i < samples.size(); ++i) {
+			const auto fit = a * std::sin(2 * std::numbers::pi * frequency * i / rate) +
+				b * std::cos(2 * std::numbers::pi * frequency * i / rate);
+			signal += fit * fit;
+			noise += (samples[i] - fit) * (samples[i] - fit);
+		}
+		return 10 * std::log10(signal / noise);
+	}
+
+	TEST(PolyphaseResampler, RejectsUnsupported) {
+		EXPECT_FALSE(PolyphaseResampler::supports(0, 48'000));
+		EXPECT_FALSE(PolyphaseResampler::supports(48'000, 44'123));
+		EXPECT_FALSE(PolyphaseResampler::supports(384'000, 48'000));
+		EXPECT_TRUE(PolyphaseResampler::supports(44'100, 48'000));
+		EXPECT_TRUE(PolyphaseResampler::supports(192'000, 48'000));
+		EXPECT_TRUE(PolyphaseResampler::supports(8'000, 48'000));
+
+		EXPECT_THROW(PolyphaseResampler(48'000, 44'123, 2), std::invalid_argument);
+		EXPECT_THROW(PolyphaseResampler(44'100, 48'000, 0), std::invalid_argument);
+	}
+
+	TEST(PolyphaseResampler, RejectsSmallOutput) {
+		PolyphaseResampler resampler(44'100, 48'000, 2);
+		const std::vector<float> input(2 * 441);
+		std::vector<float> output(2 * 441);
+
+		EXPECT_THROW(resampler.process(input, output), std::length_error);
+	}
+
+	TEST(PolyphaseResampler, OutputFollowsRatio) {
+		PolyphaseResampler resampler(44'100, 48'000, 2);
+		const std::vector<float> input(2 * 441);
+		std::vector<float> output(2 * resampler.maxOutputFrames(441));
+		size_t total = 0;
+
+		for (int i = 0; i < 100; ++i) {
+			total += resampler.process(input, output);
+		}
+
+		// A second less the frames waiting for the filter
+		EXPECT_LE(total, 48'000);
+		EXPECT_GE(total, 48'000 - resampler.taps());
+	}
+
+	TEST(PolyphaseResampler, ChunksDontChangeOutput) {
+		const auto input = sine(1'000, 44'100, 5'000, 2);
+		PolyphaseResampler whole(44'100, 48'000, 2);
+		const auto expected = resample(whole, input);
+
+		for (size_t chunk : { 1, 7, 441, 1'500 }) {
+			PolyphaseResampler resampler(44'100, 48'000, 2);
+
+			EXPECT_EQ(resample(resampler, input, chunk), expected) << "chunk " << chunk;
+		}
+	}
+
+	TEST(PolyphaseResampler, KeepsDc) {
+		for (auto [input, output] : { std::pair{ 44'100u, 48'000u }, { 96'000u, 48'000u }, { 16'000u, 48'000u } }) {
+			PolyphaseResampler resampler(input, output, 1);
+
+			const auto resampled = resample(resampler, std::vector<float>(input / 10, 0.5f));
+
+			// Past the silence before the stream, in the output frames
+			const auto start = resampler.taps() * output / input + 1;
+			for (size_t i = start; i < resampled.size(); ++i) {
+				ASSERT_NEAR(resampled[i], 0.5f, 1e-5f) << input << " to " << output << ", frame " << i;
+			}
+		}
+	}
+
+	TEST(PolyphaseResampler, KeepsSine) {
+		const std::pair<Quality, double> minimumSnrs[]{ { Quality::low, 50 }, { Quality::medium, 70 },
+			{ Quality::high, 90 } };
+		for (auto [quality, minimumSnr] : minimumSnrs) {
+			PolyphaseResampler resampler(44'100, 48'000, 1, quality);
+
+			const auto resampled = resample(resampler, sine(1'000, 44'100, 44'100));
+
+			// Aligned with the input, so the same sine at the output rate fits
+			const auto steady = std::span(resampled).subspan(resampler.taps());
+			EXPECT_GT(sineSnr(steady, 1'000, 48'000), minimumSnr) << "quality " << static_cast<int>(quality);
+		}
+	}
+
+	TEST(PolyphaseResampler, RemovesAboveNyquist) {
+		PolyphaseResampler resampler(96'000, 48'000, 1);
+
+		const auto resampled = resample(resampler, sine(30'000, 96'000, 96'000));
+
+		double power = 0;
+		for (size_t i = resampler.taps(); i < resampled.size(); ++i) {
+			power += resampled[i] * resampled[i];
+		}
+		const auto rms = std::sqrt(power / (resampled.size() - resampler.taps()));
+		// 0.5 amplitude sine is 0.35 RMS, at least 60 dB down
+		EXPECT_LT(rms, 0.35e-3);
+	}
+
+	TEST(PolyphaseResampler, KeepsChannelsApart) {
+		std::vector<float> input = sine(1'000, 44'100, 2'000, 2);
+		for (size_t i = 1; i < input.size(); i += 2) {
+			input[i] = 0.0f;
+		}
+		PolyphaseResampler resampler(44'100, 48'000, 2);
+
+		const auto resampled = resample(resampler, input);
+
+		ASSERT_GT(resampled.size(), 0);
+		for (size_t i = 1; i < resampled.size(); i += 2) {
+			ASSERT_EQ(resampled[i], 0.0f);
+		}
+	}
+
+	TEST(PolyphaseResampler, ResetStartsNewStream) {
+		const auto input = sine(1'000, 44'100, 1'000);
+		PolyphaseResampler resampler(44'100, 48'000, 1);
+		const auto first = resample(resampler, input);
+
+		resampler.reset();
+
+		EXPECT_EQ(resample(resampler, input), first);
+	}
+
+	TEST(PolyphaseResampler, VectorKernelsMatchScalar) {
+		const auto input = sine(3'000, 44'100, 3'000, 2, 0.9);
+		for (auto quality : { Quality::low, Quality::medium, Quality::high }) {
+			PolyphaseResampler scalar(44'100, 48'000, 2, quality, Isa::scalar);
+			const auto expected = resample(scalar, input);
+			for (auto isa : { Isa::sse2, Isa::avx2 }) {
+				if (!Simd::supported(isa)) {
+					continue;
+				}
+				PolyphaseResampler resampler(44'100, 48'000, 2, quality, isa);
+
+				const auto resampled = resample(resampler, input);
+
+				ASSERT_EQ(resampled.size(), expected.size());
+				for (size_t i = 0; i < resampled.size(); ++i) {
+					ASSERT_NEAR(resampled[i], expected[i], 1e-5f) << "isa " << static_cast<int>(isa) << ", sample " << i;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,88 @@
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "pch.h"
+#include "RetransmitRing.h"
+
+namespace {
+	PacketPtr makePacket(PacketPool& pool, uint32_t sequenceNumber) {
+		auto packet = pool.acquire();
+		packet->resize(sizeof(sequenceNumber));
+		std::memcpy(packet->data(), &sequenceNumber, sizeof(sequenceNumber));
+		return packet;
+	}
+
+	TEST(RetransmitRing, FindsStoredPackets) {
+		const auto pool = PacketPool::create(4, 4);
+		RetransmitRing ring(4);
+		const auto first = makePacket(*pool, 10);
+		const auto second = makePacket(*pool, 12);
+
+		ring.store(10, first);
+		ring.store(12, second);
+
+		EXPECT_EQ(ring.find(10), first);
+		EXPECT_EQ(ring.find(12), second);
+		// Not sent
+		EXPECT_FALSE(ring.find(11));
+		EXPECT_FALSE(ring.find(13));
+	}
+
+	TEST(RetransmitRing, ForgetsOlderThanCapacity) {
+		const auto pool = PacketPool::create(4, 4);
+		RetransmitRing ring(4);
+		ring.store(1, makePacket(*pool, 1));
+		ring.store(2, makePacket(*pool, 2));
+
+		// Doesn't take the slot of 2
+		ring.store(5, makePacket(*pool, 5));
+
+		EXPECT_FALSE(ring.find(1));
+		EXPECT_TRUE(ring.find(2));
+		EXPECT_TRUE(ring.find(5));
+		EXPECT_FALSE(ring.find(5 - 4));
+	}
+
+	TEST(RetransmitRing, FindsAcrossWraparound) {
+		const auto pool = PacketPool::create(4, 4);
+		RetransmitRing ring(4);
+		ring.store(0xFFFF'FFFFu, makePacket(*pool, 0xFFFF'FFFFu));
+		ring.store(0, makePacket(*pool, 0));
+
+		EXPECT_TRUE(ring.find(0xFFFF'FFFFu));
+		EXPECT_TRUE(ring.find(0));
+		EXPECT_FALSE(ring.find(0xFFFF'FFFCu));
+	}
+
+	TEST(RetransmitRing, HoldsNoMoreThanCapacity) {
+		const auto pool = PacketPool::create(4, 1);
+		RetransmitRing ring(6);
+
+		for (uint32_t sequenceNumber = 0; sequenceNumber < 1000; ++sequenceNumber) {
+			ring.store(sequenceNumber, makePacket(*pool, sequenceNumber));
+		}
+
+		EXPECT_EQ(ring.capacity(), 8);
+		EXPECT_LE(pool->allocatedCount(), ring.capacity() + 1);
+	}
+
+	TEST(RetransmitRing, ClearReleasesPackets) {
+		const auto pool = PacketPool::create(4, 1);
+		RetransmitRing ring(4);
+		ring.store(1, makePacket(*pool, 1));
+
+		ring.clear();
+
+		EXPECT_FALSE(ring.find(1));
+		// The released buffer is reused
+		makePacket(*pool, 2);
+		EXPECT_EQ(pool->allocatedCount(), 1);
+	}
+
+	TEST(RetransmitRing, RejectsCapacityOutOfRange) {
+		EXPECT_THROW(RetransmitRing(0), std::invalid_argument);
+		EXPECT_THROW(RetransmitRing(RetransmitRing::maxCapacity + 1), std::invalid_argument);
+		EXPECT_EQ(RetransmitRing(RetransmitRing::maxCapacity).capacity(), RetransmitRing::maxCapacity);
+	}
+}
@@ -0,0 +1,46 @@
+#include <chrono>
+
+#include "pch.h"
+#include "RoundTripTime.h"
+
+namespace {
+	using namespace std::chrono_literals;
+
+	TEST(RoundTripTime, NoSamples) {
+		RoundTripTime roundTrip;
+
+		EXPECT_EQ(roundTrip.load(), RoundTripStats{});
+	}
+
+	TEST(RoundTripTime, FirstSample) {
+		RoundTripTime roundTrip;
+
+		roundTrip.addSample(800us);
+
+		const auto stats = roundTrip.load();
+		EXPECT_EQ(stats.samples, 1);
+		EXPECT_EQ(stats.last, 800us);
+		EXPECT_EQ(stats.min, 800us);
+		EXPECT_EQ(stats.average, 800us);
+		EXPECT_EQ(stats.smoothed, 800us);
+		EXPECT_EQ(stats.jitter, 0us);
+	}
+
+	TEST(RoundTripTime, Statistics) {
+		RoundTripTime roundTrip;
+
+		roundTrip.addSample(1000us);
+		roundTrip.addSample(1800us);
+		roundTrip.addSample(600us);
+
+		const auto stats = roundTrip.load();
+		EXPECT_EQ(stats.samples, 3);
+		EXPECT_EQ(stats.last, 600us);
+		EXPECT_EQ(stats.min, 600us);
+		EXPECT_EQ(stats.average, 1133us);
+		// 1000 + (1800 - 1000) / 8 = 1100, 1100 + (600 - 1100) / 8 = 1038
+		EXPECT_EQ(stats.smoothed, 1038us);
+		// 0 + (800 - 0) / 16 = 50, 50 + (1200 - 50) / 16 = 121
+		EXPECT_EQ(stats.jitter, 121us);
+	}
+}
@@ -0,0 +1,62 @@
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "pch.h"
+#include "SampleConverter.h"
+
+// Benchmarks are disabled by default. To run:
+// Tests.exe --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+namespace {
+	using Isa = SampleConverter::Isa;
+
+	constexpr int buffersPerRun = 100'000;
+	// 10 ms of 48 kHz stereo, a typical capture buffer
+	constexpr size_t bufferSamples = 960;
+
+	double runConversions(SampleFormat format, bool dither, Isa isa) {
+		SampleConverter converter(format, dither, isa);
+		std::vector<char> input(bufferSamples * SampleConverter::sampleSize(format));
+		for (size_t i = 0; i < input.size(); ++i) {
+			input[i] = static_cast<char>(i * 37);
+		}
+		std::vector<int16_t> output(bufferSamples);
+		int64_t checksum = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < buffersPerRun; ++i) {
+			converter.convert(input, output);
+			checksum += output[i % bufferSamples];
+		}
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		// Keeps the conversions from being optimized out
+		EXPECT_NE(checksum, INT64_MIN);
+		return elapsed.count() / buffersPerRun;
+	}
+
+	TEST(SampleConverterBenchmark, DISABLED_ConvertBuffer) {
+		const std::pair<SampleFormat, const char*> formats[]{ { SampleFormat::float32, "float32" },
+			{ SampleFormat::int32, "int32" }, { SampleFormat::int24, "int24" } };
+		const std::pair<Isa, const char*> isas[]{ { Isa::scalar, "scalar" }, { Isa::sse2, "sse2" },
+			{ Isa::avx2, "avx2" } };
+		std::cout << std::setw(10) << "format" << std::setw(8) << "dither";
+		for (auto&& [isa, name] : isas) {
+			std::cout << std::setw(12) << name << " ns";
+		}
+		std::cout << '\n';
+		for (auto&& [format, formatName] : formats) {
+			for (auto dither : { false, true }) {
+				std::cout << std::setw(10) << formatName << std::setw(8) << dither << std::fixed << std::setprecision(0);
+				for (auto&& [isa, name] : isas) {
+					if (!Simd::supported(isa)) {
+						std::cout << std::setw(15) << "-";
+						continue;
+					}
+					std::cout << std::setw(15) << runConversions(format, dither, isa);
+				}
+				std::cout << '\n';
+			}
+		}
+	}
+}
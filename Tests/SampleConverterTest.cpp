@@ -0,0 +1,183 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "pch.h"
+#include "SampleConverter.h"
+
+namespace {
+	using Isa = SampleConverter::Isa;
+
+	template <typename T>
+	std::vector<char> toBytes(const std::vector<T>& samples) {
+		std::vector<char> result(samples.size() * sizeof(T));
+		if (!result.empty()) {
+			std::memcpy(result.data(), samples.data(), result.size());
+		}
+		return result;
+	}
+
+	// Packed little endian 24 bit samples
+	std::vector<char> toInt24Bytes(const std::vector<int32_t>& samples) {
+		std::vector<char> result;
+		for (auto sample : samples) {
+			result.push_back(static_cast<char>(sample & 0xFF));
+			result.push_back(static_cast<char>((sample >> 8) & 0xFF));
+			result.push_back(static_cast<char>((sample >> 16) & 0xFF));
+		}
+		return result;
+	}
+
+	std::vector<int16_t> convert(SampleFormat format, const std::vector<char>& input, bool dither = false,
+		Isa isa = Isa::scalar) {
+		SampleConverter converter(format, dither, isa);
+		std::vector<int16_t> output(converter.sampleCount(input.size()));
+		EXPECT_EQ(converter.convert(input, output), output.size());
+		return output;
+	}
+
+	// Input with values in range, out of range and on the rounding halves
+	std::vector<char> randomInput(SampleFormat format, size_t samples) {
+		std::mt19937 random(42);
+		switch (format) {
+		case SampleFormat::float32: {
+			std::uniform_real_distribution<float> distribution(-1.2f, 1.2f);
+			std::vector<float> values(samples);
+			for (size_t i = 0; i < samples; ++i) {
+				values[i] = i % 7 == 0 ? (static_cast<int>(i) - 500) / 32768.0f + 0.5f / 32768.0f : distribution(random);
+			}
+			return toBytes(values);
+		}
+		case SampleFormat::int32: {
+			std::vector<int32_t> values(samples);
+			for (auto& value : values) {
+				value = static_cast<int32_t>(random());
+			}
+			return toBytes(values);
+		}
+		case SampleFormat::int24: {
+			std::vector<int32_t> values(samples);
+			for (auto& value : values) {
+				value = static_cast<int32_t>(random()) >> 8;
+			}
+			return toInt24Bytes(values);
+		}
+		default:
+			return {};
+		}
+	}
+
+	TEST(SampleConverter, ConvertsFloat) {
+		const std::vector<float> input{ 0.0f, 0.5f, -0.5f, 1.0f / 32768, -1.0f, 0.999f };
+
+		const auto output = convert(SampleFormat::float32, toBytes(input));
+
+		EXPECT_EQ(output, (std::vector<int16_t>{ 0, 16384, -16384, 1, -32768, 32735 }));
+	}
+
+	TEST(SampleConverter, ClampsFloat) {
+		const std::vector<float> input{ 1.0f, 2.0f, -2.0f, std::numeric_limits<float>::infinity(),
+			-std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN() };
+
+		const auto output = convert(SampleFormat::float32, toBytes(input));
+
+		EXPECT_EQ(output, (std::vector<int16_t>{ 32767, 32767, -32768, 32767, -32768, -32768 }));
+	}
+
+	TEST(SampleConverter, RoundsHalfToEven) {
+		const std::vector<float> input{ 0.5f / 32768, 1.5f / 32768, -0.5f / 32768, 2.5f / 32768 };
+
+		const auto output = convert(SampleFormat::float32, toBytes(input));
+
+		EXPECT_EQ(output, (std::vector<int16_t>{ 0, 2, 0, 2 }));
+	}
+
+	TEST(SampleConverter, ConvertsInt32) {
+		const std::vector<int32_t> input{ 0, 0x10000, -0x10000, INT32_MAX, INT32_MIN, 0x7FFF8000 };
+
+		const auto output = convert(SampleFormat::int32, toBytes(input));
+
+		EXPECT_EQ(output, (std::vector<int16_t>{ 0, 1, -1, 32767, -32768, 32767 }));
+	}
+
+	TEST(SampleConverter, ConvertsInt24) {
+		const std::vector<int32_t> input{ 0, 0x100, -0x100, 0x7FFFFF, -0x800000, 0x1280 };
+
+		const auto output = convert(SampleFormat::int24, toInt24Bytes(input));
+
+		EXPECT_EQ(output, (std::vector<int16_t>{ 0, 1, -1, 32767, -32768, 0x12 }));
+	}
+
+	TEST(SampleConverter, CopiesInt16) {
+		const std::vector<int16_t> input{ 0, 1, -1, 32767, -32768 };
+
+		EXPECT_EQ(convert(SampleFormat::int16, toBytes(input), true), input);
+	}
+
+	TEST(SampleConverter, IgnoresPartialSample) {
+		const std::vector<float> input{ 0.5f, 0.5f };
+		auto bytes = toBytes(input);
+		bytes.pop_back();
+		SampleConverter converter(SampleFormat::float32, false);
+		std::vector<int16_t> output(2, -1);
+
+		EXPECT_EQ(converter.convert(bytes, output), 1);
+		EXPECT_EQ(output, (std::vector<int16_t>{ 16384, -1 }));
+	}
+
+	TEST(SampleConverter, RejectsUnsupportedFormat) {
+		EXPECT_THROW(SampleConverter(SampleFormat::unsupported, false), std::invalid_argument);
+	}
+
+	// Odd sizes to cover the scalar tails of the vector kernels
+	TEST(SampleConverter, VectorKernelsMatchScalar) {
+		for (auto isa : { Isa::sse2, Isa::avx2 }) {
+			if (!Simd::supported(isa)) {
+				continue;
+			}
+			for (auto format : { SampleFormat::float32, SampleFormat::int32, SampleFormat::int24 }) {
+				for (size_t samples : { 0, 1, 7, 15, 16, 17, 33, 961 }) {
+					const auto input = randomInput(format, samples);
+
+					EXPECT_EQ(convert(format, input, false, isa), convert(format, input))
+						<< "isa " << static_cast<int>(isa) << ", format " << static_cast<int>(format)
+						<< ", samples " << samples;
+				}
+			}
+		}
+	}
+
+	TEST(SampleConverter, DitherStaysWithinLsb) {
+		constexpr size_t samples = 48'000;
+		for (auto isa : { Isa::scalar, Isa::sse2, Isa::avx2 }) {
+			if (!Simd::supported(isa)) {
+				continue;
+			}
+			// Halfway between 100 and 101
+			const std::vector<float> input(samples, 100.5f / 32768);
+
+			const auto output = convert(SampleFormat::float32, toBytes(input), true, isa);
+
+			double sum = 0;
+			for (auto sample : output) {
+				ASSERT_GE(sample, 99);
+				ASSERT_LE(sample, 102);
+				sum += sample;
+			}
+			// The dither is unbiased, on average the output keeps the fraction
+			EXPECT_NEAR(sum / samples, 100.5, 0.02) << "isa " << static_cast<int>(isa);
+		}
+	}
+
+	TEST(SampleConverter, DitherKeepsSilenceQuiet) {
+		const std::vector<float> input(1'000, 0.0f);
+
+		for (auto sample : convert(SampleFormat::float32, toBytes(input), true)) {
+			ASSERT_GE(sample, -1);
+			ASSERT_LE(sample, 1);
+		}
+	}
+}
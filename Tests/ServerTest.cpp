@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "pch.h"
+#include "Clients.h"
+#include "NetUtil.h"
+#include "PacketPool.h"
+#include "Server.h"
+
+#include <boost/asio/ip/multicast.hpp>
+
+namespace {
+	using boost::asio::ip::udp;
+	using namespace std::chrono_literals;
+	using namespace std::placeholders;
+
+	class ServerTest : public testing::Test {
+	protected:
+		std::unique_ptr<Server> makeServer(std::optional<boost::asio::ip::address_v4> multicastInterface,
+			size_t retransmitPackets = 0) {
+			// The port of a socket just closed is free for the server to take
+			udp::socket probe(ioContext_, udp::endpoint(loopback_, 0));
+			serverPort_ = probe.local_endpoint().port();
+			probe.close();
+			auto server = std::make_unique<Server>(receiver_.local_endpoint().port(), serverPort_, ioContext_, clients_,
+				multicastInterface, 0, retransmitPackets);
+			clients_->addClientsListener({
+				std::bind(&Server::onClientsSnapshot, server.get(), _1, _2),
+				std::bind(&Server::onClientsDelta, server.get(), _1)
+			});
+			return server;
+		}
+		PacketPtr makeAudio(const std::vector<char>& audioData) {
+			auto audio = pool_->acquire();
+			audio->resize(audioData.size());
+			std::ranges::copy(audioData, audio->data());
+			return audio;
+		}
+		PacketPtr makeAudio() {
+			return makeAudio(expectedAudio_);
+		}
+		struct Received {
+			Net::Packet::Category category;
+			Net::Packet::SequenceNumberType sequenceNumber = 0;
+			std::vector<char> audioData;
+		};
+		// Gets the next datagram, or nothing if none arrives
+		std::optional<Received> receive() {
+			if (!runUntil([this] { return receiver_.available() > 0; }, 1s)) {
+				return {};
+			}
+			std::vector<unsigned char> datagram(Net::inputPacketSize);
+			const auto size = receiver_.receive(boost::asio::buffer(datagram));
+			Received result{ static_cast<Net::Packet::Category>(datagram[Net::Packet::categoryOffset]) };
+			if (size < Net::Packet::audioDataOffset) {
+				return result;
+			}
+			for (int i = 0; i < Net::Packet::sequenceNumberSize; ++i) {
+				result.sequenceNumber = (result.sequenceNumber << 8) | datagram[Net::Packet::dataOffset + i];
+			}
+			result.audioData.assign(datagram.begin() + Net::Packet::audioDataOffset, datagram.begin() + size);
+			return result;
+		}
+		// Gets the audio data of the datagram, or nothing if none arrives
+		std::vector<char> receiveAudio() {
+			const auto received = receive();
+			return received ? received->audioData : std::vector<char>{};
+		}
+		// Sends a client packet to the server from the address
+		void sendToServer(const boost::asio::ip::address_v4& from, Net::Packet::Category category,
+			const std::vector<uint8_t>& payload) {
+			std::vector<char> packet{ static_cast<char>(0xA5), 0x71, static_cast<char>(category), 0,
+				static_cast<char>(5 + payload.size()) };
+			packet.insert(packet.end(), payload.begin(), payload.end());
+			udp::socket client(ioContext_, udp::endpoint(from, 0));
+			client.send_to(boost::asio::buffer(packet), udp::endpoint(loopback_, serverPort_));
+		}
+		// Sends a Nack for the sequence numbers below 256
+		void sendNack(const boost::asio::ip::address_v4& from, std::initializer_list<uint8_t> sequenceNumbers) {
+			std::vector<uint8_t> payload;
+			for (auto sequenceNumber : sequenceNumbers) {
+				payload.insert(payload.end(), { 0, 0, 0, sequenceNumber });
+			}
+			sendToServer(from, Net::Packet::Category::Nack, payload);
+		}
+		// Runs the network thread until the condition holds or the time is out
+		template<typename Condition>
+		bool runUntil(Condition condition, std::chrono::milliseconds timeout = 5s) {
+			const auto deadline = std::chrono::steady_clock::now() + timeout;
+			while (!condition() && std::chrono::steady_clock::now() < deadline) {
+				ioContext_.run_for(10ms);
+				ioContext_.restart();
+			}
+			return condition();
+		}
+		Audio::Compression compressionOf(const boost::asio::ip::address_v4& address) {
+			const auto stats = clients_->stats();
+			const auto client = std::ranges::find(stats.clients, Net::Address(address), &ClientStats::address);
+			return client == stats.clients.end() ? Audio::Compression::none : client->compression;
+		}
+		static constexpr auto compression = Audio::Compression::kbps_64;
+		const std::vector<char> expectedAudio_{ 1, 2, 3, 4 };
+		const boost::asio::ip::address_v4 loopback_ = boost::asio::ip::address_v4::loopback();
+		boost::asio::io_context ioContext_;
+		std::shared_ptr<Clients> clients_ = std::make_shared<Clients>();
+		std::shared_ptr<PacketPool> pool_ = PacketPool::create(16, 2);
+		udp::socket receiver_{ ioContext_, udp::v4() };
+		unsigned short serverPort_ = 0;
+	};
+
+	TEST_F(ServerTest, SendsAudioToMulticastGroup) {
+		boost::system::error_code ec;
+		receiver_.set_option(udp::socket::reuse_address(true));
+		receiver_.bind(udp::endpoint(udp::v4(), 0));
+		receiver_.set_option(boost::asio::ip::multicast::join_group(Net::multicastGroup(compression), loopback_), ec);
+		if (ec) {
+			GTEST_SKIP() << "Multicast is not available: " << ec.message();
+		}
+		const auto server = makeServer(loopback_);
+		// Nothing listens there, so the audio can only arrive through the group
+		const auto member = boost::asio::ip::make_address_v4("192.0.2.1");
+		clients_->add(member, compression, Net::Protocol::multicast);
+
+		server->sendAudio(compression, 1, makeAudio());
+
+		EXPECT_EQ(receiveAudio(), expectedAudio_);
+		const auto stats = clients_->stats();
+		ASSERT_EQ(stats.clients.size(), 1);
+		EXPECT_EQ(stats.clients.front().traffic.packetsSent, 1);
+	}
+
+	TEST_F(ServerTest, SendsAudioByUnicastWithoutMulticastInterface) {
+		receiver_.bind(udp::endpoint(loopback_, 0));
+		const auto server = makeServer(std::nullopt);
+		clients_->add(loopback_, compression, Net::Protocol::multicast);
+
+		server->sendAudio(compression, 1, makeAudio());
+
+		EXPECT_EQ(receiveAudio(), expectedAudio_);
+	}
+
+	TEST_F(ServerTest, LossStepsOnlyClientsOutsideMulticast) {
+		using Audio::Compression;
+		boost::system::error_code ec;
+		receiver_.set_option(boost::asio::ip::multicast::outbound_interface(loopback_), ec);
+		if (ec) {
+			GTEST_SKIP() << "Multicast is not available: " << ec.message();
+		}
+		receiver_.bind(udp::endpoint(loopback_, 0));
+		const auto server = makeServer(loopback_);
+		// Gets the audio by unicast in the packets of two frames, so its bitrate can step
+		const auto aggregated = loopback_;
+		const auto member = boost::asio::ip::make_address_v4("127.0.0.2");
+		clients_->add(aggregated, Compression::kbps_192, Net::Protocol::aggregation, false, 2);
+		clients_->add(member, Compression::kbps_192, Net::Protocol::lossReport);
+
+		// 80 received, 20 lost, down to kbps_64 allowed
+		for (auto&& address : { member, aggregated }) {
+			sendToServer(address, Net::Packet::Category::LossReport, { 0, 0, 0, 80, 0, 0, 0, 20, 1 });
+		}
+
+		// The reports are handled in order, so the member's one is done by now
+		EXPECT_TRUE(runUntil([&] { return compressionOf(aggregated) == Compression::kbps_128; }));
+		EXPECT_EQ(compressionOf(member), Compression::kbps_192);
+	}
+
+	TEST_F(ServerTest, ResendsNackedAudio) {
+		using Audio::Compression;
+		receiver_.bind(udp::endpoint(loopback_, 0));
+		const auto server = makeServer(std::nullopt, 16);
+		clients_->add(loopback_, Compression::none, Net::Protocol::retransmit);
+		server->sendAudio(Compression::none, 1, makeAudio({ 1 }));
+		server->sendAudio(Compression::none, 2, makeAudio({ 2 }));
+		ASSERT_EQ(receiveAudio(), std::vector<char>{ 1 });
+		ASSERT_EQ(receiveAudio(), std::vector<char>{ 2 });
+
+		// 3 was never sent, so only 2 is resent
+		sendNack(loopback_, { 2, 3 });
+
+		const auto resent = receive();
+		ASSERT_TRUE(resent);
+		EXPECT_EQ(resent->category, Net::Packet::Category::AudioDataUncompressed);
+		EXPECT_EQ(resent->sequenceNumber, 2);
+		EXPECT_EQ(resent->audioData, std::vector<char>{ 2 });
+		EXPECT_FALSE(receive());
+	}
+
+	TEST_F(ServerTest, StopsResendingAtExhaustedBudget) {
+		using Audio::Compression;
+		receiver_.bind(udp::endpoint(loopback_, 0));
+		const auto server = makeServer(std::nullopt, 16);
+		clients_->add(loopback_, Compression::none, Net::Protocol::retransmit);
+		for (uint8_t sequenceNumber = 1; sequenceNumber <= 12; ++sequenceNumber) {
+			server->sendAudio(Compression::none, sequenceNumber, makeAudio());
+			ASSERT_TRUE(receive());
+		}
+
+		sendNack(loopback_, { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 });
+
+		// The burst of the budget, the rest is refused until it refills
+		std::vector<Net::Packet::SequenceNumberType> resent;
+		while (const auto received = receive()) {
+			resent.push_back(received->sequenceNumber);
+		}
+		const std::vector<Net::Packet::SequenceNumberType> expected{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+		EXPECT_EQ(resent, expected);
+	}
+
+	TEST_F(ServerTest, IgnoresNackOfClientWithoutRetransmits) {
+		using Audio::Compression;
+		receiver_.bind(udp::endpoint(loopback_, 0));
+		const auto server = makeServer(std::nullopt, 16);
+		clients_->add(loopback_, Compression::none, Net::Protocol::lossReport);
+		server->sendAudio(Compression::none, 1, makeAudio());
+		ASSERT_TRUE(receive());
+
+		sendNack(loopback_, { 1 });
+
+		EXPECT_FALSE(receive());
+	}
+
+	TEST_F(ServerTest, SendsFramesAggregatedPerClient) {
+		using Audio::Compression;
+		receiver_.bind(udp::endpoint(loopback_, 0));
+		const auto server = makeServer(std::nullopt);
+		clients_->add(loopback_, Compression::none, Net::Protocol::aggregation, false, 2);
+
+		server->sendAudio(Compression::none, 1, makeAudio({ 1 }));
+		server->sendAudio(Compression::none, 2, makeAudio({ 2 }));
+		server->sendAudio(Compression::none, 3, makeAudio({ 3 }));
+		// The partial packet is flushed on the silence
+		server->sendSilence(Compression::none, 4);
+
+		const auto first = receive();
+		ASSERT_TRUE(first);
+		EXPECT_EQ(first->category, Net::Packet::Category::AudioDataUncompressed);
+		EXPECT_EQ(first->sequenceNumber, 1);
+		EXPECT_EQ(first->audioData, (std::vector<char>{ 1, 2 }));
+		const auto partial = receive();
+		ASSERT_TRUE(partial);
+		EXPECT_EQ(partial->category, Net::Packet::Category::AudioDataUncompressed);
+		EXPECT_EQ(partial->sequenceNumber, 3);
+		EXPECT_EQ(partial->audioData, std::vector<char>{ 3 });
+		const auto silence = receive();
+		ASSERT_TRUE(silence);
+		EXPECT_EQ(silence->category, Net::Packet::Category::AudioSilence);
+		EXPECT_FALSE(receive());
+	}
+}
@@ -0,0 +1,56 @@
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "pch.h"
+#include "SilenceDetector.h"
+
+// Benchmarks are disabled by default. To run:
+// Tests.exe --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+namespace {
+	using Isa = SilenceDetector::Isa;
+
+	constexpr int framesPerRun = 200'000;
+	// 10 ms of 48 kHz stereo, a frame of the pipeline
+	constexpr size_t frameSamples = 960;
+
+	// A silent frame is the worst case, all of it is scanned
+	double runDetections(SampleFormat format, Isa isa) {
+		const SilenceDetector detector(format, isa);
+		const std::vector<char> frame(frameSamples * SampleConverter::sampleSize(format));
+		int silent = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < framesPerRun; ++i) {
+			silent += detector.isSilent(frame);
+		}
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		// Keeps the detections from being optimized out
+		EXPECT_EQ(silent, framesPerRun);
+		return elapsed.count() / framesPerRun;
+	}
+
+	TEST(SilenceDetectorBenchmark, DISABLED_SilentFrame) {
+		const std::pair<SampleFormat, const char*> formats[]{ { SampleFormat::int16, "int16" },
+			{ SampleFormat::float32, "float32" } };
+		const std::pair<Isa, const char*> isas[]{ { Isa::scalar, "scalar" }, { Isa::sse2, "sse2" },
+			{ Isa::avx2, "avx2" } };
+		std::cout << std::setw(10) << "format";
+		for (auto&& [isa, name] : isas) {
+			std::cout << std::setw(12) << name << " ns";
+		}
+		std::cout << '\n';
+		for (auto&& [format, formatName] : formats) {
+			std::cout << std::setw(10) << formatName << std::fixed << std::setprecision(0);
+			for (auto&& [isa, name] : isas) {
+				if (!Simd::supported(isa)) {
+					std::cout << std::setw(15) << "-";
+					continue;
+				}
+				std::cout << std::setw(15) << runDetections(format, isa);
+			}
+			std::cout << '\n';
+		}
+	}
+}
@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "pch.h"
+#include "SampleConverter.h"
+#include "SilenceDetector.h"
+
+namespace {
+	using Isa = SilenceDetector::Isa;
+
+	constexpr Isa allIsas[]{ Isa::scalar, Isa::sse2, Isa::avx2 };
+	// Covers the vectors and the scalar tails of each kernel
+	constexpr size_t frameSamples = 41;
+
+	template <typename T>
+	std::vector<char> toBytes(const std::vector<T>& samples) {
+		std::vector<char> result(samples.size() * sizeof(T));
+		if (!result.empty()) {
+			std::memcpy(result.data(), samples.data(), result.size());
+		}
+		return result;
+	}
+
+	// Quiet frame with the sample at each position in turn, all of them must be silent or not
+	template <typename T>
+	void expectAtEachPosition(SampleFormat format, T quiet, T sample, bool silent) {
+		for (auto isa : allIsas) {
+			if (!Simd::supported(isa)) {
+				continue;
+			}
+			const SilenceDetector detector(format, isa);
+			for (size_t position = 0; position < frameSamples; ++position) {
+				std::vector<T> frame(frameSamples, quiet);
+				frame[position] = sample;
+
+				ASSERT_EQ(detector.isSilent(toBytes(frame)), silent)
+					<< "isa " << static_cast<int>(isa) << ", position " << position;
+			}
+		}
+	}
+
+	TEST(SilenceDetector, EmptyIsSilent) {
+		for (auto format : { SampleFormat::int16, SampleFormat::float32 }) {
+			EXPECT_TRUE(SilenceDetector(format, Isa::scalar).isSilent({}));
+		}
+	}
+
+	TEST(SilenceDetector, Int16WithinThreshold) {
+		expectAtEachPosition<int16_t>(SampleFormat::int16, 0, 1, true);
+		expectAtEachPosition<int16_t>(SampleFormat::int16, 1, -1, true);
+		expectAtEachPosition<int16_t>(SampleFormat::int16, 0, 2, false);
+		expectAtEachPosition<int16_t>(SampleFormat::int16, -1, -2, false);
+		expectAtEachPosition<int16_t>(SampleFormat::int16, 0, INT16_MIN, false);
+		expectAtEachPosition<int16_t>(SampleFormat::int16, 0, INT16_MAX, false);
+	}
+
+	TEST(SilenceDetector, FloatWithinThreshold) {
+		constexpr float lsb = 1.0f / 32768;
+		expectAtEachPosition(SampleFormat::float32, 0.0f, lsb, true);
+		expectAtEachPosition(SampleFormat::float32, -0.0f, -lsb, true);
+		expectAtEachPosition(SampleFormat::float32, 0.0f, 1.5f * lsb, false);
+		expectAtEachPosition(SampleFormat::float32, lsb, -1.0f, false);
+		expectAtEachPosition(SampleFormat::float32, 0.0f, std::numeric_limits<float>::quiet_NaN(), false);
+		expectAtEachPosition(SampleFormat::float32, 0.0f, std::numeric_limits<float>::infinity(), false);
+	}
+
+	// The dither of the conversion to int16 doesn't make the silence audio
+	TEST(SilenceDetector, DitheredSilenceIsSilent) {
+		SampleConverter converter(SampleFormat::float32, true, Isa::scalar);
+		const std::vector<float> silence(960, 0.0f);
+		std::vector<int16_t> converted(silence.size());
+		converter.convert(toBytes(silence), converted);
+
+		for (auto isa : allIsas) {
+			if (!Simd::supported(isa)) {
+				continue;
+			}
+			EXPECT_TRUE(SilenceDetector(SampleFormat::int16, isa).isSilent(toBytes(converted)))
+				<< "isa " << static_cast<int>(isa);
+		}
+	}
+
+	TEST(SilenceDetector, IgnoresPartialSample) {
+		const std::vector<char> frame{ 0, 0, 0x7F };
+
+		EXPECT_TRUE(SilenceDetector(SampleFormat::int16, Isa::scalar).isSilent(frame));
+	}
+
+	TEST(SilenceDetector, RejectsUnsupportedFormat) {
+		EXPECT_THROW(SilenceDetector(SampleFormat::int24), std::invalid_argument);
+		EXPECT_THROW(SilenceDetector(SampleFormat::unsupported), std::invalid_argument);
+	}
+}
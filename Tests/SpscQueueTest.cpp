@@ -0,0 +1,81 @@
+#include <memory>
+#include <thread>
+
+#include "pch.h"
+#include "SpscQueue.h"
+
+namespace {
+	TEST(SpscQueue, RoundsCapacityToPowerOfTwo) {
+		SpscQueue<int> queue(5);
+
+		EXPECT_EQ(queue.capacity(), 8);
+		EXPECT_EQ(queue.size(), 0);
+	}
+
+	TEST(SpscQueue, PopsInPushOrder) {
+		SpscQueue<int> queue(4);
+
+		queue.tryPush(1);
+		queue.tryPush(2);
+
+		EXPECT_EQ(queue.size(), 2);
+		EXPECT_EQ(queue.tryPop(), 1);
+		EXPECT_EQ(queue.tryPop(), 2);
+		EXPECT_EQ(queue.tryPop(), std::nullopt);
+	}
+
+	TEST(SpscQueue, RejectsPushWhenFull) {
+		SpscQueue<std::unique_ptr<int>> queue(2);
+		queue.tryPush(std::make_unique<int>(1));
+		queue.tryPush(std::make_unique<int>(2));
+		auto rejected = std::make_unique<int>(3);
+
+		EXPECT_FALSE(queue.tryPush(std::move(rejected)));
+		// Left to the caller
+		ASSERT_NE(rejected, nullptr);
+		EXPECT_EQ(*rejected, 3);
+		EXPECT_EQ(queue.size(), 2);
+	}
+
+	TEST(SpscQueue, WrapsAround) {
+		SpscQueue<int> queue(2);
+
+		for (int i = 0; i < 10; ++i) {
+			ASSERT_TRUE(queue.tryPush(int(i)));
+			EXPECT_EQ(queue.tryPop(), i);
+		}
+	}
+
+	TEST(SpscQueue, ReleasesPoppedElement) {
+		SpscQueue<std::shared_ptr<int>> queue(2);
+		auto element = std::make_shared<int>(1);
+		queue.tryPush(std::shared_ptr(element));
+
+		queue.tryPop();
+
+		EXPECT_EQ(element.use_count(), 1);
+	}
+
+	TEST(SpscQueue, TransfersBetweenThreads) {
+		constexpr int count = 10'000;
+		SpscQueue<int> queue(16);
+
+		std::thread producer([&] {
+			for (int i = 0; i < count;) {
+				if (queue.tryPush(int(i))) {
+					++i;
+				}
+			}
+		});
+		int expected = 0;
+		while (expected < count) {
+			if (const auto value = queue.tryPop()) {
+				EXPECT_EQ(*value, expected);
+				++expected;
+			}
+		}
+		producer.join();
+
+		EXPECT_EQ(queue.size(), 0);
+	}
+}
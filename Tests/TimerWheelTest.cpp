@@ -0,0 +1,69 @@
+#include <chrono>
+#include <vector>
+
+#include "pch.h"
+#include "TimerWheel.h"
+
+namespace {
+	using namespace std::chrono_literals;
+	using Wheel = TimerWheel<int>;
+
+	class TimerWheelTest : public testing::Test {
+	protected:
+		std::vector<int> advance(Wheel::Duration sinceStart) {
+			std::vector<int> due;
+			wheel_.advance(start_ + sinceStart, [&](int key) { due.push_back(key); });
+			return due;
+		}
+		const Wheel::TimePoint start_ = Wheel::Clock::now();
+		Wheel wheel_{ 1s, 4, start_ };
+	};
+
+	TEST_F(TimerWheelTest, NotDueBeforeDeadline) {
+		wheel_.schedule(1, start_ + 1500ms);
+
+		EXPECT_TRUE(advance(1s).empty());
+		EXPECT_EQ(advance(2s), std::vector{ 1 });
+		EXPECT_EQ(wheel_.size(), 0);
+	}
+
+	TEST_F(TimerWheelTest, DeadlineBeyondOneRound) {
+		wheel_.schedule(1, start_ + 6s);
+
+		EXPECT_TRUE(advance(2s).empty());
+		EXPECT_TRUE(advance(5s).empty());
+		EXPECT_EQ(advance(6s), std::vector{ 1 });
+	}
+
+	TEST_F(TimerWheelTest, LongPauseReturnsAllDue) {
+		wheel_.schedule(1, start_ + 1s);
+		wheel_.schedule(2, start_ + 3s);
+		wheel_.schedule(3, start_ + 20s);
+
+		auto due = advance(10s);
+
+		std::ranges::sort(due);
+		EXPECT_EQ(due, (std::vector{ 1, 2 }));
+		EXPECT_EQ(wheel_.size(), 1);
+	}
+
+	TEST_F(TimerWheelTest, PastDeadlineIsDueOnNextAdvance) {
+		advance(5s);
+		wheel_.schedule(1, start_ + 1s);
+
+		EXPECT_EQ(advance(6s), std::vector{ 1 });
+	}
+
+	TEST_F(TimerWheelTest, RescheduleFromCallback) {
+		wheel_.schedule(1, start_ + 1s);
+		int calls = 0;
+
+		wheel_.advance(start_ + 1s, [&](int key) {
+			++calls;
+			wheel_.schedule(key, start_ + 1s);
+		});
+
+		EXPECT_EQ(calls, 1);
+		EXPECT_EQ(advance(2s), std::vector{ 1 });
+	}
+}
@@ -0,0 +1,50 @@
+#include <chrono>
+
+#include "pch.h"
+#include "TokenBucket.h"
+
+namespace {
+	using namespace std::chrono_literals;
+
+	int takeAll(TokenBucket& bucket, TokenBucket::Clock::time_point now) {
+		int taken = 0;
+		while (bucket.tryTake(now)) {
+			++taken;
+		}
+		return taken;
+	}
+
+	TEST(TokenBucket, StartsFull) {
+		const TokenBucket::Clock::time_point start;
+		TokenBucket bucket(20.0, 10.0, start);
+
+		EXPECT_EQ(takeAll(bucket, start), 10);
+	}
+
+	TEST(TokenBucket, RefillsAtRate) {
+		const TokenBucket::Clock::time_point start;
+		TokenBucket bucket(20.0, 10.0, start);
+		takeAll(bucket, start);
+
+		EXPECT_FALSE(bucket.tryTake(start + 40ms));
+		EXPECT_TRUE(bucket.tryTake(start + 50ms));
+		EXPECT_EQ(takeAll(bucket, start + 250ms), 4);
+	}
+
+	TEST(TokenBucket, HoldsUpToBurst) {
+		const TokenBucket::Clock::time_point start;
+		TokenBucket bucket(20.0, 10.0, start);
+		takeAll(bucket, start);
+
+		EXPECT_EQ(takeAll(bucket, start + 1h), 10);
+	}
+
+	TEST(TokenBucket, IgnoresEarlierTime) {
+		const TokenBucket::Clock::time_point start;
+		TokenBucket bucket(20.0, 1.0, start + 1s);
+		takeAll(bucket, start + 1s);
+
+		EXPECT_FALSE(bucket.tryTake(start));
+		EXPECT_TRUE(bucket.tryTake(start + 1s + 50ms));
+	}
+}
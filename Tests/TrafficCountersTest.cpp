@@ -0,0 +1,47 @@
+#include <thread>
+#include <vector>
+
+#include "pch.h"
+#include "TrafficCounters.h"
+
+namespace {
+	TEST(TrafficCounters, LoadsCounts) {
+		TrafficCounters counters;
+		counters.countSent(3, 300);
+		counters.countSendError();
+		counters.countKeepalive();
+		counters.countKeepalive();
+		counters.countFormatChange();
+
+		const TrafficStats expected{ 3, 300, 1, 2, 1 };
+		EXPECT_EQ(counters.load(), expected);
+	}
+
+	// The packets and the bytes of an update are never seen apart
+	TEST(TrafficCounters, LoadsWholeUpdates) {
+		constexpr int writers = 3;
+		constexpr int updates = 100'000;
+		constexpr uint64_t packetSize = 100;
+		TrafficCounters counters;
+		std::vector<std::thread> threads;
+		for (int i = 0; i < writers; ++i) {
+			threads.emplace_back([&] {
+				for (int update = 0; update < updates; ++update) {
+					counters.countSent(1, packetSize);
+				}
+			});
+		}
+
+		uint64_t torn = 0;
+		do {
+			const auto stats = counters.load();
+			torn += stats.bytesSent != stats.packetsSent * packetSize;
+		} while (counters.load().packetsSent < writers * updates);
+		for (auto&& thread : threads) {
+			thread.join();
+		}
+
+		EXPECT_EQ(torn, 0);
+		EXPECT_EQ(counters.load().bytesSent, writers * updates * packetSize);
+	}
+}
@@ -0,0 +1,78 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numbers>
+#include <vector>
+
+#include "pch.h"
+#include "AudioUtil.h"
+#include "EncoderOpus.h"
+#include "WorkerPool.h"
+
+// Benchmarks are disabled by default. To run:
+// Tests.exe --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+namespace {
+	using Audio::Compression;
+
+	constexpr int framesPerRun = 500;
+	constexpr Compression opusCompressions[]{ Compression::kbps_64, Compression::kbps_128, Compression::kbps_192,
+		Compression::kbps_256, Compression::kbps_320 };
+
+	// A second of stereo music-like audio, encoded frame by frame in a loop
+	std::vector<int16_t> makeAudio() {
+		constexpr int sampleRate = 48'000;
+		std::vector<int16_t> audio(2 * sampleRate);
+		for (int i = 0; i < sampleRate; ++i) {
+			const auto t = static_cast<double>(i) / sampleRate;
+			const auto value = 6'000 * std::sin(2 * std::numbers::pi * 220 * t) +
+				3'000 * std::sin(2 * std::numbers::pi * 1'760 * t) + 500 * std::sin(2 * std::numbers::pi * 7'040 * t * t);
+			audio[2 * i] = static_cast<int16_t>(value);
+			audio[2 * i + 1] = static_cast<int16_t>(-value);
+		}
+		return audio;
+	}
+
+	// Wall-clock time from the start of a frame's encodes to the last of them done, like the encoder stage runs them
+	double runEncodes(size_t compressionCount, size_t threads, const std::vector<int16_t>& audio) {
+		std::vector<std::unique_ptr<EncoderOpus>> encoders;
+		for (size_t i = 0; i < compressionCount; ++i) {
+			encoders.push_back(std::make_unique<EncoderOpus>(opusCompressions[i], Audio::Opus::SampleRate::khz_48,
+				Audio::Opus::Channels::stereo));
+		}
+		std::vector<std::vector<char>> packets(compressionCount, std::vector<char>(Audio::Opus::maxPacketSize));
+		const auto frameSamples = 2 * static_cast<size_t>(EncoderOpus::getFrameSize(Audio::Opus::SampleRate::khz_48));
+		const int16_t* frame = nullptr;
+		const std::function<void(size_t)> encode = [&](size_t i) {
+			encoders[i]->encode(reinterpret_cast<const char*>(frame), packets[i].data());
+		};
+		WorkerPool pool(threads - 1);
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < framesPerRun; ++i) {
+			frame = audio.data() + (i * frameSamples) % audio.size();
+			pool.run(compressionCount, encode);
+		}
+		const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / framesPerRun;
+	}
+
+	TEST(WorkerPoolBenchmark, DISABLED_EncodePerFrame) {
+		const auto audio = makeAudio();
+		const size_t threadCounts[]{ 1, 2, 3, 5 };
+		std::cout << std::setw(14) << "compressions";
+		for (auto threads : threadCounts) {
+			std::cout << std::setw(10) << threads << " thr us";
+		}
+		std::cout << '\n';
+		for (size_t compressions = 1; compressions <= std::size(opusCompressions); ++compressions) {
+			std::cout << std::setw(14) << compressions << std::fixed << std::setprecision(1);
+			for (auto threads : threadCounts) {
+				std::cout << std::setw(17) << runEncodes(compressions, threads, audio);
+			}
+			std::cout << '\n';
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "pch.h"
+#include "WorkerPool.h"
+
+namespace {
+	TEST(WorkerPool, RunsEveryTaskOnce) {
+		WorkerPool pool(3);
+		std::vector<std::atomic_int> runs(10);
+
+		pool.run(runs.size(), [&](size_t i) { ++runs[i]; });
+
+		for (auto&& count : runs) {
+			EXPECT_EQ(count, 1);
+		}
+	}
+
+	TEST(WorkerPool, RunsOnWorkers) {
+		constexpr size_t tasks = 4;
+		WorkerPool pool(tasks - 1);
+		std::atomic<size_t> started = 0;
+		std::mutex mutex;
+		std::set<std::thread::id> threads;
+
+		// Each task waits for all the others to start, so they can't run one after another
+		pool.run(tasks, [&](size_t) {
+			++started;
+			while (started < tasks) {
+				std::this_thread::yield();
+			}
+			const std::lock_guard lock(mutex);
+			threads.insert(std::this_thread::get_id());
+		});
+
+		EXPECT_EQ(threads.size(), tasks);
+		EXPECT_TRUE(threads.contains(std::this_thread::get_id()));
+	}
+
+	TEST(WorkerPool, NoWorkersRunsOnCaller) {
+		WorkerPool pool(0);
+		std::vector<std::thread::id> threads;
+
+		pool.run(3, [&](size_t) { threads.push_back(std::this_thread::get_id()); });
+
+		EXPECT_EQ(threads, std::vector(3, std::this_thread::get_id()));
+	}
+
+	TEST(WorkerPool, RunsBatchesInTurn) {
+		WorkerPool pool(2);
+		std::atomic_int sum = 0;
+
+		for (int batch = 0; batch < 1000; ++batch) {
+			pool.run(5, [&](size_t i) { sum += static_cast<int>(i); });
+		}
+
+		EXPECT_EQ(sum, 1000 * 10);
+	}
+
+	TEST(WorkerPool, RethrowsAfterBatch) {
+		WorkerPool pool(2);
+		std::atomic_int runs = 0;
+
+		EXPECT_THROW(pool.run(6, [&](size_t i) {
+			++runs;
+			if (i == 1) { throw std::runtime_error("task"); }
+		}), std::runtime_error);
+		EXPECT_EQ(runs, 6);
+
+		pool.run(2, [&](size_t) { ++runs; });
+		EXPECT_EQ(runs, 8);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "AudioDefines.h"
+
+namespace {
+	TEST(HeaderTest, AudioDefinesCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "BatchSender.h"
+
+namespace {
+	TEST(HeaderTest, BatchSenderCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "CaptureCounters.h"
+
+namespace {
+	TEST(HeaderTest, CaptureCountersCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "CaptureFeeder.h"
+
+namespace {
+	TEST(HeaderTest, CaptureFeederCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "CaptureSource.h"
+
+namespace {
+	TEST(HeaderTest, CaptureSourceCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
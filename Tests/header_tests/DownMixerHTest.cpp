@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "DownMixer.h"
+
+namespace {
+	TEST(HeaderTest, DownMixerCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
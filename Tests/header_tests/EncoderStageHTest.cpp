@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "EncoderStage.h"
+
+namespace {
+	TEST(HeaderTest, EncoderStageCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "EndpointTable.h"
+
+namespace {
+	TEST(HeaderTest, EndpointTableCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "FrameAggregator.h"
+
+namespace {
+	TEST(HeaderTest, FrameAggregatorCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "FrameRing.h"
+
+namespace {
+	TEST(HeaderTest, FrameRingCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "LatencyHistogram.h"
+
+namespace {
+	TEST(HeaderTest, LatencyHistogramCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "LossAdaptation.h"
+
+namespace {
+	TEST(HeaderTest, LossAdaptationCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "Metrics.h"
+
+namespace {
+	TEST(HeaderTest, MetricsCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
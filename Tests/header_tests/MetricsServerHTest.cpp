@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "MetricsServer.h"
+
+namespace {
+	TEST(HeaderTest, MetricsServerCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
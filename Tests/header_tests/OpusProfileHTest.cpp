@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "OpusProfile.h"
+
+namespace {
+	TEST(HeaderTest, OpusProfileCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "PacketPool.h"
+
+namespace {
+	TEST(HeaderTest, PacketPoolCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "ParityEncoder.h"
+
+namespace {
+	TEST(HeaderTest, ParityEncoderCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
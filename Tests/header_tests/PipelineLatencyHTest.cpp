@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "PipelineLatency.h"
+
+namespace {
+	TEST(HeaderTest, PipelineLatencyCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
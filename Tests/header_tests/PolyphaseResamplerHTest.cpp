@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "PolyphaseResampler.h"
+
+namespace {
+	TEST(HeaderTest, PolyphaseResamplerCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "Quantize.h"
+
+namespace {
+	TEST(HeaderTest, QuantizeCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "RetransmitRing.h"
+
+namespace {
+	TEST(HeaderTest, RetransmitRingCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "RoundTripTime.h"
+
+namespace {
+	TEST(HeaderTest, RoundTripTimeCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "SampleConverter.h"
+
+namespace {
+	TEST(HeaderTest, SampleConverterCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "SilenceDetector.h"
+
+namespace {
+	TEST(HeaderTest, SilenceDetectorCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
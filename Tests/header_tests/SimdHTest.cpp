@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "Simd.h"
+
+namespace {
+	TEST(HeaderTest, SimdCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "SpscQueue.h"
+
+namespace {
+	TEST(HeaderTest, SpscQueueCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
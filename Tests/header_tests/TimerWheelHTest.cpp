@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "TimerWheel.h"
+
+namespace {
+	TEST(HeaderTest, TimerWheelCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
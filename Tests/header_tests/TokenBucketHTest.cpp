@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "TokenBucket.h"
+
+namespace {
+	TEST(HeaderTest, TokenBucketCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "TrafficCounters.h"
+
+namespace {
+	TEST(HeaderTest, TrafficCountersCompiles) {
+		EXPECT_TRUE(true);
+	}
+}
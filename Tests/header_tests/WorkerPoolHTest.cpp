@@ -0,0 +1,8 @@
+#include "../pch.h"
+#include "WorkerPool.h"
+
+namespace {
+	TEST(HeaderTest, WorkerPoolCompiles) {
+		EXPECT_TRUE(true);
+	}
+}